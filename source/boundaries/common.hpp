@@ -38,9 +38,14 @@ Author(s): Ilja Honkonen
 #define PAMHD_BOUNDARIES_COMMON_HPP
 
 
+#include "array"
+#include "cstddef"
+#include "functional"
 #include "iterator"
+#include "limits"
 #include "string"
 #include "type_traits"
+#include "unordered_map"
 
 #include "rapidjson/document.h"
 
@@ -496,6 +501,100 @@ size_t find_data(
 }
 
 
+//! Hash of cell positions used by caches of boundary data.
+struct Position_Hash {
+	size_t operator()(const std::array<double, 3>& position) const
+	{
+		const std::hash<double> hasher;
+		size_t ret_val = hasher(position[0]);
+		ret_val ^= hasher(position[1]) + 0x9e3779b97f4a7c15 + (ret_val << 6) + (ret_val >> 2);
+		ret_val ^= hasher(position[2]) + 0x9e3779b97f4a7c15 + (ret_val << 6) + (ret_val >> 2);
+		return ret_val;
+	}
+};
+
+
+/*!
+Caches values of a math expression by position.
+
+Values of expressions that don't depend on time are kept
+until given time index changes, values of time dependent
+expressions are also discarded when time changes.
+Expressions that use variables other than defaults of
+math::Expression (e.g. added with add_expression_variable)
+are always evaluated.
+
+Position of a cell is assumed to uniquely identify it,
+radius, latitude and longitude are assumed to be derived
+from x, y and z. At most max_values values are cached.
+Only used by value boundaries, which are applied every
+step, initial conditions evaluate expressions directly.
+*/
+template<class Variable> class Expression_Cache
+{
+public:
+
+	typename Variable::data_type get_data(
+		math::Expression<Variable>& expression,
+		const size_t& time_index,
+		const double& t,
+		const double& x,
+		const double& y,
+		const double& z,
+		const double& radius,
+		const double& latitude,
+		const double& longitude
+	) {
+		if (not expression.uses_only_default_variables()) {
+			return expression.evaluate(t, x, y, z, radius, latitude, longitude);
+		}
+
+		if (
+			time_index != this->time_index
+			or (expression.is_time_dependent() and t != this->time)
+		) {
+			this->values.clear();
+			this->time_index = time_index;
+			this->time = t;
+		}
+
+		const std::array<double, 3> position{x, y, z};
+		const auto cached = this->values.find(position);
+		if (cached != this->values.end()) {
+			return cached->second;
+		}
+
+		const auto value = expression.evaluate(
+			t, x, y, z, radius, latitude, longitude
+		);
+		if (this->values.size() < max_values) {
+			this->values[position] = value;
+		}
+		return value;
+	}
+
+	static constexpr size_t max_values = size_t(1) << 20;
+
+	void clear()
+	{
+		this->values.clear();
+		this->time_index = std::numeric_limits<size_t>::max();
+	}
+
+
+private:
+
+	std::unordered_map<
+		std::array<double, 3>,
+		typename Variable::data_type,
+		Position_Hash
+	> values;
+
+	size_t time_index = std::numeric_limits<size_t>::max();
+	double time = std::numeric_limits<double>::quiet_NaN();
+};
+
+
 }} // namespaces
 
 #endif // ifndef PAMHD_BOUNDARIES_COMMON_HPP
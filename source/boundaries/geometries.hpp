@@ -36,13 +36,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "algorithm"
+#include "array"
+#include "cmath"
 #include "cstdlib"
 #include "exception"
 #include "iostream"
 #include "limits"
 #include "map"
+#include "stdexcept"
 #include "string"
 #include "utility"
+#include "vector"
 
 #include "rapidjson/document.h"
 
@@ -53,27 +57,92 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace pamhd {
 namespace boundaries {
 
+/*!
+Precomputed data of one cell belonging to a geometry.
+
+Coordinates are those of cell's center, r, lat and lon
+are in the same form that value boundaries and initial
+conditions expect them.
+*/
+template<
+	class Vector,
+	class Scalar,
+	class Cell_Id,
+	class Cell_Data
+> struct Cell_Info
+{
+	Cell_Id id;
+	Cell_Data* data = nullptr;
+	Vector center;
+	Scalar r, lat, lon;
+};
+
+
 /*!
 Vector_T is assumed to be std::array or similar.
+
+If Cell_Data is given then cell info records returned
+by get_cell_info() have pointers of that type to cell data.
 */
 template<
 	class Geometry_Id,
 	class Vector,
 	class Scalar,
-	class Cell_Id
+	class Cell_Id,
+	class Cell_Data = void
 > class Geometries
 {
 public:
 
+	using cell_info_type = Cell_Info<Vector, Scalar, Cell_Id, Cell_Data>;
+
 	Geometries() = default;
 
+	// spatial index isn't copied as it points to geometries of other
 	Geometries(
-		const Geometries<Geometry_Id, Vector, Scalar, Cell_Id>&
-	) = default;
+		const Geometries<Geometry_Id, Vector, Scalar, Cell_Id, Cell_Data>& other
+	) :
+		boxes(other.boxes),
+		spheres(other.spheres),
+		cell_infos(other.cell_infos),
+		cell_infos_valid(other.cell_infos_valid)
+	{}
 
 	Geometries(
-		Geometries<Geometry_Id, Vector, Scalar, Cell_Id>&&
-	) = default;
+		Geometries<Geometry_Id, Vector, Scalar, Cell_Id, Cell_Data>&& other
+	) :
+		boxes(std::move(other.boxes)),
+		spheres(std::move(other.spheres)),
+		cell_infos(std::move(other.cell_infos)),
+		cell_infos_valid(other.cell_infos_valid)
+	{
+		other.index_dirty = true;
+		other.cell_infos_valid = false;
+	}
+
+	Geometries<Geometry_Id, Vector, Scalar, Cell_Id, Cell_Data>& operator=(
+		const Geometries<Geometry_Id, Vector, Scalar, Cell_Id, Cell_Data>& other
+	) {
+		this->boxes = other.boxes;
+		this->spheres = other.spheres;
+		this->cell_infos = other.cell_infos;
+		this->cell_infos_valid = other.cell_infos_valid;
+		this->index_dirty = true;
+		return *this;
+	}
+
+	Geometries<Geometry_Id, Vector, Scalar, Cell_Id, Cell_Data>& operator=(
+		Geometries<Geometry_Id, Vector, Scalar, Cell_Id, Cell_Data>&& other
+	) {
+		this->boxes = std::move(other.boxes);
+		this->spheres = std::move(other.spheres);
+		this->cell_infos = std::move(other.cell_infos);
+		this->cell_infos_valid = other.cell_infos_valid;
+		this->index_dirty = true;
+		other.index_dirty = true;
+		other.cell_infos_valid = false;
+		return *this;
+	}
 
 	Geometries(const rapidjson::Value& object)
 	{
@@ -114,9 +183,11 @@ public:
 			throw std::invalid_argument("geometries item is not an array (\"geometries\": [...]).");
 		}
 
+		this->index_dirty = true;
 		for (rapidjson::SizeType i = 0; i < json_geometries.Size(); i++) {
 			this->boxes.erase(i);
 			this->spheres.erase(i);
+			this->cell_infos.erase(i);
 
 			if (json_geometries[i].HasMember("box")) {
 				this->boxes[i]
@@ -138,40 +209,81 @@ public:
 
 
 	/*!
-	Calls overlaps function of each existing geometry.
+	Calls overlaps function of each geometry whose
+	bounding box overlaps given volume.
 
-	Returns ids of all geometries that overlap given volume.
+	Returns ids of all geometries that overlap given volume
+	in ascending order.
 	*/
 	std::vector<Geometry_Id> overlaps(
 		const Vector& start,
 		const Vector& end,
 		const Cell_Id& cell_id
 	) {
-		std::vector<Geometry_Id> geometry_ids;
-		geometry_ids.reserve(this->boxes.size() + this->spheres.size());
-		for (const auto& box: this->boxes) {
-			geometry_ids.push_back(box.first);
+		std::vector<Geometry_Id> overlapping;
+		this->overlaps(start, end, cell_id, overlapping);
+		return overlapping;
+	}
+
+
+	/*!
+	Same as other overlaps() but writes ids of overlapping
+	geometries into given vector, previous contents of which
+	are removed.
+
+	Doesn't allocate memory after the first call unless
+	geometries have changed or result doesn't have enough
+	capacity.
+	*/
+	void overlaps(
+		const Vector& start,
+		const Vector& end,
+		const Cell_Id& cell_id,
+		std::vector<Geometry_Id>& result
+	) {
+		result.clear();
+		if (this->index_dirty) {
+			this->build_index();
 		}
-		for (const auto& sphere: this->spheres) {
-			geometry_ids.push_back(sphere.first);
+		if (this->index_records.size() == 0) {
+			return;
 		}
 
-		std::vector<Geometry_Id> overlapping;
-		if (geometry_ids.size() == 0) {
-			return overlapping;
+		// collect geometries whose bounding box overlaps given volume
+		this->index_found.clear();
+		std::array<size_t, 64> stack;
+		size_t stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0) {
+			const auto& node = this->index_nodes[stack[--stack_size]];
+			if (not bounds_overlap(node.min, node.max, start, end)) {
+				continue;
+			}
+			if (node.left == 0) {
+				for (size_t i = node.first; i < node.first + node.count; i++) {
+					const auto& record = this->index_records[this->index_order[i]];
+					if (bounds_overlap(record.min, record.max, start, end)) {
+						this->index_found.push_back(this->index_order[i]);
+					}
+				}
+			} else {
+				stack[stack_size++] = node.left + 1;
+				stack[stack_size++] = node.left;
+			}
 		}
 
-		std::sort(geometry_ids.begin(), geometry_ids.end());
+		// records are sorted by geometry id
+		std::sort(this->index_found.begin(), this->index_found.end());
 
-		for (const auto& geometry_id: geometry_ids) {
-
-			if (this->boxes.count(geometry_id) > 0) {
-				if (this->boxes.at(geometry_id).overlaps(start, end, cell_id)) {
-					overlapping.push_back(geometry_id);
+		for (const auto& i: this->index_found) {
+			const auto& record = this->index_records[i];
+			if (record.box != nullptr) {
+				if (record.box->overlaps(start, end, cell_id)) {
+					result.push_back(record.id);
 				}
-			} else if (this->spheres.count(geometry_id) > 0) {
-				if (this->spheres.at(geometry_id).overlaps(start, end, cell_id)) {
-					overlapping.push_back(geometry_id);
+			} else if (record.sphere != nullptr) {
+				if (record.sphere->overlaps(start, end, cell_id)) {
+					result.push_back(record.id);
 				}
 			} else {
 				throw std::out_of_range(
@@ -180,8 +292,42 @@ public:
 				);
 			}
 		}
+	}
 
-		return overlapping;
+
+	/*!
+	Assigns given cells to all geometries they overlap.
+
+	Removes previous cells of all geometries and rebuilds
+	their cell info records afterwards, see update_cell_info().
+
+	Grid is assumed to be a dccrg grid or similar and
+	Cells a range of items with an id member, e.g.
+	grid.local_cells().
+	*/
+	template<class Grid, class Cells> void classify(
+		Grid& grid,
+		const Cells& cells
+	) {
+		for (auto& box: this->boxes) {
+			box.second.clear_cells();
+		}
+		for (auto& sphere: this->spheres) {
+			sphere.second.clear_cells();
+		}
+
+		std::vector<Geometry_Id> overlapping;
+		overlapping.reserve(this->boxes.size() + this->spheres.size());
+		for (const auto& cell: cells) {
+			this->overlaps(
+				grid.geometry.get_min(cell.id),
+				grid.geometry.get_max(cell.id),
+				cell.id,
+				overlapping
+			);
+		}
+
+		this->update_cell_info(grid);
 	}
 
 
@@ -208,6 +354,105 @@ public:
 		} else if (this->spheres.count(geometry) > 0) {
 			this->spheres.at(geometry).clear_cells();
 		}
+		this->cell_infos.erase(geometry);
+	}
+
+
+	/*!
+	Rebuilds cell info records of all geometries.
+
+	Must be called after cells have been assigned to
+	geometries with overlaps() and whenever pointers
+	to cell data in given grid might have changed, e.g.
+	after load balancing or adaptive mesh refinement,
+	see invalidate_cell_info().
+
+	Grid is assumed to be a dccrg grid or similar.
+	*/
+	template<class Grid> void update_cell_info(Grid& grid)
+	{
+		this->cell_infos.clear();
+		this->cell_infos_valid = true;
+		for (const auto& gid: this->get_geometry_ids()) {
+			const auto& cells = this->get_cells(gid);
+			auto& infos = this->cell_infos[gid];
+			infos.reserve(cells.size());
+			for (const auto& cell: cells) {
+				auto* const cell_data = grid[cell];
+				if (cell_data == nullptr) {
+					throw std::out_of_range(
+						std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+						+ "No data for cell " + std::to_string(cell)
+					);
+				}
+
+				const auto c = grid.geometry.get_center(cell);
+				const Scalar r = std::sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
+				cell_info_type info;
+				info.id = cell;
+				info.data = cell_data;
+				info.center = {c[0], c[1], c[2]};
+				info.r = r;
+				info.lat = std::asin(c[2] / r);
+				info.lon = std::atan2(c[1], c[0]);
+				infos.push_back(info);
+			}
+		}
+	}
+
+
+	/*!
+	Marks cell info records of all geometries out of date.
+
+	Must be called before cells of grid change, e.g. before
+	load balancing or adaptive mesh refinement, after which
+	records are rebuilt by classify() or update_cell_info().
+	*/
+	void invalidate_cell_info()
+	{
+		this->cell_infos.clear();
+		this->cell_infos_valid = false;
+	}
+
+
+	/*!
+	Returns cell info records of given geometry id
+	in same order as get_cells().
+
+	Throws an exception if given geometry id doesn't exist
+	or if records haven't been updated since cells
+	of given geometry or grid were last changed.
+	*/
+	const std::vector<cell_info_type>& get_cell_info(
+		const Geometry_Id& geometry
+	) const {
+		const auto& cells = this->get_cells(geometry);
+		if (not this->cell_infos_valid and cells.size() > 0) {
+			throw std::out_of_range(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Cell info of geometry " + std::to_string(geometry)
+				+ " not up to date after grid change, call update_cell_info()"
+			);
+		}
+		if (this->cell_infos.count(geometry) == 0) {
+			if (cells.size() == 0) {
+				return this->no_cell_infos;
+			}
+			throw std::out_of_range(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Cell info of geometry " + std::to_string(geometry)
+				+ " not up to date, call update_cell_info()"
+			);
+		}
+		const auto& infos = this->cell_infos.at(geometry);
+		if (infos.size() != cells.size()) {
+			throw std::out_of_range(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Cell info of geometry " + std::to_string(geometry)
+				+ " not up to date, call update_cell_info()"
+			);
+		}
+		return infos;
 	}
 
 
@@ -240,6 +485,149 @@ private:
 		Sphere<Vector, Scalar, Cell_Id>
 	> spheres;
 
+	std::map<
+		Geometry_Id,
+		std::vector<cell_info_type>
+	> cell_infos;
+
+	// false after grid change until records are rebuilt
+	bool cell_infos_valid = false;
+
+	static inline const std::vector<cell_info_type> no_cell_infos{};
+
+
+	/*
+	Bounding volume hierarchy over boxes and spheres
+	used by overlaps(), rebuilt when geometries change.
+	*/
+
+	struct Index_Record {
+		Geometry_Id id;
+		Vector min, max;
+		Box<Vector, Cell_Id>* box = nullptr;
+		Sphere<Vector, Scalar, Cell_Id>* sphere = nullptr;
+	};
+
+	struct Index_Node {
+		Vector min, max;
+		// children are at left and left + 1, leaf if left == 0
+		size_t left = 0, first = 0, count = 0;
+	};
+
+	//! sorted by geometry id
+	std::vector<Index_Record> index_records;
+	//! records of leaf nodes, index into index_records
+	std::vector<size_t> index_order, index_found;
+	std::vector<Index_Node> index_nodes;
+	bool index_dirty = true;
+
+	static constexpr size_t max_leaf_records = 4;
+
+
+	//! Returns false if given volumes can't overlap
+	static bool bounds_overlap(
+		const Vector& min1,
+		const Vector& max1,
+		const Vector& min2,
+		const Vector& max2
+	) {
+		for (size_t i = 0; i < size_t(min1.size()); i++) {
+			if (min2[i] > max1[i] or max2[i] < min1[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	void build_index()
+	{
+		this->index_records.clear();
+		for (auto& item: this->boxes) {
+			Index_Record record;
+			record.id = item.first;
+			record.min = item.second.start;
+			record.max = item.second.end;
+			record.box = &item.second;
+			this->index_records.push_back(record);
+		}
+		for (auto& item: this->spheres) {
+			Index_Record record;
+			record.id = item.first;
+			record.min = item.second.center;
+			record.max = item.second.center;
+			for (size_t i = 0; i < size_t(record.min.size()); i++) {
+				record.min[i] -= item.second.radius;
+				record.max[i] += item.second.radius;
+			}
+			record.sphere = &item.second;
+			this->index_records.push_back(record);
+		}
+		std::sort(
+			this->index_records.begin(), this->index_records.end(),
+			[](const Index_Record& a, const Index_Record& b) {
+				return a.id < b.id;
+			}
+		);
+
+		this->index_order.resize(this->index_records.size());
+		for (size_t i = 0; i < this->index_order.size(); i++) {
+			this->index_order[i] = i;
+		}
+		this->index_found.clear();
+		this->index_found.reserve(this->index_records.size());
+		this->index_nodes.clear();
+		if (this->index_records.size() > 0) {
+			this->index_nodes.emplace_back();
+			this->build_node(0, 0, this->index_order.size());
+		}
+		this->index_dirty = false;
+	}
+
+
+	//! Splits records [first, first + count) at median of longest dimension
+	void build_node(const size_t node_i, const size_t first, const size_t count)
+	{
+		Index_Node node;
+		node.first = first;
+		node.count = count;
+		node.min = this->index_records[this->index_order[first]].min;
+		node.max = this->index_records[this->index_order[first]].max;
+		for (size_t i = first + 1; i < first + count; i++) {
+			const auto& record = this->index_records[this->index_order[i]];
+			for (size_t d = 0; d < size_t(node.min.size()); d++) {
+				node.min[d] = std::min(node.min[d], record.min[d]);
+				node.max[d] = std::max(node.max[d], record.max[d]);
+			}
+		}
+
+		if (count > max_leaf_records) {
+			size_t dim = 0;
+			for (size_t d = 1; d < size_t(node.min.size()); d++) {
+				if (node.max[d] - node.min[d] > node.max[dim] - node.min[dim]) {
+					dim = d;
+				}
+			}
+			const auto begin = this->index_order.begin() + first;
+			std::nth_element(
+				begin, begin + count / 2, begin + count,
+				[&](const size_t a, const size_t b) {
+					const auto& ra = this->index_records[a];
+					const auto& rb = this->index_records[b];
+					return ra.min[dim] + ra.max[dim] < rb.min[dim] + rb.max[dim];
+				}
+			);
+
+			node.left = this->index_nodes.size();
+			this->index_nodes.emplace_back();
+			this->index_nodes.emplace_back();
+			this->build_node(node.left, first, count / 2);
+			this->build_node(node.left + 1, first + count / 2, count - count / 2);
+		}
+
+		this->index_nodes[node_i] = node;
+	}
+
 };
 
 }} // namespaces
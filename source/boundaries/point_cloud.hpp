@@ -0,0 +1,660 @@
+/*
+Interpolated point cloud data of boundaries of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_BOUNDARIES_POINT_CLOUD_HPP
+#define PAMHD_BOUNDARIES_POINT_CLOUD_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "cstddef"
+#include "cstdint"
+#include "cstring"
+#include "fstream"
+#include "functional"
+#include "iterator"
+#include "limits"
+#include "stdexcept"
+#include "string"
+#include "type_traits"
+#include "unordered_map"
+#include "utility"
+#include "vector"
+
+#include "boundaries/common.hpp"
+
+
+namespace pamhd {
+namespace boundaries {
+
+
+/*!
+Writes point cloud data in format read by Point_Cloud::set_file().
+
+File consists of, in native byte order:
+\verbatim
+char[8]  "pamhdpc1"
+uint64   coordinate type, 1 == x, y, z, 2 == radius, lat, lon
+uint64   number of coordinates in each dimension nx, ny, nz
+uint64   number of time stamps nt
+uint64   size of one value in bytes
+double   x[nx], y[ny], z[nz], time_stamps[nt]
+Data     nt slices of nx*ny*nz values each
+\endverbatim
+where each slice is in same order as data given to Point_Cloud::set().
+*/
+template<class Data> void write_point_cloud_file(
+	const std::string& path,
+	const std::array<std::vector<double>, 3>& coordinates,
+	const int coordinate_type,
+	const std::vector<double>& time_stamps,
+	const std::vector<Data>& data
+) {
+	static_assert(std::is_trivially_copyable<Data>::value);
+
+	const uint64_t slice_size
+		= coordinates[0].size()
+		* coordinates[1].size()
+		* coordinates[2].size();
+	if (data.size() != slice_size * time_stamps.size()) {
+		throw std::invalid_argument(
+			std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+			+ "Wrong amount of data: " + std::to_string(data.size())
+			+ ", should be " + std::to_string(slice_size * time_stamps.size())
+		);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (not file.good()) {
+		throw std::runtime_error(
+			std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+			+ "Couldn't open " + path + " for writing"
+		);
+	}
+
+	const std::array<uint64_t, 6> header{
+		uint64_t(coordinate_type),
+		coordinates[0].size(),
+		coordinates[1].size(),
+		coordinates[2].size(),
+		time_stamps.size(),
+		sizeof(Data)
+	};
+	file.write("pamhdpc1", 8);
+	file.write(reinterpret_cast<const char*>(header.data()), sizeof(header));
+	for (const auto& coordinate: coordinates) {
+		file.write(
+			reinterpret_cast<const char*>(coordinate.data()),
+			coordinate.size() * sizeof(double)
+		);
+	}
+	file.write(
+		reinterpret_cast<const char*>(time_stamps.data()),
+		time_stamps.size() * sizeof(double)
+	);
+	file.write(
+		reinterpret_cast<const char*>(data.data()),
+		data.size() * sizeof(Data)
+	);
+	if (not file.good()) {
+		throw std::runtime_error(
+			std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+			+ "Couldn't write to " + path
+		);
+	}
+}
+
+
+/*!
+Time series of values on a 3d cartesian grid of points.
+
+Data is either kept in memory or read from a file given to
+set_file() one time slice at a time when needed, at most two
+slices are in memory at once.
+
+Values are either those of nearest point and time stamp or
+interpolated trilinearly between points and linearly in time.
+Points to use and their weights are computed once per requested
+position, position is assumed to uniquely identify a cell and
+radius, latitude and longitude to be derived from x, y and z.
+Requests are fastest when positions are given in same order
+every time, e.g. by iterating over cell info records of a
+boundary geometry.
+
+Data outside of grid or time stamps is that of nearest edge.
+*/
+template<class Variable> class Point_Cloud
+{
+public:
+
+	using data_type = typename Variable::data_type;
+
+	Point_Cloud() = default;
+
+	// slices of current time point into data of other
+	Point_Cloud(const Point_Cloud<Variable>& other)
+	{
+		*this = other;
+	}
+
+	Point_Cloud(Point_Cloud<Variable>&& other)
+	{
+		*this = std::move(other);
+	}
+
+	Point_Cloud<Variable>& operator=(const Point_Cloud<Variable>& other)
+	{
+		this->coordinates = other.coordinates;
+		this->coordinate_type = other.coordinate_type;
+		this->time_stamps = other.time_stamps;
+		this->linear = other.linear;
+		this->slice_size = other.slice_size;
+		this->data = other.data;
+		this->file_path = other.file_path;
+		this->data_offset = other.data_offset;
+		this->buffers = other.buffers;
+		this->loaded = other.loaded;
+		this->stencils = other.stencils;
+		this->stencil_indices = other.stencil_indices;
+		this->next_stencil = other.next_stencil;
+		this->reset_time();
+		return *this;
+	}
+
+	Point_Cloud<Variable>& operator=(Point_Cloud<Variable>&& other)
+	{
+		this->coordinates = std::move(other.coordinates);
+		this->coordinate_type = other.coordinate_type;
+		this->time_stamps = std::move(other.time_stamps);
+		this->linear = other.linear;
+		this->slice_size = other.slice_size;
+		this->data = std::move(other.data);
+		this->file_path = std::move(other.file_path);
+		this->data_offset = other.data_offset;
+		this->buffers = std::move(other.buffers);
+		this->loaded = other.loaded;
+		this->stencils = std::move(other.stencils);
+		this->stencil_indices = std::move(other.stencil_indices);
+		this->next_stencil = other.next_stencil;
+		this->reset_time();
+		other.clear();
+		return *this;
+	}
+
+	/*!
+	Sets data kept in memory.
+
+	Data is in order x[0],y[0],z[0],t[0]; x[1],y[0],z[0],t[0]; ...
+	or same with radius, lat and lon instead of x, y and z if
+	coordinate_type == 2.
+	*/
+	void set(
+		std::array<std::vector<double>, 3> given_coordinates,
+		const int given_coordinate_type,
+		std::vector<double> given_time_stamps,
+		std::vector<data_type> given_data,
+		const bool given_linear
+	) {
+		this->clear();
+		this->coordinates = std::move(given_coordinates);
+		this->coordinate_type = given_coordinate_type;
+		this->time_stamps = std::move(given_time_stamps);
+		this->data = std::move(given_data);
+		this->linear = given_linear;
+		this->check();
+
+		if (this->data.size() != this->slice_size * this->time_stamps.size()) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Lengths of time stamps * coordinates and data don't match: "
+				+ std::to_string(this->slice_size * this->time_stamps.size())
+				+ " vs " + std::to_string(this->data.size())
+			);
+		}
+	}
+
+
+	/*!
+	Sets data to be read from given file when needed.
+
+	Reads coordinates and time stamps from file immediately,
+	see write_point_cloud_file() for format of file.
+	*/
+	void set_file(const std::string& path, const bool given_linear)
+	{
+		static_assert(std::is_trivially_copyable<data_type>::value);
+
+		this->clear();
+		this->file_path = path;
+		this->linear = given_linear;
+
+		std::ifstream file(path, std::ios::binary);
+		if (not file.good()) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Couldn't open point cloud file " + path
+			);
+		}
+
+		std::array<char, 8> magic{};
+		std::array<uint64_t, 6> header{};
+		file.read(magic.data(), magic.size());
+		file.read(reinterpret_cast<char*>(header.data()), sizeof(header));
+		if (not file.good() or std::memcmp(magic.data(), "pamhdpc1", 8) != 0) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ path + " isn't a point cloud file"
+			);
+		}
+		if (header[5] != sizeof(data_type)) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Size of values in " + path + " is " + std::to_string(header[5])
+				+ " bytes instead of " + std::to_string(sizeof(data_type))
+				+ " for variable " + Variable::get_name()
+			);
+		}
+
+		this->coordinate_type = int(header[0]);
+		for (size_t dim = 0; dim < 3; dim++) {
+			this->coordinates[dim].resize(header[dim + 1]);
+			file.read(
+				reinterpret_cast<char*>(this->coordinates[dim].data()),
+				this->coordinates[dim].size() * sizeof(double)
+			);
+		}
+		this->time_stamps.resize(header[4]);
+		file.read(
+			reinterpret_cast<char*>(this->time_stamps.data()),
+			this->time_stamps.size() * sizeof(double)
+		);
+		if (not file.good()) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Couldn't read header of " + path
+			);
+		}
+		this->data_offset = file.tellg();
+		this->check();
+	}
+
+
+	const std::vector<double>& get_time_stamps() const
+	{
+		return this->time_stamps;
+	}
+
+
+	data_type get_data(
+		const double& t,
+		const double& x,
+		const double& y,
+		const double& z,
+		const double& radius,
+		const double& latitude,
+		const double& longitude
+	) {
+		if (this->time_stamps.size() == 0) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + ") "
+				+ " Empty time series for variable " + Variable::get_name()
+			);
+		}
+
+		if (t != this->time) {
+			this->set_time(t);
+		}
+
+		const auto& stencil = this->get_stencil(
+			{x, y, z},
+			[&]() -> std::array<double, 3> {
+				if (this->coordinate_type == 2) {
+					return {radius, latitude, longitude};
+				}
+				return {x, y, z};
+			}
+		);
+
+		const auto* const slice0 = this->slices[0];
+		if (stencil.count == 1 and this->time_weight == 0) {
+			return slice0[stencil.index[0]];
+		}
+
+		if constexpr (is_interpolable()) {
+			data_type value{};
+			for (size_t i = 0; i < stencil.count; i++) {
+				add_scaled(
+					value,
+					slice0[stencil.index[i]],
+					stencil.weight[i] * (1 - this->time_weight)
+				);
+			}
+			if (this->time_weight > 0) {
+				const auto* const slice1 = this->slices[1];
+				for (size_t i = 0; i < stencil.count; i++) {
+					add_scaled(
+						value,
+						slice1[stencil.index[i]],
+						stencil.weight[i] * this->time_weight
+					);
+				}
+			}
+			return value;
+		} else {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Internal error"
+			);
+		}
+	}
+
+
+	void clear()
+	{
+		this->coordinates = {};
+		this->coordinate_type = -1;
+		this->time_stamps.clear();
+		this->data.clear();
+		this->file_path.clear();
+		this->slice_size = 0;
+		this->loaded = {
+			std::numeric_limits<size_t>::max(),
+			std::numeric_limits<size_t>::max()
+		};
+		this->reset_time();
+		this->clear_stencils();
+	}
+
+
+	/*!
+	Removes precomputed points and weights, e.g. after
+	cells have been refined or moved to other processes.
+	*/
+	void clear_stencils()
+	{
+		this->stencils.clear();
+		this->stencil_indices.clear();
+		this->next_stencil = 0;
+	}
+
+
+	static constexpr size_t max_stencils = size_t(1) << 20;
+
+
+private:
+
+	struct Stencil {
+		std::array<double, 3> position;
+		std::array<size_t, 8> index;
+		std::array<double, 8> weight;
+		size_t count = 0;
+	};
+
+	std::array<std::vector<double>, 3> coordinates;
+	int coordinate_type = -1; // cartesian == 1, geographic == 2
+	std::vector<double> time_stamps;
+	bool linear = false;
+	size_t slice_size = 0;
+
+	// all data if not read from file
+	std::vector<data_type> data;
+
+	// slices read from file
+	std::string file_path;
+	std::streamoff data_offset = 0;
+	std::array<std::vector<data_type>, 2> buffers;
+	std::array<size_t, 2> loaded{
+		std::numeric_limits<size_t>::max(),
+		std::numeric_limits<size_t>::max()
+	};
+
+	// slices of current time, second used if time_weight > 0
+	std::array<const data_type*, 2> slices{nullptr, nullptr};
+	double time = std::numeric_limits<double>::quiet_NaN(), time_weight = 0;
+
+	std::vector<Stencil> stencils;
+	std::unordered_map<std::array<double, 3>, size_t, Position_Hash> stencil_indices;
+	size_t next_stencil = 0;
+
+
+	static constexpr bool is_interpolable()
+	{
+		if constexpr (std::is_floating_point<data_type>::value) {
+			return true;
+		} else if constexpr (std::is_class<data_type>::value) {
+			return std::is_floating_point<
+				typename std::remove_cvref<decltype(std::declval<data_type>()[0])>::type
+			>::value;
+		} else {
+			return false;
+		}
+	}
+
+	static void add_scaled(data_type& result, const data_type& value, const double weight)
+	{
+		if constexpr (std::is_floating_point<data_type>::value) {
+			result += weight * value;
+		} else {
+			for (size_t i = 0; i < size_t(value.size()); i++) {
+				result[i] += weight * value[i];
+			}
+		}
+	}
+
+
+	void check()
+	{
+		if (this->coordinate_type != 1 and this->coordinate_type != 2) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Invalid coordinate type: " + std::to_string(this->coordinate_type)
+			);
+		}
+		for (const auto& coordinate: this->coordinates) {
+			if (coordinate.size() == 0) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "No coordinates in some dimension"
+				);
+			}
+			if (not std::is_sorted(coordinate.cbegin(), coordinate.cend())) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "Coordinates aren't sorted in non-descending order"
+				);
+			}
+		}
+		if (not std::is_sorted(this->time_stamps.cbegin(), this->time_stamps.cend())) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Time stamps aren't sorted in non-descending order"
+			);
+		}
+		if (this->linear and not is_interpolable()) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Can't interpolate values of variable " + Variable::get_name()
+			);
+		}
+		this->slice_size
+			= this->coordinates[0].size()
+			* this->coordinates[1].size()
+			* this->coordinates[2].size();
+	}
+
+
+	/*!
+	Returns indices of values before and after given coordinate
+	and weight of latter, or nearest index with zero weight.
+	*/
+	std::pair<size_t, double> bracket(
+		const std::vector<double>& values,
+		const double& value
+	) const {
+		const auto after = std::lower_bound(values.cbegin(), values.cend(), value);
+		if (after == values.cbegin()) {
+			return {0, 0.0};
+		}
+		if (after == values.cend()) {
+			return {values.size() - 1, 0.0};
+		}
+		const auto before = after - 1;
+		const size_t before_i = size_t(std::distance(values.cbegin(), before));
+		if (this->linear) {
+			return {before_i, (value - *before) / (*after - *before)};
+		}
+		if (std::abs(value - *before) <= std::abs(value - *after)) {
+			return {before_i, 0.0};
+		}
+		return {before_i + 1, 0.0};
+	}
+
+
+	//! Slices are found again for next requested time
+	void reset_time()
+	{
+		this->slices = {nullptr, nullptr};
+		this->time = std::numeric_limits<double>::quiet_NaN();
+		this->time_weight = 0;
+	}
+
+
+	void set_time(const double& t)
+	{
+		const auto [time_i, weight] = this->bracket(this->time_stamps, t);
+		this->time_weight = weight;
+		this->slices[0] = this->get_slice(time_i, time_i + 1);
+		if (weight > 0) {
+			this->slices[1] = this->get_slice(time_i + 1, time_i);
+		}
+		this->time = t;
+	}
+
+
+	//! Returns given time slice, keeps slice keep if loaded
+	const data_type* get_slice(const size_t& time_i, const size_t& keep)
+	{
+		if (this->file_path == "") {
+			return this->data.data() + time_i * this->slice_size;
+		}
+
+		for (size_t i = 0; i < this->loaded.size(); i++) {
+			if (this->loaded[i] == time_i) {
+				return this->buffers[i].data();
+			}
+		}
+
+		const size_t buffer_i = (this->loaded[0] == keep) ? 1 : 0;
+
+		std::ifstream file(this->file_path, std::ios::binary);
+		file.seekg(
+			this->data_offset
+			+ std::streamoff(time_i * this->slice_size * sizeof(data_type))
+		);
+		auto& buffer = this->buffers[buffer_i];
+		buffer.resize(this->slice_size);
+		file.read(
+			reinterpret_cast<char*>(buffer.data()),
+			buffer.size() * sizeof(data_type)
+		);
+		if (not file.good()) {
+			this->loaded[buffer_i] = std::numeric_limits<size_t>::max();
+			throw std::runtime_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Couldn't read time slice " + std::to_string(time_i)
+				+ " from " + this->file_path
+			);
+		}
+		this->loaded[buffer_i] = time_i;
+		return buffer.data();
+	}
+
+
+	template<class Get_Coordinate> const Stencil& get_stencil(
+		const std::array<double, 3>& position,
+		const Get_Coordinate& get_coordinate
+	) {
+		if (
+			this->next_stencil < this->stencils.size()
+			and this->stencils[this->next_stencil].position == position
+		) {
+			return this->stencils[this->next_stencil++];
+		}
+
+		const auto cached = this->stencil_indices.find(position);
+		if (cached != this->stencil_indices.end()) {
+			this->next_stencil = cached->second + 1;
+			return this->stencils[cached->second];
+		}
+
+		const auto coordinate = get_coordinate();
+		std::array<std::pair<size_t, double>, 3> brackets;
+		for (size_t dim = 0; dim < 3; dim++) {
+			brackets[dim] = this->bracket(this->coordinates[dim], coordinate[dim]);
+		}
+
+		Stencil stencil;
+		stencil.position = position;
+		for (size_t corner = 0; corner < 8; corner++) {
+			double weight = 1;
+			std::array<size_t, 3> index;
+			for (size_t dim = 0; dim < 3; dim++) {
+				const bool upper = (corner >> dim) & 1;
+				weight *= upper ? brackets[dim].second : 1 - brackets[dim].second;
+				index[dim] = brackets[dim].first + (upper ? 1 : 0);
+			}
+			if (weight == 0) {
+				continue;
+			}
+			stencil.index[stencil.count]
+				= index[0]
+				+ index[1] * this->coordinates[0].size()
+				+ index[2] * this->coordinates[0].size() * this->coordinates[1].size();
+			stencil.weight[stencil.count] = weight;
+			stencil.count++;
+		}
+
+		if (this->stencils.size() >= max_stencils) {
+			this->stencils.clear();
+			this->stencil_indices.clear();
+		}
+		this->stencil_indices[position] = this->stencils.size();
+		this->stencils.push_back(stencil);
+		this->next_stencil = this->stencils.size();
+		return this->stencils.back();
+	}
+};
+
+
+}} // namespaces
+
+#endif // ifndef PAMHD_BOUNDARIES_POINT_CLOUD_HPP
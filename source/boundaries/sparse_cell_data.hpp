@@ -0,0 +1,434 @@
+/*
+Sparse storage of cell variables used only in some cells of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_BOUNDARIES_SPARSE_CELL_DATA_HPP
+#define PAMHD_BOUNDARIES_SPARSE_CELL_DATA_HPP
+
+
+#include "cstdint"
+#include "cstring"
+#include "stdexcept"
+#include "string"
+#include "tuple"
+#include "type_traits"
+#include "unordered_map"
+#include "unordered_set"
+#include "utility"
+#include "vector"
+
+#include "mpi.h"
+
+
+namespace pamhd {
+namespace boundaries {
+
+
+/*! Stores variables only in cells that need them.
+
+For variables like boundary data that are used only in cells of
+boundary geometries. allocate() creates data with default values
+in all local cells, retain() removes data of cells that aren't
+in any boundary geometry, e.g. after initial conditions have been
+applied to every cell. Getters throw if given cell doesn't have
+data, find() can be used in cells that might not have data.
+
+Data is stored by cell id and kept with cells through load
+balancing and adaptive mesh refinement by calling
+before_grid_change() before cells change and after_grid_change()
+afterwards. Data must not be accessed in between. Children of
+refined cells get copies of their parent's data and parent of
+unrefined cells gets data of its child with smallest id, call
+retain() afterwards if only some of them should keep data. Data
+of other removed cells is discarded.
+
+Cell is the type of data stored in grid cells, variables' data
+must be trivially copyable.
+
+Example:
+\verbatim
+pamhd::boundaries::Sparse_Cell_Data<Cell, Bdy_Temperature> bdy_data;
+const auto Bdy_T = bdy_data.getter<Bdy_Temperature>();
+// initial condition in all cells
+bdy_data.allocate(grid);
+for (const auto& cell: grid.local_cells()) {
+	Bdy_T(*cell.data) = 1;
+}
+...
+bdy_data.retain(grid, geometries);
+\endverbatim
+*/
+template<class Cell, class... Variables> class Sparse_Cell_Data
+{
+	static_assert(
+		(std::is_trivially_copyable_v<typename Variables::data_type> and ...),
+		"Variables of sparse cell data must be trivially copyable"
+	);
+
+public:
+
+	using values_type = std::tuple<typename Variables::data_type...>;
+
+	//! Returns data of given variable like Variable_Getter.
+	template<class Variable> class Getter
+	{
+	public:
+		Getter(Sparse_Cell_Data& given) : storage(&given) {}
+
+		Variable::data_type& data(Cell& cell_data) const
+		{
+			return this->storage->template get<Variable>(cell_data);
+		}
+
+		Variable::data_type& operator()(Cell& cell_data) const
+		{
+			return this->data(cell_data);
+		}
+
+		Variable type() const { return Variable{}; }
+
+	private:
+		Sparse_Cell_Data* storage;
+	};
+
+
+	/*!
+	Returns data of given variable in given cell.
+
+	Throws if given cell doesn't have data.
+	*/
+	template<class Variable> Variable::data_type& get(Cell& cell_data)
+	{
+		auto* const data = this->find<Variable>(cell_data);
+		if (data == nullptr) {
+			throw std::runtime_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Cell doesn't have sparse data"
+			);
+		}
+		return *data;
+	}
+
+	/*!
+	Returns data of given variable in given cell.
+
+	Returns nullptr if given cell doesn't have data.
+	*/
+	template<class Variable> Variable::data_type* find(const Cell& cell_data)
+	{
+		const auto id = this->ids.find(&cell_data);
+		if (id == this->ids.end()) {
+			return nullptr;
+		}
+		const auto entry = this->entries.find(id->second);
+		if (entry == this->entries.end()) {
+			return nullptr;
+		}
+		return &std::get<index_of<Variable>()>(entry->second.values);
+	}
+
+	//! Returns getter of given variable usable in place of Variable_Getter.
+	template<class Variable> Getter<Variable> getter()
+	{
+		return Getter<Variable>(*this);
+	}
+
+	//! Returns true if given cell has data.
+	bool contains(const Cell& cell_data) const
+	{
+		const auto id = this->ids.find(&cell_data);
+		return id != this->ids.end() and this->entries.count(id->second) > 0;
+	}
+
+	//! Returns number of cells with data.
+	size_t size() const
+	{
+		return this->entries.size();
+	}
+
+	/*!
+	Adds default initialized data to local cells without data.
+	*/
+	template<class Grid> void allocate(Grid& grid)
+	{
+		for (const auto& cell: grid.local_cells()) {
+			this->entries.try_emplace(cell.id);
+		}
+		this->index(grid);
+	}
+
+	/*!
+	Removes data of cells that aren't local or in any geometry.
+
+	Cells must have been assigned to geometries after last
+	change of grid, e.g. by Geometries::classify().
+	*/
+	template<class Grid, class Geometries> void retain(
+		Grid& grid,
+		const Geometries& geometries
+	) {
+		std::unordered_set<uint64_t> keep;
+		for (const auto& gid: geometries.get_geometry_ids()) {
+			const auto& cells = geometries.get_cells(gid);
+			keep.insert(cells.cbegin(), cells.cend());
+		}
+
+		std::unordered_map<uint64_t, Entry> kept;
+		for (const auto& cell: grid.local_cells()) {
+			const auto iter = this->entries.find(cell.id);
+			if (iter == this->entries.end() or keep.count(cell.id) == 0) {
+				continue;
+			}
+			kept[cell.id] = std::move(iter->second);
+		}
+		this->entries = std::move(kept);
+		this->index(grid);
+	}
+
+	/*!
+	Detaches data from cells of grid before they change.
+
+	Data of remote cells is discarded.
+	*/
+	template<class Grid> void before_grid_change(Grid& grid)
+	{
+		this->detached.clear();
+		for (const auto& cell: grid.local_cells()) {
+			const auto iter = this->entries.find(cell.id);
+			if (iter == this->entries.end()) {
+				continue;
+			}
+			this->detached.emplace_back(cell.id, std::move(iter->second.values));
+		}
+		this->entries.clear();
+		this->ids.clear();
+	}
+
+	/*!
+	Attaches data detached by before_grid_change() to cells.
+
+	Data of cells that moved to another process is sent
+	to their new owner, data of refined and unrefined cells
+	to owners of their children and parent respectively.
+	Must be called by all processes.
+	*/
+	template<class Grid> void after_grid_change(Grid& grid)
+	{
+		MPI_Comm comm = grid.get_communicator();
+		int rank = 0, comm_size = 0;
+		MPI_Comm_rank(comm, &rank);
+		MPI_Comm_size(comm, &comm_size);
+
+		// data of unrefined cells by parent, parent gets smallest child's
+		std::unordered_map<uint64_t, std::pair<uint64_t, values_type>> unrefined;
+		const auto add = [&](const uint64_t id, const values_type& values) {
+			if (grid.is_local(id)) {
+				this->attach(grid, id, values);
+				return;
+			}
+			const auto parent = grid.mapping.get_parent(id);
+			const auto iter = unrefined.find(parent);
+			if (iter == unrefined.end() or id < iter->second.first) {
+				unrefined[parent] = std::make_pair(id, values);
+			}
+		};
+
+		std::vector<std::vector<char>> outgoing(comm_size);
+		const auto send = [&](
+			const uint64_t owner,
+			const uint64_t id,
+			const values_type& values
+		) {
+			if (owner == uint64_t(rank)) {
+				add(id, values);
+			} else {
+				pack(outgoing[owner], id, values);
+			}
+		};
+		for (const auto& item: this->detached) {
+			const auto& id = item.first;
+			const auto owner = grid.get_process(id);
+			if (owner < uint64_t(comm_size)) {
+				send(owner, id, item.second);
+				continue;
+			}
+
+			bool refined = false;
+			for (const auto& child: grid.mapping.get_all_children(id)) {
+				const auto child_owner = grid.get_process(child);
+				if (child_owner < uint64_t(comm_size)) {
+					refined = true;
+					send(child_owner, child, item.second);
+				}
+			}
+			if (refined) {
+				continue;
+			}
+
+			// unrefined, data of other removed cells is discarded
+			const auto parent = grid.mapping.get_parent(id);
+			const auto parent_owner = grid.get_process(parent);
+			if (parent != id and parent_owner < uint64_t(comm_size)) {
+				send(parent_owner, id, item.second);
+			}
+		}
+		this->detached.clear();
+
+		std::vector<int>
+			send_counts(comm_size), receive_counts(comm_size),
+			send_displs(comm_size), receive_displs(comm_size);
+		std::vector<char> send_buffer;
+		for (int process = 0; process < comm_size; process++) {
+			send_counts[process] = int(outgoing[process].size());
+			send_displs[process] = int(send_buffer.size());
+			send_buffer.insert(
+				send_buffer.end(),
+				outgoing[process].cbegin(),
+				outgoing[process].cend()
+			);
+		}
+		MPI_Alltoall(
+			send_counts.data(), 1, MPI_INT,
+			receive_counts.data(), 1, MPI_INT, comm
+		);
+		size_t receive_size = 0;
+		for (int process = 0; process < comm_size; process++) {
+			receive_displs[process] = int(receive_size);
+			receive_size += receive_counts[process];
+		}
+		std::vector<char> receive_buffer(receive_size);
+		MPI_Alltoallv(
+			send_buffer.data(), send_counts.data(), send_displs.data(), MPI_BYTE,
+			receive_buffer.data(), receive_counts.data(), receive_displs.data(), MPI_BYTE,
+			comm
+		);
+		MPI_Comm_free(&comm);
+
+		const char* position = receive_buffer.data();
+		const char* const end = receive_buffer.data() + receive_buffer.size();
+		while (position < end) {
+			uint64_t id = 0;
+			values_type values;
+			position = unpack(position, id, values);
+			add(id, values);
+		}
+		for (const auto& [parent, item]: unrefined) {
+			this->attach(grid, parent, item.second);
+		}
+		this->index(grid);
+	}
+
+
+private:
+
+	struct Entry {
+		values_type values;
+	};
+
+	std::unordered_map<uint64_t, Entry> entries;
+	//! ids of local cells with data, rebuilt when cells change
+	std::unordered_map<const Cell*, uint64_t> ids;
+	//! data of cells between before_ and after_grid_change()
+	std::vector<std::pair<uint64_t, values_type>> detached;
+
+	//! position of given variable in Variables
+	template<class Variable> static constexpr size_t index_of()
+	{
+		constexpr bool matches[] = {std::is_same_v<Variable, Variables>...};
+		size_t i = 0;
+		while (i < sizeof...(Variables) and not matches[i]) {
+			i++;
+		}
+		static_assert(
+			(std::is_same_v<Variable, Variables> or ...),
+			"Variable isn't stored in sparse cell data"
+		);
+		return i;
+	}
+
+	template<class Grid> void attach(
+		Grid& grid,
+		const uint64_t id,
+		const values_type& values
+	) {
+		auto* const cell_data = grid[id];
+		if (cell_data == nullptr or not grid.is_local(id)) {
+			throw std::runtime_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Cell " + std::to_string(id) + " isn't local"
+			);
+		}
+		this->entries[id].values = values;
+	}
+
+	template<class Grid> void index(Grid& grid)
+	{
+		this->ids.clear();
+		for (const auto& cell: grid.local_cells()) {
+			if (this->entries.count(cell.id) > 0) {
+				this->ids[cell.data] = cell.id;
+			}
+		}
+	}
+
+	static void pack(
+		std::vector<char>& buffer,
+		const uint64_t id,
+		const values_type& values
+	) {
+		const auto append = [&buffer](const auto& item){
+			const auto* const bytes = reinterpret_cast<const char*>(&item);
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(item));
+		};
+		append(id);
+		std::apply([&](const auto&... value){ (append(value), ...); }, values);
+	}
+
+	static const char* unpack(
+		const char* position,
+		uint64_t& id,
+		values_type& values
+	) {
+		const auto extract = [&position](auto& item){
+			std::memcpy(&item, position, sizeof(item));
+			position += sizeof(item);
+		};
+		extract(id);
+		std::apply([&](auto&... value){ (extract(value), ...); }, values);
+		return position;
+	}
+};
+
+
+}} // namespaces
+
+
+#endif // ifndef PAMHD_BOUNDARIES_SPARSE_CELL_DATA_HPP
@@ -45,6 +45,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mpParser.h"
 
 #include "boundaries/common.hpp"
+#include "boundaries/point_cloud.hpp"
 #include "math/expression.hpp"
 
 
@@ -92,6 +93,19 @@ public:
 		}
 	}
 	\endverbatim
+
+	Point cloud data is by default that of nearest point and
+	time stamp, with "interpolation": "linear" in values object
+	it's interpolated trilinearly in space and linearly in time.
+	Point cloud data can also be read from a file written by
+	write_point_cloud_file() one time slice at a time, in which
+	case time stamps are also read from the file:
+	\verbatim
+	{
+		"geometry-id": 0,
+		"values": {"file": "solar_wind.dat", "interpolation": "linear"}
+	}
+	\endverbatim
 	*/
 	void set(
 		const rapidjson::Value& object,
@@ -118,6 +132,49 @@ public:
 		}
 
 
+		if (not object.HasMember(values_name.c_str())) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Object doesn't have a " + values_name + " key."
+			);
+		}
+		const auto& values = object[values_name.c_str()];
+
+		this->expression_cache.clear();
+		this->point_cloud.clear();
+
+		bool linear = false;
+		if (values.IsObject() and values.HasMember("interpolation")) {
+			const auto& interpolation = values["interpolation"];
+			if (interpolation.IsString() and std::string(interpolation.GetString()) == "linear") {
+				linear = true;
+			} else if (not interpolation.IsString() or std::string(interpolation.GetString()) != "nearest") {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "interpolation must be either \"nearest\" or \"linear\"."
+				);
+			}
+		}
+
+		if (values.IsObject() and values.HasMember("file")) {
+			if (object.HasMember("time-stamps")) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "time-stamps given for point cloud read from file."
+				);
+			}
+			if (not values["file"].IsString()) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "file isn't a string."
+				);
+			}
+			this->value_bdy_type = 3;
+			this->point_cloud.set_file(values["file"].GetString(), linear);
+			this->time_stamps = this->point_cloud.get_time_stamps();
+			return;
+		}
+
 		if (time_stamps_name != "") {
 			if (not object.HasMember("time-stamps")) {
 				throw std::invalid_argument(__FILE__ ": object doesn't have a time-stamps key.");
@@ -142,23 +199,18 @@ public:
 		}
 
 
-		if (not object.HasMember(values_name.c_str())) {
-			throw std::invalid_argument(
-				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
-				+ "Object doesn't have a " + values_name + " key."
-			);
-		}
-		const auto& values = object[values_name.c_str()];
-
+		std::array<std::vector<double>, 3> coordinates;
+		int coordinate_type = -1;
+		std::vector<typename Variable::data_type> data;
 		try {
 			fill_variable_value_from_json(
 				values,
 				this->value_bdy_type,
 				this->number_values,
 				this->math_expressions,
-				this->coordinates,
-				this->coordinate_type,
-				this->data
+				coordinates,
+				coordinate_type,
+				data
 			);
 		} catch (const std::invalid_argument& error) {
 			throw std::invalid_argument(
@@ -192,16 +244,18 @@ public:
 			}
 			break;
 		case 3:
-			correct_data_size
-				*= this->coordinates[0].size()
-				* this->coordinates[1].size()
-				* this->coordinates[2].size();
-			if (this->data.size() != correct_data_size) {
+			try {
+				this->point_cloud.set(
+					std::move(coordinates),
+					coordinate_type,
+					this->time_stamps,
+					std::move(data),
+					linear
+				);
+			} catch (const std::invalid_argument& error) {
 				throw std::invalid_argument(
 					std::string(__FILE__ "(") + std::to_string(__LINE__) + ") "
-					+ " Lengths of time stamps * coordinates and data don't match: "
-					+ std::to_string(correct_data_size) + " vs "
-					+ std::to_string(this->data.size())
+					+ " Invalid point cloud: " + error.what()
 				);
 			}
 			break;
@@ -231,6 +285,12 @@ public:
 			);
 		}
 
+		if (this->value_bdy_type == 3) {
+			return this->point_cloud.get_data(
+				t, x, y, z, radius, latitude, longitude
+			);
+		}
+
 		const auto after = std::lower_bound(
 			this->time_stamps.cbegin(),
 			this->time_stamps.cend(),
@@ -256,35 +316,11 @@ public:
 			return this->number_values[time_index];
 
 		case 2:
-			return this->math_expressions[time_index].evaluate(
+			return this->expression_cache.get_data(
+				this->math_expressions[time_index], time_index,
 				t, x, y, z, radius, latitude, longitude
 			);
 
-		// nearest neighbor interpolation in point cloud
-		case 3:
-			return this->data[
-				find_data(
-					[&]()
-						-> std::array<double, 3>
-					{
-						switch (this->coordinate_type) {
-						case 1:
-							return {x, y, z};
-						case 2:
-							return {radius, latitude, longitude};
-						default:
-							throw std::out_of_range(__FILE__ ": Invalid coordinate type.");
-						}
-					}(),
-					this->coordinates
-				)
-				// take into account current time index
-				+ time_index
-					* this->coordinates[0].size()
-					* this->coordinates[1].size()
-					* this->coordinates[2].size()
-			];
-
 		default:
 			throw std::out_of_range(__FILE__ ": Invalid initial condition type.");
 		}
@@ -298,6 +334,7 @@ public:
 		for (auto& expression: this->math_expressions) {
 			expression.add_expression_variable(name, variable);
 		}
+		this->expression_cache.clear();
 	}
 
 
@@ -322,16 +359,13 @@ private:
 
 	// value boundary if array of strings was given in json file
 	std::vector<math::Expression<Variable>> math_expressions;
+	Expression_Cache<Variable> expression_cache;
 
 	// value boundary if object was given in json file
-	std::array<std::vector<double>, 3> coordinates; // e.g. x,y,z coordinates of points
-	int coordinate_type = -1; // cartesian == 1, geographic == 2
+	Point_Cloud<Variable> point_cloud;
 
 	std::vector<double> time_stamps;
 
-	// data in order x[0],y[0],z[0],t[0]; x[1],y[0],z[0],t[0]; ...
-	std::vector<typename Variable::data_type> data;
-
 	int value_bdy_type = -1; // number == 1, string == 2, object == 3
 };
 
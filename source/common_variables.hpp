@@ -599,6 +599,25 @@ struct Magnetic_Field_Divergence {
 	static const std::string get_option_help() { return {"Divergence of plasma magnetic field (T/m)"}; }
 };
 
+/*! Scalar ψ of generalized Lagrange multiplier (GLM) divergence cleaning
+
+Carries divergence of magnetic field away from where it's created
+and damps it, see doi:10.1006/jcph.2001.6961.
+*/
+struct Divergence_Cleaning_Potential {
+	using data_type = double;
+	static const std::string get_name() { return {"divergence cleaning potential"}; }
+	static const std::string get_option_name() { return {"div-cleaning-potential"}; }
+	static const std::string get_option_help() { return {"GLM divergence cleaning potential (T m/s)"}; }
+};
+
+struct Divergence_Cleaning_Potential_Flux {
+	using data_type = double;
+	static const std::string get_name() { return {"divergence cleaning potential flux"}; }
+	static const std::string get_option_name() { return {"div-cleaning-potential-flux"}; }
+	static const std::string get_option_help() { return {"Flux of GLM divergence cleaning potential"}; }
+};
+
 //! J in J = ∇×B
 struct Electric_Current_Density {
 	static bool is_stale;
@@ -61,8 +61,20 @@ struct Options
 		poisson_iterations_min = 0;
 	double
 		remove_n = -1,
+		/*!
+		Absolute residual norm for dccrg solver, norm
+		relative to rhs for multigrid, unused by fft
+		*/
 		poisson_norm_stop = 1e-15,
-		poisson_norm_increase_max = 10;
+		poisson_norm_increase_max = 10,
+		//! speed of GLM cleaning waves, derived from time step if <= 0
+		glm_speed = -1,
+		//! dimensionless damping of GLM cleaning potential per cell crossing
+		glm_damping = 0.1;
+	//! dccrg, multigrid or fft
+	std::string poisson_solver = "dccrg";
+	//! projection (divergence removal every remove_n) or glm
+	std::string cleaning = "projection";
 
 	void set(const rapidjson::Value& object) {
 		using std::to_string;
@@ -104,6 +116,47 @@ struct Options
 				+ to_string(poisson_norm_increase_max)
 			);
 		}
+
+		if (object.HasMember("poisson-solver")) {
+			poisson_solver = object["poisson-solver"].GetString();
+			if (
+				poisson_solver != "dccrg"
+				and poisson_solver != "multigrid"
+				and poisson_solver != "fft"
+			) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "poisson-solver must be dccrg, multigrid or fft but is "
+					+ poisson_solver
+				);
+			}
+		}
+
+		if (object.HasMember("div-B-cleaning")) {
+			cleaning = object["div-B-cleaning"].GetString();
+			if (cleaning != "projection" and cleaning != "glm") {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "div-B-cleaning must be projection or glm but is "
+					+ cleaning
+				);
+			}
+		}
+
+		if (object.HasMember("glm-speed")) {
+			glm_speed = object["glm-speed"].GetDouble();
+		}
+
+		if (object.HasMember("glm-damping")) {
+			glm_damping = object["glm-damping"].GetDouble();
+			if (not std::isfinite(glm_damping) or glm_damping < 0) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "glm-damping must be >= 0 but is "
+					+ to_string(glm_damping)
+				);
+			}
+		}
 	}
 };
 
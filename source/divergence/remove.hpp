@@ -34,8 +34,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef PAMHD_DIVERGENCE_REMOVE_HPP
 #define PAMHD_DIVERGENCE_REMOVE_HPP
 
+#include "array"
 #include "cmath"
+#include "cstdint"
 #include "limits"
+#include "memory"
+#include "utility"
 #include "vector"
 
 #include "dccrg.hpp"
@@ -43,6 +47,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mpi.h"
 #include "tests/poisson/poisson_solve.hpp" // part of dccrg
 
+#include "poisson/fft_solver.hpp"
+#include "poisson/multigrid.hpp"
+
 
 namespace pamhd {
 namespace divergence {
@@ -111,8 +118,8 @@ template <
 	Divergence_Getter Divergence,
 	Cell_Type_Getter Cell_Type
 ) {
-	double local_divergence = 0, global_divergence = 0;
-	uint64_t local_calculated_cells = 0, global_calculated_cells = 0;
+	double local_divergence = 0;
+	uint64_t local_calculated_cells = 0;
 	for (const auto& cell: cells) {
 		if (Cell_Type(*cell.data) < 0) {
 			continue;
@@ -270,26 +277,20 @@ template <
 		local_divergence += std::fabs(div);
 	}
 
+	// divergence and number of cells in one reduction
+	std::array<double, 2> global{local_divergence, double(local_calculated_cells)};
 	MPI_Comm comm = grid.get_communicator();
 	MPI_Allreduce(
-		&local_divergence,
-		&global_divergence,
-		1,
+		MPI_IN_PLACE,
+		global.data(),
+		2,
 		MPI_DOUBLE,
 		MPI_SUM,
 		comm
 	);
-	MPI_Allreduce(
-		&local_calculated_cells,
-		&global_calculated_cells,
-		1,
-		MPI_UINT64_T,
-		MPI_SUM,
-		comm
-	);
 	MPI_Comm_free(&comm);
 
-	return global_divergence / global_calculated_cells;
+	return global[0] / global[1];
 }
 
 
@@ -576,6 +577,202 @@ template <
 }
 
 
+/*!
+Poisson grid and solution kept between calls to remove().
+
+Poisson grid is created again only if cells of simulation grid
+have changed on any process, e.g. due to adaptive mesh
+refinement or load balancing. Otherwise solution of previous
+call is used as initial guess of next one.
+
+If use_multigrid is true pamhd::poisson::Multigrid is used
+instead of dccrg's Poisson_Solve and its levels are kept
+instead of poisson grid, recreated also if cell types change.
+
+If use_fft is true pamhd::poisson::FFT_Solver is used instead
+of others when grid isn't refined, is periodic in every
+dimension and phi is solved in all cells.
+*/
+template<class Geometry> class Poisson_Cache
+{
+public:
+
+	using grid_type = dccrg::Dccrg<Poisson_Cell, Geometry>;
+
+	bool use_multigrid = false, use_fft = false;
+
+	/*!
+	Creates poisson grid from given grid if necessary.
+
+	Returns true if poisson grid from previous call can be used.
+	Must be called by all processes.
+	*/
+	template<class Grid> bool update(Grid& grid)
+	{
+		std::vector<uint64_t> new_cells;
+		new_cells.reserve(this->cells.size());
+		for (const auto& cell: grid.local_cells()) {
+			new_cells.push_back(cell.id);
+		}
+
+		int changed = 0, global_changed = 0;
+		if (this->poisson_grid == nullptr or new_cells != this->cells) {
+			changed = 1;
+		}
+		MPI_Comm comm = grid.get_communicator();
+		MPI_Allreduce(
+			&changed, &global_changed, 1, MPI_INT, MPI_MAX, comm
+		);
+		MPI_Comm_free(&comm);
+		if (global_changed == 0) {
+			return true;
+		}
+
+		this->cells = std::move(new_cells);
+		this->poisson_grid.reset();
+		this->poisson_grid = std::make_unique<grid_type>(grid);
+		this->rebuilds++;
+		return false;
+	}
+
+	grid_type& get_grid()
+	{
+		return *this->poisson_grid;
+	}
+
+	/*!
+	Creates multigrid levels from given cells if necessary.
+
+	Returns true if levels and solution from previous call
+	can be used. Must be called by all processes.
+	*/
+	template<
+		class Grid,
+		class Cells,
+		class Cell_Type_Getter
+	> bool update_multigrid(
+		Grid& grid,
+		const Cells& given_cells,
+		Cell_Type_Getter Cell_Type
+	) {
+		std::vector<std::pair<uint64_t, int>> new_cell_types;
+		new_cell_types.reserve(this->cell_types.size());
+		for (const auto& cell: given_cells) {
+			new_cell_types.emplace_back(cell.id, Cell_Type(*cell.data));
+		}
+
+		int changed = 0, global_changed = 0;
+		if (this->multigrid.get_nr_levels() == 0 or new_cell_types != this->cell_types) {
+			changed = 1;
+		}
+		MPI_Comm comm = grid.get_communicator();
+		MPI_Allreduce(
+			&changed, &global_changed, 1, MPI_INT, MPI_MAX, comm
+		);
+		MPI_Comm_free(&comm);
+		if (global_changed == 0) {
+			return true;
+		}
+
+		this->cell_types = std::move(new_cell_types);
+		this->multigrid.set(grid, given_cells, Cell_Type);
+		this->solution.assign(this->multigrid.get_cells().size(), 0);
+		this->rebuilds++;
+		return false;
+	}
+
+	/*!
+	Creates FFT solver from given cells if necessary.
+
+	Returns false if FFT solver can't be used with given grid
+	or cell types. Must be called by all processes.
+	*/
+	template<
+		class Grid,
+		class Cells,
+		class Cell_Type_Getter
+	> bool update_fft(
+		Grid& grid,
+		const Cells& given_cells,
+		Cell_Type_Getter Cell_Type
+	) {
+		int usable = 1;
+		if (grid.get_maximum_refinement_level() > 0) {
+			usable = 0;
+		}
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (not grid.topology.is_periodic(dim)) {
+				usable = 0;
+			}
+		}
+
+		std::vector<uint64_t> new_cells;
+		new_cells.reserve(this->fft_cells.size());
+		for (const auto& cell: given_cells) {
+			if (Cell_Type(*cell.data) != 1) {
+				usable = 0;
+			}
+			new_cells.push_back(cell.id);
+		}
+
+		std::array<int, 2> flags{
+			1 - usable,
+			(this->fft_rebuilds == 0 or new_cells != this->fft_cells) ? 1 : 0
+		};
+		MPI_Comm comm = grid.get_communicator();
+		MPI_Allreduce(
+			MPI_IN_PLACE, flags.data(), 2, MPI_INT, MPI_MAX, comm
+		);
+		MPI_Comm_free(&comm);
+		if (flags[0] > 0) {
+			return false;
+		}
+
+		if (flags[1] > 0) {
+			this->fft_cells = std::move(new_cells);
+			this->fft.set(grid, given_cells, true);
+			this->fft_rebuilds++;
+		}
+		return true;
+	}
+
+	pamhd::poisson::FFT_Solver& get_fft()
+	{
+		return this->fft;
+	}
+
+	pamhd::poisson::Multigrid& get_multigrid()
+	{
+		return this->multigrid;
+	}
+
+	//! Solution of multigrid in order of get_multigrid().get_cells()
+	std::vector<double>& get_solution()
+	{
+		return this->solution;
+	}
+
+	//! Returns number of times poisson grid has been created
+	size_t get_rebuilds() const
+	{
+		return this->rebuilds;
+	}
+
+private:
+
+	std::unique_ptr<grid_type> poisson_grid;
+	std::vector<uint64_t> cells;
+	size_t rebuilds = 0;
+
+	pamhd::poisson::Multigrid multigrid;
+	std::vector<std::pair<uint64_t, int>> cell_types;
+	std::vector<double> solution;
+	pamhd::poisson::FFT_Solver fft;
+	std::vector<uint64_t> fft_cells;
+	size_t fft_rebuilds = 0;
+};
+
+
 /*!
 Removes divergence of a vector variable.
 
@@ -605,6 +802,20 @@ https://gitorious.org/dccrg/dccrg/source/master:tests/poisson/poisson_solve.hpp
 Poisson solver is applied to previous results retries
 number of times in a row, i.e. solver is used once
 if retries == 0.
+
+If cache is given poisson grid and solution are kept in it
+for next call, otherwise they're created for this call only
+and solution starts from zero, see Poisson_Cache.
+
+If cache->use_multigrid is true and use_failsafe is false
+phi is solved with pamhd::poisson::Multigrid used as
+preconditioner of conjugate gradient method instead, in which
+case stop_residual is relative to norm of rhs, p_of_norm is
+always 2 and retries and min_iterations aren't used.
+If cache->use_fft is true and grid allows it phi is solved
+directly with pamhd::poisson::FFT_Solver for operator of
+get_divergence() and get_gradient(), after which divergence
+is zero up to roundoff except for its checkerboard component.
 */
 template <
 	class Cell_Iterator,
@@ -613,7 +824,6 @@ template <
 	class Divergence_Getter,
 	class Gradient_Getter,
 	class Cell_Type_Getter
-	// TODO: add possibility to reuse solution from previous call
 > double remove(
 	const Cell_Iterator& cells,
 	Grid& grid,
@@ -628,7 +838,8 @@ template <
 	const double stop_after_residual_increase = 10,
 	const unsigned int retries = 0,
 	const bool use_failsafe = false,
-	const bool verbose = false
+	const bool verbose = false,
+	Poisson_Cache<typename Grid::geometry_type>* cache = nullptr
 ) {
 	/*
 	Prepare solution grid and source term
@@ -651,94 +862,153 @@ template <
 		}
 	}
 
-	dccrg::Dccrg<Poisson_Cell, typename Grid::geometry_type> poisson_grid(grid);
+	Poisson_Cache<typename Grid::geometry_type> local_cache;
+	if (cache == nullptr) {
+		cache = &local_cache;
+	}
 
-	// transfer rhs to poisson grid
-	for (const auto& cell: cells) {
-		auto* const poisson_data = poisson_grid[cell.id];
-		if (poisson_data == nullptr) {
-			std::cerr <<  __FILE__ << "(" << __LINE__<< "): "
-				<< "No data for poisson cell " << cell.id
-				<< std::endl;
-			abort();
+	if (
+		cache->use_fft
+		and not use_failsafe
+		and cache->update_fft(grid, cells, Cell_Type)
+	) {
+		std::vector<double> rhs, solution;
+		rhs.reserve(cache->get_fft().get_nr_cells());
+		for (const auto& cell: cells) {
+			rhs.push_back(Divergence(*cell.data));
 		}
 
-		if (Cell_Type(*cell.data) != 1) {
-			poisson_data->cell_type = DCCRG_POISSON_BOUNDARY_CELL;
-			continue;
-		}
+		cache->get_fft().solve(rhs, solution);
 
-		poisson_data->solution = 0;
-		poisson_data->rhs = Divergence(*cell.data);
-		poisson_data->cell_type = DCCRG_POISSON_SOLVE_CELL;
-	}
+		size_t solution_i = 0;
+		for (const auto& cell: cells) {
+			Divergence(*cell.data) = solution[solution_i++];
+		}
+	} else if (cache->use_multigrid and not use_failsafe) {
+		cache->update_multigrid(grid, cells, Cell_Type);
+		auto& multigrid = cache->get_multigrid();
+
+		std::vector<double> rhs;
+		rhs.reserve(multigrid.get_cells().size());
+		for (const auto& cell: cells) {
+			if (Cell_Type(*cell.data) == 1) {
+				rhs.push_back(Divergence(*cell.data));
+			}
+		}
 
-	Poisson_Solve solver(
-		max_iterations,
-		min_iterations,
-		stop_residual,
-		p_of_norm,
-		stop_after_residual_increase,
-		verbose
-	);
+		auto& solution = cache->get_solution();
+		const auto iterations = multigrid.solve(
+			rhs,
+			solution,
+			max_iterations,
+			stop_residual,
+			stop_after_residual_increase
+		);
+		if (verbose and grid.get_rank() == 0) {
+			std::cout << "Multigrid Poisson solver stopped after "
+				<< iterations << " iterations with relative residual "
+				<< multigrid.get_residual() << std::endl;
+		}
 
-	// solve phi in div(grad(phi)) = rhs
-	std::vector<uint64_t> solve_cells, skip_cells;
-	for (const auto& cell: cells) {
-		const auto type = Cell_Type(*cell.data);
-		switch (type) {
-		case 1:
-			solve_cells.push_back(cell.id);
-			break;
-		case 0:
-			skip_cells.push_back(cell.id);
-			break;
-		default:
-			break;
+		size_t solution_i = 0;
+		for (const auto& cell: cells) {
+			if (Cell_Type(*cell.data) == 1) {
+				Divergence(*cell.data) = solution[solution_i++];
+			}
 		}
-	}
-	if (use_failsafe) {
-		solver.solve_failsafe(solve_cells, poisson_grid, skip_cells);
 	} else {
-		size_t iters = 0;
-		while (iters <= retries) {
-			solver.solve(
-				solve_cells,
-				poisson_grid,
-				skip_cells,
-				[iters](){
-					if (iters == 0) {
-						return false;
-					} else {
-						return true;
-					}
-				}()
-			);
-			iters++;
-		}
-	}
+		const bool warm_start = cache->update(grid);
+		auto& poisson_grid = cache->get_grid();
 
-	/*
-	Remove divergence with Vec = Vec - grad(phi)
-	*/
+		// transfer rhs to poisson grid
+		for (const auto& cell: cells) {
+			auto* const poisson_data = poisson_grid[cell.id];
+			if (poisson_data == nullptr) {
+				std::cerr <<  __FILE__ << "(" << __LINE__<< "): "
+					<< "No data for poisson cell " << cell.id
+					<< std::endl;
+				abort();
+			}
 
-	// store phi (solution) in divergence variable
-	for (const auto& cell: cells) {
-		if (Cell_Type(*cell.data) != 1) {
-			continue;
+			if (Cell_Type(*cell.data) != 1) {
+				poisson_data->cell_type = DCCRG_POISSON_BOUNDARY_CELL;
+				continue;
+			}
+
+			if (not warm_start) {
+				poisson_data->solution = 0;
+			}
+			poisson_data->rhs = Divergence(*cell.data);
+			poisson_data->cell_type = DCCRG_POISSON_SOLVE_CELL;
 		}
 
-		auto* const poisson_data = poisson_grid[cell.id];
-		if (poisson_data == nullptr) {
-			std::cerr <<  __FILE__ << "(" << __LINE__<< "): "
-				<< "No data for poisson cell " << cell.id
-				<< std::endl;
-			abort();
+		Poisson_Solve solver(
+			max_iterations,
+			min_iterations,
+			stop_residual,
+			p_of_norm,
+			stop_after_residual_increase,
+			verbose
+		);
+
+		// solve phi in div(grad(phi)) = rhs
+		std::vector<uint64_t> solve_cells, skip_cells;
+		for (const auto& cell: cells) {
+			const auto type = Cell_Type(*cell.data);
+			switch (type) {
+			case 1:
+				solve_cells.push_back(cell.id);
+				break;
+			case 0:
+				skip_cells.push_back(cell.id);
+				break;
+			default:
+				break;
+			}
 		}
+		if (use_failsafe) {
+			solver.solve_failsafe(solve_cells, poisson_grid, skip_cells);
+		} else {
+			size_t iters = 0;
+			while (iters <= retries) {
+				solver.solve(
+					solve_cells,
+					poisson_grid,
+					skip_cells,
+					[iters](){
+						if (iters == 0) {
+							return false;
+						} else {
+							return true;
+						}
+					}()
+				);
+				iters++;
+			}
+		}
+
+		// store phi (solution) in divergence variable
+		for (const auto& cell: cells) {
+			if (Cell_Type(*cell.data) != 1) {
+				continue;
+			}
+
+			auto* const poisson_data = poisson_grid[cell.id];
+			if (poisson_data == nullptr) {
+				std::cerr <<  __FILE__ << "(" << __LINE__<< "): "
+					<< "No data for poisson cell " << cell.id
+					<< std::endl;
+				abort();
+			}
 
-		Divergence(*cell.data) = poisson_data->solution;
+			Divergence(*cell.data) = poisson_data->solution;
+		}
 	}
 
+	/*
+	Remove divergence with Vec = Vec - grad(phi)
+	*/
+
 	grid.update_copies_of_remote_neighbors();
 
 	get_gradient(
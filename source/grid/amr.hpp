@@ -38,6 +38,7 @@ Author(s): Ilja Honkonen
 
 
 #include "algorithm"
+#include "cstdint"
 #include "initializer_list"
 #include "set"
 #include "stdexcept"
@@ -200,7 +201,9 @@ template<
 
 /*! Adapts given grid based on target min and max refinement level.
 
-Grid is adapted at most grid.get_maximum_refinement_level() times.
+Grid is adapted at most grid.get_maximum_refinement_level() or
+max_rounds times, whichever is smaller. Returns total number of
+cells created and removed by all processes.
 Cells whose refinement level is smaller than target minimum are
 refined.
 Cells whose refinement level is larger than target maximum are
@@ -219,7 +222,7 @@ template <
 	class Target_Refinement_Level_Max_Getter,
 	class New_Cells_Handler,
 	class Removed_Cells_Handler
-> void adapt_grid(
+> uint64_t adapt_grid(
 	Grid& grid,
 	const Target_Refinement_Level_Min_Getter& RLMin,
 	const Target_Refinement_Level_Max_Getter& RLMax,
@@ -232,6 +235,7 @@ template <
 	Cell::set_transfer_all(true, RLMin.type(), RLMax.type());
 	MPI_Comm comm = grid.get_communicator();
 	#endif
+	uint64_t total_changes = 0;
 	for (
 		int i = 0;
 		i < std::min(max_rounds, grid.get_maximum_refinement_level());
@@ -256,6 +260,7 @@ template <
 		total_size_global = dccrg::All_Reduce()(total_size_local, comm);
 		#endif
 
+		total_changes += total_size_global;
 		if (total_size_global == 0) {
 			break;
 		} else {
@@ -269,6 +274,7 @@ template <
 	grid.update_copies_of_remote_neighbors();
 	Cell::set_transfer_all(false, RLMin.type(), RLMax.type());
 	#endif
+	return total_changes;
 }
 
 /*! Potentially emulates 1d/2d grid
@@ -0,0 +1,212 @@
+/*
+Storage of cell variables outside of grid cells for PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_GRID_ARENA_HPP
+#define PAMHD_GRID_ARENA_HPP
+
+
+#include "cstdint"
+#include "limits"
+#include "stdexcept"
+#include "string"
+#include "tuple"
+#include "type_traits"
+#include "unordered_map"
+#include "utility"
+#include "vector"
+
+
+namespace pamhd {
+namespace grid {
+
+
+/*! Stores variables of cells in arrays outside of grid cells.
+
+Allows moving cold variables, i.e. ones used by few loops over
+cells, out of cell data so that loops over the remaining hot
+variables don't load them into cache. Each variable is stored in
+its own array in order of local cells followed by remote cells,
+index of cell in arrays is stored in cell's Index_Variable. Several
+arenas can be used for groups of variables accessed together.
+
+Arena variables aren't transferred between processes by dccrg,
+Index_Variable shouldn't be either. update() must be called
+after grid is created and every time cells change, it keeps
+values of cells that stay on this process and default
+initializes values of other cells.
+
+Example:
+\verbatim
+using Cell = gensimcell::Cell<..., pamhd::grid::Arena_Index>;
+pamhd::grid::Arena<pamhd::grid::Arena_Index, Bdy_Temperature> cold;
+const auto Bdy_T = cold.getter<Bdy_Temperature>();
+...
+cold.update(grid);
+for (const auto& cell: grid.local_cells()) {
+	Bdy_T(*cell.data) = 0;
+}
+\endverbatim
+*/
+template<class Index_Variable, class... Variables> class Arena
+{
+	static_assert(
+		(not std::is_same_v<typename Variables::data_type, bool> and ...),
+		"Use char instead of bool in arena variables"
+	);
+
+public:
+
+	//! Returns data of given variable in arena like Variable_Getter.
+	template<class Variable> class Getter
+	{
+	public:
+		Getter(Arena& given) : arena(&given) {}
+
+		template<class Cell> Variable::data_type& data(Cell& cell_data) const
+		{
+			return this->arena->template get<Variable>(cell_data);
+		}
+
+		template<class Cell> Variable::data_type& operator()(Cell& cell_data) const
+		{
+			return this->data(cell_data);
+		}
+
+		Variable type() const { return Variable{}; }
+
+	private:
+		Arena* arena;
+	};
+
+
+	/*!
+	Assigns arena index to local and remote cells of grid.
+
+	Values of cells that were in arena before are kept.
+	*/
+	template<class Grid> void update(Grid& grid)
+	{
+		std::unordered_map<uint64_t, size_t> old_index;
+		old_index.reserve(this->cells.size());
+		for (size_t i = 0; i < this->cells.size(); i++) {
+			old_index[this->cells[i]] = i;
+		}
+
+		std::vector<uint64_t> new_cells;
+		for (const auto& cell: grid.local_cells()) {
+			new_cells.push_back(cell.id);
+		}
+		for (const auto& cell: grid.remote_cells()) {
+			new_cells.push_back(cell.id);
+		}
+		if (new_cells.size() > std::numeric_limits<typename Index_Variable::data_type>::max()) {
+			throw std::out_of_range(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Too many cells for arena index: " + std::to_string(new_cells.size())
+			);
+		}
+
+		std::apply([&](auto&... arrays){
+			(this->reorder(arrays, new_cells, old_index), ...);
+		}, this->arrays);
+
+		size_t index = 0;
+		for (const auto& cell: grid.local_cells()) {
+			(*cell.data)[Index_Variable()] = index++;
+		}
+		for (const auto& cell: grid.remote_cells()) {
+			(*cell.data)[Index_Variable()] = index++;
+		}
+		this->cells = std::move(new_cells);
+	}
+
+	//! Returns data of given variable in given cell.
+	template<class Variable, class Cell> Variable::data_type& get(Cell& cell_data)
+	{
+		return std::get<index_of<Variable>()>(this->arrays)[cell_data[Index_Variable()]];
+	}
+
+	//! Returns getter of given variable usable in place of Variable_Getter.
+	template<class Variable> Getter<Variable> getter()
+	{
+		return Getter<Variable>(*this);
+	}
+
+	//! Returns number of cells in arena.
+	size_t size() const
+	{
+		return this->cells.size();
+	}
+
+
+private:
+
+	std::tuple<std::vector<typename Variables::data_type>...> arrays;
+	//! id of cell at each index
+	std::vector<uint64_t> cells;
+
+	//! position of given variable in Variables
+	template<class Variable> static constexpr size_t index_of()
+	{
+		constexpr bool matches[] = {std::is_same_v<Variable, Variables>...};
+		size_t i = 0;
+		while (i < sizeof...(Variables) and not matches[i]) {
+			i++;
+		}
+		static_assert(
+			(std::is_same_v<Variable, Variables> or ...),
+			"Variable isn't stored in arena"
+		);
+		return i;
+	}
+
+	template<class Data> void reorder(
+		std::vector<Data>& array,
+		const std::vector<uint64_t>& new_cells,
+		const std::unordered_map<uint64_t, size_t>& old_index
+	) {
+		std::vector<Data> new_array(new_cells.size());
+		for (size_t i = 0; i < new_cells.size(); i++) {
+			const auto iter = old_index.find(new_cells[i]);
+			if (iter != old_index.end()) {
+				new_array[i] = std::move(array[iter->second]);
+			}
+		}
+		array = std::move(new_array);
+	}
+};
+
+
+}} // namespaces
+
+
+#endif // ifndef PAMHD_GRID_ARENA_HPP
@@ -0,0 +1,289 @@
+/*
+Merges exchanges of stale variables between processes of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_GRID_HALO_EXCHANGE_HPP
+#define PAMHD_GRID_HALO_EXCHANGE_HPP
+
+
+#include "stdexcept"
+#include "string"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+#include "grid/packed_halo.hpp"
+
+
+namespace pamhd {
+namespace grid {
+
+
+/*! Plans updates of remote neighbor copies based on is_stale flags.
+
+Stale variables requested by one or more kernels are exchanged
+together in one dccrg update when the first kernel needing one of
+them calls update() or start(). Requesting variables that aren't
+stale does nothing. Variables are marked as not stale when
+requested so a variable marked stale again before its exchange
+finishes is exchanged again by a later update.
+
+Cell is the type of data stored in grid cells and must provide
+static set_transfer_all(bool, Variable...). Getters given to
+member functions must provide type() that returns the variable,
+which must have a static is_stale flag.
+
+If a Packed_Halo has been given to use() and its set() has been
+called exchanges are done by it instead of dccrg, unless a
+requested variable isn't trivially copyable. Packed_Halo must
+be cleared or set again before changing the grid.
+
+Requested variables aren't transferred by dccrg updates that don't
+go through this class. After start() no other dccrg update can be
+started before finish(), and data of variables being exchanged
+must not be modified.
+
+Example:
+\verbatim
+using Halo = pamhd::grid::Halo_Exchange<Cell>;
+// merged with exchange of SInfo below if both are stale
+Halo::request(Mas, Mom);
+...
+// doesn't transfer anything if SInfo isn't stale
+Halo::update(grid, SInfo);
+\endverbatim
+*/
+template<class Cell> class Halo_Exchange
+{
+private:
+
+	//! enables or disables transfer of one variable
+	using Switch = void (*)(const bool);
+
+	inline static std::vector<Switch> switches;
+
+	//! returns byte range of one variable in cell data, empty if not packable
+	using Range_Getter = std::pair<size_t, size_t> (*)();
+
+	inline static std::vector<Range_Getter> range_getters;
+
+	inline static bool started = false, received = false, started_packed = false;
+
+	template<class Grid> inline static Packed_Halo<Grid>* packed = nullptr;
+
+	//! whether variable is waiting for or being exchanged
+	template<class Variable> inline static bool in_flight = false;
+
+	template<class Getter> using variable_t
+		= std::remove_cvref_t<decltype(std::declval<Getter>().type())>;
+
+	template<class Variable> static void set_transfer(const bool transfer)
+	{
+		Cell::set_transfer_all(transfer, Variable());
+		if (not transfer) {
+			in_flight<Variable> = false;
+		}
+	}
+
+	template<class Variable> static std::pair<size_t, size_t> get_range()
+	{
+		using data_t = typename Variable::data_type;
+		if constexpr (std::is_trivially_copyable_v<data_t>) {
+			static Cell sample;
+			const auto offset
+				= reinterpret_cast<const char*>(&sample[Variable()])
+				- reinterpret_cast<const char*>(&sample);
+			return {size_t(offset), sizeof(data_t)};
+		} else {
+			return {0, 0};
+		}
+	}
+
+
+public:
+
+	/*!
+	Exchanges variables with given halo instead of dccrg when possible.
+
+	Given nullptr exchanges use dccrg again. Must not be called
+	between start() and finish().
+	*/
+	template<class Grid> static void use(Packed_Halo<Grid>* halo)
+	{
+		if (started) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Can't change halo during exchange."
+			);
+		}
+		packed<Grid> = halo;
+	}
+
+	/*!
+	Adds stale variables of given getters to next exchange.
+
+	Must not be called between start() and finish().
+	*/
+	template<class... Getters> static void request(const Getters&... getters)
+	{
+		if (started) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Can't request variables during exchange."
+			);
+		}
+
+		([&](const auto& getter){
+			using Variable = variable_t<decltype(getter)>;
+			if (not Variable::is_stale or in_flight<Variable>) {
+				return;
+			}
+			Variable::is_stale = false;
+			in_flight<Variable> = true;
+			switches.push_back(&set_transfer<Variable>);
+			range_getters.push_back(&get_range<Variable>);
+		}(getters), ...);
+	}
+
+	/*!
+	Starts exchanging requested variables.
+
+	Returns true if exchange was started or is in progress.
+	*/
+	template<class Grid> static bool start(Grid& grid)
+	{
+		if (started) {
+			return true;
+		}
+		if (switches.size() == 0) {
+			return false;
+		}
+
+		started = true;
+		received = false;
+
+		auto* const halo = packed<Grid>;
+		if (halo != nullptr and halo->is_set()) {
+			std::vector<std::pair<size_t, size_t>> ranges;
+			for (const auto& r: range_getters) {
+				ranges.push_back(r());
+				if (ranges.back().second == 0) {
+					break;
+				}
+			}
+			if (ranges.back().second > 0) {
+				halo->start(Packed_Halo<Grid>::merge(std::move(ranges)));
+				started_packed = true;
+				return true;
+			}
+		}
+
+		for (const auto& s: switches) {
+			s(true);
+		}
+		grid.start_remote_neighbor_copy_updates();
+		started_packed = false;
+		return true;
+	}
+
+	//! Waits until copies of remote neighbors have been updated.
+	template<class Grid> static void wait_receives(Grid& grid)
+	{
+		if (not started or received) {
+			return;
+		}
+		if (started_packed) {
+			packed<Grid>->wait_receives();
+		} else {
+			grid.wait_remote_neighbor_copy_update_receives();
+		}
+		received = true;
+	}
+
+	/*!
+	Finishes exchange started by start().
+
+	Afterwards data of exchanged variables can be modified again.
+	*/
+	template<class Grid> static void finish(Grid& grid)
+	{
+		if (not started) {
+			return;
+		}
+		wait_receives(grid);
+		if (started_packed) {
+			packed<Grid>->wait_sends();
+		} else {
+			grid.wait_remote_neighbor_copy_update_sends();
+		}
+		for (const auto& s: switches) {
+			s(false);
+		}
+		switches.clear();
+		range_getters.clear();
+		started = false;
+		started_packed = false;
+	}
+
+	/*!
+	Updates copies of remote neighbors of given variables if stale.
+
+	Also exchanges all variables requested earlier if any given
+	variable is stale or was requested earlier. Returns true if
+	exchange was done.
+	*/
+	template<
+		class Grid,
+		class... Getters
+	> static bool update(Grid& grid, const Getters&... getters)
+	{
+		finish(grid);
+		request(getters...);
+		if ((not in_flight<variable_t<Getters>> and ...)) {
+			return false;
+		}
+		start(grid);
+		finish(grid);
+		return true;
+	}
+
+	//! Returns true if variable of given getter is waiting for or being exchanged.
+	template<class Getter> static bool is_in_flight(const Getter&)
+	{
+		return in_flight<variable_t<Getter>>;
+	}
+};
+
+
+}} // namespaces
+
+
+#endif // ifndef PAMHD_GRID_HALO_EXCHANGE_HPP
@@ -0,0 +1,435 @@
+/*
+Halo exchange of PAMHD using pre-packed persistent buffers.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_GRID_PACKED_HALO_HPP
+#define PAMHD_GRID_PACKED_HALO_HPP
+
+
+#include "algorithm"
+#include "climits"
+#include "cstdint"
+#include "cstring"
+#include "map"
+#include "stdexcept"
+#include "string"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+#include "mpi.h"
+
+
+namespace pamhd {
+namespace grid {
+
+
+/*! Updates copies of remote neighbors from contiguous per process buffers.
+
+Instead of dccrg's per cell MPI datatypes data of transferred
+variables is copied into one buffer per neighboring process
+using offsets of variables within cell data and sent with
+persistent requests. Lists of cells to send and receive are
+created by set() and kept until grid changes, buffers and
+requests of each combination of transferred variables are
+created on first use and kept until next set().
+
+Only trivially copyable variables can be transferred, data of
+other variables must be transferred by dccrg.
+
+Example:
+\verbatim
+pamhd::grid::Packed_Halo<Grid> halo;
+halo.set(grid);
+halo.update(grid, Mas, Mom, Nrj);
+...
+// after refinement or load balancing
+halo.set(grid);
+\endverbatim
+*/
+template<class Grid> class Packed_Halo
+{
+public:
+
+	using Cell = typename Grid::cell_data_type;
+
+	//! offset in bytes from start of cell data and number of bytes
+	using Range = std::pair<size_t, size_t>;
+
+
+	Packed_Halo() = default;
+	Packed_Halo(const Packed_Halo& other) = delete;
+	Packed_Halo& operator=(const Packed_Halo& other) = delete;
+
+	~Packed_Halo()
+	{
+		this->clear();
+	}
+
+
+	/*!
+	Creates lists of cells to send to and receive from other processes.
+
+	Must be called by all processes before first exchange
+	and again every time cells of grid or their owners change.
+	*/
+	void set(Grid& grid)
+	{
+		this->clear();
+		this->comm = grid.get_communicator();
+
+		int comm_size = 0;
+		MPI_Comm_size(this->comm, &comm_size);
+
+		std::vector<std::vector<std::pair<uint64_t, Cell*>>> receives(comm_size);
+		for (const auto& cell: grid.remote_cells()) {
+			const auto owner = grid.get_process(cell.id);
+			receives.at(owner).emplace_back(cell.id, cell.data);
+		}
+
+		// tell owners which of their cells are needed here
+		std::vector<int>
+			recv_counts(comm_size), send_counts(comm_size),
+			recv_displs(comm_size), send_displs(comm_size);
+		std::vector<uint64_t> recv_ids;
+		for (int process = 0; process < comm_size; process++) {
+			auto& cells = receives[process];
+			std::sort(cells.begin(), cells.end());
+			recv_counts[process] = int(cells.size());
+			recv_displs[process] = int(recv_ids.size());
+			for (const auto& item: cells) {
+				recv_ids.push_back(item.first);
+			}
+		}
+		MPI_Alltoall(
+			recv_counts.data(), 1, MPI_INT,
+			send_counts.data(), 1, MPI_INT, this->comm
+		);
+		size_t nr_send_ids = 0;
+		for (int process = 0; process < comm_size; process++) {
+			send_displs[process] = int(nr_send_ids);
+			nr_send_ids += send_counts[process];
+		}
+		std::vector<uint64_t> send_ids(nr_send_ids);
+		MPI_Alltoallv(
+			recv_ids.data(), recv_counts.data(), recv_displs.data(), MPI_UINT64_T,
+			send_ids.data(), send_counts.data(), send_displs.data(), MPI_UINT64_T,
+			this->comm
+		);
+
+		for (int process = 0; process < comm_size; process++) {
+			if (recv_counts[process] == 0 and send_counts[process] == 0) {
+				continue;
+			}
+			this->neighbors.emplace_back();
+			auto& neighbor = this->neighbors.back();
+			neighbor.process = process;
+			for (const auto& item: receives[process]) {
+				neighbor.receive_cells.push_back(item.second);
+			}
+			for (int i = 0; i < send_counts[process]; i++) {
+				const auto id = send_ids[send_displs[process] + i];
+				auto* const data = grid[id];
+				if (data == nullptr or not grid.is_local(id)) {
+					throw std::runtime_error(
+						std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+						+ "Process " + std::to_string(process)
+						+ " needs cell " + std::to_string(id)
+						+ " which isn't local"
+					);
+				}
+				neighbor.send_cells.push_back(data);
+			}
+		}
+	}
+
+	//! Returns true if set() has been called after clear().
+	bool is_set() const
+	{
+		return this->comm != MPI_COMM_NULL;
+	}
+
+	/*!
+	Frees all buffers, requests and lists of cells.
+
+	Must not be called between start() and wait_sends().
+	*/
+	void clear()
+	{
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (not finalized) {
+			for (auto& item: this->plans) {
+				for (auto& request: item.second.requests) {
+					MPI_Request_free(&request);
+				}
+			}
+			if (this->comm != MPI_COMM_NULL) {
+				MPI_Comm_free(&this->comm);
+			}
+		}
+		this->comm = MPI_COMM_NULL;
+		this->plans.clear();
+		this->neighbors.clear();
+		this->active = nullptr;
+	}
+
+
+	/*!
+	Returns byte ranges of variables of given getters within cell data.
+
+	Adjacent and overlapping ranges are merged.
+	*/
+	template<class... Getters> static std::vector<Range> get_ranges(
+		const Getters&... getters
+	) {
+		static Cell sample;
+		std::vector<Range> ranges;
+		([&](const auto& getter){
+			auto& data = getter.data(sample);
+			using data_t = std::remove_cvref_t<decltype(data)>;
+			static_assert(
+				std::is_trivially_copyable_v<data_t>,
+				"Only trivially copyable variables can be packed"
+			);
+			const auto offset
+				= reinterpret_cast<const char*>(&data)
+				- reinterpret_cast<const char*>(&sample);
+			if (offset < 0 or offset + sizeof(data_t) > sizeof(Cell)) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "Variable isn't stored in cell data"
+				);
+			}
+			ranges.emplace_back(size_t(offset), sizeof(data_t));
+		}(getters), ...);
+		return merge(std::move(ranges));
+	}
+
+	//! Sorts given ranges and merges adjacent and overlapping ones.
+	static std::vector<Range> merge(std::vector<Range> ranges)
+	{
+		std::sort(ranges.begin(), ranges.end());
+		std::vector<Range> merged;
+		for (const auto& range: ranges) {
+			if (range.second == 0) {
+				continue;
+			}
+			if (
+				merged.size() > 0
+				and merged.back().first + merged.back().second >= range.first
+			) {
+				merged.back().second = std::max(
+					merged.back().second,
+					range.first + range.second - merged.back().first
+				);
+			} else {
+				merged.push_back(range);
+			}
+		}
+		return merged;
+	}
+
+
+	/*!
+	Starts updating given byte ranges of remote neighbor copies.
+
+	Ranges must be from get_ranges() or merge(). Data in those
+	ranges of local cells must not be modified before wait_sends()
+	and of remote cells before wait_receives().
+	*/
+	void start(const std::vector<Range>& ranges)
+	{
+		if (not this->is_set()) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "set() hasn't been called"
+			);
+		}
+		if (this->active != nullptr) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Previous exchange hasn't finished"
+			);
+		}
+
+		auto iter = this->plans.find(ranges);
+		if (iter == this->plans.end()) {
+			iter = this->plans.emplace(ranges, this->make_plan(ranges)).first;
+		}
+		this->active = &iter->second;
+		this->received = false;
+		auto& plan = *this->active;
+		const size_t nr_neighbors = this->neighbors.size();
+
+		if (nr_neighbors > 0) {
+			MPI_Startall(int(nr_neighbors), plan.requests.data());
+		}
+		for (size_t i = 0; i < nr_neighbors; i++) {
+			auto* buffer = plan.send_buffers[i].data();
+			for (const auto* cell: this->neighbors[i].send_cells) {
+				const auto* const data = reinterpret_cast<const char*>(cell);
+				for (const auto& range: ranges) {
+					std::memcpy(buffer, data + range.first, range.second);
+					buffer += range.second;
+				}
+			}
+		}
+		if (nr_neighbors > 0) {
+			MPI_Startall(int(nr_neighbors), plan.requests.data() + nr_neighbors);
+		}
+	}
+
+	//! Waits for data started by start() and copies it to remote cells.
+	void wait_receives()
+	{
+		if (this->active == nullptr or this->received) {
+			return;
+		}
+		auto& plan = *this->active;
+		const size_t nr_neighbors = this->neighbors.size();
+		if (nr_neighbors > 0) {
+			MPI_Waitall(int(nr_neighbors), plan.requests.data(), MPI_STATUSES_IGNORE);
+		}
+		for (size_t i = 0; i < nr_neighbors; i++) {
+			const auto* buffer = plan.receive_buffers[i].data();
+			for (auto* cell: this->neighbors[i].receive_cells) {
+				auto* const data = reinterpret_cast<char*>(cell);
+				for (const auto& range: plan.ranges) {
+					std::memcpy(data + range.first, buffer, range.second);
+					buffer += range.second;
+				}
+			}
+		}
+		this->received = true;
+	}
+
+	//! Finishes exchange started by start().
+	void wait_sends()
+	{
+		if (this->active == nullptr) {
+			return;
+		}
+		this->wait_receives();
+		const size_t nr_neighbors = this->neighbors.size();
+		if (nr_neighbors > 0) {
+			MPI_Waitall(
+				int(nr_neighbors),
+				this->active->requests.data() + nr_neighbors,
+				MPI_STATUSES_IGNORE
+			);
+		}
+		this->active = nullptr;
+	}
+
+	/*!
+	Updates copies of remote neighbors of variables of given getters.
+
+	Calls set() first if it hasn't been called.
+	*/
+	template<class... Getters> void update(
+		Grid& grid,
+		const Getters&... getters
+	) {
+		if (not this->is_set()) {
+			this->set(grid);
+		}
+		this->start(get_ranges(getters...));
+		this->wait_sends();
+	}
+
+
+private:
+
+	struct Neighbor {
+		int process = -1;
+		std::vector<Cell*> send_cells, receive_cells;
+	};
+
+	//! buffers and requests for one set of byte ranges
+	struct Plan {
+		std::vector<Range> ranges;
+		std::vector<std::vector<char>> send_buffers, receive_buffers;
+		//! receives of all neighbors followed by sends
+		std::vector<MPI_Request> requests;
+	};
+
+	MPI_Comm comm = MPI_COMM_NULL;
+	std::vector<Neighbor> neighbors;
+	std::map<std::vector<Range>, Plan> plans;
+	Plan* active = nullptr;
+	bool received = false;
+
+
+	Plan make_plan(const std::vector<Range>& ranges) const
+	{
+		size_t cell_bytes = 0;
+		for (const auto& range: ranges) {
+			cell_bytes += range.second;
+		}
+
+		Plan plan;
+		plan.ranges = ranges;
+		const size_t nr_neighbors = this->neighbors.size();
+		plan.send_buffers.resize(nr_neighbors);
+		plan.receive_buffers.resize(nr_neighbors);
+		plan.requests.resize(2 * nr_neighbors, MPI_REQUEST_NULL);
+		for (size_t i = 0; i < nr_neighbors; i++) {
+			const auto& neighbor = this->neighbors[i];
+			const size_t
+				send_bytes = cell_bytes * neighbor.send_cells.size(),
+				receive_bytes = cell_bytes * neighbor.receive_cells.size();
+			if (send_bytes > INT_MAX or receive_bytes > INT_MAX) {
+				throw std::runtime_error(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "Too much data for process " + std::to_string(neighbor.process)
+				);
+			}
+			plan.send_buffers[i].resize(send_bytes);
+			plan.receive_buffers[i].resize(receive_bytes);
+			MPI_Recv_init(
+				plan.receive_buffers[i].data(), int(receive_bytes), MPI_BYTE,
+				neighbor.process, 0, this->comm, &plan.requests[i]
+			);
+			MPI_Send_init(
+				plan.send_buffers[i].data(), int(send_bytes), MPI_BYTE,
+				neighbor.process, 0, this->comm, &plan.requests[nr_neighbors + i]
+			);
+		}
+		return plan;
+	}
+};
+
+
+}} // namespaces
+
+
+#endif // ifndef PAMHD_GRID_PACKED_HALO_HPP
@@ -116,6 +116,49 @@ template<
 }
 
 
+/*! Returns whether given cell must be at maximum refinement level
+
+True if cell spans inner boundary or if its face or
+edge neighbor that spans inner boundary is closer to
+origin than the cell.
+*/
+template<
+	class Grid,
+	class Cell_Item
+> bool near_inner_boundary(
+	const double& inner_bdy_radius,
+	const Cell_Item& cell,
+	const Grid& grid
+) {
+	const auto [inside, outside]
+		= at_inner_boundary(inner_bdy_radius, cell.id, grid);
+	if (inside and outside) {
+		return true;
+	}
+	const auto [cx, cy, cz]
+		= grid.geometry.get_center(cell.id);
+	const auto cr2 = cx*cx + cy*cy + cz*cz;
+	for (const auto& neighbor: cell.neighbors_of) {
+		if (
+			neighbor.face_neighbor == 0
+			and neighbor.edge_neighbor[0] < 0
+		) {
+			continue;
+		}
+		const auto [inside, outside]
+			= at_inner_boundary(inner_bdy_radius, neighbor.id, grid);
+		if (inside and outside) {
+			const auto [nx, ny, nz]
+				= grid.geometry.get_center(neighbor.id);
+			if (cr2 > nx*nx + ny*ny + nz*nz) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
 //! Refines cells near inner boundary
 template<
 	class Grid
@@ -127,41 +170,12 @@ template<
 	const auto mrlvl = grid.get_maximum_refinement_level();
 	for (int i = 0; i <= mrlvl; i++) {
 		for (const auto& cell: grid.local_cells()) {
-			const auto [inside, outside]
-				= at_inner_boundary(inner_bdy_radius, cell.id, grid);
-			if (inside and outside) {
+			if (near_inner_boundary(inner_bdy_radius, cell, grid)) {
 				if (grid.get_refinement_level(cell.id) < mrlvl) {
 					grid.refine_completely(cell.id);
 				} else {
 					ret_val.insert(cell.id);
 				}
-				continue;
-			}
-			const auto [cx, cy, cz]
-				= grid.geometry.get_center(cell.id);
-			const auto cr2 = cx*cx + cy*cy + cz*cz;
-			// maybe refine if neighbor at inner boundary
-			for (const auto& neighbor: cell.neighbors_of) {
-				if (
-					neighbor.face_neighbor == 0
-					and neighbor.edge_neighbor[0] < 0
-				) {
-					continue;
-				}
-				const auto [inside, outside]
-					= at_inner_boundary(inner_bdy_radius, neighbor.id, grid);
-				if (inside and outside) {
-					const auto [nx, ny, nz]
-						= grid.geometry.get_center(neighbor.id);
-					if (cr2 > nx*nx + ny*ny + nz*nz) {
-						if (grid.get_refinement_level(cell.id) < mrlvl) {
-							grid.refine_completely(cell.id);
-						} else {
-							ret_val.insert(cell.id);
-						}
-						break;
-					}
-				}
 			}
 		}
 		grid.stop_refining();
@@ -176,42 +190,36 @@ template<
 }
 
 
-/*! Prepares grid for physics initialization
+/*! Sets min and max target refinement levels of local cells
 
--maximally refines inner boundary cells + their normal neighbors
--sets default minimum and maximum target refinement levels
--sets solver info for inner and outer boundaries
-
-Requires following transfers to be switched on:
-solver info, ...
+Cells near inner boundary, see near_inner_boundary(), are
+kept at maximum refinement level and refinement level is
+limited near outer boundaries, in between levels are set
+from grid options at given time.
 */
 template<
 	class Grid,
-	class Solver_Info_Getter,
 	class Targer_Maximum_Refinement_Level_Getter,
 	class Targer_Minimum_Refinement_Level_Getter
-> auto prepare_grid(
-	const pamhd::Options& options_sim,
+> void set_minmax_refinement_level_sw_box(
 	pamhd::grid::Options& options_grid,
 	const pamhd::Solar_Wind_Box_Options& options_box,
+	const double& simulation_time,
 	Grid& grid,
-	const Solver_Info_Getter& SInfo,
 	const Targer_Maximum_Refinement_Level_Getter& Ref_max,
 	const Targer_Minimum_Refinement_Level_Getter& Ref_min
 ) try {
-	using std::invalid_argument;
-	using std::max;
 	using std::min;
 	using std::runtime_error;
 	using std::to_string;
 
-	using Cell = Grid::cell_data_type;
-
 	// maximum refinement level at inner boundary
-	const auto max_ref_cells = refine_inner_cells(options_box.inner_radius, grid);
 	const auto mrlvl = grid.get_maximum_refinement_level();
 	for (const auto& cell: grid.local_cells()) {
-		if (max_ref_cells.count(cell.id) > 0) {
+		if (
+			grid.get_refinement_level(cell.id) == mrlvl
+			and near_inner_boundary(options_box.inner_radius, cell, grid)
+		) {
 			Ref_min.data(*cell.data) = mrlvl;
 		} else {
 			Ref_min.data(*cell.data) = 0;
@@ -254,15 +262,41 @@ template<
 
 	pamhd::grid::set_minmax_refinement_level(
 		grid.local_cells(), grid, options_grid,
-		options_sim.time_start, Ref_min, Ref_max, true
+		simulation_time, Ref_min, Ref_max, true
 	);
-	adapt_grid_sw_box(grid, Ref_min, Ref_max);
-	Cell::set_transfer_all(true, Ref_min.type(), Ref_max.type());
-	grid.balance_load();
-	Cell::set_transfer_all(false, Ref_min.type(), Ref_max.type());
-	Ref_max.type().is_stale = false;
-	Ref_min.type().is_stale = false;
 
+} catch (const std::exception& e) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + "): " + e.what());
+} catch (...) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+}
+
+
+/*! Sets solver info for inner and outer boundaries
+
+Returns lists of solar wind, outflow face, edge and vertex
+and planet boundary cells. Must be called again after grid
+has been adapted or load balanced.
+*/
+template<
+	class Grid,
+	class Solver_Info_Getter
+> auto classify_cells_sw_box(
+	const pamhd::Solar_Wind_Box_Options& options_box,
+	Grid& grid,
+	const Solver_Info_Getter& SInfo
+) try {
+	using std::runtime_error;
+	using std::to_string;
+
+	using Cell = Grid::cell_data_type;
+
+	const auto mrlvl = grid.get_maximum_refinement_level();
+	const auto len0 = grid.length.get();
+	const auto indices0 = uint64_t(1) << mrlvl;
+	const std::array<uint64_t, 3> end_indices{
+		len0[0] * indices0, len0[1] * indices0, len0[2] * indices0
+	};
 
 	/*
 	Classify and collect boundary cells
@@ -429,6 +463,52 @@ template<
 }
 
 
+/*! Prepares grid for physics initialization
+
+-maximally refines inner boundary cells + their normal neighbors
+-sets default minimum and maximum target refinement levels
+-sets solver info for inner and outer boundaries
+
+Requires following transfers to be switched on:
+solver info, ...
+*/
+template<
+	class Grid,
+	class Solver_Info_Getter,
+	class Targer_Maximum_Refinement_Level_Getter,
+	class Targer_Minimum_Refinement_Level_Getter
+> auto prepare_grid(
+	const pamhd::Options& options_sim,
+	pamhd::grid::Options& options_grid,
+	const pamhd::Solar_Wind_Box_Options& options_box,
+	Grid& grid,
+	const Solver_Info_Getter& SInfo,
+	const Targer_Maximum_Refinement_Level_Getter& Ref_max,
+	const Targer_Minimum_Refinement_Level_Getter& Ref_min
+) try {
+	using Cell = Grid::cell_data_type;
+
+	refine_inner_cells(options_box.inner_radius, grid);
+	set_minmax_refinement_level_sw_box(
+		options_grid, options_box, options_sim.time_start,
+		grid, Ref_max, Ref_min
+	);
+	adapt_grid_sw_box(grid, Ref_min, Ref_max);
+	Cell::set_transfer_all(true, Ref_min.type(), Ref_max.type());
+	grid.balance_load();
+	Cell::set_transfer_all(false, Ref_min.type(), Ref_max.type());
+	Ref_max.type().is_stale = false;
+	Ref_min.type().is_stale = false;
+
+	return classify_cells_sw_box(options_box, grid, SInfo);
+
+} catch (const std::exception& e) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + "): " + e.what());
+} catch (...) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+}
+
+
 template <
 	class Grid,
 	class Target_Refinement_Level_Min_Getter,
@@ -37,6 +37,7 @@ Author(s): Ilja Honkonen
 #define PAMHD_GRID_VARIABLES_HPP
 
 
+#include "cstdint"
 #include "limits"
 #include "stdexcept"
 #include "string"
@@ -45,6 +46,14 @@ Author(s): Ilja Honkonen
 namespace pamhd {
 namespace grid {
 
+/*! Index of cell's data in arrays of pamhd::grid::Arena.
+
+Different on every process so shouldn't be transferred.
+*/
+struct Arena_Index {
+	using data_type = uint32_t;
+};
+
 /*! Stores whether cell and neighbor share a face.
 
 Non-face neighbors have face_neighbor == 0.
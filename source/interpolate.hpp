@@ -38,6 +38,7 @@ Author(s): Ilja Honkonen
 #define PAMHD_INTERPOLATE_HPP
 
 
+#include "algorithm"
 #include "array"
 
 #include "common_functions.hpp"
@@ -214,6 +215,93 @@ template<class Coord_T, class Data_T> Data_T interpolate(
 	return ret_val;
 }
 
+/*!
+Data indices and weights of linear interpolation to one position.
+
+Indices refer to data in order used by interpolate().
+*/
+struct Interpolation_Stencil {
+	std::array<size_t, 8> index;
+	std::array<double, 8> weight;
+};
+
+
+/*!
+Returns stencil for interpolating data given to interpolate()
+to position coord.
+
+Gives identical result to interpolate() but only uses the 8
+data points of the octant containing coord, since weights of
+other points are zero, and can be reused for several variables.
+
+coord must be within start and end.
+*/
+template<class Coord_T> Interpolation_Stencil get_interpolation_stencil(
+	const Coord_T& coord,
+	const Coord_T& start,
+	const Coord_T& end
+) {
+	using std::max;
+	using std::min;
+
+	// index of lower data point and weight of upper one in each dimension
+	std::array<size_t, 3> lower;
+	std::array<double, 3> upper_w;
+	for (size_t dim = 0; dim < 3; dim++) {
+		const double
+			dr = 0.5 * (end[dim] - start[dim]),
+			r = (coord[dim] - start[dim]) / dr;
+		lower[dim] = (r < 1) ? 0 : 1;
+		upper_w[dim] = min(1.0, max(0.0, r - lower[dim]));
+	}
+
+	Interpolation_Stencil stencil;
+	for (size_t i = 0; i < 8; i++) {
+		const size_t
+			x = i & 1,
+			y = (i >> 1) & 1,
+			z = (i >> 2) & 1;
+		stencil.index[i]
+			= (lower[2] + z) * 9
+			+ (lower[1] + y) * 3
+			+ lower[0] + x;
+		stencil.weight[i]
+			= (x == 0 ? 1 - upper_w[0] : upper_w[0])
+			* (y == 0 ? 1 - upper_w[1] : upper_w[1])
+			* (z == 0 ? 1 - upper_w[2] : upper_w[2]);
+	}
+	return stencil;
+}
+
+
+/*!
+Returns value interpolated from data using given stencil.
+
+Data_T can be a scalar or an array of any size, e.g. several
+vector variables packed together can be interpolated at once.
+*/
+template<class Data_T> Data_T interpolate(
+	const Interpolation_Stencil& stencil,
+	const std::array<Data_T, 27>& data
+) {
+	Data_T ret_val;
+	if constexpr (requires {ret_val.fill(0);}) {
+		ret_val.fill(0);
+		for (size_t i = 0; i < 8; i++) {
+			const auto& item = data[stencil.index[i]];
+			for (size_t j = 0; j < ret_val.size(); j++) {
+				ret_val[j] += stencil.weight[i] * item[j];
+			}
+		}
+	} else {
+		ret_val = 0;
+		for (size_t i = 0; i < 8; i++) {
+			ret_val += stencil.weight[i] * data[stencil.index[i]];
+		}
+	}
+	return ret_val;
+}
+
 } // namespace pamhd
 
 #endif
@@ -0,0 +1,679 @@
+/*
+Compiler of math expressions into bytecode for PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_MATH_COMPILED_EXPRESSION_HPP
+#define PAMHD_MATH_COMPILED_EXPRESSION_HPP
+
+
+#include "algorithm"
+#include "cctype"
+#include "cmath"
+#include "cstdint"
+#include "cstdlib"
+#include "stdexcept"
+#include "string"
+#include "utility"
+#include "vector"
+
+
+namespace pamhd {
+namespace math {
+
+
+/*!
+Math expression compiled into stack machine bytecode.
+
+Supports the subset of muparserx syntax used in simulation
+parameters:
+	- numbers, e.g. 1, 2.5, 3e-4, and constants _pi and _e
+	- variables given to compile()
+	- + - * / ^ and unary - + !
+	- < <= > >= == != && || and c ? a : b
+	- functions sin, cos, tan, asin, acos, atan, sinh, cosh,
+	  tanh, asinh, acosh, atanh, sqrt, exp, ln, log2, log10,
+	  abs, min and max
+	- top level row vector {a, b, ...} of the above
+
+Everything is evaluated in double precision and both
+branches of c ? a : b are evaluated. compile() throws
+std::invalid_argument for anything else in which case
+the caller should fall back to muparserx.
+
+Expressions are evaluated for batches of points at
+once, instruction by instruction, so that the cost of
+interpreting bytecode is amortized over many points.
+*/
+class Compiled_Expression
+{
+public:
+
+	//! input of batch evaluation, stride 0 repeats first value
+	struct Batch_Variable {
+		const double* data = nullptr;
+		size_t stride = 1;
+	};
+
+
+	Compiled_Expression() = default;
+
+	Compiled_Expression(
+		const std::string& expression,
+		const std::vector<std::string>& variable_names
+	) {
+		this->compile(expression, variable_names);
+	}
+
+
+	/*!
+	Compiles given expression.
+
+	Index of each variable in variable_names is used
+	as its index in input of evaluate().
+	*/
+	void compile(
+		const std::string& expression,
+		const std::vector<std::string>& variable_names
+	) {
+		this->clear();
+
+		Parser parser{expression, variable_names, {}, 0};
+		std::vector<Program> new_programs;
+
+		parser.skip_space();
+		if (parser.peek() == '{') {
+			parser.position++;
+			while (true) {
+				new_programs.push_back(parser.compile_component());
+				parser.skip_space();
+				if (parser.peek() == ',') {
+					parser.position++;
+					continue;
+				}
+				parser.expect('}');
+				break;
+			}
+		} else {
+			new_programs.push_back(parser.compile_component());
+		}
+
+		parser.skip_space();
+		if (parser.position < expression.size()) {
+			parser.fail("unexpected character");
+		}
+
+		this->programs = std::move(new_programs);
+		this->nr_variables = variable_names.size();
+	}
+
+
+	void clear()
+	{
+		this->programs.clear();
+		this->nr_variables = 0;
+	}
+
+	bool is_compiled() const
+	{
+		return this->programs.size() > 0;
+	}
+
+	//! returns number of components, 1 for scalar expression
+	size_t get_dimension() const
+	{
+		return this->programs.size();
+	}
+
+
+	/*!
+	Evaluates given component of expression for n points.
+
+	variables[i] is input for i:th variable given to compile(),
+	out must have space for n values.
+	*/
+	void evaluate(
+		const size_t component,
+		const size_t n,
+		const Batch_Variable* const variables,
+		double* const out
+	) const {
+		if (component >= this->programs.size()) {
+			throw std::out_of_range(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Invalid component " + std::to_string(component)
+				+ " of expression with " + std::to_string(this->programs.size())
+			);
+		}
+		const auto& program = this->programs[component];
+
+		this->workspace.resize(program.max_depth * chunk);
+		double* const ws = this->workspace.data();
+
+		for (size_t start = 0; start < n; start += chunk) {
+			const size_t m = std::min(chunk, n - start);
+
+			size_t depth = 0;
+			for (const auto& instruction: program.code) {
+				// operands of binary operations, b is the top of stack
+				double* const a = ws + (depth >= 2 ? depth - 2 : 0) * chunk;
+				double* const b = ws + (depth >= 1 ? depth - 1 : 0) * chunk;
+				switch (instruction.op) {
+				case Op::constant: {
+					double* const d = ws + depth * chunk;
+					for (size_t i = 0; i < m; i++) d[i] = instruction.value;
+					depth++;
+					break;
+				}
+				case Op::variable: {
+					double* const d = ws + depth * chunk;
+					const auto& v = variables[instruction.index];
+					const double* const src = v.data + start * v.stride;
+					if (v.stride == 0) {
+						for (size_t i = 0; i < m; i++) d[i] = src[0];
+					} else {
+						for (size_t i = 0; i < m; i++) d[i] = src[i * v.stride];
+					}
+					depth++;
+					break;
+				}
+				case Op::negate:
+					for (size_t i = 0; i < m; i++) b[i] = -b[i];
+					break;
+				case Op::logical_not:
+					for (size_t i = 0; i < m; i++) b[i] = (b[i] == 0) ? 1 : 0;
+					break;
+				case Op::function:
+					for (size_t i = 0; i < m; i++) b[i] = instruction.function(b[i]);
+					break;
+				case Op::add:
+					for (size_t i = 0; i < m; i++) a[i] += b[i];
+					depth--;
+					break;
+				case Op::subtract:
+					for (size_t i = 0; i < m; i++) a[i] -= b[i];
+					depth--;
+					break;
+				case Op::multiply:
+					for (size_t i = 0; i < m; i++) a[i] *= b[i];
+					depth--;
+					break;
+				case Op::divide:
+					for (size_t i = 0; i < m; i++) a[i] /= b[i];
+					depth--;
+					break;
+				case Op::power:
+					for (size_t i = 0; i < m; i++) a[i] = std::pow(a[i], b[i]);
+					depth--;
+					break;
+				case Op::less:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] < b[i]) ? 1 : 0;
+					depth--;
+					break;
+				case Op::less_equal:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] <= b[i]) ? 1 : 0;
+					depth--;
+					break;
+				case Op::greater:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] > b[i]) ? 1 : 0;
+					depth--;
+					break;
+				case Op::greater_equal:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] >= b[i]) ? 1 : 0;
+					depth--;
+					break;
+				case Op::equal:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] == b[i]) ? 1 : 0;
+					depth--;
+					break;
+				case Op::not_equal:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] != b[i]) ? 1 : 0;
+					depth--;
+					break;
+				case Op::logical_and:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] != 0 and b[i] != 0) ? 1 : 0;
+					depth--;
+					break;
+				case Op::logical_or:
+					for (size_t i = 0; i < m; i++) a[i] = (a[i] != 0 or b[i] != 0) ? 1 : 0;
+					depth--;
+					break;
+				case Op::minimum:
+					for (size_t i = 0; i < m; i++) a[i] = std::min(a[i], b[i]);
+					depth--;
+					break;
+				case Op::maximum:
+					for (size_t i = 0; i < m; i++) a[i] = std::max(a[i], b[i]);
+					depth--;
+					break;
+				case Op::select: {
+					double* const c = ws + (depth - 3) * chunk;
+					for (size_t i = 0; i < m; i++) c[i] = (c[i] != 0) ? a[i] : b[i];
+					depth -= 2;
+					break;
+				}
+				}
+			}
+
+			std::copy(ws, ws + m, out + start);
+		}
+	}
+
+
+	/*!
+	Evaluates given component of expression for one point.
+
+	values[i] is value of i:th variable given to compile().
+	*/
+	double evaluate(
+		const size_t component,
+		const double* const values
+	) const {
+		this->batch_values.resize(this->nr_variables);
+		for (size_t i = 0; i < this->nr_variables; i++) {
+			this->batch_values[i] = {values + i, 0};
+		}
+		double result = 0;
+		this->evaluate(component, 1, this->batch_values.data(), &result);
+		return result;
+	}
+
+
+private:
+
+	static constexpr size_t chunk = 64;
+
+	enum class Op : uint8_t {
+		constant, variable,
+		negate, logical_not, function,
+		add, subtract, multiply, divide, power,
+		less, less_equal, greater, greater_equal, equal, not_equal,
+		logical_and, logical_or, minimum, maximum,
+		select
+	};
+
+	struct Instruction {
+		Op op;
+		size_t index = 0;
+		double value = 0;
+		double (*function)(double) = nullptr;
+	};
+
+	struct Program {
+		std::vector<Instruction> code;
+		size_t max_depth = 0;
+	};
+
+	std::vector<Program> programs;
+	size_t nr_variables = 0;
+	mutable std::vector<double> workspace;
+	mutable std::vector<Batch_Variable> batch_values;
+
+
+	static double (*get_function(const std::string& name))(double)
+	{
+		using F = double (*)(double);
+		static const std::vector<std::pair<std::string, F>> functions{
+			{"sin", [](double a){ return std::sin(a); }},
+			{"cos", [](double a){ return std::cos(a); }},
+			{"tan", [](double a){ return std::tan(a); }},
+			{"asin", [](double a){ return std::asin(a); }},
+			{"acos", [](double a){ return std::acos(a); }},
+			{"atan", [](double a){ return std::atan(a); }},
+			{"sinh", [](double a){ return std::sinh(a); }},
+			{"cosh", [](double a){ return std::cosh(a); }},
+			{"tanh", [](double a){ return std::tanh(a); }},
+			{"asinh", [](double a){ return std::asinh(a); }},
+			{"acosh", [](double a){ return std::acosh(a); }},
+			{"atanh", [](double a){ return std::atanh(a); }},
+			{"sqrt", [](double a){ return std::sqrt(a); }},
+			{"exp", [](double a){ return std::exp(a); }},
+			{"ln", [](double a){ return std::log(a); }},
+			{"log2", [](double a){ return std::log2(a); }},
+			{"log10", [](double a){ return std::log10(a); }},
+			{"abs", [](double a){ return std::abs(a); }}
+		};
+		for (const auto& item: functions) {
+			if (item.first == name) {
+				return item.second;
+			}
+		}
+		return nullptr;
+	}
+
+
+	//! recursive descent parser emitting postfix code
+	struct Parser {
+		const std::string& expression;
+		const std::vector<std::string>& variable_names;
+		Program program;
+		size_t position, depth = 0;
+
+		[[noreturn]] void fail(const std::string& reason) const
+		{
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Couldn't compile expression \"" + this->expression
+				+ "\" at position " + std::to_string(this->position)
+				+ ": " + reason
+			);
+		}
+
+		void skip_space()
+		{
+			while (
+				this->position < this->expression.size()
+				and std::isspace(static_cast<unsigned char>(this->expression[this->position]))
+			) {
+				this->position++;
+			}
+		}
+
+		char peek(const size_t offset = 0) const
+		{
+			if (this->position + offset >= this->expression.size()) {
+				return '\0';
+			}
+			return this->expression[this->position + offset];
+		}
+
+		bool accept(const char* token)
+		{
+			this->skip_space();
+			const size_t length = std::char_traits<char>::length(token);
+			if (this->expression.compare(this->position, length, token) != 0) {
+				return false;
+			}
+			this->position += length;
+			return true;
+		}
+
+		void expect(const char c)
+		{
+			this->skip_space();
+			if (this->peek() != c) {
+				this->fail(std::string("expected ") + c);
+			}
+			this->position++;
+		}
+
+		void emit(const Instruction& instruction, const int depth_change)
+		{
+			this->program.code.push_back(instruction);
+			this->depth += depth_change;
+			this->program.max_depth = std::max(this->program.max_depth, this->depth);
+		}
+
+		Program compile_component()
+		{
+			this->program = Program();
+			this->depth = 0;
+			this->ternary();
+			if (this->depth != 1) {
+				this->fail("internal error");
+			}
+			return std::move(this->program);
+		}
+
+		void ternary()
+		{
+			this->logical_or();
+			if (this->accept("?")) {
+				this->ternary();
+				this->expect(':');
+				this->ternary();
+				this->emit({Op::select}, -2);
+			}
+		}
+
+		void logical_or()
+		{
+			this->logical_and();
+			while (this->accept("||")) {
+				this->logical_and();
+				this->emit({Op::logical_or}, -1);
+			}
+		}
+
+		void logical_and()
+		{
+			this->equality();
+			while (this->accept("&&")) {
+				this->equality();
+				this->emit({Op::logical_and}, -1);
+			}
+		}
+
+		void equality()
+		{
+			this->relation();
+			while (true) {
+				if (this->accept("==")) {
+					this->relation();
+					this->emit({Op::equal}, -1);
+				} else if (this->accept("!=")) {
+					this->relation();
+					this->emit({Op::not_equal}, -1);
+				} else {
+					return;
+				}
+			}
+		}
+
+		void relation()
+		{
+			this->sum();
+			while (true) {
+				if (this->accept("<=")) {
+					this->sum();
+					this->emit({Op::less_equal}, -1);
+				} else if (this->accept(">=")) {
+					this->sum();
+					this->emit({Op::greater_equal}, -1);
+				} else if (this->accept("<")) {
+					this->sum();
+					this->emit({Op::less}, -1);
+				} else if (this->accept(">")) {
+					this->sum();
+					this->emit({Op::greater}, -1);
+				} else {
+					return;
+				}
+			}
+		}
+
+		void sum()
+		{
+			this->product();
+			while (true) {
+				if (this->accept("+")) {
+					this->product();
+					this->emit({Op::add}, -1);
+				} else if (this->accept("-")) {
+					this->product();
+					this->emit({Op::subtract}, -1);
+				} else {
+					return;
+				}
+			}
+		}
+
+		void product()
+		{
+			this->unary();
+			while (true) {
+				if (this->accept("*")) {
+					this->unary();
+					this->emit({Op::multiply}, -1);
+				} else if (this->accept("/")) {
+					this->unary();
+					this->emit({Op::divide}, -1);
+				} else {
+					return;
+				}
+			}
+		}
+
+		/*
+		Precedence of unary operators relative to ^ is
+		ambiguous so e.g. -x^2 is left to muparserx.
+		*/
+		void unary(const bool after_sign = false)
+		{
+			this->skip_space();
+			if (this->peek() == '-') {
+				this->position++;
+				this->unary(true);
+				this->emit({Op::negate}, 0);
+			} else if (this->peek() == '+') {
+				this->position++;
+				this->unary(true);
+			} else if (this->peek() == '!' and this->peek(1) != '=') {
+				this->position++;
+				this->unary(true);
+				this->emit({Op::logical_not}, 0);
+			} else {
+				this->power(after_sign);
+			}
+		}
+
+		// right associative
+		void power(const bool after_sign)
+		{
+			this->primary();
+			if (this->accept("^")) {
+				if (after_sign) {
+					this->fail("sign before power");
+				}
+				this->unary();
+				this->emit({Op::power}, -1);
+			}
+		}
+
+		void primary()
+		{
+			this->skip_space();
+			const char c = this->peek();
+
+			if (c == '(') {
+				this->position++;
+				this->ternary();
+				this->expect(')');
+				return;
+			}
+
+			if (std::isdigit(static_cast<unsigned char>(c)) or c == '.') {
+				const char* const begin = this->expression.c_str() + this->position;
+				char* end = nullptr;
+				const double value = std::strtod(begin, &end);
+				if (end == begin) {
+					this->fail("invalid number");
+				}
+				this->position += end - begin;
+				// reject e.g. unit postfixes or hex numbers
+				const char next = this->peek();
+				if (std::isalpha(static_cast<unsigned char>(next)) or next == '_' or next == '{') {
+					this->fail("unsupported number format");
+				}
+				Instruction instruction{Op::constant};
+				instruction.value = value;
+				this->emit(instruction, +1);
+				return;
+			}
+
+			if (not std::isalpha(static_cast<unsigned char>(c)) and c != '_') {
+				this->fail("unexpected character");
+			}
+
+			std::string name;
+			while (
+				std::isalnum(static_cast<unsigned char>(this->peek()))
+				or this->peek() == '_'
+			) {
+				name += this->peek();
+				this->position++;
+			}
+
+			this->skip_space();
+			if (this->peek() == '(') {
+				this->position++;
+				this->call(name);
+				return;
+			}
+
+			for (size_t i = 0; i < this->variable_names.size(); i++) {
+				if (this->variable_names[i] == name) {
+					Instruction instruction{Op::variable};
+					instruction.index = i;
+					this->emit(instruction, +1);
+					return;
+				}
+			}
+
+			Instruction instruction{Op::constant};
+			if (name == "_pi") {
+				instruction.value = 3.141592653589793238462643383279502884;
+			} else if (name == "_e") {
+				instruction.value = 2.718281828459045235360287471352662498;
+			} else {
+				this->fail("unknown variable " + name);
+			}
+			this->emit(instruction, +1);
+		}
+
+		void call(const std::string& name)
+		{
+			if (name == "min" or name == "max") {
+				const Op op = (name == "min") ? Op::minimum : Op::maximum;
+				this->ternary();
+				while (this->accept(",")) {
+					this->ternary();
+					this->emit({op}, -1);
+				}
+				this->expect(')');
+				return;
+			}
+
+			const auto function = get_function(name);
+			if (function == nullptr) {
+				this->fail("unsupported function " + name);
+			}
+			this->ternary();
+			this->expect(')');
+			Instruction instruction{Op::function};
+			instruction.function = function;
+			this->emit(instruction, 0);
+		}
+	};
+};
+
+}} // namespaces
+
+#endif // ifndef PAMHD_MATH_COMPILED_EXPRESSION_HPP
@@ -38,13 +38,18 @@ Author(s): Ilja Honkonen
 #define PAMHD_MATH_EXPRESSION_HPP
 
 
+#include "cmath"
+#include "set"
 #include "stdexcept"
 #include "string"
 #include "type_traits"
 #include "utility"
+#include "vector"
 
 #include "mpParser.h"
 
+#include "math/compiled_expression.hpp"
+
 
 namespace pamhd {
 namespace math {
@@ -55,6 +60,9 @@ Variables available in expression, all are of floating point type:
 	- t: simulation time
 	- x, y, z: center of simulation cell in cartesian coordinates
 	- radius, lat, lon: center in spherical coordinates
+
+Expressions are validated with muparserx and if possible
+evaluated with Compiled_Expression, otherwise with muparserx.
 */
 template<class Variable> class Expression
 {
@@ -99,18 +107,84 @@ public:
 		mup::Variable& variable
 	) {
 		this->parser.DefineVar(name, variable);
+		this->extra_names.push_back(name);
+		this->extra_variables.push_back(&variable);
+		this->dependencies = -1;
+		this->compile();
 	}
 
 
 	void clear_expression_variables()
 	{
 		this->parser.ClearVar();
+		this->default_variables = false;
+		this->extra_names.clear();
+		this->extra_variables.clear();
+		this->dependencies = -1;
+		this->compile();
 	}
 
 
 	void set_expression(const std::string& expression)
 	{
 		this->parser.SetExpr(expression);
+		this->dependencies = -1;
+		this->compile();
+	}
+
+
+	//! returns true if expression is evaluated without muparserx
+	bool is_compiled() const
+	{
+		return this->compiled.is_compiled();
+	}
+
+
+	/*!
+	Returns names of all variables used by current expression.
+	*/
+	std::set<std::string> get_used_variables() const
+	{
+		std::set<std::string> names;
+		try {
+			for (const auto& item: this->parser.GetExprVar()) {
+				names.insert(item.first);
+			}
+		} catch(const mup::ParserError& error) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Couldn't parse expression \"" + this->parser.GetExpr()
+				+ "\" for variable " + Variable::get_name()
+				+ ": " + error.GetMsg()
+			);
+		}
+		return names;
+	}
+
+	bool depends_on(const std::string& name) const
+	{
+		return this->get_used_variables().count(name) > 0;
+	}
+
+
+	/*!
+	Returns true if current expression uses simulation time.
+	*/
+	bool is_time_dependent() const
+	{
+		this->update_dependencies();
+		return (this->dependencies & 1) > 0;
+	}
+
+	/*!
+	Returns true if current expression uses no other variables
+	than t, x, y, z, radius, lat and lon, i.e. its value
+	at a given position and time never changes.
+	*/
+	bool uses_only_default_variables() const
+	{
+		this->update_dependencies();
+		return (this->dependencies & 2) == 0;
 	}
 
 	std::string get_expression() const
@@ -128,6 +202,34 @@ public:
 		const double& latitude,
 		const double& longitude
 	) {
+		if (this->compiled.is_compiled()) {
+			this->values.resize(nr_default_variables + this->extra_variables.size());
+			this->values[0] = t;
+			this->values[1] = x;
+			this->values[2] = y;
+			this->values[3] = z;
+			this->values[4] = radius;
+			this->values[5] = latitude;
+			this->values[6] = longitude;
+			for (size_t i = 0; i < this->extra_variables.size(); i++) {
+				this->values[nr_default_variables + i] = this->extra_variables[i]->GetFloat();
+			}
+
+			if constexpr (std::is_arithmetic_v<typename Variable::data_type>) {
+				return this->convert<typename Variable::data_type>(
+					this->compiled.evaluate(0, this->values.data())
+				);
+			} else {
+				typename Variable::data_type ret_val;
+				for (size_t i = 0; i < ret_val.size(); i++) {
+					ret_val[i] = this->convert<typename Variable::data_type::value_type>(
+						this->compiled.evaluate(i, this->values.data())
+					);
+				}
+				return ret_val;
+			}
+		}
+
 		this->t_val = t;
 		this->x_val = x;
 		this->y_val = y;
@@ -149,12 +251,180 @@ public:
 	}
 
 
+	/*!
+	Evaluates expression at n points.
+
+	Values of variables added with add_expression_variable()
+	are given in extra_values, in same order as added and
+	each with n values. out must have space for n values.
+
+	Points are evaluated in batches if expression is compiled
+	and one by one otherwise, in which case extra_values must
+	be empty.
+	*/
+	void evaluate(
+		const size_t n,
+		const double& t,
+		const double* const x,
+		const double* const y,
+		const double* const z,
+		const double* const radius,
+		const double* const latitude,
+		const double* const longitude,
+		typename Variable::data_type* const out,
+		const std::vector<const double*>& extra_values = {}
+	) {
+		using Data = typename Variable::data_type;
+
+		if (not this->compiled.is_compiled()) {
+			if (extra_values.size() > 0) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "Expression \"" + this->parser.GetExpr()
+					+ "\" for variable " + Variable::get_name()
+					+ " isn't compiled, can't evaluate with extra variables."
+				);
+			}
+			for (size_t i = 0; i < n; i++) {
+				out[i] = this->evaluate(
+					t, x[i], y[i], z[i], radius[i], latitude[i], longitude[i]
+				);
+			}
+			return;
+		}
+
+		if (extra_values.size() != this->extra_variables.size()) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Wrong number of extra variables for expression \""
+				+ this->parser.GetExpr() + "\": " + std::to_string(extra_values.size())
+				+ ", should be " + std::to_string(this->extra_variables.size())
+			);
+		}
+
+		std::vector<Compiled_Expression::Batch_Variable> inputs{
+			{&t, 0}, {x, 1}, {y, 1}, {z, 1},
+			{radius, 1}, {latitude, 1}, {longitude, 1}
+		};
+		for (const auto& extra: extra_values) {
+			inputs.push_back({extra, 1});
+		}
+
+		if constexpr (std::is_same_v<Data, double>) {
+			this->compiled.evaluate(0, n, inputs.data(), out);
+		} else if constexpr (std::is_arithmetic_v<Data>) {
+			this->values.resize(n);
+			this->compiled.evaluate(0, n, inputs.data(), this->values.data());
+			for (size_t i = 0; i < n; i++) {
+				out[i] = this->convert<Data>(this->values[i]);
+			}
+		} else {
+			this->values.resize(n);
+			for (size_t dim = 0; dim < this->compiled.get_dimension(); dim++) {
+				this->compiled.evaluate(dim, n, inputs.data(), this->values.data());
+				for (size_t i = 0; i < n; i++) {
+					out[i][dim] = this->convert<typename Data::value_type>(this->values[i]);
+				}
+			}
+		}
+	}
+
+
 private:
 
 	mup::ParserX parser = mup::ParserX(mup::pckCOMMON | mup::pckNON_COMPLEX | mup::pckMATRIX | mup::pckUNIT);
 	mup::Value t_val, x_val, y_val, z_val, radius_val, lat_val, lon_val;
 	mup::Variable t_var, x_var, y_var, z_var, radius_var, lat_var, lon_var;
 
+	/*
+	Variables used by current expression, -1 if not known,
+	otherwise bit 0 is set if t is used and bit 1 is set
+	if variables other than defaults are used.
+	*/
+	mutable int dependencies = -1;
+
+	static constexpr size_t nr_default_variables = 7;
+	bool default_variables = true;
+	std::vector<std::string> extra_names;
+	std::vector<mup::Variable*> extra_variables;
+	Compiled_Expression compiled;
+	std::vector<double> values;
+
+	/*
+	Compiles current expression if muparserx accepts it,
+	compiled expression is disabled if muparserx or
+	Compiled_Expression doesn't support it.
+	*/
+	void compile()
+	{
+		this->compiled.clear();
+		try {
+			this->parser.GetExprVar();
+		} catch (const mup::ParserError&) {
+			return;
+		}
+
+		std::vector<std::string> names;
+		if (this->default_variables) {
+			names = {"t", "x", "y", "z", "radius", "lat", "lon"};
+		} else {
+			// unmatchable names keep extra variables at same index
+			names.resize(nr_default_variables, "");
+		}
+		names.insert(names.end(), this->extra_names.cbegin(), this->extra_names.cend());
+
+		size_t dimension = 1;
+		if constexpr (not std::is_arithmetic_v<typename Variable::data_type>) {
+			dimension = std::tuple_size<typename Variable::data_type>::value;
+		}
+
+		try {
+			this->compiled.compile(this->parser.GetExpr(), names);
+		} catch (const std::invalid_argument&) {
+			this->compiled.clear();
+			return;
+		}
+		if (this->compiled.get_dimension() != dimension) {
+			this->compiled.clear();
+		}
+	}
+
+	//! converts result of compiled expression to type of variable
+	template<class T> T convert(const double value) const
+	{
+		if constexpr (std::is_integral_v<T>) {
+			if (std::trunc(value) != value) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "Expression \"" + this->parser.GetExpr()
+					+ "\" for variable " + Variable::get_name()
+					+ " isn't an integer: " + std::to_string(value)
+				);
+			}
+		}
+		return static_cast<T>(value);
+	}
+
+	void update_dependencies() const
+	{
+		if (this->dependencies >= 0) {
+			return;
+		}
+
+		int new_dependencies = 0;
+		for (const auto& name: this->get_used_variables()) {
+			if (name == "t") {
+				new_dependencies |= 1;
+			} else if (
+				name != "x" and name != "y" and name != "z"
+				and name != "radius" and name != "lat" and name != "lon"
+			) {
+				new_dependencies |= 2;
+			}
+		}
+		this->dependencies = new_dependencies;
+	}
+
 
 	//! used to evaluate math expression if Variable::data_type is integral
 	template<class V = Variable> typename std::enable_if<
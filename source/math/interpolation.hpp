@@ -40,6 +40,7 @@ Author(s): Ilja Honkonen
 #include "string"
 
 #include "common_variables.hpp"
+#include "grid/halo_exchange.hpp"
 
 
 namespace pamhd {
@@ -71,21 +72,7 @@ template<
 
 	Tgt.type().is_stale = true;
 
-	bool update_copies = false;
-	if (Src.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Src.type());
-		Src.type().is_stale = false;
-	}
-	if (Type.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Type.type());
-		Type.type().is_stale = false;
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-		Cell::set_transfer_all(false, Src.type(), Type.type());
-	}
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, Src, Type);
 
 	for (const auto& cell: grid.local_cells()) {
 		if (Type.data(*cell.data) <= 0) continue;
@@ -170,74 +157,82 @@ template<
 }
 
 
-/*! Interpolates data from cell's vertices to arbitrary location.
+/*! Returns weights of cell's vertices for interpolating to arbitrary location.
 
-Assumes data is wrapped in pamhd::Vertex_Type.
+Weights can be given to vertex2r() for interpolating several
+variables to same location.
 
 Uses trilinear interpolation.
 */
-auto vertex2r(
+pamhd::Vertex_Type<double> get_vertex_weights(
 	const auto& r,
 	const auto& cell_end,
-	const auto& cell_length,
-	const auto& data
-) try {
+	const auto& cell_length
+) {
 	static_assert(requires{r[0];r[1];r[2];});
 
 	using std::max;
 	using std::min;
 
-	pamhd::Vertex_Type<double> weight;
-	for (int x: {-1, +1})
-	for (int y: {-1, +1})
-	for (int z: {-1, +1}) {
-		weight(x, y, z) = 1;
-	}
+	const double
+		neg_x = min(1.0, max(0.0, (cell_end[0] - r[0]) / cell_length[0])),
+		neg_y = min(1.0, max(0.0, (cell_end[1] - r[1]) / cell_length[1])),
+		neg_z = min(1.0, max(0.0, (cell_end[2] - r[2]) / cell_length[2]));
 
-	const double neg_x = min(1.0, max(0.0, (cell_end[0] - r[0]) / cell_length[0]));
-	for (int y: {-1, +1})
-	for (int z: {-1, +1}) {
-		weight(-1, y, z) *= neg_x;
-		weight(+1, y, z) *= 1 - neg_x;
+	// same order as in Vertex_Type
+	pamhd::Vertex_Type<double> weight;
+	for (size_t i = 0; i < weight.vertex.size(); i++) {
+		weight.vertex[i]
+			= ((i & 1) == 0 ? neg_x : 1 - neg_x)
+			* ((i & 2) == 0 ? neg_y : 1 - neg_y)
+			* ((i & 4) == 0 ? neg_z : 1 - neg_z);
 	}
+	return weight;
+}
 
-	const double neg_y = min(1.0, max(0.0, (cell_end[1] - r[1]) / cell_length[1]));
-	for (int x: {-1, +1})
-	for (int z: {-1, +1}) {
-		weight(x, -1, z) *= neg_y;
-		weight(x, +1, z) *= 1 - neg_y;
-	}
 
-	const double neg_z = min(1.0, max(0.0, (cell_end[2] - r[2]) / cell_length[2]));
-	for (int x: {-1, +1})
-	for (int y: {-1, +1}) {
-		weight(x, y, -1) *= neg_z;
-		weight(x, y, +1) *= 1 - neg_z;
-	}
+/*! Interpolates data from cell's vertices using given weights.
 
-	auto result = data(0,0,0);
+Assumes data is wrapped in pamhd::Vertex_Type,
+weight is from get_vertex_weights().
+*/
+auto vertex2r(
+	const pamhd::Vertex_Type<double>& weight,
+	const auto& data
+) {
+	auto result = data.vertex[0];
 	if constexpr(requires {result = 0;}) {
 		result = 0;
-	} else if constexpr(requires {result.fill(0);}) {
+		for (size_t i = 0; i < weight.vertex.size(); i++) {
+			result += weight.vertex[i] * data.vertex[i];
+		}
+	} else if constexpr (requires {result[result.size()-1] = 0;}) {
 		result.fill(0);
-	} else {
-		static_assert("Given data is of unsupported type");
-	}
-	for (int x: {-1, +1})
-	for (int y: {-1, +1})
-	for (int z: {-1, +1}) {
-		if constexpr(requires {result = 0;}) {
-			result += weight(x,y,z) * data(x,y,z);
-		} else if constexpr (requires {result[result.size()-1] = 0;}) {
-			for (size_t i = 0; i < result.size(); i++) {
-				result[i] += weight(x,y,z) * data(x,y,z)[i];
+		for (size_t i = 0; i < weight.vertex.size(); i++) {
+			for (size_t j = 0; j < result.size(); j++) {
+				result[j] += weight.vertex[i] * data.vertex[i][j];
 			}
-		} else {
-			static_assert("Given data is of unsupported type");
 		}
+	} else {
+		static_assert("Given data is of unsupported type");
 	}
 	return result;
+}
+
+
+/*! Interpolates data from cell's vertices to arbitrary location.
+
+Assumes data is wrapped in pamhd::Vertex_Type.
 
+Uses trilinear interpolation.
+*/
+auto vertex2r(
+	const auto& r,
+	const auto& cell_end,
+	const auto& cell_length,
+	const auto& data
+) try {
+	return vertex2r(get_vertex_weights(r, cell_end, cell_length), data);
 } catch (const std::exception& e) {
 	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + "): " + e.what());
 } catch (...) {
@@ -432,21 +427,7 @@ template<
 
 	Tgt.type().is_stale = true;
 
-	bool update_copies = false;
-	if (Src.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Src.type());
-		Src.type().is_stale = false;
-	}
-	if (Type.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Type.type());
-		Type.type().is_stale = false;
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-		Cell::set_transfer_all(false, Src.type(), Type.type());
-	}
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, Src, Type);
 
 	for (const auto& cell: grid.local_cells()) {
 		if (Type.data(*cell.data) <= 0) continue;
@@ -39,10 +39,16 @@ Author(s): Ilja Honkonen
 #define PAMHD_MATH_NABLA_HPP
 
 
+#include "array"
+#include "cmath"
+#include "cstdint"
 #include "string"
+#include "utility"
 
 #include "mpi.h"
 
+#include "grid/halo_exchange.hpp"
+
 
 namespace pamhd {
 namespace math {
@@ -53,7 +59,9 @@ namespace math {
 Assumes Face_Var is scalar wrapped in pamhd::Face_Type and
 Divergence is scalar.
 
-Returns average absolute divergence in cells of all processes.
+Returns sum of absolute divergence and number of cells in which
+it was calculated on this process, for reducing with other
+values e.g. by pamhd::Reductions.
 */
 template <
 	class Cell_Iterator,
@@ -61,15 +69,15 @@ template <
 	class Face_Var_Getter,
 	class Divergence_Getter,
 	class Cell_Type_Getter
-> double get_divergence_face2volume(
+> std::pair<double, uint64_t> get_local_divergence_face2volume(
 	const Cell_Iterator& cells,
 	Grid& grid,
 	const Face_Var_Getter& Face_Var,
 	const Divergence_Getter& Divergence,
 	const Cell_Type_Getter& Cell_Type
 ) {
-	double local_divergence = 0, global_divergence = 0;
-	uint64_t local_calculated_cells = 0, global_calculated_cells = 0;
+	double local_divergence = 0;
+	uint64_t local_calculated_cells = 0;
 	for (const auto& cell: cells) {
 		if (Cell_Type.data(*cell.data) <= 0) {
 			continue;
@@ -86,30 +94,49 @@ template <
 		}
 		local_divergence += std::abs(div);
 	}
+	return {local_divergence, local_calculated_cells};
+}
+
+
+/*! Calculates divergence of cell face variable at cell center.
+
+Same as get_local_divergence_face2volume() but returns
+average absolute divergence in cells of all processes.
+*/
+template <
+	class Cell_Iterator,
+	class Grid,
+	class Face_Var_Getter,
+	class Divergence_Getter,
+	class Cell_Type_Getter
+> double get_divergence_face2volume(
+	const Cell_Iterator& cells,
+	Grid& grid,
+	const Face_Var_Getter& Face_Var,
+	const Divergence_Getter& Divergence,
+	const Cell_Type_Getter& Cell_Type
+) {
+	const auto local = get_local_divergence_face2volume(
+		cells, grid, Face_Var, Divergence, Cell_Type
+	);
 
+	// divergence and number of cells in one reduction
+	std::array<double, 2> global{local.first, double(local.second)};
 	MPI_Comm comm = grid.get_communicator();
 	MPI_Allreduce(
-		&local_divergence,
-		&global_divergence,
-		1,
+		MPI_IN_PLACE,
+		global.data(),
+		2,
 		MPI_DOUBLE,
 		MPI_SUM,
 		comm
 	);
-	MPI_Allreduce(
-		&local_calculated_cells,
-		&global_calculated_cells,
-		1,
-		MPI_UINT64_T,
-		MPI_SUM,
-		comm
-	);
 	MPI_Comm_free(&comm);
 
-	if (global_calculated_cells == 0) {
+	if (global[1] == 0) {
 		return 0.0;
 	}
-	return global_divergence / global_calculated_cells;
+	return global[0] / global[1];
 }
 
 
@@ -134,21 +161,7 @@ template <
 
 	using Cell = Grid::cell_data_type;
 
-	bool update_copies = false;
-	if (CType.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, CType.type());
-		CType.type().is_stale = false;
-	}
-	if (Vol_B.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Vol_B.type());
-		Vol_B.type().is_stale = false;
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-	}
-	Cell::set_transfer_all(false, CType.type(), Vol_B.type());
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, CType, Vol_B);
 
 	for (const auto& cell: grid.local_cells()) {
 		if (CType.data(*cell.data) < 0) {
@@ -292,21 +305,7 @@ template <
 
 	Tgt.type().is_stale = true;
 
-	bool update_copies = false;
-	if (CType.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, CType.type());
-		CType.type().is_stale = false;
-	}
-	if (Src.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Src.type());
-		Src.type().is_stale = false;
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-	}
-	Cell::set_transfer_all(false, CType.type(), Src.type());
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, CType, Src);
 
 	for (const auto& cell: grid.local_cells()) {
 		if (CType.data(*cell.data) <= 0) continue;
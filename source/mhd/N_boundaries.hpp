@@ -370,28 +370,17 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(N, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto mass_density
 				= proton_mass
 				* value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-				abort();
-			}
-
 			Mas(*cell_data) = mass_density;
 		}
 	}
@@ -430,28 +419,17 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(N2, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto mass_density
 				= proton_mass
 				* value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-				abort();
-			}
-
 			Mas2(*cell_data) = mass_density;
 		}
 	}
@@ -491,26 +469,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(V, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto velocity = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-				abort();
-			}
-
 			Mom(*cell_data) = Mas(*cell_data) * velocity;
 		}
 	}
@@ -552,26 +519,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(V2, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto velocity = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-				abort();
-			}
-
 			Mom2(*cell_data) = Mas2(*cell_data) * velocity;
 		}
 	}
@@ -614,26 +570,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(P, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto pressure = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-				abort();
-			}
-
 			if (Mas(*cell_data) > 0 and pressure > 0) {
 				Nrj(*cell_data) = pamhd::mhd::get_total_energy_density(
 					Mas(*cell_data),
@@ -701,26 +646,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(P2, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto pressure = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-				abort();
-			}
-
 			if (Mas2(*cell_data) > 0 and pressure > 0) {
 				Nrj2(*cell_data) = pamhd::mhd::get_total_energy_density(
 					Mas2(*cell_data),
@@ -789,26 +723,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(B, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto magnetic_field = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-				abort();
-			}
-
 			Mag(*cell_data) = magnetic_field;
 
 			// add magnetic field contribution to total energy densities
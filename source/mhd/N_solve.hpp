@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PAMHD_MHD_N_SOLVE_HPP
 
 
+#include "algorithm"
 #include "cmath"
 #include "limits"
 #include "string"
@@ -54,12 +55,54 @@ namespace pamhd {
 namespace mhd {
 
 
+namespace detail {
+
+//! Default type of cleaning getters, disables divergence cleaning.
+struct No_Cleaning {};
+
+} // namespace detail
+
+
+/*!
+Returns length of shortest edge of given cells.
+
+Limits speed of divergence cleaning in N_solve(), must
+be called again after cells of grid change.
+*/
+template <
+	class Cell_Iterator,
+	class Grid
+> double get_min_cell_length(
+	const Cell_Iterator& cells,
+	Grid& grid
+) {
+	double min_length = std::numeric_limits<double>::max();
+	for (const auto& cell: cells) {
+		const auto length = grid.geometry.get_length(cell.id);
+		min_length = std::min(
+			min_length,
+			std::min(length[0], std::min(length[1], length[2]))
+		);
+	}
+	return min_length;
+}
+
+
 /*!
 Advances MHD solution for one time step of length dt with given solver.
 
 *_Getters should be a pair of objects that return a reference to given variable
 of population 1 and 2 respectively when given a reference to simulation cell data. 
 
+If Psi and Psi_f are given and cleaning_speed > 0 divergence of magnetic
+field is also cleaned with generalized Lagrange multiplier (GLM) method of
+Dedner et al. (doi:10.1006/jcph.2001.6961): normal component of magnetic
+field and potential psi are upwinded at faces with cleaning_speed, and psi
+is damped by exp(-cleaning_damping * cleaning_speed * dt / cell length) as
+in Mignone & Tzeferacos (doi:10.1016/j.jcp.2009.11.026). cleaning_speed * dt
+must not exceed length of smallest cell and isn't included in returned
+time step.
+
 Returns the maximum allowed length of time step for the next step on this process.
 */
 template <
@@ -75,7 +118,9 @@ template <
 	class Momentum_Density_Flux_Getters,
 	class Total_Energy_Density_Flux_Getters,
 	class Magnetic_Field_Flux_Getter,
-	class Solver_Info_Getter
+	class Solver_Info_Getter,
+	class Cleaning_Potential_Getter = detail::No_Cleaning,
+	class Cleaning_Potential_Flux_Getter = detail::No_Cleaning
 > double N_solve(
 	const Solver solver,
 	const Cell_Iterator& cells,
@@ -92,11 +137,18 @@ template <
 	const Momentum_Density_Flux_Getters Mom_f,
 	const Total_Energy_Density_Flux_Getters Nrj_f,
 	const Magnetic_Field_Flux_Getter Mag_f,
-	const Solver_Info_Getter SInfo
+	const Solver_Info_Getter SInfo,
+	const Cleaning_Potential_Getter Psi = {},
+	const Cleaning_Potential_Flux_Getter Psi_f = {},
+	const double cleaning_speed = 0,
+	const double cleaning_damping = 0
 ) {
 	using std::get;
 	using std::to_string;
 
+	constexpr bool clean_div
+		= not std::is_same_v<Cleaning_Potential_Getter, detail::No_Cleaning>;
+
 	if (not std::isfinite(dt) or dt < 0) {
 		throw std::domain_error(
 			"Invalid time step: "
@@ -104,6 +156,22 @@ template <
 		);
 	}
 
+	if constexpr (clean_div) {
+		if (not std::isfinite(cleaning_speed) or cleaning_speed < 0) {
+			throw std::domain_error(
+				"Invalid divergence cleaning speed: "
+				+ to_string(cleaning_speed)
+			);
+		}
+		if (not std::isfinite(cleaning_damping) or cleaning_damping < 0) {
+			throw std::domain_error(
+				"Invalid divergence cleaning damping: "
+				+ to_string(cleaning_damping)
+			);
+		}
+	}
+	const bool cleaning = clean_div and cleaning_speed > 0;
+
 	// shorthand for referring to variables of internal MHD data type
 	const Mass_Density mas_int{};
 	const Momentum_Density mom_int{};
@@ -124,6 +192,19 @@ template <
 			}};
 		const int cell_length_i = grid.mapping.get_cell_length_in_indices(cell.id);
 
+		// damp psi as a source term applied with other fluxes
+		if constexpr (clean_div) {
+			if (cleaning and SInfo(*cell.data) >= 0) {
+				const double min_length = std::min(
+					cell_length[0], std::min(cell_length[1], cell_length[2])
+				);
+				Psi_f(*cell.data)
+					-= cell_length[0] * cell_length[1] * cell_length[2]
+					* Psi(*cell.data)
+					* (1 - std::exp(-cleaning_damping * cleaning_speed * dt / min_length));
+			}
+		}
+
 		for (const auto& neighbor: cell.neighbors_of) {
 			// don't solve between dont_solve_cell and any other
 			if (SInfo(*cell.data) < 0) {
@@ -345,6 +426,28 @@ template <
 
 			max_dt = std::min(max_dt, cell_length[neighbor_dim] / max_vel);
 
+			// replace flux of normal B with upwinded GLM fluxes
+			double psi_flux = 0;
+			if constexpr (clean_div) {
+				if (cleaning) {
+					const double
+						psi_neg = direction > 0 ? Psi(*cell.data) : Psi(*neighbor.data),
+						psi_pos = direction > 0 ? Psi(*neighbor.data) : Psi(*cell.data),
+						bn_neg = state_neg[mag_int][0],
+						bn_pos = state_pos[mag_int][0],
+						psi_face
+							= 0.5 * (psi_neg + psi_pos)
+							- 0.5 * cleaning_speed * (bn_pos - bn_neg),
+						bn_face
+							= 0.5 * (bn_neg + bn_pos)
+							- 0.5 * (psi_pos - psi_neg) / cleaning_speed;
+
+					flux_neg[mag_int][0] = shared_area * dt * psi_face;
+					flux_pos[mag_int][0] = 0;
+					psi_flux = shared_area * dt * cleaning_speed * cleaning_speed * bn_face;
+				}
+			}
+
 			// rotate flux back
 			flux_neg[mom_int] = get_rotated_vector(flux_neg[mom_int], -abs(direction));
 			flux_pos[mom_int] = get_rotated_vector(flux_pos[mom_int], -abs(direction));
@@ -366,6 +469,17 @@ template <
 					= Mas.second(*neighbor.data)
 					/ (Mas.first(*neighbor.data) + Mas.second(*neighbor.data));
 
+			if constexpr (clean_div) {
+				if (direction > 0) {
+					Psi_f(*cell.data) -= psi_flux;
+					if (grid.is_local(neighbor.id)) {
+						Psi_f(*neighbor.data) += psi_flux;
+					}
+				} else {
+					Psi_f(*cell.data) += psi_flux;
+				}
+			}
+
 			if (direction > 0) {
 				Mag_f(*cell.data) -= flux_neg[mag_int] + flux_pos[mag_int];
 
@@ -455,6 +569,8 @@ template <
 /*!
 Applies the MHD solution to given cells.
 
+Also applies flux of divergence cleaning potential if Psi and Psi_f are given.
+
 Returns 1 + last index where solution was applied.
 */
 template <
@@ -467,7 +583,9 @@ template <
 	class Momentum_Density_Flux_Getters,
 	class Total_Energy_Density_Flux_Getters,
 	class Magnetic_Field_Flux_Getter,
-	class Solver_Info_Getter
+	class Solver_Info_Getter,
+	class Cleaning_Potential_Getter = detail::No_Cleaning,
+	class Cleaning_Potential_Flux_Getter = detail::No_Cleaning
 > void apply_fluxes_N(
 	Grid& grid,
 	const double min_pressure,
@@ -481,9 +599,23 @@ template <
 	const Momentum_Density_Flux_Getters Mom_f,
 	const Total_Energy_Density_Flux_Getters Nrj_f,
 	const Magnetic_Field_Flux_Getter Mag_f,
-	const Solver_Info_Getter SInfo
+	const Solver_Info_Getter SInfo,
+	const Cleaning_Potential_Getter Psi = {},
+	const Cleaning_Potential_Flux_Getter Psi_f = {}
 ) {
+	constexpr bool clean_div
+		= not std::is_same_v<Cleaning_Potential_Getter, detail::No_Cleaning>;
+
 	for (auto& cell: grid.local_cells()) {
+		if constexpr (clean_div) {
+			if (SInfo(*cell.data) == 0) {
+				const auto length = grid.geometry.get_length(cell.id);
+				Psi(*cell.data)
+					+= Psi_f(*cell.data) / (length[0] * length[1] * length[2]);
+			}
+			Psi_f(*cell.data) = 0;
+		}
+
 		if (SInfo(*cell.data) < 0) {
 			Mas_f.first(*cell.data)     =
 			Mas_f.second(*cell.data)    =
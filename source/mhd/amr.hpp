@@ -224,29 +224,321 @@ template <
 }
 
 
-// Handlers that handle all parameters required by MHD test program.
+/*!
+Sets magnetic field of new cells from their parents.
+
+Faces of new cell that coincide with parent's face get
+parent's face B, others average of parent's face B so
+that volume B of parent needn't be up to date, background
+field is evaluated at new cell's faces.
+*/
+template <
+	class Face_Magnetic_Field_Getter,
+	class Volume_Magnetic_Field_Getter,
+	class Background_Magnetic_Field_Getter,
+	class Background_Magnetic_Field
+> struct Magnetic_Field_New_Cells_Handler {
+	const Face_Magnetic_Field_Getter& Face_B;
+	const Volume_Magnetic_Field_Getter& Vol_B;
+	const Background_Magnetic_Field_Getter& Bg_B;
+	const Background_Magnetic_Field& bg_B;
+	const double& vacuum_permeability;
+
+	Magnetic_Field_New_Cells_Handler(
+		const Face_Magnetic_Field_Getter& Face_B_,
+		const Volume_Magnetic_Field_Getter& Vol_B_,
+		const Background_Magnetic_Field_Getter& Bg_B_,
+		const Background_Magnetic_Field& bg_B_,
+		const double& vacuum_permeability_
+	) :
+		Face_B(Face_B_), Vol_B(Vol_B_), Bg_B(Bg_B_), bg_B(bg_B_),
+		vacuum_permeability(vacuum_permeability_)
+	{};
+
+	template<
+		class Grid,
+		class Cells
+	> void operator()(
+		const Grid& grid,
+		const Cells& new_cells
+	) const {
+		using std::runtime_error;
+		using std::to_string;
+
+		for (const auto& new_cell_id: new_cells) {
+			auto* const cell_data = grid[new_cell_id];
+			if (cell_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+
+			const auto parent_id = grid.mapping.get_parent(new_cell_id);
+			auto* const parent_data = grid[parent_id];
+			if (parent_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+
+			const auto
+				cindex = grid.mapping.get_indices(new_cell_id),
+				pindex = grid.mapping.get_indices(parent_id);
+			for (auto dim: {0, 1, 2}) {
+				const int side = [&](){
+					if (cindex[dim] == pindex[dim]) {
+						// neg faces coincide
+						return -1;
+					} else {
+						// pos faces coincide
+						return +1;
+					}
+				}();
+				Face_B.data(*cell_data)(dim, side) = Face_B.data(*parent_data)(dim, side);
+				Face_B.data(*cell_data)(dim, -side) = 0.5 * (
+					Face_B.data(*parent_data)(dim, -1)
+					+ Face_B.data(*parent_data)(dim, +1));
+			}
+
+			for (auto dim: {0, 1, 2}) {
+				Vol_B.data(*cell_data)[dim] = 0.5 * (Face_B.data(*cell_data)(dim, -1) + Face_B.data(*cell_data)(dim, +1));
+			}
+
+			set_background_field(grid, new_cell_id, *cell_data);
+		}
+	}
+
+	template<class Grid, class Cell> void set_background_field(
+		const Grid& grid,
+		const uint64_t cell_id,
+		Cell& cell_data
+	) const {
+		const auto [
+			center, start, end
+		] = pamhd::grid::get_cell_geom_emulated(grid, cell_id);
+		const auto [rx, ry, rz] = center;
+		const auto [sx, sy, sz] = start;
+		const auto [ex, ey, ez] = end;
+		Bg_B.data(cell_data)(0, -1) = bg_B.get_background_field(
+			{sx, ry, rz},
+			vacuum_permeability
+		);
+		Bg_B.data(cell_data)(0, +1) = bg_B.get_background_field(
+			{ex, ry, rz},
+			vacuum_permeability
+		);
+		Bg_B.data(cell_data)(1, -1) = bg_B.get_background_field(
+			{rx, sy, rz},
+			vacuum_permeability
+		);
+		Bg_B.data(cell_data)(1, +1) = bg_B.get_background_field(
+			{rx, ey, rz},
+			vacuum_permeability
+		);
+		Bg_B.data(cell_data)(2, -1) = bg_B.get_background_field(
+			{rx, ry, sz},
+			vacuum_permeability
+		);
+		Bg_B.data(cell_data)(2, +1) = bg_B.get_background_field(
+			{rx, ry, ez},
+			vacuum_permeability
+		);
+	}
+};
+
+
+/*!
+Sets magnetic field of parents of removed cells.
+
+Parent's face B is average of face B of children sharing
+that face, volume B is average of parent's face B.
+*/
 template <
-	class Mass_Density_Getter,
-	class Momentum_Density_Getter,
-	class Total_Energy_Density_Getter,
 	class Face_Magnetic_Field_Getter,
 	class Volume_Magnetic_Field_Getter,
 	class Background_Magnetic_Field_Getter,
+	class Background_Magnetic_Field
+> struct Magnetic_Field_Removed_Cells_Handler {
+	const Magnetic_Field_New_Cells_Handler<
+		Face_Magnetic_Field_Getter,
+		Volume_Magnetic_Field_Getter,
+		Background_Magnetic_Field_Getter,
+		Background_Magnetic_Field
+	> nch;
+
+	Magnetic_Field_Removed_Cells_Handler(
+		const Face_Magnetic_Field_Getter& Face_B_,
+		const Volume_Magnetic_Field_Getter& Vol_B_,
+		const Background_Magnetic_Field_Getter& Bg_B_,
+		const Background_Magnetic_Field& bg_B_,
+		const double& vacuum_permeability_
+	) :
+		nch(Face_B_, Vol_B_, Bg_B_, bg_B_, vacuum_permeability_)
+	{};
+
+	template<
+		class Grid,
+		class Cells
+	> void operator()(
+		const Grid& grid,
+		const Cells& removed_cells
+	) const {
+		using std::runtime_error;
+		using std::to_string;
+
+		const auto& Face_B = this->nch.Face_B;
+		const auto& Vol_B = this->nch.Vol_B;
+
+		// process each parent of removed cells only once
+		std::set<uint64_t> parents;
+		for (const auto& removed_cell: removed_cells) {
+			parents.insert(grid.mapping.get_parent(removed_cell));
+		}
+
+		for (const auto& parent: parents) {
+			auto* const parent_data = grid[parent];
+			if (parent_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+			Face_B.data(*parent_data) = {0, 0, 0, 0, 0, 0};
+		}
+
+		// only children sharing face(s) with parent included
+		for (const auto& removed_cell_id: removed_cells) {
+			auto* const removed_cell_data = grid[removed_cell_id];
+			if (removed_cell_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+
+			const auto parent_id = grid.mapping.get_parent(removed_cell_id);
+			auto* const parent_data = grid[parent_id];
+			if (parent_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+
+			const auto
+				pindex = grid.mapping.get_indices(parent_id),
+				rindex = grid.mapping.get_indices(removed_cell_id);
+			for (auto dim: {0, 1, 2}) {
+				const int side = [&](){
+					if (pindex[dim] == rindex[dim]) {
+						return -1;
+					} else {
+						return +1;
+					}
+				}();
+				Face_B.data(*parent_data)(dim, side) += Face_B.data(*removed_cell_data)(dim, side) / 4;
+			}
+		}
+
+		for (const auto& parent: parents) {
+			auto* const parent_data = grid[parent];
+			if (parent_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+
+			for (auto dim: {0, 1, 2}) {
+				Vol_B.data(*parent_data)[dim] = 0.5 * (Face_B.data(*parent_data)(dim, -1) + Face_B.data(*parent_data)(dim, +1));
+			}
+			this->nch.set_background_field(grid, parent, *parent_data);
+		}
+	}
+};
+
+
+/*!
+Refines and unrefines cells of given grid and their data.
+
+Target refinement levels and magnetic field of new cells
+and parents of removed cells are handled here, other cell
+data by given handlers, see pamhd::grid::adapt_grid(), which
+are called after magnetic field has been set. Used by MHD,
+hybrid and test particle solvers so that all cell data is
+adapted in one pass over grid.
+
+Copies of remote neighbors' data are updated afterwards for
+magnetic field and for variables whose transfers were switched
+on by caller. Grid is adapted at most max_rounds times, returns
+total number of cells created and removed by all processes.
+*/
+template <
+	class Grid,
 	class Background_Magnetic_Field,
+	class Face_Magnetic_Field_Getter,
+	class Volume_Magnetic_Field_Getter,
+	class Background_Magnetic_Field_Getter,
 	class Target_Refinement_Level_Min_Getter,
 	class Target_Refinement_Level_Max_Getter,
+	class New_Cells_Handler,
+	class Removed_Cells_Handler
+> uint64_t adapt_cells(
+	Grid& grid,
+	const Background_Magnetic_Field& bg_B,
+	const double& vacuum_permeability,
+	const Face_Magnetic_Field_Getter& Face_B,
+	const Volume_Magnetic_Field_Getter& Vol_B,
+	const Background_Magnetic_Field_Getter& Bg_B,
+	const Target_Refinement_Level_Min_Getter& Ref_min,
+	const Target_Refinement_Level_Max_Getter& Ref_max,
+	const New_Cells_Handler& nch,
+	const Removed_Cells_Handler& rch,
+	const int max_rounds = 1 << 30
+) try {
+	using Cell = Grid::cell_data_type;
+
+	const pamhd::grid::New_Cells_Handler grid_nch(Ref_min, Ref_max);
+	const pamhd::grid::Removed_Cells_Handler grid_rch(Ref_min, Ref_max);
+	const Magnetic_Field_New_Cells_Handler field_nch(
+		Face_B, Vol_B, Bg_B, bg_B, vacuum_permeability);
+	const Magnetic_Field_Removed_Cells_Handler field_rch(
+		Face_B, Vol_B, Bg_B, bg_B, vacuum_permeability);
+
+	Cell::set_transfer_all(true, Vol_B.type(), Face_B.type());
+	const auto changes = pamhd::grid::adapt_grid(
+		grid, Ref_min, Ref_max,
+		[&](const auto& g, const auto& new_cells) {
+			grid_nch(g, new_cells);
+			field_nch(g, new_cells);
+			nch(g, new_cells);
+		},
+		[&](const auto& g, const auto& removed_cells) {
+			grid_rch(g, removed_cells);
+			field_rch(g, removed_cells);
+			rch(g, removed_cells);
+		},
+		max_rounds
+	);
+	Cell::set_transfer_all(true, Bg_B.type());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Vol_B.type(), Face_B.type(), Bg_B.type());
+	Vol_B.type().is_stale = false;
+	Face_B.type().is_stale = false;
+	Bg_B.type().is_stale = false;
+
+	return changes;
+
+} catch (const std::exception& e) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + "): " + e.what());
+} catch (...) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+}
+
+
+/*!
+Sets plasma of new cells from their parents.
+
+Magnetic field of new cells must be set before, e.g.
+by Magnetic_Field_New_Cells_Handler, parent's thermal
+pressure is inherited by children.
+*/
+template <
+	class Mass_Density_Getter,
+	class Momentum_Density_Getter,
+	class Total_Energy_Density_Getter,
+	class Volume_Magnetic_Field_Getter,
 	class Maximum_Signal_Velocity_Getter,
 	class Face_B_Error_Getter
 > struct New_Cells_Handler {
 	const Mass_Density_Getter& Mas;
 	const Momentum_Density_Getter& Mom;
 	const Total_Energy_Density_Getter& Nrj;
-	const Face_Magnetic_Field_Getter& Face_B;
 	const Volume_Magnetic_Field_Getter& Vol_B;
-	const Background_Magnetic_Field_Getter& Bg_B;
-	const Background_Magnetic_Field& bg_B;
-	const Target_Refinement_Level_Min_Getter& RLMin;
-	const Target_Refinement_Level_Max_Getter& RLMax;
 	const Maximum_Signal_Velocity_Getter& Max_v;
 	const Face_B_Error_Getter& Berror;
 	const double& adiabatic_index;
@@ -256,21 +548,15 @@ template <
 		const Mass_Density_Getter& Mas_,
 		const Momentum_Density_Getter& Mom_,
 		const Total_Energy_Density_Getter& Nrj_,
-		const Face_Magnetic_Field_Getter& Face_B_,
 		const Volume_Magnetic_Field_Getter& Vol_B_,
-		const Background_Magnetic_Field_Getter& Bg_B_,
-		const Background_Magnetic_Field& bg_B_,
-		const Target_Refinement_Level_Min_Getter& RLMin_,
-		const Target_Refinement_Level_Max_Getter& RLMax_,
 		const Maximum_Signal_Velocity_Getter& Max_v_,
 		const Face_B_Error_Getter& Berror_,
 		const double& adiabatic_index_,
 		const double& vacuum_permeability_
 	) :
-		Mas(Mas_), Mom(Mom_), Nrj(Nrj_),
-		Face_B(Face_B_), Vol_B(Vol_B_), Bg_B(Bg_B_), bg_B(bg_B_),
-		RLMin(RLMin_), RLMax(RLMax_), Max_v(Max_v_),
-		Berror(Berror_), adiabatic_index(adiabatic_index_),
+		Mas(Mas_), Mom(Mom_), Nrj(Nrj_), Vol_B(Vol_B_),
+		Max_v(Max_v_), Berror(Berror_),
+		adiabatic_index(adiabatic_index_),
 		vacuum_permeability(vacuum_permeability_)
 	{};
 
@@ -281,7 +567,6 @@ template <
 		const Grid& grid,
 		const Cells& new_cells
 	) const {
-		using std::array;
 		using std::runtime_error;
 		using std::to_string;
 
@@ -298,8 +583,6 @@ template <
 			}
 			Mas.data(*cell_data) = Mas.data(*parent_data);
 			Mom.data(*cell_data) = Mom.data(*parent_data);
-			RLMin.data(*cell_data) = RLMin.data(*parent_data);
-			RLMax.data(*cell_data) = RLMax.data(*parent_data);
 			Max_v.data(*cell_data) = Max_v.data(*parent_data);
 			Berror.data(*cell_data) = Berror.data(*parent_data);
 
@@ -319,26 +602,6 @@ template <
 				}
 			}();
 
-			const auto
-				cindex = grid.mapping.get_indices(new_cell_id),
-				pindex = grid.mapping.get_indices(parent_id);
-			for (auto dim: {0, 1, 2}) {
-				const int side = [&](){
-					if (cindex[dim] == pindex[dim]) {
-						// neg faces coincide
-						return -1;
-					} else {
-						// pos faces coincide
-						return +1;
-					}
-				}();
-				Face_B.data(*cell_data)(dim, side) = Face_B.data(*parent_data)(dim, side);
-				Face_B.data(*cell_data)(dim, -side) = Vol_B.data(*parent_data)[dim];
-			}
-
-			for (auto dim: {0, 1, 2}) {
-				Vol_B.data(*cell_data)[dim] = 0.5 * (Face_B.data(*cell_data)(dim, -1) + Face_B.data(*cell_data)(dim, +1));
-			}
 			Nrj.data(*cell_data) = get_total_energy_density(
 				Mas.data(*cell_data),
 				pamhd::mul(Mom.data(*cell_data), 1 / Mas.data(*cell_data)),
@@ -347,63 +610,29 @@ template <
 				adiabatic_index,
 				vacuum_permeability
 			);
-
-			const auto [
-				center, start, end
-			] = pamhd::grid::get_cell_geom_emulated(grid, new_cell_id);
-			const auto [rx, ry, rz] = center;
-			const auto [sx, sy, sz] = start;
-			const auto [ex, ey, ez] = end;
-			Bg_B.data(*cell_data)(0, -1) = bg_B.get_background_field(
-				{sx, ry, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*cell_data)(0, +1) = bg_B.get_background_field(
-				{ex, ry, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*cell_data)(1, -1) = bg_B.get_background_field(
-				{rx, sy, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*cell_data)(1, +1) = bg_B.get_background_field(
-				{rx, ey, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*cell_data)(2, -1) = bg_B.get_background_field(
-				{rx, ry, sz},
-				vacuum_permeability
-			);
-			Bg_B.data(*cell_data)(2, +1) = bg_B.get_background_field(
-				{rx, ry, ez},
-				vacuum_permeability
-			);
 		}
 	}
 };
 
 
+/*!
+Averages plasma of parents of removed cells from their children.
+
+Magnetic field of parents must be set before, e.g. by
+Magnetic_Field_Removed_Cells_Handler, parent's thermal
+pressure is average of children's.
+*/
 template <
 	class Mass_Density_Getter,
 	class Momentum_Density_Getter,
 	class Total_Energy_Density_Getter,
-	class Face_Magnetic_Field_Getter,
 	class Volume_Magnetic_Field_Getter,
-	class Background_Magnetic_Field_Getter,
-	class Background_Magnetic_Field,
-	class Target_Refinement_Level_Min_Getter,
-	class Target_Refinement_Level_Max_Getter,
 	class Maximum_Signal_Velocity_Getter
 > struct Removed_Cells_Handler {
 	const Mass_Density_Getter& Mas;
 	const Momentum_Density_Getter& Mom;
 	const Total_Energy_Density_Getter& Nrj;
-	const Face_Magnetic_Field_Getter& Face_B;
 	const Volume_Magnetic_Field_Getter& Vol_B;
-	const Background_Magnetic_Field_Getter& Bg_B;
-	const Background_Magnetic_Field& bg_B;
-	const Target_Refinement_Level_Min_Getter& RLMin;
-	const Target_Refinement_Level_Max_Getter& RLMax;
 	const Maximum_Signal_Velocity_Getter& Max_v;
 	const double& adiabatic_index;
 	const double& vacuum_permeability;
@@ -412,19 +641,13 @@ template <
 		const Mass_Density_Getter& Mas_,
 		const Momentum_Density_Getter& Mom_,
 		const Total_Energy_Density_Getter& Nrj_,
-		const Face_Magnetic_Field_Getter& Face_B_,
 		const Volume_Magnetic_Field_Getter& Vol_B_,
-		const Background_Magnetic_Field_Getter& Bg_B_,
-		const Background_Magnetic_Field& bg_B_,
-		const Target_Refinement_Level_Min_Getter& RLMin_,
-		const Target_Refinement_Level_Max_Getter& RLMax_,
 		const Maximum_Signal_Velocity_Getter& Max_v_,
 		const double& adiabatic_index_,
 		const double& vacuum_permeability_
 	) :
-		Mas(Mas_), Mom(Mom_), Nrj(Nrj_),
-		Face_B(Face_B_), Vol_B(Vol_B_), Bg_B(Bg_B_), bg_B(bg_B_),
-		RLMin(RLMin_), RLMax(RLMax_), Max_v(Max_v_),
+		Mas(Mas_), Mom(Mom_), Nrj(Nrj_), Vol_B(Vol_B_),
+		Max_v(Max_v_),
 		adiabatic_index(adiabatic_index_),
 		vacuum_permeability(vacuum_permeability_)
 	{};
@@ -437,7 +660,6 @@ template <
 		const Cells& removed_cells
 	) const {
 		using std::max;
-		using std::min;
 		using std::runtime_error;
 		using std::to_string;
 
@@ -453,16 +675,13 @@ template <
 			if (parent_data == nullptr) {
 				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
 			}
-			RLMin.data(*parent_data) = 999;
-			RLMax.data(*parent_data) = 0;
 			Max_v.data(*parent_data) = {-1, -1, -1, -1, -1, -1};
 			Mas.data(*parent_data) =
 			Nrj.data(*parent_data) = 0;
 			Mom.data(*parent_data) = {0, 0, 0};
-			Face_B.data(*parent_data) = {0, 0, 0, 0, 0, 0};
 		}
 
-		// average parents' plasma parameters from their children, etc
+		// average parents' plasma parameters from their children
 		for (const auto& removed_cell_id: removed_cells) {
 			auto* const removed_cell_data = grid[removed_cell_id];
 			if (removed_cell_data == nullptr) {
@@ -483,11 +702,6 @@ template <
 				);
 			}
 
-			// plasma, all children included
-			RLMin.data(*parent_data) = min(RLMin.data(*parent_data),
-				RLMin.data(*removed_cell_data));
-			RLMax.data(*parent_data) = max(RLMax.data(*parent_data),
-				RLMax.data(*removed_cell_data));
 			for (int dir: {-3,-2,-1,+1,+2,+3}) {
 				Max_v.data(*parent_data)(dir) = max(Max_v.data(*parent_data)(dir),
 					Max_v.data(*removed_cell_data)(dir));
@@ -508,65 +722,14 @@ template <
 			} catch (...) {
 				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
 			}
-
-			// magnetic field, only children sharing
-			// face(s) with parent included
-			const auto
-				pindex = grid.mapping.get_indices(parent_id),
-				rindex = grid.mapping.get_indices(removed_cell_id);
-			for (auto dim: {0, 1, 2}) {
-				const int side = [&](){
-					if (pindex[dim] == rindex[dim]) {
-						return -1;
-					} else {
-						return +1;
-					}
-				}();
-				Face_B.data(*parent_data)(dim, side) += Face_B.data(*removed_cell_data)(dim, side) / 4;
-			}
-
-			const auto [
-				center, start, end
-			] = pamhd::grid::get_cell_geom_emulated(grid, parent_id);
-			const auto [rx, ry, rz] = center;
-			const auto [sx, sy, sz] = start;
-			const auto [ex, ey, ez] = end;
-			Bg_B.data(*parent_data)(0, -1) = bg_B.get_background_field(
-				{sx, ry, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*parent_data)(0, +1) = bg_B.get_background_field(
-				{ex, ry, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*parent_data)(1, -1) = bg_B.get_background_field(
-				{rx, sy, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*parent_data)(1, +1) = bg_B.get_background_field(
-				{rx, ey, rz},
-				vacuum_permeability
-			);
-			Bg_B.data(*parent_data)(2, -1) = bg_B.get_background_field(
-				{rx, ry, sz},
-				vacuum_permeability
-			);
-			Bg_B.data(*parent_data)(2, +1) = bg_B.get_background_field(
-				{rx, ry, ez},
-				vacuum_permeability
-			);
 		}
-		// set volume magnetic field and energy density
+
+		// set energy density
 		for (const auto& parent: parents) {
 			auto* const parent_data = grid[parent];
 			if (parent_data == nullptr) {
 				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
 			}
-
-			for (auto dim: {0, 1, 2}) {
-				Vol_B.data(*parent_data)[dim] = 0.5 * (Face_B.data(*parent_data)(dim, -1) + Face_B.data(*parent_data)(dim, +1));
-			}
-
 			Nrj.data(*parent_data) = get_total_energy_density(
 				Mas.data(*parent_data),
 				pamhd::mul(Mom.data(*parent_data), 1 / Mas.data(*parent_data)),
@@ -634,31 +797,24 @@ template<
 		Mas, Mom, Nrj, Vol_B, SInfo, Ref_min, Ref_max,
 		adiabatic_index, vacuum_permeability, proton_mass);
 
-	Cell::set_transfer_all(true,
-		Mas.type(), Mom.type(), Nrj.type(),
-		Vol_B.type(), Face_B.type());
-	pamhd::grid::adapt_grid(
-		grid, Ref_min, Ref_max,
+	// rebuilt by classify() below
+	geometries.invalidate_cell_info();
+
+	Cell::set_transfer_all(true, Mas.type(), Mom.type(), Nrj.type());
+	adapt_cells(
+		grid, bg_B, vacuum_permeability,
+		Face_B, Vol_B, Bg_B, Ref_min, Ref_max,
 		pamhd::mhd::New_Cells_Handler(
-			Mas, Mom, Nrj, Face_B, Vol_B, Bg_B,
-			bg_B, Ref_min, Ref_max, Max_v, Berror,
+			Mas, Mom, Nrj, Vol_B, Max_v, Berror,
 			adiabatic_index, vacuum_permeability),
 		pamhd::mhd::Removed_Cells_Handler(
-			Mas, Mom, Nrj, Face_B, Vol_B, Bg_B,
-			bg_B, Ref_min, Ref_max, Max_v,
+			Mas, Mom, Nrj, Vol_B, Max_v,
 			adiabatic_index, vacuum_permeability)
 	);
-	Cell::set_transfer_all(true, Bg_B.type());
-	grid.update_copies_of_remote_neighbors();
-	Cell::set_transfer_all(false,
-		Mas.type(), Mom.type(), Nrj.type(),
-		Vol_B.type(), Face_B.type(), Bg_B.type());
+	Cell::set_transfer_all(false, Mas.type(), Mom.type(), Nrj.type());
 	Mas.type().is_stale = false;
 	Mom.type().is_stale = false;
 	Nrj.type().is_stale = false;
-	Vol_B.type().is_stale = false;
-	Face_B.type().is_stale = false;
-	Bg_B.type().is_stale = false;
 
 	for (const auto& cell: grid.local_cells()) {
 		(*cell.data)[pamhd::MPI_Rank()] = grid.get_rank();
@@ -669,15 +825,7 @@ template<
 	Cell::set_transfer_all(false, Substep.type());
 	Substep.type().is_stale = false;
 
-	for (const auto& gid: geometries.get_geometry_ids()) {
-		geometries.clear_cells(gid);
-	}
-	for (const auto& cell: grid.local_cells()) {
-		geometries.overlaps(
-			grid.geometry.get_min(cell.id),
-			grid.geometry.get_max(cell.id),
-			cell.id);
-	}
+	geometries.classify(grid, grid.local_cells());
 
 	pamhd::mhd::set_solver_info(grid, boundaries, geometries, SInfo);
 	pamhd::mhd::classify_faces(grid, SInfo, FInfo);
@@ -51,6 +51,7 @@ Author(s): Ilja Honkonen
 #include "dccrg.hpp"
 
 #include "grid/amr.hpp"
+#include "grid/halo_exchange.hpp"
 #include "mhd/common.hpp"
 #include "mhd/solve.hpp"
 #include "mhd/variables.hpp"
@@ -281,16 +282,10 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(B, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
-			}
-
-			const auto
-				c = grid.geometry.get_center(cell),
-				len = grid.geometry.get_length(cell);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
+			const auto& c = info.center;
+			const auto len = grid.geometry.get_length(info.id);
 
 			const auto get_B = [&value_bdy, &t](const array<double, 3>& c) -> pamhd::Magnetic_Field::data_type {
 				const auto
@@ -669,25 +664,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(B, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto magnetic_field = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
-			}
-
 			Vol_B.data(*cell_data) = magnetic_field;
 		}
 	}
@@ -763,24 +748,8 @@ template<
 
 	using Cell = Grid::cell_data_type;
 
-	bool update_copies = false;
-	if (Nrj.type().is_stale) {
-		update_copies = true;
-		// these become stale again below
-		Cell::set_transfer_all(true,
-			Mas.type(), Mom.type(), Nrj.type(), Vol_B.type());
-	}
-	if (CInfo.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, CInfo.type());
-		CInfo.type().is_stale = false;
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-	}
-	Cell::set_transfer_all(false,
-		Mas.type(), Mom.type(), Nrj.type(),
-		Vol_B.type(), CInfo.type());
+	// MHD state becomes stale again below
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, Mas, Mom, Nrj, Vol_B, CInfo);
 
 	std::set<uint64_t> cp_bdy_cells;
 
@@ -793,27 +762,17 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(N, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto mass_density
 				= proton_mass
 				* value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
-			}
-
 			Mas.data(*cell_data) = mass_density;
 		}
 	}
@@ -856,25 +815,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(V, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto velocity = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
-			}
-
 			Mom.data(*cell_data) = pamhd::mul(Mas.data(*cell_data), velocity);
 		}
 	}
@@ -927,25 +876,15 @@ template<
 	) {
 		auto& value_bdy = boundaries.get_value_boundary(P, i);
 		const auto& geometry_id = value_bdy.get_geometry_id();
-		const auto& cells = bdy_geoms.get_cells(geometry_id);
-		for (const auto& cell: cells) {
-			const auto c = grid.geometry.get_center(cell);
-			const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-			const auto
-				lat = asin(c[2] / r),
-				lon = atan2(c[1], c[0]);
+		for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+			auto* const cell_data = info.data;
 
 			const auto pressure = value_bdy.get_data(
 				simulation_time,
-				c[0], c[1], c[2],
-				r, lat, lon
+				info.center[0], info.center[1], info.center[2],
+				info.r, info.lat, info.lon
 			);
 
-			auto* const cell_data = grid[cell];
-			if (cell_data == nullptr) {
-				throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
-			}
-
 			Nrj.data(*cell_data) = pamhd::mhd::get_total_energy_density(
 				Mas.data(*cell_data),
 				pamhd::mhd::get_velocity(
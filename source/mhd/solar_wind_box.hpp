@@ -48,6 +48,7 @@ Author(s): Ilja Honkonen
 
 #include "common_functions.hpp"
 #include "grid/amr.hpp"
+#include "grid/halo_exchange.hpp"
 #include "mhd/common.hpp"
 #include "mhd/solve.hpp"
 #include "mhd/variables.hpp"
@@ -70,7 +71,7 @@ template<
 	class Background_Magnetic_Field_Getter
 > void initialize_plasma(
 	Grid& grid,
-	const double& /*sim_time*/,
+	const double& sim_time,
 	const Solar_Wind_Box_Options& options,
 	const pamhd::Background_Magnetic_Field<
 		double,
@@ -92,22 +93,21 @@ template<
 	using std::runtime_error;
 	using std::to_string;
 
-	for (const auto& B: options.sw_magnetic_field) {
-		if (B[options.sw_dim] != 0) {
-			throw runtime_error(
-				__FILE__ "(" + to_string(__LINE__) + "): solar "
-				"wind boundary in " + to_string(options.sw_dim) + " dimension"
-				" but corresponding B component(s) non-zero: "
-				+ to_string(B[options.sw_dim]));
-		}
+	const auto sw = options.solar_wind.get(sim_time);
+	if (sw.magnetic_field[options.sw_dim] != 0) {
+		throw runtime_error(
+			__FILE__ "(" + to_string(__LINE__) + "): solar "
+			"wind boundary in " + to_string(options.sw_dim) + " dimension"
+			" but corresponding B component(s) non-zero: "
+			+ to_string(sw.magnetic_field[options.sw_dim]));
 	}
 
 	if (grid.get_rank() == 0) {
 		std::cout << "Initializing run, solar wind: "
-		<< options.sw_nr_density[0] << " #/m^3, "
-		<< options.sw_velocity[0] << " m/s, "
-		<< options.sw_pressure[0] << " Pa, "
-		<< options.sw_magnetic_field[0] << " T"
+		<< sw.nr_density << " #/m^3, "
+		<< sw.velocity << " m/s, "
+		<< sw.pressure << " Pa, "
+		<< sw.magnetic_field << " T"
 		<< std::endl;
 	}
 
@@ -172,32 +172,32 @@ template<
 				);
 		}
 
-		const auto mass = options.sw_nr_density[0] * proton_mass;
+		const auto mass = sw.nr_density * proton_mass;
 		Mas.data(*cell.data) = mass;
 
 		const auto cell_center = grid.geometry.get_center(cell.id);
 		const auto v_factor = std::max(0.0, cell_center[0]/grid_end[0]);
 		const std::array<double, 3> velocity{
-			v_factor * options.sw_velocity[0][0],
-			v_factor * options.sw_velocity[0][1],
-			v_factor * options.sw_velocity[0][2]};
+			v_factor * sw.velocity[0],
+			v_factor * sw.velocity[1],
+			v_factor * sw.velocity[2]};
 		Mom.data(*cell.data) = pamhd::mul(mass, velocity);
 
 		Vol_B.data(*cell.data)[0]   =
 		Face_B.data(*cell.data)(-1) =
-		Face_B.data(*cell.data)(+1) = options.sw_magnetic_field[0][0];
+		Face_B.data(*cell.data)(+1) = sw.magnetic_field[0];
 		Vol_B.data(*cell.data)[1]   =
 		Face_B.data(*cell.data)(-2) =
-		Face_B.data(*cell.data)(+2) = options.sw_magnetic_field[0][1];
+		Face_B.data(*cell.data)(+2) = sw.magnetic_field[1];
 		Vol_B.data(*cell.data)[2]   =
 		Face_B.data(*cell.data)(-3) =
-		Face_B.data(*cell.data)(+3) = options.sw_magnetic_field[0][2];
+		Face_B.data(*cell.data)(+3) = sw.magnetic_field[2];
 		Face_dB.data(*cell.data) = {0, 0, 0, 0, 0, 0};
 
 		Nrj.data(*cell.data) = pamhd::mhd::get_total_energy_density(
 			Mas.data(*cell.data),
 			velocity,
-			options.sw_pressure[0],
+			sw.pressure,
 			Vol_B.data(*cell.data),
 			adiabatic_index,
 			vacuum_permeability
@@ -238,36 +238,38 @@ template<
 	const Face_Magnetic_Field_Getter& Face_B,
 	const Face_Magnetic_Field_Change_Getter& Face_dB
 ) try {
-	size_t sw_index = 0;
-	while (
-		sw_index < options.sw_timestamps.size()
-		and sim_time >= options.sw_timestamps[sw_index]
-	) {
-		sw_index++;
+	const auto sw = options.solar_wind.get(sim_time);
+	if (sw.magnetic_field[options.sw_dim] != 0) {
+		throw std::runtime_error(
+			__FILE__ "(" + std::to_string(__LINE__) + "): solar "
+			"wind boundary in " + std::to_string(options.sw_dim) + " dimension"
+			" but corresponding B component(s) non-zero at time "
+			+ std::to_string(sim_time) + ": "
+			+ std::to_string(sw.magnetic_field[options.sw_dim]));
 	}
 	for (const auto& cell: solar_wind_cells) {
 		if (cell.is_local) {
-			const auto mass = options.sw_nr_density[sw_index] * proton_mass;
+			const auto mass = sw.nr_density * proton_mass;
 			Mas.data(*cell.data) = mass;
 			Mom.data(*cell.data) = {
-				mass*options.sw_velocity[sw_index][0],
-				mass*options.sw_velocity[sw_index][1],
-				mass*options.sw_velocity[sw_index][2]
+				mass*sw.velocity[0],
+				mass*sw.velocity[1],
+				mass*sw.velocity[2]
 			};
 			Face_dB.data(*cell.data) = {0, 0, 0, 0, 0, 0};
 
 			Vol_B.data(*cell.data)[0]   =
 			Face_B.data(*cell.data)(-1) =
-			Face_B.data(*cell.data)(+1) = options.sw_magnetic_field[sw_index][0];
+			Face_B.data(*cell.data)(+1) = sw.magnetic_field[0];
 			Vol_B.data(*cell.data)[1]   =
 			Face_B.data(*cell.data)(-2) =
-			Face_B.data(*cell.data)(+2) = options.sw_magnetic_field[sw_index][1];
+			Face_B.data(*cell.data)(+2) = sw.magnetic_field[1];
 			Vol_B.data(*cell.data)[2]   =
 			Face_B.data(*cell.data)(-3) =
-			Face_B.data(*cell.data)(+3) = options.sw_magnetic_field[sw_index][2];
+			Face_B.data(*cell.data)(+3) = sw.magnetic_field[2];
 			Nrj.data(*cell.data) = pamhd::mhd::get_total_energy_density(
-				mass, options.sw_velocity[sw_index],
-				options.sw_pressure[sw_index], Vol_B.data(*cell.data),
+				mass, sw.velocity,
+				sw.pressure, Vol_B.data(*cell.data),
 				adiabatic_index, vacuum_permeability
 			);
 		}
@@ -287,7 +289,7 @@ template<
 			);
 
 			Face_B.data(*neighbor.data)(options.sw_dir)
-				= options.sw_magnetic_field[sw_index][options.sw_dim];
+				= sw.magnetic_field[options.sw_dim];
 			Vol_B.data(*neighbor.data)[options.sw_dim]
 				= Face_B.data(*neighbor.data)(+options.sw_dir) / 2
 				+ Face_B.data(*neighbor.data)(-options.sw_dir) / 2;
@@ -351,31 +353,7 @@ template<
 
 	using Cell = Grid::cell_data_type;
 
-	bool update_copies = false;
-	if (
-		Mas.type().is_stale
-		or Mom.type().is_stale
-		or Nrj.type().is_stale
-		or Vol_B.type().is_stale
-	) {
-		update_copies = true;
-		Cell::set_transfer_all(true,
-			Mas.type(), Mom.type(), Nrj.type(), Vol_B.type());
-	}
-	if (Face_B.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Face_B.type());
-	}
-	if (SInfo.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, SInfo.type());
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-	}
-	Cell::set_transfer_all(false,
-		Mas.type(), Mom.type(), Nrj.type(),
-		Vol_B.type(), Face_B.type(), SInfo.type());
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, Mas, Mom, Nrj, Vol_B, Face_B, SInfo);
 
 	Mas.type().is_stale = true;
 	Mom.type().is_stale = true;
@@ -42,8 +42,10 @@ Author(s): Ilja Honkonen
 #include "array"
 #include "cmath"
 #include "limits"
+#include "optional"
 #include "string"
 #include "tuple"
+#include "utility"
 #include "vector"
 
 #include "dccrg.hpp"
@@ -51,6 +53,7 @@ Author(s): Ilja Honkonen
 #include "prettyprint.hpp"
 
 #include "grid/amr.hpp"
+#include "grid/halo_exchange.hpp"
 #include "mhd/rusanov.hpp"
 #include "mhd/hll_athena.hpp"
 #include "mhd/hlld_athena.hpp"
@@ -58,10 +61,87 @@ Author(s): Ilja Honkonen
 #include "mhd/roe_athena.hpp"
 #include "mhd/variables.hpp"
 #include "substepping.hpp"
+#include "timers.hpp"
 #include "variables.hpp"
 
 
 namespace pamhd {
+
+
+//! Makes sure all cells agree on common face Bs
+template <
+	class Grid,
+	class Face_Magnetic_Field_Getter,
+	class Volume_Magnetic_Field_Getter,
+	class Mag_Error_Getter,
+	class Cell_Type_Getter
+> void sync_magnetic_field(
+	Grid& grid,
+	const Face_Magnetic_Field_Getter& Face_B,
+	const Volume_Magnetic_Field_Getter& Vol_B,
+	const Mag_Error_Getter& B_Error,
+	const Cell_Type_Getter& CType
+) try {
+	using Cell = Grid::cell_data_type;
+
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, Face_B, CType);
+
+	for (const auto& cell: grid.local_cells()) {
+		if (CType.data(*cell.data) < 0) continue;
+
+		// track error between cell and smaller neighbors
+		pamhd::Face_Type<std::optional<double>> oldB;
+		// prepare face B on side(s) of smaller neighbors
+		for (const auto& neighbor: cell.neighbors_of) {
+			const auto& fn = neighbor.face_neighbor;
+			if (
+				fn != 0
+				and CType.data(*neighbor.data) >= 0
+				and neighbor.relative_size > 0
+			) {
+				if (oldB(fn)) continue;
+				oldB(fn) = Face_B.data(*cell.data)(fn);
+				Face_B.data(*cell.data)(fn) = 0;
+			}
+		}
+
+		for (const auto& neighbor: cell.neighbors_of) {
+			const auto& fn = neighbor.face_neighbor;
+			if (
+				fn == 0
+				or CType.data(*neighbor.data) < 0
+			) continue;
+
+			if (neighbor.relative_size == 0) {
+				const auto diff
+					= Face_B.data(*cell.data)(fn)
+					- Face_B.data(*neighbor.data)(-fn);
+				B_Error.data(*cell.data) += std::abs(diff);
+				Face_B.data(*cell.data)(fn) -= diff / 2;
+				Face_B.data(*neighbor.data)(-fn) += diff / 2;
+			} else if (neighbor.relative_size > 0) {
+				// replace with average of smaller neighbors
+				Face_B.data(*cell.data)(fn) += Face_B.data(*neighbor.data)(-fn) / 4;
+			}
+		}
+
+		for (int dir: {-3,-2,-1,+1,+2,+3}) {
+			if (not oldB(dir)) continue;
+			oldB(dir).value() -= Face_B.data(*cell.data)(dir);
+			B_Error.data(*cell.data) += std::abs(oldB(dir).value());
+		}
+	}
+
+	Face_B.type().is_stale = true;
+	Vol_B.type().is_stale = true;
+
+} catch (const std::exception& e) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + "): " + e.what());
+} catch (...) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+}
+
+
 namespace mhd {
 
 
@@ -196,6 +276,13 @@ Flux getters with array indices [0..5] should return variables in this order:
 
 Saves fluxes of cells with SInfo.data(*cell_data) == 1,
 ignores cells with SInfo < 0.
+
+Flux through face between cells of same size and substepping
+period is saved only once into +dir face of cell on negative
+side of the face, also if that cell is a remote copy. Otherwise
+flux is saved into both cells, the larger cell receiving average
+of fluxes through its face, as cells with different periods
+consume their fluxes at different substeps.
 */
 template <
 	class Cell_Iter,
@@ -372,8 +459,22 @@ template <
 				if (min_dt == 0) return 0.0;
 				else return 1.0 / min_dt;}();
 
+			// flux through face shared by cells of same size
+			// and period is read by neighbor from cell, see
+			// update_mhd_state()
+			const bool
+				shared_face
+					= neighbor.relative_size == 0
+					and Substep.data(*cell.data) == Substep.data(*neighbor.data),
+				save_cell_flux
+					= solver != Solver::hybrid
+					and (cell.is_local or (shared_face and neighbor.is_local)),
+				save_neigh_flux
+					= solver != Solver::hybrid
+					and not shared_face and neighbor.is_local;
+
 			if (fn == +1) {
-				if (solver != Solver::hybrid and cell.is_local) {
+				if (save_cell_flux) {
 					Mas_f(*cell.data, +1) += cfac * flux[mas_int];
 					Mom_f(*cell.data, +1) = pamhd::add(Mom_f(*cell.data, +1),
 						pamhd::mul(cfac, flux[mom_int]));
@@ -382,7 +483,7 @@ template <
 						pamhd::mul(cfac, flux[mag_int]));
 				}
 
-				if (solver != Solver::hybrid and neighbor.is_local) {
+				if (save_neigh_flux) {
 					Mas_f(*neighbor.data, -1) += nfac * flux[mas_int];
 					Mom_f(*neighbor.data, -1) = pamhd::add(Mom_f(*neighbor.data, -1),
 						pamhd::mul(nfac, flux[mom_int]));
@@ -425,7 +526,7 @@ template <
 			}
 
 			if (fn == +2) {
-				if (solver != Solver::hybrid and cell.is_local) {
+				if (save_cell_flux) {
 					Mas_f(*cell.data, +2) += cfac * flux[mas_int];
 					Mom_f(*cell.data, +2) = pamhd::add(Mom_f(*cell.data, +2),
 						pamhd::mul(cfac, flux[mom_int]));
@@ -434,7 +535,7 @@ template <
 						pamhd::mul(cfac, flux[mag_int]));
 				}
 
-				if (solver != Solver::hybrid and neighbor.is_local) {
+				if (save_neigh_flux) {
 					Mas_f(*neighbor.data, -2) += nfac * flux[mas_int];
 					Mom_f(*neighbor.data, -2) = pamhd::add(Mom_f(*neighbor.data, -2),
 						pamhd::mul(nfac, flux[mom_int]));
@@ -475,7 +576,7 @@ template <
 			}
 
 			if (fn == +3) {
-				if (solver != Solver::hybrid and cell.is_local) {
+				if (save_cell_flux) {
 					Mas_f(*cell.data, +3) += cfac * flux[mas_int];
 					Mom_f(*cell.data, +3) = pamhd::add(Mom_f(*cell.data, +3),
 						pamhd::mul(cfac, flux[mom_int]));
@@ -484,7 +585,7 @@ template <
 						pamhd::mul(cfac, flux[mag_int]));
 				}
 
-				if (solver != Solver::hybrid and neighbor.is_local) {
+				if (save_neigh_flux) {
 					Mas_f(*neighbor.data, -3) += nfac * flux[mas_int];
 					Mom_f(*neighbor.data, -3) = pamhd::add(Mom_f(*neighbor.data, -3),
 						pamhd::mul(nfac, flux[mom_int]));
@@ -1499,6 +1600,10 @@ Set new MHD state in cells with SInfo.data(*cell.data) == 1.
 
 Sets new MHD state based on fluxes and face B changes.
 Zeroes fluxes and face B changes afterwards.
+
+Fluxes through -dir faces shared with cells of same size and
+substepping period are read from +dir faces of those neighbors,
+see get_fluxes().
 */
 template <
 	class Cells,
@@ -1540,6 +1645,8 @@ template <
 	using pamhd::mul;
 	using pamhd::neg;
 
+	using Cell = typename Grid::cell_data_type;
+
 	for (const auto& cell: cells) {
 		if (SInfo.data(*cell.data) > 0) {
 			if (current_substep % Substep.data(*cell.data) != 0) {
@@ -1548,9 +1655,32 @@ template <
 
 			const auto [dx, dy, dz] = grid.geometry.get_length(cell.id);
 
+			// cell and face storing flux through each -dir face
+			std::array<Cell*, 3> neg_data{cell.data, cell.data, cell.data};
+			std::array<int, 3> neg_dir{-1, -2, -3};
+			for (const auto& neighbor: cell.neighbors_of) {
+				const auto& fn = neighbor.face_neighbor;
+				if (
+					fn >= 0
+					or neighbor.relative_size != 0
+					or neighbor.data == nullptr
+					or Substep.data(*neighbor.data) != Substep.data(*cell.data)
+				) continue;
+				neg_data[-fn - 1] = neighbor.data;
+				neg_dir[-fn - 1] = -fn;
+			}
+			const auto face = [&](const int dir)->std::pair<Cell&, int> {
+				if (dir > 0) {
+					return {*cell.data, dir};
+				} else {
+					return {*neg_data[-dir - 1], neg_dir[-dir - 1]};
+				}
+			};
+
 			auto& mas = Mas.data(*cell.data);
 			const auto mas_f = [&](const int dir){
-				return Mas_f(*cell.data, dir);
+				const auto [data, d] = face(dir);
+				return Mas_f(data, d);
 			};
 			mas += (mas_f(-1) - mas_f(+1)) / dx;
 			mas += (mas_f(-2) - mas_f(+2)) / dy;
@@ -1558,7 +1688,8 @@ template <
 
 			auto& mom = Mom.data(*cell.data);
 			const auto mom_f = [&](const int dir){
-				return Mom_f(*cell.data, dir);
+				const auto [data, d] = face(dir);
+				return Mom_f(data, d);
 			};
 			mom = add(mom,
 				mul(1/dx, add(mom_f(-1), neg(mom_f(+1)))));
@@ -1569,7 +1700,8 @@ template <
 
 			auto& nrj = Nrj.data(*cell.data);
 			const auto nrj_f = [&](const int dir){
-				return Nrj_f(*cell.data, dir);
+				const auto [data, d] = face(dir);
+				return Nrj_f(data, d);
 			};
 			nrj += (nrj_f(-1) - nrj_f(+1)) / dx;
 			nrj += (nrj_f(-2) - nrj_f(+2)) / dy;
@@ -1577,7 +1709,8 @@ template <
 
 			auto& vol_b = Vol_B.data(*cell.data);
 			const auto mag_f = [&](const int dir){
-				return Mag_f(*cell.data, dir);
+				const auto [data, d] = face(dir);
+				return Mag_f(data, d);
 			};
 			vol_b = add(vol_b,
 				mul(1/dx, add(mag_f(-1), neg(mag_f(+1)))));
@@ -1592,14 +1725,42 @@ template <
 				Face_B.data(*cell.data)(dim, +1) += Face_dB.data(*cell.data)(dim, +1) / area[dim];
 			}
 		}
+	}
+
+	// zero fluxes only after all cells have read them from neighbors
+	const auto zero_fluxes = [&](Cell& cell_data, const int dir){
+		Mas_f(cell_data, dir) =
+		Nrj_f(cell_data, dir) = 0;
+		Mom_f(cell_data, dir) =
+		Mag_f(cell_data, dir) = {0, 0, 0};
+	};
+	for (const auto& cell: cells) {
+		// keep accumulating until cell's next update, also in
+		// unsolved cells whose +dir faces solved cells read
+		if (
+			SInfo.data(*cell.data) >= 0
+			and current_substep % Substep.data(*cell.data) != 0
+		) {
+			continue;
+		}
 
 		for (int dir: {-3,-2,-1,+1,+2,+3}) {
-			Mas_f(*cell.data, dir) =
-			Nrj_f(*cell.data, dir) = 0;
-			Mom_f(*cell.data, dir) =
-			Mag_f(*cell.data, dir) = {0, 0, 0};
+			zero_fluxes(*cell.data, dir);
 		}
 		Face_dB.data(*cell.data) = {0, 0, 0, 0, 0, 0};
+
+		// remote neighbors aren't zeroed by their owner
+		for (const auto& neighbor: cell.neighbors_of) {
+			const auto& fn = neighbor.face_neighbor;
+			if (
+				fn >= 0
+				or neighbor.relative_size != 0
+				or neighbor.is_local
+				or neighbor.data == nullptr
+				or Substep.data(*neighbor.data) != Substep.data(*cell.data)
+			) continue;
+			zero_fluxes(*neighbor.data, -fn);
+		}
 	}
 	Mas.type().is_stale = true;
 	Mom.type().is_stale = true;
@@ -1721,51 +1882,18 @@ template <
 	const Substepping_Period_Getter& Substep,
 	const Max_Velocity_Getter& Max_v
 ) try {
-	using Cell = Grid::cell_data_type;
+	using Halo = pamhd::grid::Halo_Exchange<typename Grid::cell_data_type>;
 
-	bool update_copies = false;
-	if (
-		Mas.type().is_stale or Mom.type().is_stale
-		or Nrj.type().is_stale or Vol_B.type().is_stale
-	) {
-		update_copies = true;
-		Cell::set_transfer_all(true,
-			Mas.type(), Mom.type(), Nrj.type(), Vol_B.type());
-		Mas.type().is_stale = false;
-		Mom.type().is_stale = false;
-		Nrj.type().is_stale = false;
-		Vol_B.type().is_stale = false;
-	}
-	if (SInfo.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, SInfo.type());
-		SInfo.type().is_stale = false;
-	}
-	if (Substep.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Substep.type());
-		Substep.type().is_stale = false;
-	}
-	if (Bg_B.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Bg_B.type());
-		Bg_B.type().is_stale = false;
-	}
-	if (Max_v.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Max_v.type());
-		Max_v.type().is_stale = false;
-	}
+	Timer wait_timer("mhd.halo_wait");
+	Halo::finish(grid);
+	wait_timer.stop();
+	Halo::request(Mas, Mom, Nrj, Vol_B, SInfo, Substep, Bg_B, Max_v);
 	if (solver == Solver::hybrid) {
-		if (Face_B.type().is_stale) {
-			update_copies = true;
-			Cell::set_transfer_all(true, Face_B.type());
-			Face_B.type().is_stale = false;
-		}
-	}
-	if (update_copies) {
-		grid.start_remote_neighbor_copy_updates();
+		Halo::request(Face_B);
 	}
+	Halo::start(grid);
+
+	Timer inner_timer("mhd.fluxes");
 	auto flux_calcs = pamhd::mhd::get_fluxes(
 		solver, grid.inner_cells(), grid, substep,
 		adiabatic_index, vacuum_permeability, sub_dt,
@@ -1773,11 +1901,13 @@ template <
 		Mas_f, Mom_f, Nrj_f, Mag_f,
 		SInfo, Substep, Max_v
 	);
+	inner_timer.stop();
 
-	if (update_copies) {
-		grid.wait_remote_neighbor_copy_update_receives();
-	}
+	Timer receive_timer("mhd.halo_wait");
+	Halo::wait_receives(grid);
+	receive_timer.stop();
 
+	Timer outer_timer("mhd.fluxes");
 	flux_calcs += pamhd::mhd::get_fluxes(
 		solver, grid.outer_cells(), grid, substep,
 		adiabatic_index, vacuum_permeability, sub_dt,
@@ -1785,14 +1915,13 @@ template <
 		Mas_f, Mom_f, Nrj_f, Mag_f,
 		SInfo, Substep, Max_v
 	);
+	outer_timer.stop();
 
-	if (update_copies) {
-		grid.wait_remote_neighbor_copy_update_sends();
-	}
-	Cell::set_transfer_all(false,
-		Mas.type(), Mom.type(), Nrj.type(), Vol_B.type(),
-		SInfo.type(), Substep.type(), Max_v.type(), Bg_B.type(), Face_B.type());
+	Timer send_timer("mhd.halo_wait");
+	Halo::finish(grid);
+	send_timer.stop();
 
+	Timer remote_timer("mhd.fluxes");
 	flux_calcs += pamhd::mhd::get_fluxes(
 		solver, grid.remote_cells(), grid, substep,
 		adiabatic_index, vacuum_permeability, sub_dt,
@@ -1800,6 +1929,7 @@ template <
 		Mas_f, Mom_f, Nrj_f, Mag_f,
 		SInfo, Substep, Max_v
 	);
+	remote_timer.stop();
 	Max_v.type().is_stale = true;
 
 	return flux_calcs;
@@ -1862,9 +1992,20 @@ template <
 	const Substep_Max_Getter& Substep_Max,
 	const Max_Velocity_Getter& Max_v
 ) try {
+	using Halo = pamhd::grid::Halo_Exchange<typename Grid::cell_data_type>;
+
+	// exchange MHD state with Max_v in minimize_timestep() instead
+	// of separately in first substep, not modified in between
+	Halo::request(Mas, Mom, Nrj, Vol_B, Bg_B);
+	if (solver == Solver::hybrid) {
+		Halo::request(Face_B);
+	}
+
+	Timer substep_timer("mhd.substepping");
+	// offset with reduction of timesteps
 	set_minmax_substepping_period(
 		simulation_time, grid, options,
-		Substep_Min, Substep_Max
+		Substep_Min, Substep_Max, false
 	);
 
 	minimize_timestep(
@@ -1881,6 +2022,8 @@ template <
 	);
 
 	const int max_substep = update_substeps(grid, CType, Substep);
+	substep_timer.stop();
+
 	double total_dt = 0;
 	size_t flux_calcs = 0;
 	for (int substep = 1; substep <= max_substep; substep += 1) {
@@ -1893,6 +2036,7 @@ template <
 			Mag_f, CType, Substep, Max_v
 		);
 
+		Timer update_timer("mhd.update_state");
 		update_mhd_state(
 			grid.local_cells(), grid, substep,
 			Face_B, Face_dB, CType, Substep,
@@ -1908,12 +2052,14 @@ template <
 		);
 	}
 
+	Timer sync_timer("mhd.sync_B");
 	sync_magnetic_field(grid, Face_B, Vol_B, B_Error, CType);
 
 	update_vol_B(
 		0, grid.local_cells(), Mas, Mom, Nrj, Vol_B, Face_B,
 		CType, Substep, adiabatic_index, vacuum_permeability, true
 	);
+	sync_timer.stop();
 
 	return std::make_tuple(total_dt, max_substep, flux_calcs);
 
@@ -1942,21 +2088,7 @@ template <
 
 	using Cell = Grid::cell_data_type;
 
-	bool update_copies = false;
-	if (Max_v.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Max_v.type());
-		Max_v.type().is_stale = false;
-	}
-	if (SInfo.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, SInfo.type());
-		SInfo.type().is_stale = false;
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-	}
-	Cell::set_transfer_all(false, Max_v.type(), SInfo.type());
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, Max_v, SInfo);
 
 	for (const auto& cell: grid.local_cells()) {
 		Timestep.data(*cell.data) = numeric_limits<double>::max();
@@ -47,9 +47,11 @@ Author(s): Ilja Honkonen
 #include "dccrg.hpp"
 #include "dccrg_cartesian_geometry.hpp"
 
+#include "grid/halo_exchange.hpp"
 #include "mhd/common.hpp"
 #include "particle/accumulate.hpp"
 #include "particle/common.hpp"
+#include "particle/relative_position.hpp"
 #include "particle/variables.hpp"
 
 
@@ -146,11 +148,12 @@ template<
 			Accu_List(*cell.data).clear();
 		}
 
-		const auto cilen = grid.mapping.get_cell_length_in_indices(cell.id);
+		const auto cilen = int64_t(grid.mapping.get_cell_length_in_indices(cell.id));
 
 		// TODO: faster to iterate over neighbors first?
 		for (auto& particle: Part(*cell.data)) {
-			auto& position = Part_Pos(particle);
+			const auto position = get_absolute_position(
+				Part_Pos(particle), cell_min, cell_length);
 			const std::array<double, 3>
 				value_box_min{
 					position[0] - cell_length[0] / 2,
@@ -174,12 +177,15 @@ template<
 
 			// accumulate to neighbors
 			for (const auto& neighbor: cell.neighbors_of) {
-				// don't accumulate too far
+				// don't accumulate into neighbors not touching cell,
+				// which can be of different size than cell
+				const auto nilen = int64_t(
+					grid.mapping.get_cell_length_in_indices(neighbor.id));
 				if (
-					abs(neighbor.x) > cilen
-					or abs(neighbor.y) > cilen
-					or abs(neighbor.z) > cilen
-				) continue; // TODO: AMR
+					neighbor.x < -nilen or neighbor.x > cilen
+					or neighbor.y < -nilen or neighbor.y > cilen
+					or neighbor.z < -nilen or neighbor.z > cilen
+				) continue;
 
 				// don't accumulate into dont_solve cells
 				if (CType.data(*neighbor.data) < 0) {
@@ -346,7 +352,8 @@ template<
 		}
 
 		for (auto& particle: Part(*cell.data)) {
-			auto& position = Part_Pos(particle);
+			const auto position = get_absolute_position(
+				Part_Pos(particle), cell_min, cell_length);
 			const std::array<double, 3>
 				value_box_min{
 					position[0] - cell_length[0] / 2,
@@ -520,11 +527,6 @@ template<
 			__FILE__ "(" + to_string(__LINE__) + "): "
 			"Periodic grid not supported.");
 	}
-	if (grid.get_maximum_refinement_level() > 0) {
-		throw runtime_error(
-			__FILE__ "(" + to_string(__LINE__) + "): "
-			"Refined grid not supported.");
-	}
 
 	const auto
 		grid_start = grid.geometry.get_start(),
@@ -549,18 +551,23 @@ template<
 		] = get_cell_geometry(cell.id, grid.geometry);
 		const auto cell_vol = cell_length[0]*cell_length[1]*cell_length[2];
 
+		/*
+		owner_* refer to cell in which particle is stored,
+		particle's value box is of same size as owner so
+		contributions of particle add up to its charge also
+		when neighbors are of different size
+		*/
 		const auto accumulate_to_cell = [&](
 			const auto& cmin,
 			const auto& cmax,
+			const auto& owner_min,
+			const auto& owner_length,
 			auto& part
 		) {
-			const auto pos = PPos(part);
+			const auto pos = get_absolute_position(
+				PPos(part), owner_min, owner_length);
+			const auto& length = owner_length;
 			const std::array<double, 3>
-				length{
-					cmax[0] - cmin[0],
-					cmax[1] - cmin[1],
-					cmax[2] - cmin[2]
-				},
 				value_box_min{
 					pos[0] - length[0] / 2,
 					pos[1] - length[1] / 2,
@@ -582,7 +589,8 @@ template<
 			vol_ji[2] += qi_contrib * PVel(part)[2];
 		};
 		for (auto& particle: Part(*cell.data)) {
-			accumulate_to_cell(cell_min, cell_max, particle);
+			accumulate_to_cell(
+				cell_min, cell_max, cell_min, cell_length, particle);
 		}
 		for (const auto& neighbor: cell.neighbors_of) {
 			const auto& fn = neighbor.face_neighbor;
@@ -590,8 +598,12 @@ template<
 			const auto& vn = neighbor.vertex_neighbor;
 			if (fn == 0 and en[0] < 0 and vn[0] == 0) continue;
 
+			const auto
+				neigh_min = grid.geometry.get_min(neighbor.id),
+				neigh_length = grid.geometry.get_length(neighbor.id);
 			for (auto& particle: Part(*neighbor.data)) {
-				accumulate_to_cell(cell_min, cell_max, particle);
+				accumulate_to_cell(
+					cell_min, cell_max, neigh_min, neigh_length, particle);
 			}
 		}
 	}
@@ -765,18 +777,7 @@ template<
 
 	using Cell = Grid::cell_data_type;
 
-	bool update_copies = false;
-	if (CType.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, CType.type());
-		CType.type().is_stale = false;
-	}
-
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-		update_copies = false;
-	}
-	Cell::set_transfer_all(false, CType.type());
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, CType);
 
 	Bulk_Mass.type().is_stale = true;
 	Bulk_Momentum.type().is_stale = true;
@@ -1075,26 +1076,11 @@ template<
 ) {
 	using Cell = Grid::cell_data_type;
 
-	bool update_copies = false;
-	if (Particle_Bulk_Mass.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Particle_Bulk_Mass.type());
-	}
-	if (Particle_Bulk_Momentum.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Particle_Bulk_Momentum.type());
-	}
-	if (Particle_Bulk_Relative_Velocity2.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Particle_Bulk_Relative_Velocity2.type());
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-	}
-	Cell::set_transfer_all(false,
-		Particle_Bulk_Mass.type(),
-		Particle_Bulk_Momentum.type(),
-		Particle_Bulk_Relative_Velocity2.type()
+	pamhd::grid::Halo_Exchange<Cell>::update(
+		grid,
+		Particle_Bulk_Mass,
+		Particle_Bulk_Momentum,
+		Particle_Bulk_Relative_Velocity2
 	);
 
 	MHD_Mass.type().is_stale = true;
@@ -0,0 +1,509 @@
+/*
+Handling of particles on adapted grid of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_PARTICLE_AMR_HPP
+#define PAMHD_PARTICLE_AMR_HPP
+
+
+#include "array"
+#include "cstdint"
+#include "cstring"
+#include "set"
+#include "stdexcept"
+#include "string"
+#include "type_traits"
+#include "unordered_set"
+#include "utility"
+#include "vector"
+
+#include "dccrg.hpp"
+#include "mpi.h"
+
+#include "grid/amr.hpp"
+#include "mhd/amr.hpp"
+#include "particle/relative_position.hpp"
+#include "particle/variables.hpp"
+
+
+namespace pamhd {
+namespace particle {
+
+namespace detail {
+
+//! Converts position relative to old cell to new cell, absolute positions are unchanged.
+template<class Position> void move_position_to_cell(
+	Position& position,
+	const std::array<double, 3>& old_min,
+	const std::array<double, 3>& old_length,
+	const std::array<double, 3>& new_min,
+	const std::array<double, 3>& new_length
+) {
+	if constexpr (is_cell_relative<Position>()) {
+		using Real = std::remove_cvref_t<decltype(position[0])>;
+		position = get_relative_position<Real>(
+			get_absolute_position(position, old_min, old_length),
+			new_min, new_length);
+	}
+}
+
+} // namespace detail
+
+
+/*!
+Moves particles of refined cells to their children.
+
+Each particle of parent goes to the child containing it,
+particles on faces shared by children go to positive side.
+*/
+template<
+	class Particles_Getter,
+	class Particle_Position_Getter
+> struct New_Cells_Handler {
+	const Particles_Getter& Part;
+	const Particle_Position_Getter& Part_Pos;
+
+	New_Cells_Handler(
+		const Particles_Getter& Part_,
+		const Particle_Position_Getter& Part_Pos_
+	) :
+		Part(Part_), Part_Pos(Part_Pos_)
+	{};
+
+	template<
+		class Grid,
+		class Cells
+	> void operator()(
+		const Grid& grid,
+		const Cells& new_cells
+	) const {
+		using std::runtime_error;
+		using std::to_string;
+
+		for (const auto& new_cell_id: new_cells) {
+			auto* const cell_data = grid[new_cell_id];
+			if (cell_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+			const auto parent_id = grid.mapping.get_parent(new_cell_id);
+			auto* const parent_data = grid[parent_id];
+			if (parent_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+
+			const std::array<double, 3>
+				parent_min = grid.geometry.get_min(parent_id),
+				parent_max = grid.geometry.get_max(parent_id),
+				parent_length = grid.geometry.get_length(parent_id),
+				cell_min = grid.geometry.get_min(new_cell_id),
+				cell_max = grid.geometry.get_max(new_cell_id),
+				cell_length = grid.geometry.get_length(new_cell_id);
+
+			Part(*cell_data).clear();
+			for (auto& particle: Part(*parent_data)) {
+				const auto pos = get_absolute_position(
+					Part_Pos(particle), parent_min, parent_length);
+				bool inside = true;
+				for (size_t dim = 0; dim < 3; dim++) {
+					if (
+						(pos[dim] < cell_min[dim] and cell_min[dim] > parent_min[dim])
+						or (pos[dim] >= cell_max[dim] and cell_max[dim] < parent_max[dim])
+					) {
+						inside = false;
+						break;
+					}
+				}
+				if (not inside) {
+					continue;
+				}
+
+				Part(*cell_data).push_back(particle);
+				detail::move_position_to_cell(
+					Part_Pos(Part(*cell_data).back()),
+					parent_min, parent_length,
+					cell_min, cell_length);
+			}
+		}
+	}
+};
+
+
+/*!
+Moves particles of unrefined cells to their parents.
+
+Removed cells in skipped_cells are ignored, e.g. ones that
+were on another process whose particles aren't transferred
+by dccrg, see adapt_grid().
+*/
+template<
+	class Particles_Getter,
+	class Particle_Position_Getter
+> struct Removed_Cells_Handler {
+	const Particles_Getter& Part;
+	const Particle_Position_Getter& Part_Pos;
+	const std::unordered_set<uint64_t>* skipped_cells;
+
+	Removed_Cells_Handler(
+		const Particles_Getter& Part_,
+		const Particle_Position_Getter& Part_Pos_,
+		const std::unordered_set<uint64_t>* skipped_cells_ = nullptr
+	) :
+		Part(Part_), Part_Pos(Part_Pos_), skipped_cells(skipped_cells_)
+	{};
+
+	template<
+		class Grid,
+		class Cells
+	> void operator()(
+		const Grid& grid,
+		const Cells& removed_cells
+	) const {
+		using std::runtime_error;
+		using std::to_string;
+
+		// process each parent of removed cells only once
+		std::set<uint64_t> parents;
+		for (const auto& removed_cell: removed_cells) {
+			parents.insert(grid.mapping.get_parent(removed_cell));
+		}
+		for (const auto& parent: parents) {
+			auto* const parent_data = grid[parent];
+			if (parent_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+			Part(*parent_data).clear();
+		}
+
+		for (const auto& removed_cell_id: removed_cells) {
+			if (
+				this->skipped_cells != nullptr
+				and this->skipped_cells->count(removed_cell_id) > 0
+			) {
+				continue;
+			}
+			auto* const removed_cell_data = grid[removed_cell_id];
+			if (removed_cell_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+			const auto parent_id = grid.mapping.get_parent(removed_cell_id);
+			auto* const parent_data = grid[parent_id];
+			if (parent_data == nullptr) {
+				throw runtime_error(__FILE__ ":" + to_string(__LINE__));
+			}
+
+			const std::array<double, 3>
+				parent_min = grid.geometry.get_min(parent_id),
+				parent_length = grid.geometry.get_length(parent_id),
+				cell_min = grid.geometry.get_min(removed_cell_id),
+				cell_length = grid.geometry.get_length(removed_cell_id);
+
+			for (auto& particle: Part(*removed_cell_data)) {
+				Part(*parent_data).push_back(particle);
+				detail::move_position_to_cell(
+					Part_Pos(Part(*parent_data).back()),
+					cell_min, cell_length,
+					parent_min, parent_length);
+			}
+		}
+	}
+};
+
+
+namespace detail {
+
+//! Copy of particles in local cell with sibling(s) on other process(es).
+template<class Particles> struct Split_Siblings_Cell {
+	uint64_t id;
+	//! processes of siblings, one of them gets parent if cell is removed
+	std::set<int> processes;
+	Particles particles;
+};
+
+/*!
+Returns copies of particles in local cells whose siblings
+aren't all local, ids of those siblings are inserted into
+remote_siblings.
+
+Assumes grid was initialized with neighborhood length of at
+least 1 so that processes of siblings are known.
+*/
+template<
+	class Grid,
+	class Particles_Getter
+> auto copy_split_siblings(
+	Grid& grid,
+	const Particles_Getter& Part,
+	std::unordered_set<uint64_t>& remote_siblings
+) {
+	using Cell = Grid::cell_data_type;
+	using Particles = std::remove_cvref_t<
+		decltype(Part(std::declval<Cell&>()))>;
+
+	const auto
+		rank = uint64_t(grid.get_rank()),
+		comm_size = uint64_t(grid.get_comm_size());
+
+	std::vector<Split_Siblings_Cell<Particles>> ret_val;
+	remote_siblings.clear();
+	for (const auto& cell: grid.local_cells()) {
+		if (grid.get_refinement_level(cell.id) == 0) {
+			continue;
+		}
+		std::set<int> processes;
+		for (const auto& sibling: grid.mapping.get_all_children(
+			grid.mapping.get_parent(cell.id)
+		)) {
+			// refined siblings don't exist and prevent unrefinement
+			const auto process = uint64_t(grid.get_process(sibling));
+			if (process >= comm_size or process == rank) {
+				continue;
+			}
+			processes.insert(int(process));
+			remote_siblings.insert(sibling);
+		}
+		if (processes.size() > 0) {
+			ret_val.push_back({cell.id, std::move(processes), Part(*cell.data)});
+		}
+	}
+	return ret_val;
+}
+
+/*!
+Adds particles of cells copied by copy_split_siblings() that
+were removed from grid to their parent on another process.
+
+Copies are sent to all processes of removed cell's siblings
+and added to parent by the process which has it. Must be called
+by all processes after grid has been adapted once.
+*/
+template<
+	class Grid,
+	class Particles,
+	class Particles_Getter,
+	class Particle_Position_Getter
+> void send_split_siblings(
+	Grid& grid,
+	const std::vector<Split_Siblings_Cell<Particles>>& split_cells,
+	const Particles_Getter& Part,
+	const Particle_Position_Getter& Part_Pos
+) {
+	// particles are sent as bytes as in MPI transfers of cell data
+	using Particle = Particles::value_type;
+
+	MPI_Comm comm = grid.get_communicator();
+	int comm_size = 0;
+	MPI_Comm_size(comm, &comm_size);
+
+	std::vector<std::vector<char>> outgoing(comm_size);
+	for (const auto& item: split_cells) {
+		// unchanged, refined or parent handled by Removed_Cells_Handler
+		if (
+			grid.is_local(item.id)
+			or grid.is_local(grid.mapping.get_parent(item.id))
+		) {
+			continue;
+		}
+		const std::array<uint64_t, 2> header{item.id, item.particles.size()};
+		const auto* const header_bytes = reinterpret_cast<const char*>(header.data());
+		const auto* const particle_bytes = reinterpret_cast<const char*>(item.particles.data());
+		for (const auto& process: item.processes) {
+			auto& buffer = outgoing[process];
+			buffer.insert(buffer.end(), header_bytes, header_bytes + sizeof(header));
+			buffer.insert(
+				buffer.end(), particle_bytes,
+				particle_bytes + item.particles.size() * sizeof(Particle));
+		}
+	}
+
+	std::vector<int>
+		send_counts(comm_size), receive_counts(comm_size),
+		send_displs(comm_size), receive_displs(comm_size);
+	std::vector<char> send_buffer;
+	for (int process = 0; process < comm_size; process++) {
+		send_counts[process] = int(outgoing[process].size());
+		send_displs[process] = int(send_buffer.size());
+		send_buffer.insert(
+			send_buffer.end(),
+			outgoing[process].cbegin(),
+			outgoing[process].cend()
+		);
+	}
+	MPI_Alltoall(
+		send_counts.data(), 1, MPI_INT,
+		receive_counts.data(), 1, MPI_INT, comm
+	);
+	size_t receive_size = 0;
+	for (int process = 0; process < comm_size; process++) {
+		receive_displs[process] = int(receive_size);
+		receive_size += receive_counts[process];
+	}
+	std::vector<char> receive_buffer(receive_size);
+	MPI_Alltoallv(
+		send_buffer.data(), send_counts.data(), send_displs.data(), MPI_BYTE,
+		receive_buffer.data(), receive_counts.data(), receive_displs.data(), MPI_BYTE,
+		comm
+	);
+	MPI_Comm_free(&comm);
+
+	const char* position = receive_buffer.data();
+	const char* const end = receive_buffer.data() + receive_buffer.size();
+	while (position < end) {
+		std::array<uint64_t, 2> header;
+		std::memcpy(header.data(), position, sizeof(header));
+		position += sizeof(header);
+
+		const auto
+			removed_cell_id = header[0],
+			parent_id = grid.mapping.get_parent(removed_cell_id);
+		// sent to all siblings' processes, only one has parent
+		if (not grid.is_local(parent_id)) {
+			position += header[1] * sizeof(Particle);
+			continue;
+		}
+		auto* const parent_data = grid[parent_id];
+		if (parent_data == nullptr) {
+			throw std::runtime_error(__FILE__ ":" + std::to_string(__LINE__));
+		}
+
+		const std::array<double, 3>
+			parent_min = grid.geometry.get_min(parent_id),
+			parent_length = grid.geometry.get_length(parent_id),
+			cell_min = grid.geometry.get_min(removed_cell_id),
+			cell_length = grid.geometry.get_length(removed_cell_id);
+
+		auto& parent_particles = Part(*parent_data);
+		for (uint64_t i = 0; i < header[1]; i++) {
+			parent_particles.emplace_back();
+			std::memcpy(&parent_particles.back(), position, sizeof(Particle));
+			position += sizeof(Particle);
+			move_position_to_cell(
+				Part_Pos(parent_particles.back()),
+				cell_min, cell_length,
+				parent_min, parent_length);
+		}
+	}
+}
+
+} // namespace detail
+
+
+/*!
+Adapts grid based on target min and max refinement level.
+
+Particles of refined and unrefined cells are redistributed
+as in handlers above and magnetic field as in
+pamhd::mhd::adapt_cells() which is used for refinement so that
+particles and fields are adapted together. Copies of remote
+neighbors' internal particles are updated afterwards.
+
+dccrg transfers data of unrefined cells on other processes
+than their parent only for variables with fixed size, so grid
+is adapted one level at a time and particles of cells with
+siblings on other processes are sent to parent's process
+separately, see detail::copy_split_siblings().
+
+Must be called between time steps, i.e. when there are no
+external particles. Assumes grid was initialized with
+neighborhood length of at least 1.
+*/
+template <
+	class Grid,
+	class Background_Magnetic_Field,
+	class Face_Magnetic_Field_Getter,
+	class Volume_Magnetic_Field_Getter,
+	class Background_Magnetic_Field_Getter,
+	class Target_Refinement_Level_Min_Getter,
+	class Target_Refinement_Level_Max_Getter,
+	class Particles_Getter,
+	class Particle_Position_Getter
+> void adapt_grid(
+	Grid& grid,
+	const Background_Magnetic_Field& bg_B,
+	const double& vacuum_permeability,
+	const Face_Magnetic_Field_Getter& Face_B,
+	const Volume_Magnetic_Field_Getter& Vol_B,
+	const Background_Magnetic_Field_Getter& Bg_B,
+	const Target_Refinement_Level_Min_Getter& RLMin,
+	const Target_Refinement_Level_Max_Getter& RLMax,
+	const Particles_Getter& Part_Int,
+	const Particle_Position_Getter& Part_Pos
+) try {
+	using Cell = Grid::cell_data_type;
+
+	std::unordered_set<uint64_t> remote_siblings;
+	for (int round = 0; round < grid.get_maximum_refinement_level(); round++) {
+		const auto split_cells = detail::copy_split_siblings(
+			grid, Part_Int, remote_siblings);
+		const auto changes = pamhd::mhd::adapt_cells(
+			grid, bg_B, vacuum_permeability,
+			Face_B, Vol_B, Bg_B, RLMin, RLMax,
+			New_Cells_Handler(Part_Int, Part_Pos),
+			Removed_Cells_Handler(Part_Int, Part_Pos, &remote_siblings),
+			1
+		);
+		if (changes == 0) {
+			break;
+		}
+		detail::send_split_siblings(grid, split_cells, Part_Int, Part_Pos);
+	}
+
+	// (ab)use external number counter as internal number counter
+	for (const auto& cell: grid.local_cells()) {
+		(*cell.data)[Nr_Particles_External()] = Part_Int(*cell.data).size();
+	}
+	Cell::set_transfer_all(true, Nr_Particles_External());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Nr_Particles_External());
+
+	for (const auto& cell: grid.remote_cells()) {
+		Part_Int(*cell.data).resize((*cell.data)[Nr_Particles_External()]);
+	}
+	Cell::set_transfer_all(true, Particles_Internal());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Particles_Internal());
+
+	for (const auto& cell: grid.local_cells()) {
+		(*cell.data)[Nr_Particles_External()] = 0;
+	}
+	Cell::set_transfer_all(true, Nr_Particles_External());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Nr_Particles_External());
+
+} catch (const std::exception& e) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + "): " + e.what());
+} catch (...) {
+	throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+}
+
+
+}} // namespaces
+
+#endif // ifndef PAMHD_PARTICLE_AMR_HPP
@@ -0,0 +1,216 @@
+/*
+Cached background magnetic field for particle propagation of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_PARTICLE_BACKGROUND_FIELD_CACHE_HPP
+#define PAMHD_PARTICLE_BACKGROUND_FIELD_CACHE_HPP
+
+
+#include "array"
+#include "cstdint"
+#include "stdexcept"
+#include "string"
+#include "unordered_map"
+#include "unordered_set"
+
+
+namespace pamhd {
+namespace particle {
+
+
+/*!
+Background magnetic field tabulated at vertices of grid cells.
+
+Evaluating analytic background field for every particle
+sums over all dipoles of field with divisions and powers
+even though field is static. This stores analytic field at
+corners of every local cell and returns trilinear
+interpolation inside the cell instead.
+
+Call update() after initializing grid and after every
+refinement or load balancing. Analytic field given to
+constructor must outlive cache and remains available via
+get_analytic() for validation.
+
+Dimensions with only one cell at refinement level 0
+are evaluated at center of grid as in particle::solve().
+
+Can be given to particle::solve() and solve_hyb() instead of
+analytic field.
+*/
+template<class Background_Field> class Background_Field_Cache
+{
+public:
+	//! field at cell corners, index = x + 2*y + 4*z, 0 == min side
+	using vertex_fields_type = std::array<std::array<double, 3>, 8>;
+
+private:
+	const Background_Field& analytic;
+	double vacuum_permeability = 0;
+	std::unordered_map<uint64_t, vertex_fields_type> vertex_fields;
+
+public:
+	Background_Field_Cache(
+		const Background_Field& analytic_,
+		const double& vacuum_permeability_
+	) :
+		analytic(analytic_),
+		vacuum_permeability(vacuum_permeability_)
+	{}
+
+
+	const Background_Field& get_analytic() const {
+		return this->analytic;
+	}
+
+
+	bool exists() const {
+		return this->analytic.exists();
+	}
+
+
+	/*!
+	Tabulates field in local cells of given grid which haven't
+	been tabulated yet and removes cells which aren't local.
+	*/
+	template<class Grid> void update(const Grid& grid) {
+		const std::array<double, 3>
+			grid_start{grid.geometry.get_start()},
+			grid_end{grid.geometry.get_end()},
+			grid_center{
+				(grid_end[0]-grid_start[0]) / 2,
+				(grid_end[1]-grid_start[1]) / 2,
+				(grid_end[2]-grid_start[2]) / 2
+			};
+		const auto lvl0 = grid.mapping.length.get();
+
+		std::unordered_set<uint64_t> local;
+		for (const auto& cell: grid.local_cells()) {
+			local.insert(cell.id);
+			if (this->vertex_fields.count(cell.id) > 0) {
+				continue;
+			}
+
+			const auto
+				cell_min = grid.geometry.get_min(cell.id),
+				cell_max = grid.geometry.get_max(cell.id);
+
+			auto& fields = this->vertex_fields[cell.id];
+			for (size_t i = 0; i < fields.size(); i++) {
+				std::array<double, 3> r{
+					(i & 1) == 0 ? cell_min[0] : cell_max[0],
+					(i & 2) == 0 ? cell_min[1] : cell_max[1],
+					(i & 4) == 0 ? cell_min[2] : cell_max[2]
+				};
+				for (size_t dim = 0; dim < 3; dim++) {
+					if (lvl0[dim] == 1) {
+						r[dim] = grid_center[dim];
+					}
+				}
+				const auto field = this->analytic.get_background_field(
+					r, this->vacuum_permeability);
+				fields[i] = {field[0], field[1], field[2]};
+			}
+		}
+
+		for (auto item = this->vertex_fields.begin(); item != this->vertex_fields.end(); ) {
+			if (local.count(item->first) == 0) {
+				item = this->vertex_fields.erase(item);
+			} else {
+				item++;
+			}
+		}
+	}
+
+
+	void clear() {
+		this->vertex_fields.clear();
+	}
+
+
+	//! Throws if field hasn't been tabulated in given cell.
+	const vertex_fields_type& get_vertex_fields(const uint64_t& cell_id) const {
+		const auto item = this->vertex_fields.find(cell_id);
+		if (item == this->vertex_fields.cend()) {
+			throw std::out_of_range(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Background field not tabulated in cell "
+				+ std::to_string(cell_id) + ", call update() after "
+				+ "modifying grid."
+			);
+		}
+		return item->second;
+	}
+
+
+	/*!
+	Returns field at given position relative to cell with given
+	vertex fields, every component in [0, 1] inside of cell.
+	*/
+	static std::array<double, 3> interpolate(
+		const vertex_fields_type& fields,
+		const auto& relative_position
+	) {
+		const std::array<double, 3>
+			pos_w{
+				double(relative_position[0]),
+				double(relative_position[1]),
+				double(relative_position[2])
+			},
+			neg_w{1 - pos_w[0], 1 - pos_w[1], 1 - pos_w[2]};
+
+		std::array<double, 3> ret_val{0, 0, 0};
+		for (size_t i = 0; i < fields.size(); i++) {
+			const double weight
+				= ((i & 1) == 0 ? neg_w[0] : pos_w[0])
+				* ((i & 2) == 0 ? neg_w[1] : pos_w[1])
+				* ((i & 4) == 0 ? neg_w[2] : pos_w[2]);
+			ret_val[0] += weight * fields[i][0];
+			ret_val[1] += weight * fields[i][1];
+			ret_val[2] += weight * fields[i][2];
+		}
+		return ret_val;
+	}
+
+
+	//! Returns field at given position relative to given cell.
+	std::array<double, 3> get_background_field(
+		const uint64_t& cell_id,
+		const auto& relative_position
+	) const {
+		return interpolate(this->get_vertex_fields(cell_id), relative_position);
+	}
+};
+
+
+}} // namespaces
+
+#endif // ifndef PAMHD_PARTICLE_BACKGROUND_FIELD_CACHE_HPP
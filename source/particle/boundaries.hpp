@@ -52,6 +52,7 @@ Author(s): Ilja Honkonen
 
 #include "mhd/common.hpp"
 #include "particle/common.hpp"
+#include "particle/random.hpp"
 #include "particle/splitter.hpp"
 #include "particle/variables.hpp"
 
@@ -384,14 +385,15 @@ template<
 	class Boundary_Temperature_Getter,
 	class Boundary_Nr_Particles_Getter,
 	class Boundary_Charge_To_Mass_Ratio_Getter,
-	class Boundary_Species_Mass_Getter
+	class Boundary_Species_Mass_Getter,
+	class Random_Source
 > size_t apply_massless_boundaries(
 	const Sim_Geometries& bdy_geoms,
 	std::vector<Boundaries>& boundaries,
 	const double& simulation_time,
 	const size_t& simulation_step,
 	Grid& grid,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	const double& particle_temp_nrj_ratio,
 	const double& vacuum_permeability,
 	const unsigned long long int& first_particle_id,
@@ -422,24 +424,11 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(B, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << ")" << std::endl;
-					abort();
-				}
-
-				Vol_B.data(*cell_data) = value_bdy.get_data(
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				Vol_B.data(*info.data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
@@ -453,24 +442,11 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(E, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-					const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << ")" << std::endl;
-					abort();
-				}
-
-				Ele.data(*cell_data) = value_bdy.get_data(
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				Ele.data(*info.data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
@@ -486,13 +462,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(N, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -500,16 +472,10 @@ template<
 
 				bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_N(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
@@ -523,13 +489,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(V, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -537,16 +499,10 @@ template<
 
 				bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_V(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
@@ -560,13 +516,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(T, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -574,16 +526,10 @@ template<
 
 				bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_T(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
@@ -597,13 +543,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(Nr, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -611,16 +553,10 @@ template<
 
 				bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_NPIC(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
@@ -634,13 +570,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(SpM, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -648,16 +580,10 @@ template<
 
 				bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_SpM(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
@@ -671,13 +597,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(C2M, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -685,22 +607,20 @@ template<
 
 				bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_C2M(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 			}
 		}
 
 		for (const auto& cell: bdy_cells) {
-			random_source.seed(cell + 100000 * simulation_step + 10000000000 * bdy_i);
+			set_random_stream(
+				random_source, cell, simulation_step,
+				random_stream::boundary + uint32_t(bdy_i),
+				cell + 100000 * simulation_step + 10000000000 * bdy_i
+			);
 
 			auto* const cell_data = grid[cell];
 			if (cell_data == nullptr) {
@@ -764,12 +684,13 @@ template<
 	class Particle_Position_T,
 	class Particle_ID_T,
 	class Grid,
-	class Particles_Getter
+	class Particles_Getter,
+	class Random_Source
 > size_t copy_particles(
 	const std::vector<uint64_t>& cells,
 	unsigned long long int first_particle_id,
 	const unsigned long long int particle_id_increase,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	Grid& grid,
 	const Particles_Getter Par
 ) {
@@ -791,9 +712,13 @@ template<
 	Par(*target_data).clear();
 
 	// copy particles to random position in target cell
-	const auto
-		cell_min = grid.geometry.get_min(cells[0]),
+	std::array<double, 3>
+		cell_min{0, 0, 0},
+		cell_max{1, 1, 1};
+	if constexpr (not is_cell_relative<typename Particle_Position_T::data_type>()) {
+		cell_min = grid.geometry.get_min(cells[0]);
 		cell_max = grid.geometry.get_max(cells[0]);
+	}
 	std::uniform_real_distribution<double>
 		pos_x_gen(cell_min[0], cell_max[0]),
 		pos_y_gen(cell_min[1], cell_max[1]),
@@ -860,14 +785,15 @@ template<
 	class Boundary_Temperature_Getter,
 	class Boundary_Nr_Particles_Getter,
 	class Boundary_Charge_To_Mass_Ratio_Getter,
-	class Boundary_Species_Mass_Getter
+	class Boundary_Species_Mass_Getter,
+	class Random_Source
 > size_t apply_boundaries(
 	const Sim_Geometries& bdy_geoms,
 	std::vector<Boundaries>& boundaries,
 	const double simulation_time,
 	const size_t simulation_step,
 	Grid& grid,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	const double particle_temp_nrj_ratio,
 	const double vacuum_permeability,
 	const unsigned long long int first_particle_id,
@@ -1117,13 +1043,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(N, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -1131,16 +1053,10 @@ template<
 
 				value_bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_N(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
 				/*
@@ -1173,13 +1089,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(V, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -1187,16 +1099,10 @@ template<
 
 				value_bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_V(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
 				if (v_cells.count(cell) == 0 and cpy_bdy_cells.count(cell) > 0) {
@@ -1224,13 +1130,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(T, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -1238,16 +1140,10 @@ template<
 
 				value_bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_T(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
 				if (t_cells.count(cell) == 0 and cpy_bdy_cells.count(cell) > 0) {
@@ -1282,13 +1178,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(Nr, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -1296,16 +1188,10 @@ template<
 
 				value_bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_NPIC(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
 				if (nr_cells.count(cell) == 0 and cpy_bdy_cells.count(cell) > 0) {
@@ -1339,13 +1225,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(SpM, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -1353,16 +1235,10 @@ template<
 
 				value_bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_SpM(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
 				if (spm_cells.count(cell) == 0 and cpy_bdy_cells.count(cell) > 0) {
@@ -1383,13 +1259,9 @@ template<
 		) {
 			auto& value_bdy = boundaries[bdy_i].get_value_boundary(C2M, i);
 			const auto& geometry_id = value_bdy.get_geometry_id();
-			const auto& cells = bdy_geoms.get_cells(geometry_id);
-			for (const auto& cell: cells) {
-				auto* const cell_data = grid[cell];
-				if (cell_data == nullptr) {
-					std::cerr <<  __FILE__ << "(" << __LINE__ << std::endl;
-					abort();
-				}
+			for (const auto& info: bdy_geoms.get_cell_info(geometry_id)) {
+				const auto& cell = info.id;
+				auto* const cell_data = info.data;
 
 				if (SInfo.data(*cell_data) < 0) {
 					continue;
@@ -1397,16 +1269,10 @@ template<
 
 				value_bdy_cells.insert(cell);
 
-				const auto c = grid.geometry.get_center(cell);
-				const auto r = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
-				const auto
-					lat = asin(c[2] / r),
-					lon = atan2(c[1], c[0]);
-
 				Bdy_C2M(*cell_data) = value_bdy.get_data(
 					simulation_time,
-					c[0], c[1], c[2],
-					r, lat, lon
+					info.center[0], info.center[1], info.center[2],
+					info.r, info.lat, info.lon
 				);
 
 				if (c2m_cells.count(cell) == 0 and cpy_bdy_cells.count(cell) > 0) {
@@ -1425,7 +1291,11 @@ template<
 				continue;
 			}
 
-			random_source.seed(cell + 100000 * simulation_step + 10000000000 * bdy_i);
+			set_random_stream(
+				random_source, cell, simulation_step,
+				random_stream::boundary + uint32_t(bdy_i),
+				cell + 100000 * simulation_step + 10000000000 * bdy_i
+			);
 
 			auto* const cell_data = grid[cell];
 			if (cell_data == nullptr) {
@@ -38,9 +38,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "cmath"
 #include "iostream"
 #include "random"
+#include "stdexcept"
+#include "string"
 #include "vector"
 
 #include "common_functions.hpp"
+#include "particle/relative_position.hpp"
 
 
 namespace pamhd {
@@ -206,6 +209,12 @@ template <
 	const typename Particle_ID_T::data_type first_id = 0,
 	const typename Particle_ID_T::data_type id_increment = 0
 ) {
+	static_assert(
+		not is_cell_relative<typename Position_T::data_type>(),
+		"Particles are created at absolute positions, convert "
+		"with get_relative_position() after assigning to cells"
+	);
+
 	using std::sqrt;
 
 	const Mass_T Mas{};
@@ -265,6 +274,344 @@ template <
 }
 
 
+/*!
+Returns speed normal to a surface of particle crossing it.
+
+Speed is in units of thermal speed sqrt(kT/m) and is sampled from
+flux weighted drifting Maxwellian x*exp(-(x-s)^2/2), x > 0,
+where s is bulk velocity normal to surface in same units,
+positive when plasma flows across surface.
+*/
+template<class Random_Source> double get_inflow_speed(
+	const double drift,
+	Random_Source& random_source
+) {
+	using std::abs;
+	using std::exp;
+	using std::log;
+	using std::sqrt;
+
+	std::uniform_real_distribution<> uniform(0, 1);
+	std::normal_distribution<> normal(0, 1);
+
+	if (drift < 0) {
+		// x*exp(-x^2/2) bounds target when drift < 0
+		while (true) {
+			const auto x = sqrt(-2 * log(1 - uniform(random_source)));
+			if (uniform(random_source) < exp(drift * x)) {
+				return x;
+			}
+		}
+	}
+
+	/*
+	(|x-s| + s)*exp(-(x-s)^2/2) bounds target when drift >= 0,
+	sample it as mixture of its two terms
+	*/
+	const auto first_weight = 2 / (2 + drift * sqrt(2 * M_PI));
+	while (true) {
+		double offset;
+		if (uniform(random_source) < first_weight) {
+			offset = sqrt(-2 * log(1 - uniform(random_source)));
+			if (uniform(random_source) < 0.5) {
+				offset = -offset;
+			}
+		} else {
+			offset = normal(random_source);
+		}
+		const auto x = drift + offset;
+		if (x <= 0) {
+			continue;
+		}
+		if (uniform(random_source) * (abs(offset) + drift) < x) {
+			return x;
+		}
+	}
+}
+
+
+/*!
+Returns number of particles crossing unit area in unit time.
+
+Particles have drifting Maxwellian velocity distribution
+with given number density, thermal speed sqrt(kT/m) and
+bulk velocity normal to surface, positive when plasma flows
+across surface.
+*/
+inline double get_inflow_flux(
+	const double number_density,
+	const double thermal_speed,
+	const double normal_velocity
+) {
+	if (thermal_speed <= 0) {
+		return number_density * std::max(0.0, normal_velocity);
+	}
+	const auto drift = normal_velocity / thermal_speed;
+	return number_density * thermal_speed * (
+		std::exp(-drift * drift / 2) / std::sqrt(2 * M_PI)
+		+ drift / 2 * (1 + std::erf(drift / std::sqrt(2.0)))
+	);
+}
+
+
+/*!
+Creates particles that cross given face of given volume during dt.
+
+Unlike create_particles() which fills volume with a drifting
+Maxwellian, only particles of flux weighted distribution that
+enter the domain from given volume during next dt are created,
+so volume need only be a thin layer outside of domain.
+
+face is direction of face shared with domain from given volume:
+-1 == -x face, +2 == +y face, etc. Particles are placed in given
+volume at distance from face that they travel in time uniformly
+distributed in [0, dt], capped to volume's length.
+
+nr_of_particles is number of particles that would fill given
+volume, total mass of created particles is that of real
+particles crossing the face but their number is scaled
+accordingly, at least one particle is created if any mass
+crosses the face.
+*/
+template <
+	class Particle,
+	class Mass_T,
+	class Charge_Mass_Ratio_T,
+	class Position_T,
+	class Velocity_T,
+	class Particle_ID_T,
+	class Species_Mass_T,
+	class Random_Source
+> std::vector<Particle> create_inflowing_particles(
+	const typename Velocity_T::data_type bulk_velocity,
+	const typename Position_T::data_type volume_min,
+	const typename Position_T::data_type volume_max,
+	const int face,
+	const double dt,
+	const double temperature,
+	const double number_density,
+	const size_t nr_of_particles,
+	const double charge_mass_ratio,
+	const typename Species_Mass_T::data_type species_mass,
+	const double particle_temp_nrj_ratio,
+	Random_Source& random_source,
+	const typename Particle_ID_T::data_type first_id = 0,
+	const typename Particle_ID_T::data_type id_increment = 0
+) {
+	static_assert(
+		not is_cell_relative<typename Position_T::data_type>(),
+		"Particles are created at absolute positions, convert "
+		"with get_relative_position() after assigning to cells"
+	);
+
+	using std::ceil;
+	using std::min;
+	using std::sqrt;
+	using std::to_string;
+
+	if (face == 0 or face < -3 or face > 3) {
+		throw std::domain_error(
+			__FILE__ "(" + to_string(__LINE__) + "): Invalid face: "
+			+ to_string(face)
+		);
+	}
+
+	std::vector<Particle> particles;
+	if (dt <= 0 or nr_of_particles == 0 or number_density <= 0) {
+		return particles;
+	}
+
+	const Mass_T Mas{};
+	const Position_T Pos{};
+	const Velocity_T Vel{};
+	const Charge_Mass_Ratio_T C2M{};
+	const Particle_ID_T Id{};
+	const Species_Mass_T Spe{};
+
+	const size_t
+		dim = size_t(std::abs(face) - 1),
+		dim1 = (dim + 1) % 3,
+		dim2 = (dim + 2) % 3;
+	// into domain
+	const double normal = face > 0 ? 1 : -1;
+	const auto
+		length = volume_max[dim] - volume_min[dim],
+		area
+			= (volume_max[dim1] - volume_min[dim1])
+			* (volume_max[dim2] - volume_min[dim2]),
+		face_coord = face > 0 ? volume_max[dim] : volume_min[dim],
+		thermal_speed = sqrt(particle_temp_nrj_ratio * temperature / species_mass),
+		normal_velocity = normal * bulk_velocity[dim];
+
+	const auto nr_real
+		= get_inflow_flux(number_density, thermal_speed, normal_velocity)
+		* area * dt;
+	if (nr_real <= 0) {
+		return particles;
+	}
+	const auto nr_real_per_particle
+		= number_density * length * area / nr_of_particles;
+	const size_t nr_created = size_t(ceil(nr_real / nr_real_per_particle));
+	const double particle_mass = species_mass * nr_real / nr_created;
+
+	std::normal_distribution<>
+		velocity_generator1(bulk_velocity[dim1], thermal_speed),
+		velocity_generator2(bulk_velocity[dim2], thermal_speed);
+	std::uniform_real_distribution<>
+		position_generator1(volume_min[dim1], volume_max[dim1]),
+		position_generator2(volume_min[dim2], volume_max[dim2]),
+		time_generator(0, dt);
+
+	particles.resize(nr_created);
+	typename Particle_ID_T::data_type new_id = first_id;
+	for (auto& p: particles) {
+		const auto speed
+			= thermal_speed > 0
+			? thermal_speed * get_inflow_speed(
+				normal_velocity / thermal_speed, random_source)
+			: normal_velocity;
+		const auto distance = min(
+			speed * time_generator(random_source),
+			length * (1 - 1e-9)
+		);
+
+		p[Mas] = particle_mass;
+		p[C2M] = charge_mass_ratio;
+		p[Spe] = species_mass;
+		p[Pos][dim] = face_coord - normal * distance;
+		p[Pos][dim1] = position_generator1(random_source);
+		p[Pos][dim2] = position_generator2(random_source);
+		p[Vel][dim] = normal * speed;
+		p[Vel][dim1] = velocity_generator1(random_source);
+		p[Vel][dim2] = velocity_generator2(random_source);
+		p[Id] = new_id;
+		new_id += id_increment;
+	}
+
+	return particles;
+}
+
+
+/*!
+Keeps given volume outside of domain stocked with particles
+that enter the domain across given face.
+
+Given particles are assumed to be in given volume, those that
+move toward face haven't crossed it yet and are kept, others are
+removed. Particles that entered volume across its opposite face
+during dt are added so mass crossing face during any time step
+matches flux of upstream plasma as long as step is too short for
+particles to cross whole volume. If dt isn't positive particles
+are replaced with those of drifting Maxwellian filling volume
+that move toward face.
+
+See create_inflowing_particles() for other arguments, returns
+number of particle ids used starting from first_id.
+*/
+template <
+	class Particle,
+	class Mass_T,
+	class Charge_Mass_Ratio_T,
+	class Position_T,
+	class Velocity_T,
+	class Particle_ID_T,
+	class Species_Mass_T,
+	class Random_Source
+> size_t stock_inflowing_particles(
+	std::vector<Particle>& particles,
+	const typename Velocity_T::data_type bulk_velocity,
+	const typename Position_T::data_type volume_min,
+	const typename Position_T::data_type volume_max,
+	const int face,
+	const double dt,
+	const double temperature,
+	const double number_density,
+	const size_t nr_of_particles,
+	const double charge_mass_ratio,
+	const typename Species_Mass_T::data_type species_mass,
+	const double particle_temp_nrj_ratio,
+	Random_Source& random_source,
+	const typename Particle_ID_T::data_type first_id = 0,
+	const typename Particle_ID_T::data_type id_increment = 0
+) {
+	using std::to_string;
+
+	if (face == 0 or face < -3 or face > 3) {
+		throw std::domain_error(
+			__FILE__ "(" + to_string(__LINE__) + "): Invalid face: "
+			+ to_string(face)
+		);
+	}
+
+	const Velocity_T Vel{};
+
+	const size_t dim = size_t(std::abs(face) - 1);
+	// into domain
+	const double normal = face > 0 ? 1 : -1;
+	const auto not_inflowing = [&](const Particle& p) {
+		return normal * p[Vel][dim] <= 0;
+	};
+
+	std::vector<Particle> new_particles;
+	if (dt <= 0) {
+		particles.clear();
+		if (number_density <= 0 or nr_of_particles == 0) {
+			return 0;
+		}
+		new_particles = create_particles<
+			Particle,
+			Mass_T,
+			Charge_Mass_Ratio_T,
+			Position_T,
+			Velocity_T,
+			Particle_ID_T,
+			Species_Mass_T
+		>(
+			bulk_velocity, volume_min, volume_max,
+			{temperature, temperature, temperature},
+			nr_of_particles, charge_mass_ratio,
+			species_mass * number_density
+				* (volume_max[0] - volume_min[0])
+				* (volume_max[1] - volume_min[1])
+				* (volume_max[2] - volume_min[2]),
+			species_mass, particle_temp_nrj_ratio,
+			random_source, first_id, id_increment
+		);
+		std::erase_if(new_particles, not_inflowing);
+		particles.insert(particles.end(), new_particles.cbegin(), new_particles.cend());
+		return nr_of_particles;
+	}
+
+	std::erase_if(particles, not_inflowing);
+
+	/*
+	particles entering volume across opposite face are
+	mirror images of ones leaving it in mirrored flow
+	*/
+	auto mirrored_velocity = bulk_velocity;
+	mirrored_velocity[dim] = -mirrored_velocity[dim];
+	new_particles = create_inflowing_particles<
+		Particle,
+		Mass_T,
+		Charge_Mass_Ratio_T,
+		Position_T,
+		Velocity_T,
+		Particle_ID_T,
+		Species_Mass_T
+	>(
+		mirrored_velocity, volume_min, volume_max, -face, dt,
+		temperature, number_density, nr_of_particles,
+		charge_mass_ratio, species_mass, particle_temp_nrj_ratio,
+		random_source, first_id, id_increment
+	);
+	for (auto& p: new_particles) {
+		p[Vel][dim] = -p[Vel][dim];
+	}
+	particles.insert(particles.end(), new_particles.cbegin(), new_particles.cend());
+	return new_particles.size();
+}
+
+
 /*
 Returns number of particles represented by given macroparticles.
 
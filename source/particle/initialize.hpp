@@ -45,6 +45,7 @@ Author(s): Ilja Honkonen
 #include "utility"
 
 #include "particle/common.hpp"
+#include "particle/random.hpp"
 #include "particle/variables.hpp"
 
 
@@ -152,13 +153,14 @@ template<
 	class Boundary_Nr_Particles_Getter,
 	class Boundary_Charge_To_Mass_Ratio_Getter,
 	class Boundary_Species_Mass_Getter,
-	class Solver_Info_Getter
+	class Solver_Info_Getter,
+	class Random_Source
 > size_t initialize_particles(
 	const Sim_Geometries& geometries,
 	Init_Cond& initial_conditions,
 	const double simulation_time,
 	Grid& grid,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	const double particle_temp_nrj_ratio,
 	const unsigned long long int first_particle_id,
 	const unsigned long long int particle_id_increase,
@@ -472,7 +474,8 @@ template<
 			continue;
 		}
 
-		random_source.seed(cell.id);
+		set_random_stream(
+			random_source, cell.id, 0, random_stream::initialize, cell.id);
 
 		const auto
 			cell_start = grid.geometry.get_min(cell.id),
@@ -51,7 +51,10 @@ namespace particle {
 
 
 /*
-Removes (TODO: Joins) particles in normal cells within given radius from origin.
+Removes particles in normal cells within given radius from origin.
+
+See merger.hpp for reducing number of particles while
+conserving their mass, momentum and energy.
 
 Ignores cells whose center is outside of given radius.
 
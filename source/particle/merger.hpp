@@ -0,0 +1,382 @@
+/*
+Particle merger of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_PARTICLE_MERGER_HPP
+#define PAMHD_PARTICLE_MERGER_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "cmath"
+#include "cstdint"
+#include "limits"
+#include "map"
+#include "stdexcept"
+#include "string"
+#include "type_traits"
+#include "utility"
+#include "vector"
+
+
+namespace pamhd {
+namespace particle {
+
+
+/*!
+Merges given particles into two particles.
+
+Total mass, momentum and kinetic energy of given particles
+are conserved. Merged particles are created at center of
+mass of given particles with half of total mass each and
+velocities v_c +- d where v_c is center of mass velocity
+and |d|^2 is mass weighted variance of velocity around v_c.
+d points towards velocity furthest from v_c among given
+particles so merged particles span the original distribution.
+
+First two particles indexed by given indices are overwritten
+with merged particles, others are left unmodified and should
+be removed by caller. Indices must not contain duplicates.
+*/
+template<
+	class Particle,
+	class Particle_Position_Getter,
+	class Particle_Mass_Getter,
+	class Particle_Velocity_Getter
+> void merge(
+	std::vector<Particle>& particles,
+	const std::vector<size_t>& indices,
+	const Particle_Position_Getter& Part_Pos,
+	const Particle_Mass_Getter& Part_Mas,
+	const Particle_Velocity_Getter& Part_Vel
+) {
+	using std::sqrt;
+	using std::to_string;
+
+	if (indices.size() < 3) {
+		throw std::invalid_argument(
+			__FILE__ "(" + to_string(__LINE__) + "): "
+			+ "At least 3 particles required for merging, given "
+			+ to_string(indices.size())
+		);
+	}
+
+	double mass = 0;
+	std::array<double, 3> center{0, 0, 0}, momentum{0, 0, 0};
+	for (const auto& i: indices) {
+		auto& particle = particles[i];
+		const double m = Part_Mas(particle);
+		const auto& pos = Part_Pos(particle);
+		const auto& vel = Part_Vel(particle);
+		mass += m;
+		for (size_t dim = 0; dim < 3; dim++) {
+			center[dim] += m * double(pos[dim]);
+			momentum[dim] += m * double(vel[dim]);
+		}
+	}
+	if (mass <= 0) {
+		throw std::domain_error(
+			__FILE__ "(" + to_string(__LINE__) + "): "
+			+ "Non-positive total mass of merged particles: "
+			+ to_string(mass)
+		);
+	}
+	std::array<double, 3> bulk_vel;
+	for (size_t dim = 0; dim < 3; dim++) {
+		center[dim] /= mass;
+		bulk_vel[dim] = momentum[dim] / mass;
+	}
+
+	// thermal energy around bulk velocity and its direction
+	double thermal = 0, max_dist2 = -1;
+	std::array<double, 3> direction{1, 0, 0};
+	for (const auto& i: indices) {
+		auto& particle = particles[i];
+		const double m = Part_Mas(particle);
+		const auto& vel = Part_Vel(particle);
+		const std::array<double, 3> dv{
+			double(vel[0]) - bulk_vel[0],
+			double(vel[1]) - bulk_vel[1],
+			double(vel[2]) - bulk_vel[2]
+		};
+		const auto dist2 = dv[0]*dv[0] + dv[1]*dv[1] + dv[2]*dv[2];
+		thermal += m * dist2;
+		if (dist2 > max_dist2) {
+			max_dist2 = dist2;
+			direction = dv;
+		}
+	}
+	const auto dir_length = sqrt(max_dist2);
+	if (dir_length > 0) {
+		for (auto& d: direction) {
+			d /= dir_length;
+		}
+	} else {
+		direction = {1, 0, 0};
+	}
+	const auto spread = sqrt(thermal / mass);
+
+	for (size_t merged = 0; merged < 2; merged++) {
+		auto& particle = particles[indices[merged]];
+		const double sign = merged == 0 ? 1 : -1;
+
+		Part_Mas(particle) = mass / 2;
+
+		auto& pos = Part_Pos(particle);
+		auto& vel = Part_Vel(particle);
+		using Pos_Real = std::remove_cvref_t<decltype(pos[0])>;
+		using Vel_Real = std::remove_cvref_t<decltype(vel[0])>;
+		for (size_t dim = 0; dim < 3; dim++) {
+			pos[dim] = Pos_Real(center[dim]);
+			vel[dim] = Vel_Real(bulk_vel[dim] + sign * spread * direction[dim]);
+		}
+	}
+}
+
+
+/*!
+Merges particles of given cell until at most given number remain.
+
+Particles are grouped by species, i.e. by species mass and
+charge to mass ratio, and every species gets a share of
+max_particles proportional to its number of particles but at
+least 2. Particles of a species are sorted into bins of their
+velocity space and consecutive runs of particles in bin order
+are merged into two particles with merge() so that mass,
+momentum and energy of every species are conserved.
+
+Particles with zero mass, e.g. test particles, are not merged.
+Positions returned by Part_Pos can be absolute or relative to
+cell as long as all particles of cell use the same format.
+
+Does nothing if max_particles is 0.
+
+Returns number of particles removed.
+*/
+template<
+	class Particle,
+	class Particle_Position_Getter,
+	class Particle_Mass_Getter,
+	class Particle_Velocity_Getter,
+	class Particle_Species_Mass_Getter,
+	class Particle_Charge_Mass_Ratio_Getter
+> uint64_t merge(
+	std::vector<Particle>& particles,
+	const size_t max_particles,
+	const Particle_Position_Getter& Part_Pos,
+	const Particle_Mass_Getter& Part_Mas,
+	const Particle_Velocity_Getter& Part_Vel,
+	const Particle_Species_Mass_Getter& Part_SpM,
+	const Particle_Charge_Mass_Ratio_Getter& Part_C2M
+) {
+	using std::ceil;
+	using std::cbrt;
+	using std::floor;
+	using std::max;
+	using std::min;
+
+	if (max_particles == 0 or particles.size() <= max_particles) {
+		return 0;
+	}
+
+	std::map<std::pair<double, double>, std::vector<size_t>> species;
+	size_t nr_massive = 0;
+	for (size_t i = 0; i < particles.size(); i++) {
+		auto& particle = particles[i];
+		if (Part_Mas(particle) <= 0) {
+			continue;
+		}
+		species[{Part_SpM(particle), Part_C2M(particle)}].push_back(i);
+		nr_massive++;
+	}
+	if (nr_massive == 0) {
+		return 0;
+	}
+	const size_t nr_massless = particles.size() - nr_massive;
+	const size_t max_massive
+		= max_particles > nr_massless ? max_particles - nr_massless : 0;
+
+	std::vector<bool> removed(particles.size(), false);
+	std::vector<size_t> run;
+	uint64_t nr_removed = 0;
+	for (auto& item: species) {
+		auto& indices = item.second;
+		const size_t target = max(
+			size_t(2),
+			size_t(floor(double(max_massive) * indices.size() / nr_massive))
+		);
+		if (indices.size() <= target) {
+			continue;
+		}
+		const size_t nr_runs = target / 2;
+
+		// bin velocities so that there are about as many bins as runs
+		constexpr auto inf = std::numeric_limits<double>::infinity();
+		std::array<double, 3> vmin{inf, inf, inf}, vmax{-inf, -inf, -inf};
+		for (const auto& i: indices) {
+			const auto& vel = Part_Vel(particles[i]);
+			for (size_t dim = 0; dim < 3; dim++) {
+				vmin[dim] = min(vmin[dim], double(vel[dim]));
+				vmax[dim] = max(vmax[dim], double(vel[dim]));
+			}
+		}
+		const uint64_t nr_bins = max(uint64_t(1), uint64_t(ceil(cbrt(double(nr_runs)))));
+		const auto get_bin = [&](const size_t& i) {
+			const auto& vel = Part_Vel(particles[i]);
+			std::array<uint64_t, 3> bin{0, 0, 0};
+			for (size_t dim = 0; dim < 3; dim++) {
+				const auto range = vmax[dim] - vmin[dim];
+				if (range <= 0) {
+					continue;
+				}
+				bin[dim] = min(
+					nr_bins - 1,
+					uint64_t((double(vel[dim]) - vmin[dim]) / range * nr_bins)
+				);
+			}
+			// snake order keeps consecutive bins adjacent in velocity space
+			if (bin[2] % 2 == 1) {
+				bin[1] = nr_bins - 1 - bin[1];
+			}
+			const auto row = bin[1] + nr_bins * bin[2];
+			if (row % 2 == 1) {
+				bin[0] = nr_bins - 1 - bin[0];
+			}
+			return bin[0] + nr_bins * row;
+		};
+		std::vector<std::pair<uint64_t, size_t>> sorted;
+		sorted.reserve(indices.size());
+		for (const auto& i: indices) {
+			sorted.emplace_back(get_bin(i), i);
+		}
+		std::sort(sorted.begin(), sorted.end());
+
+		// split into runs whose sizes differ by at most one
+		size_t start = 0;
+		for (size_t r = 0; r < nr_runs; r++) {
+			const size_t end = (r + 1) * sorted.size() / nr_runs;
+			if (end - start >= 3) {
+				run.clear();
+				for (size_t s = start; s < end; s++) {
+					run.push_back(sorted[s].second);
+				}
+				merge(particles, run, Part_Pos, Part_Mas, Part_Vel);
+				for (size_t s = 2; s < run.size(); s++) {
+					removed[run[s]] = true;
+					nr_removed++;
+				}
+			}
+			start = end;
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < particles.size(); i++) {
+		if (removed[i]) {
+			continue;
+		}
+		if (kept != i) {
+			particles[kept] = std::move(particles[i]);
+		}
+		kept++;
+	}
+	particles.resize(kept);
+
+	return nr_removed;
+}
+
+
+/*!
+Merges particles in normal cells until at most given number remain.
+
+Counterpart of split_particles() in splitter.hpp, see merge()
+for details. Max particles of 0 disables merging.
+
+Returns number of particles removed on this process.
+*/
+template<
+	class Grid,
+	class Particles_Getter,
+	class Particle_Position_Getter,
+	class Particle_Mass_Getter,
+	class Particle_Velocity_Getter,
+	class Particle_Species_Mass_Getter,
+	class Particle_Charge_Mass_Ratio_Getter,
+	class Solver_Info_Getter
+> uint64_t merge_particles(
+	const size_t max_particles,
+	Grid& grid,
+	const Particles_Getter& Particles,
+	const Particle_Position_Getter& Part_Pos,
+	const Particle_Mass_Getter& Part_Mas,
+	const Particle_Velocity_Getter& Part_Vel,
+	const Particle_Species_Mass_Getter& Part_SpM,
+	const Particle_Charge_Mass_Ratio_Getter& Part_C2M,
+	const Solver_Info_Getter& SInfo
+) {
+	using std::to_string;
+
+	if (max_particles == 0) {
+		return 0;
+	}
+
+	uint64_t removed = 0;
+	for (const auto& cell: grid.local_cells()) {
+		if (SInfo.data(*cell.data) < 0) {
+			continue;
+		}
+
+		try {
+			removed += merge(
+				Particles(*cell.data),
+				max_particles,
+				Part_Pos,
+				Part_Mas,
+				Part_Vel,
+				Part_SpM,
+				Part_C2M
+			);
+		} catch (const std::exception& e) {
+			throw std::runtime_error(
+				"Couldn't merge particles in cell "
+				+ to_string(cell.id) + " of type "
+				+ to_string(SInfo.data(*cell.data))
+				+ ": " + e.what()
+			);
+		}
+	}
+	return removed;
+}
+
+
+}} // namespaces
+
+#endif // ifndef PAMHD_PARTICLE_MERGER_HPP
@@ -54,7 +54,11 @@ struct Options
 		save_n{0},
 		gyroperiod_time_step_factor{1},
 		flight_time_step_factor{1};
-	size_t particles_in_cell{10}, min_particles{0};
+	size_t particles_in_cell{10}, min_particles{0}, max_particles{0};
+	// create only particles entering domain at solar wind boundary
+	bool flux_injection{false};
+	// max number of Boris steps per particle step, see solve()
+	unsigned int max_orbit_subcycles{1};
 
 	Options() = default;
 	Options(const Options& other) = default;
@@ -114,6 +118,51 @@ struct Options
 			this->min_particles = min_particles_json.GetUint();
 		}
 
+		if (object.HasMember("maximum-particles")) {
+			const auto& max_particles_json = object["maximum-particles"];
+			if (not max_particles_json.IsUint()) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "JSON item maximum-particles is not an unsigned integer."
+				);
+			}
+			this->max_particles = max_particles_json.GetUint();
+			if (
+				this->max_particles > 0
+				and this->max_particles < this->min_particles
+			) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "Invalid maximum-particles: "
+					+ to_string(this->max_particles)
+					+ ", should be 0 or >= minimum-particles ("
+					+ to_string(this->min_particles) + ")"
+				);
+			}
+		}
+
+		if (object.HasMember("solar-wind-injection")) {
+			const auto& injection_json = object["solar-wind-injection"];
+			if (not injection_json.IsString()) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "JSON item solar-wind-injection is not a string."
+				);
+			}
+			const string injection = injection_json.GetString();
+			if (injection == "fill") {
+				this->flux_injection = false;
+			} else if (injection == "flux") {
+				this->flux_injection = true;
+			} else {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "Invalid solar-wind-injection: " + injection
+					+ ", should be fill or flux"
+				);
+			}
+		}
+
 		if (object.HasMember("gyroperiod-time-step-factor")) {
 			const auto& gyroperiod_json = object["gyroperiod-time-step-factor"];
 			if (not gyroperiod_json.IsNumber()) {
@@ -125,6 +174,23 @@ struct Options
 			this->gyroperiod_time_step_factor = gyroperiod_json.GetDouble();
 		}
 
+		if (object.HasMember("max-orbit-subcycles")) {
+			const auto& subcycles_json = object["max-orbit-subcycles"];
+			if (not subcycles_json.IsUint()) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "JSON item max-orbit-subcycles is not an unsigned integer."
+				);
+			}
+			this->max_orbit_subcycles = subcycles_json.GetUint();
+			if (this->max_orbit_subcycles == 0) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "Invalid max-orbit-subcycles: 0, should be > 0"
+				);
+			}
+		}
+
 		if (object.HasMember("flight-time-step-factor")) {
 			const auto& flight_time_json = object["flight-time-step-factor"];
 			if (not flight_time_json.IsNumber()) {
@@ -0,0 +1,210 @@
+/*
+Counter based random number generator of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_PARTICLE_RANDOM_HPP
+#define PAMHD_PARTICLE_RANDOM_HPP
+
+
+#include "array"
+#include "cstdint"
+#include "limits"
+
+
+namespace pamhd {
+namespace particle {
+
+
+//! Streams of random numbers used by different parts of particle model.
+namespace random_stream {
+	constexpr uint32_t
+		initialize = 0,
+		split = 1,
+		solar_wind = 2,
+		copy = 3,
+		//! add boundary's index to get stream of that boundary
+		boundary = 1024;
+}
+
+
+/*!
+Counter based random number generator.
+
+Implements Philox4x32-10 of Salmon et al., "Parallel Random
+Numbers: As Easy as 1, 2, 3", SC11. Every (seed, cell, step,
+stream) produces an independent sequence of random numbers
+without state shared between sequences, so particles of any
+cell can be created independently of other cells, in any
+order and by any process or thread, and results don't depend
+on domain decomposition.
+
+Satisfies UniformRandomBitGenerator so can be used with
+distributions of standard library. Each sequence has 2^33
+numbers, after that sequence wraps around.
+
+Use set_random_stream() to position either this or other
+random source, e.g. std::mt19937_64, at start of a sequence.
+*/
+class Counter_Random_Source
+{
+public:
+	using result_type = uint64_t;
+
+	static constexpr result_type min() {
+		return std::numeric_limits<result_type>::min();
+	}
+	static constexpr result_type max() {
+		return std::numeric_limits<result_type>::max();
+	}
+
+	Counter_Random_Source(const uint32_t seed = 0) {
+		this->seed(seed);
+	}
+
+	//! Sets seed shared by all sequences and restarts current sequence.
+	void seed(const uint32_t seed) {
+		this->key_seed = seed;
+		this->restart();
+	}
+
+	/*!
+	Starts sequence of given cell, step and stream.
+
+	Only least significant 32 bits of step are used.
+	*/
+	void set_stream(
+		const uint64_t cell,
+		const uint64_t step,
+		const uint32_t stream
+	) {
+		this->counter_cell = cell;
+		this->counter_step = uint32_t(step);
+		this->key_stream = stream;
+		this->restart();
+	}
+
+	result_type operator()() {
+		if (this->buffer_i >= 2) {
+			this->buffer = this->get_block(this->block++);
+			this->buffer_i = 0;
+		}
+		const auto i = 2 * this->buffer_i++;
+		return (uint64_t(this->buffer[i]) << 32) | this->buffer[i + 1];
+	}
+
+	void discard(unsigned long long int n) {
+		while (n > 0 and this->buffer_i < 2) {
+			this->buffer_i++;
+			n--;
+		}
+		this->block += uint32_t(n / 2);
+		if (n % 2 > 0) {
+			this->buffer = this->get_block(this->block++);
+			this->buffer_i = 1;
+		}
+	}
+
+	//! Returns Philox4x32-10 of given counter and key.
+	static std::array<uint32_t, 4> philox(
+		std::array<uint32_t, 4> counter,
+		std::array<uint32_t, 2> key
+	) {
+		constexpr uint64_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+		constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+		for (int round = 0; round < 10; round++) {
+			const uint64_t
+				product0 = M0 * counter[0],
+				product1 = M1 * counter[2];
+			counter = {
+				uint32_t(product1 >> 32) ^ counter[1] ^ key[0],
+				uint32_t(product1),
+				uint32_t(product0 >> 32) ^ counter[3] ^ key[1],
+				uint32_t(product0)
+			};
+			key[0] += W0;
+			key[1] += W1;
+		}
+		return counter;
+	}
+
+private:
+	uint32_t key_seed = 0, key_stream = 0, counter_step = 0, block = 0;
+	uint64_t counter_cell = 0;
+	std::array<uint32_t, 4> buffer{0, 0, 0, 0};
+	// next unused half of buffer, 2 if none
+	unsigned int buffer_i = 2;
+
+	void restart() {
+		this->block = 0;
+		this->buffer_i = 2;
+	}
+
+	std::array<uint32_t, 4> get_block(const uint32_t block_i) const {
+		return philox(
+			{
+				uint32_t(this->counter_cell),
+				uint32_t(this->counter_cell >> 32),
+				this->counter_step,
+				block_i
+			},
+			{this->key_seed, this->key_stream}
+		);
+	}
+};
+
+
+/*!
+Positions given random source at start of sequence of given cell.
+
+Counter based sources are set to sequence of given cell, step
+and stream, see Counter_Random_Source. Other sources, e.g.
+std::mt19937_64, are seeded with legacy_seed if given and left
+as is otherwise, in which case their numbers depend on order
+in which cells are processed.
+*/
+template<class Random_Source, class... Legacy_Seed> void set_random_stream(
+	Random_Source& random_source,
+	const uint64_t cell,
+	const uint64_t step,
+	const uint32_t stream,
+	const Legacy_Seed&... legacy_seed
+) {
+	if constexpr (requires {random_source.set_stream(cell, step, stream);}) {
+		random_source.set_stream(cell, step, stream);
+	} else if constexpr (sizeof...(legacy_seed) > 0) {
+		random_source.seed(legacy_seed...);
+	}
+}
+
+
+}} // namespaces
+
+#endif // ifndef PAMHD_PARTICLE_RANDOM_HPP
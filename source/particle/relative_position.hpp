@@ -0,0 +1,216 @@
+/*
+Cell-relative particle positions of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_PARTICLE_RELATIVE_POSITION_HPP
+#define PAMHD_PARTICLE_RELATIVE_POSITION_HPP
+
+
+#include "array"
+#include "cmath"
+#include "cstdint"
+#include "tuple"
+#include "type_traits"
+
+
+namespace pamhd {
+namespace particle {
+
+
+/*!
+Particle position relative to minimum corner of particle's cell.
+
+Each component is given in units of cell's length in that
+dimension so particle is inside of its cell if every
+component is in [0, 1).
+
+Real can be float to halve memory used by positions, in
+which case precision of position is ~1e-7 of cell length
+regardless of cell's distance from origin.
+
+When compiled with MPI provides get_mpi_datatype().
+*/
+template<class Real> struct Cell_Relative_Position {
+	static_assert(std::is_floating_point_v<Real>);
+
+	//! Marks data as relative to cell, see is_cell_relative()
+	static constexpr bool is_cell_relative = true;
+
+	std::array<Real, 3> r;
+
+	Real& operator[](const size_t& i) { return this->r[i]; }
+	const Real& operator[](const size_t& i) const { return this->r[i]; }
+	static constexpr size_t size() { return 3; }
+
+	#ifdef MPI_VERSION
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype() const {
+		if constexpr (std::is_same_v<Real, float>) {
+			return std::make_tuple((void*) this->r.data(), 3, MPI_FLOAT);
+		} else if constexpr (std::is_same_v<Real, double>) {
+			return std::make_tuple((void*) this->r.data(), 3, MPI_DOUBLE);
+		} else {
+			return std::make_tuple((void*) this->r.data(), 3, MPI_LONG_DOUBLE);
+		}
+	}
+	#endif
+};
+
+
+//! Returns true if given position is relative to particle's cell.
+template<class Position> constexpr bool is_cell_relative() {
+	return requires {
+		std::remove_cvref_t<Position>::is_cell_relative;
+	};
+}
+
+
+//! Returns given absolute position relative to given cell.
+template<class Real> Cell_Relative_Position<Real> get_relative_position(
+	const auto& position,
+	const auto& cell_min,
+	const auto& cell_length
+) {
+	Cell_Relative_Position<Real> ret_val;
+	for (size_t dim = 0; dim < 3; dim++) {
+		ret_val[dim] = Real((position[dim] - cell_min[dim]) / cell_length[dim]);
+	}
+	return ret_val;
+}
+
+
+/*!
+Returns absolute coordinate of given position.
+
+Position can be absolute in which case it's returned
+as is or relative to cell with given min corner and length.
+*/
+std::array<double, 3> get_absolute_position(
+	const auto& position,
+	const auto& cell_min,
+	const auto& cell_length
+) {
+	if constexpr (is_cell_relative<decltype(position)>()) {
+		return {
+			cell_min[0] + double(position[0]) * cell_length[0],
+			cell_min[1] + double(position[1]) * cell_length[1],
+			cell_min[2] + double(position[2]) * cell_length[2]
+		};
+	} else {
+		return {position[0], position[1], position[2]};
+	}
+}
+
+
+//! Returns true if given relative position is inside of its cell.
+template<class Real> bool is_inside_cell(
+	const Cell_Relative_Position<Real>& position
+) {
+	return
+		position[0] >= 0 and position[0] < 1
+		and position[1] >= 0 and position[1] < 1
+		and position[2] >= 0 and position[2] < 1;
+}
+
+
+/*!
+Returns direction of cell into which given relative position points.
+
+Components are -1, 0 or +1 if position is at most one cell
+length away from its cell, 0 in every dimension if inside.
+*/
+template<class Real> std::array<int, 3> get_cell_offset(
+	const Cell_Relative_Position<Real>& position
+) {
+	return {
+		int(std::floor(position[0])),
+		int(std::floor(position[1])),
+		int(std::floor(position[2]))
+	};
+}
+
+
+/*!
+Returns relative position moved by given absolute displacement.
+
+Displacement is scaled by cell length so that relative
+position doesn't lose precision far from origin.
+*/
+template<class Real> Cell_Relative_Position<Real> get_displaced_position(
+	const Cell_Relative_Position<Real>& position,
+	const auto& displacement,
+	const auto& cell_length
+) {
+	Cell_Relative_Position<Real> ret_val;
+	for (size_t dim = 0; dim < 3; dim++) {
+		ret_val[dim] = Real(
+			double(position[dim]) + displacement[dim] / cell_length[dim]
+		);
+	}
+	return ret_val;
+}
+
+
+/*!
+Returns relative position with respect to another cell.
+
+neighbor_offset is distance from minimum corner of current
+cell to minimum corner of other cell, in units of cell length
+of current cell, e.g. dccrg neighbor.x / cell length in indices.
+Periodic grids are handled transparently as long as offset
+is obtained from neighbor lists instead of cell geometry.
+*/
+template<class Real> Cell_Relative_Position<Real> renormalize(
+	const Cell_Relative_Position<Real>& position,
+	const auto& cell_length,
+	const auto& neighbor_offset,
+	const auto& neighbor_length
+) {
+	Cell_Relative_Position<Real> ret_val;
+	for (size_t dim = 0; dim < 3; dim++) {
+		ret_val[dim] = Real(
+			(double(position[dim]) - neighbor_offset[dim])
+			* cell_length[dim] / neighbor_length[dim]
+		);
+		// guard against rounding outside of new cell
+		if (ret_val[dim] < 0 and ret_val[dim] > -1e-6) {
+			ret_val[dim] = 0;
+		}
+		if (ret_val[dim] >= 1 and ret_val[dim] < 1 + 1e-6) {
+			ret_val[dim] = std::nextafter(Real(1), Real(0));
+		}
+	}
+	return ret_val;
+}
+
+
+}} // namespaces
+
+#endif // ifndef PAMHD_PARTICLE_RELATIVE_POSITION_HPP
@@ -49,6 +49,7 @@ Author(s): Ilja Honkonen
 #include "mhd/solar_wind_box.hpp"
 #include "particle/common.hpp"
 #include "particle/options.hpp"
+#include "particle/random.hpp"
 #include "particle/solve_dccrg.hpp"
 #include "particle/variables.hpp"
 #include "simulation_options.hpp"
@@ -63,14 +64,15 @@ namespace particle {
 //! Returns id of next particle of this process
 template<
 	class Grid,
-	class Internal_Particle_Getter
+	class Internal_Particle_Getter,
+	class Random_Source
 > uint64_t initialize_plasma(
 	Grid& grid,
 	const double& sim_time,
 	const pamhd::Options& options_sim,
 	const pamhd::Solar_Wind_Box_Options& options_box,
 	const particle::Options& options_part,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	const Internal_Particle_Getter& Part_Int
 ) try {
 	using std::array;
@@ -85,9 +87,10 @@ template<
 	uint64_t
 		id_start = grid.get_rank(),
 		id_increase = grid.get_comm_size();
+	const auto sw = options_box.solar_wind.get(sim_time);
 	const auto temperature
-		= options_box.sw_pressure
-		/ options_box.sw_nr_density
+		= sw.pressure
+		/ sw.nr_density
 		/ options_sim.temp2nrj;
 	if (options_box.sw_dir != +1) {
 		throw std::runtime_error(__FILE__":"+std::to_string(__LINE__));
@@ -101,11 +104,12 @@ template<
 			cell_center = grid.geometry.get_center(cell.id);
 		const auto v_factor = std::max(0.0, cell_center[0]/grid_end[0]);
 		const array<double, 3> velocity{
-			v_factor * options_box.sw_velocity[0],
-			v_factor * options_box.sw_velocity[1],
-			v_factor * options_box.sw_velocity[2]};
+			v_factor * sw.velocity[0],
+			v_factor * sw.velocity[1],
+			v_factor * sw.velocity[2]};
 
-		random_source.seed(cell.id);
+		set_random_stream(
+			random_source, cell.id, 0, random_stream::initialize, cell.id);
 		Part_Int(*cell.data) = create_particles<
 			pamhd::particle::Particle_Internal,
 			pamhd::particle::Mass,
@@ -121,7 +125,7 @@ template<
 			array<double, 3>{temperature, temperature, temperature},
 			options_part.particles_in_cell,
 			options_sim.charge2mass,
-			options_sim.proton_mass * options_box.sw_nr_density
+			options_sim.proton_mass * sw.nr_density
 				* cell_length[0] * cell_length[1] * cell_length[2],
 			options_sim.proton_mass,
 			options_sim.temp2nrj,
@@ -174,10 +178,25 @@ template<
 }
 
 
+/*!
+Creates solar wind particles in given boundary cells.
+
+By default replaces particles of every local solar wind cell with
+particles_in_cell particles of drifting Maxwellian. If flux
+injection is enabled in options_part particles of solar wind cells
+moving toward normal cells are kept and those that entered solar
+wind cells from upstream during dt, length of step just taken, are
+added, see stock_inflowing_particles(). Other particles, e.g. ones
+that left the domain, are removed. Solar wind cells are filled
+with inflowing particles if dt is 0, e.g. before first step.
+
+Returns id of next particle of this process.
+*/
 template<
 	class Grid,
 	class Cells,
-	class Internal_Particle_Getter
+	class Internal_Particle_Getter,
+	class Random_Source
 > uint64_t apply_solar_wind_boundaries(
 	uint64_t next_particle_id,
 	const uint64_t& simulation_step,
@@ -187,52 +206,86 @@ template<
 	const Grid& grid,
 	const Cells& solar_wind_cells,
 	const double& sim_time,
-	std::mt19937_64& random_source,
+	const double& dt,
+	Random_Source& random_source,
 	const Internal_Particle_Getter& Part_Int
 ) try {
 	using std::array;
 
 	const uint64_t id_increase = grid.get_comm_size();
-	const auto temperature
-		= options_box.sw_pressure
-		/ options_box.sw_nr_density
-		/ options_sim.temp2nrj;
+	const auto sw = options_box.solar_wind.get(sim_time);
+	const auto
+		nr_density = sw.nr_density,
+		temperature
+			= sw.pressure
+			/ nr_density
+			/ options_sim.temp2nrj;
+	const auto& velocity = sw.velocity;
 	for (const auto& cell: solar_wind_cells) {
 		if (not cell.is_local) continue;
-		random_source.seed(cell.id + simulation_step * 1'000'000);
+		set_random_stream(
+			random_source, cell.id, simulation_step, random_stream::solar_wind,
+			cell.id + simulation_step * 1'000'000
+		);
 
 		const auto
 			cell_start = grid.geometry.get_min(cell.id),
 			cell_end = grid.geometry.get_max(cell.id),
 			cell_length = grid.geometry.get_length(cell.id);
 
-		Part_Int(*cell.data) = create_particles<
-			pamhd::particle::Particle_Internal,
-			pamhd::particle::Mass,
-			pamhd::particle::Charge_Mass_Ratio,
-			pamhd::particle::Position,
-			pamhd::particle::Velocity,
-			pamhd::particle::Particle_ID,
-			pamhd::particle::Species_Mass
-		>(
-			array<double, 3>{
-				options_box.sw_velocity[0],
-				options_box.sw_velocity[1],
-				options_box.sw_velocity[2]},
-			array<double, 3>{cell_start[0], cell_start[1], cell_start[2]},
-			array<double, 3>{cell_end[0], cell_end[1], cell_end[2]},
-			array<double, 3>{temperature, temperature, temperature},
-			options_part.particles_in_cell,
-			options_sim.charge2mass,
-			options_sim.proton_mass * options_box.sw_nr_density
-				* cell_length[0] * cell_length[1] * cell_length[2],
-			options_sim.proton_mass,
-			options_sim.temp2nrj,
-			random_source,
-			next_particle_id,
-			id_increase
-		);
-		next_particle_id += Part_Int(*cell.data).size() * id_increase;
+		if (options_part.flux_injection) {
+			const auto nr_ids = stock_inflowing_particles<
+				pamhd::particle::Particle_Internal,
+				pamhd::particle::Mass,
+				pamhd::particle::Charge_Mass_Ratio,
+				pamhd::particle::Position,
+				pamhd::particle::Velocity,
+				pamhd::particle::Particle_ID,
+				pamhd::particle::Species_Mass
+			>(
+				Part_Int(*cell.data),
+				array<double, 3>{velocity[0], velocity[1], velocity[2]},
+				array<double, 3>{cell_start[0], cell_start[1], cell_start[2]},
+				array<double, 3>{cell_end[0], cell_end[1], cell_end[2]},
+				-options_box.sw_dir,
+				dt,
+				temperature,
+				nr_density,
+				options_part.particles_in_cell,
+				options_sim.charge2mass,
+				options_sim.proton_mass,
+				options_sim.temp2nrj,
+				random_source,
+				next_particle_id,
+				id_increase
+			);
+			next_particle_id += nr_ids * id_increase;
+		} else {
+			Part_Int(*cell.data) = create_particles<
+				pamhd::particle::Particle_Internal,
+				pamhd::particle::Mass,
+				pamhd::particle::Charge_Mass_Ratio,
+				pamhd::particle::Position,
+				pamhd::particle::Velocity,
+				pamhd::particle::Particle_ID,
+				pamhd::particle::Species_Mass
+			>(
+				array<double, 3>{velocity[0], velocity[1], velocity[2]},
+				array<double, 3>{cell_start[0], cell_start[1], cell_start[2]},
+				array<double, 3>{cell_end[0], cell_end[1], cell_end[2]},
+				array<double, 3>{temperature, temperature, temperature},
+				options_part.particles_in_cell,
+				options_sim.charge2mass,
+				options_sim.proton_mass * nr_density
+					* cell_length[0] * cell_length[1] * cell_length[2],
+				options_sim.proton_mass,
+				options_sim.temp2nrj,
+				random_source,
+				next_particle_id,
+				id_increase
+			);
+			next_particle_id += Part_Int(*cell.data).size() * id_increase;
+		}
 	}
 	return next_particle_id;
 
@@ -243,6 +296,12 @@ template<
 }
 
 
+/*!
+Applies particle boundaries of solar wind box, see
+apply_solar_wind_boundaries() for use of dt.
+
+Returns id of next particle of this process.
+*/
 template<
 	class Grid,
 	class SW_Cells,
@@ -251,12 +310,14 @@ template<
 	class Vert_Cells,
 	class Planet_Cells,
 	class Internal_Particle_Getter,
-	class Solver_Info_Getter
+	class Solver_Info_Getter,
+	class Random_Source
 > uint64_t apply_boundaries_sw_box(
 	uint64_t next_particle_id,
 	const uint64_t& simulation_step,
 	Grid& grid,
 	const double& sim_time,
+	const double& dt,
 	const pamhd::Options& options_sim,
 	const pamhd::Solar_Wind_Box_Options& options_box,
 	const particle::Options& options_part,
@@ -265,7 +326,7 @@ template<
 	const Edge_Cells& edge_cells,
 	const Vert_Cells& vert_cells,
 	const Planet_Cells& planet_cells,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	const Internal_Particle_Getter& Part_Int,
 	const Solver_Info_Getter& SInfo
 ) try {
@@ -291,7 +352,10 @@ template<
 			}
 			if (copy_cells.size() != 2) throw runtime_error(__FILE__"(" + to_string(__LINE__) + ")");
 
-			random_source.seed(cell.id + simulation_step * 1'000'000);
+			set_random_stream(
+				random_source, cell.id, simulation_step, random_stream::copy,
+				cell.id + simulation_step * 1'000'000
+			);
 			next_particle_id += id_increase * copy_particles<
 				pamhd::particle::Position,
 				pamhd::particle::Particle_ID
@@ -316,7 +380,10 @@ template<
 			}
 			if (copy_cells.size() != 2) throw runtime_error(__FILE__"(" + to_string(__LINE__) + ")");
 
-			random_source.seed(cell.id + simulation_step * 1'000'000);
+			set_random_stream(
+				random_source, cell.id, simulation_step, random_stream::copy,
+				cell.id + simulation_step * 1'000'000
+			);
 			next_particle_id += id_increase * copy_particles<
 				pamhd::particle::Position,
 				pamhd::particle::Particle_ID
@@ -346,7 +413,10 @@ template<
 		}
 		if (copy_cells.size() != 2) throw runtime_error(__FILE__"(" + to_string(__LINE__) + ")");
 
-		random_source.seed(cell.id + simulation_step * 1'000'000);
+		set_random_stream(
+			random_source, cell.id, simulation_step, random_stream::copy,
+			cell.id + simulation_step * 1'000'000
+		);
 		next_particle_id += id_increase * copy_particles<
 			pamhd::particle::Position,
 			pamhd::particle::Particle_ID
@@ -359,11 +429,14 @@ template<
 
 	// planetary boundary cells
 	const auto temperature
-		= options_box.sw_pressure
-		/ options_box.sw_nr_density
+		= options_box.inner_pressure
+		/ options_box.inner_nr_density
 		/ options_sim.temp2nrj;
 	for (const auto& cell: planet_cells) {
-		random_source.seed(cell.id + simulation_step * 1'000'000);
+		set_random_stream(
+			random_source, cell.id, simulation_step, random_stream::solar_wind,
+			cell.id + simulation_step * 1'000'000
+		);
 		const auto
 			cell_start = grid.geometry.get_min(cell.id),
 			cell_end = grid.geometry.get_max(cell.id),
@@ -377,13 +450,13 @@ template<
 			pamhd::particle::Particle_ID,
 			pamhd::particle::Species_Mass
 		>(
-			array<double, 3>{0,0,0},
+			options_box.inner_velocity,
 			array<double, 3>{cell_start[0], cell_start[1], cell_start[2]},
 			array<double, 3>{cell_end[0], cell_end[1], cell_end[2]},
 			array<double, 3>{temperature, temperature, temperature},
 			options_part.particles_in_cell,
 			options_sim.charge2mass,
-			options_sim.proton_mass * options_box.sw_nr_density
+			options_sim.proton_mass * options_box.inner_nr_density
 				* cell_length[0] * cell_length[1] * cell_length[2],
 			options_sim.proton_mass,
 			options_sim.temp2nrj,
@@ -397,7 +470,7 @@ template<
 	next_particle_id = apply_solar_wind_boundaries(
 		next_particle_id, simulation_step, options_sim,
 		options_box, options_part, grid, solar_wind_cells,
-		sim_time, random_source, Part_Int
+		sim_time, dt, random_source, Part_Int
 	);
 
 	// update internal particles
@@ -39,6 +39,7 @@ Author(s): Ilja Honkonen
 
 
 #include "array"
+#include "cmath"
 #include "cstdlib"
 #include "exception"
 #include "type_traits"
@@ -49,12 +50,16 @@ Author(s): Ilja Honkonen
 
 #include "accumulate_dccrg.hpp"
 #include "common.hpp"
+#include "grid/halo_exchange.hpp"
 #include "interpolate.hpp"
 #include "math/interpolation.hpp"
 #include "math/nabla.hpp"
 #include "mhd/solve.hpp"
+#include "particle/background_field_cache.hpp"
+#include "particle/relative_position.hpp"
 #include "particle/solve.hpp"
 #include "substepping.hpp"
+#include "timers.hpp"
 #include "variables.hpp"
 
 
@@ -62,6 +67,340 @@ namespace pamhd {
 namespace particle {
 
 
+namespace detail {
+
+//! Substepping period of every cell is 1, for solving without substepping.
+struct No_Substeps {
+	int data(const auto&) const {
+		return 1;
+	}
+};
+
+
+/*!
+Returns number of Boris steps to take during dt.
+
+Particle with given gyrofrequency (rad/s) is subcycled so that
+each step is at most gyroperiod_factor gyroperiods but at most
+max_subcycles steps are taken.
+*/
+inline unsigned int get_orbit_subcycles(
+	const double& angular_velocity,
+	const double& dt,
+	const double& gyroperiod_factor,
+	const unsigned int& max_subcycles
+) {
+	if (max_subcycles <= 1 or gyroperiod_factor <= 0) {
+		return 1;
+	}
+	const auto needed = std::ceil(
+		angular_velocity * dt / (2 * M_PI * gyroperiod_factor));
+	if (not (needed > 1)) {
+		return 1;
+	}
+	if (needed >= max_subcycles) {
+		return max_subcycles;
+	}
+	return (unsigned int)needed;
+}
+
+
+/*!
+Stores position of propagated particle and moves particle to
+list of external particles of its cell if it left the cell.
+
+old_pos and new_pos are absolute coordinates of particle
+before and after propagation. Position returned by Part_Pos
+can be absolute or relative to particle's cell, see
+particle/relative_position.hpp. Relative positions are
+renormalized to destination cell.
+
+Particle stays in its current cell if destination cell isn't
+solved at current_substep, i.e. destination's particles
+haven't reached the same time yet, and is moved during a later
+substep so that every particle is propagated by same total time.
+
+Returns true if particle was removed from internal particles
+of given cell, i.e. particle was moved to external particles
+or removed from simulation because it left the grid.
+
+Throws if particle stayed inside of grid but no destination
+was found among neighbors of given cell.
+*/
+template<
+	class Cell_Item,
+	class Grid,
+	class Particles_Internal_Getter,
+	class Particles_External_Getter,
+	class Particle_Position_Getter,
+	class Particle_Destination_Cell_Getter,
+	class Substepping_Period_Getter
+> bool move_particle(
+	const Cell_Item& cell,
+	Grid& grid,
+	const std::array<double, 3>& cell_min,
+	const std::array<double, 3>& cell_max,
+	const std::array<double, 3>& cell_length,
+	const std::array<double, 3>& old_pos,
+	const std::array<double, 3>& new_pos,
+	const size_t part_i,
+	const Particles_Internal_Getter& Part_Int,
+	const Particles_External_Getter& Part_Ext,
+	const Particle_Position_Getter& Part_Pos,
+	const Particle_Destination_Cell_Getter& Part_Des,
+	const int& current_substep,
+	const Substepping_Period_Getter& Substep
+) {
+	using std::isnan;
+	using std::to_string;
+
+	auto& particles = Part_Int(*cell.data);
+	auto& position = Part_Pos(particles[part_i]);
+
+	uint64_t destination = dccrg::error_cell;
+	bool destination_synchronized = true;
+
+	if constexpr (is_cell_relative<decltype(position)>()) {
+
+		const auto rel_pos = get_displaced_position(
+			position,
+			std::array<double, 3>{
+				new_pos[0] - old_pos[0],
+				new_pos[1] - old_pos[1],
+				new_pos[2] - old_pos[2]
+			},
+			cell_length
+		);
+		if (is_inside_cell(rel_pos)) {
+			position = rel_pos;
+			return false;
+		}
+
+		// position in indices of grid's max refinement level
+		const auto cilen = grid.mapping.get_cell_length_in_indices(cell.id);
+		const std::array<double, 3> index_pos{
+			double(rel_pos[0]) * cilen,
+			double(rel_pos[1]) * cilen,
+			double(rel_pos[2]) * cilen
+		};
+		for (const auto& neighbor: cell.neighbors_of) {
+			const auto nilen = grid.mapping.get_cell_length_in_indices(neighbor.id);
+			if (
+				index_pos[0] >= neighbor.x
+				and index_pos[0] < neighbor.x + double(nilen)
+				and index_pos[1] >= neighbor.y
+				and index_pos[1] < neighbor.y + double(nilen)
+				and index_pos[2] >= neighbor.z
+				and index_pos[2] < neighbor.z + double(nilen)
+			) {
+				destination = neighbor.id;
+				destination_synchronized
+					= current_substep % Substep.data(*neighbor.data) == 0;
+				if (destination_synchronized) {
+					position = renormalize(
+						rel_pos,
+						cell_length,
+						std::array<double, 3>{
+							double(neighbor.x) / cilen,
+							double(neighbor.y) / cilen,
+							double(neighbor.z) / cilen
+						},
+						grid.geometry.get_length(neighbor.id)
+					);
+				} else {
+					position = rel_pos;
+				}
+				break;
+			}
+		}
+
+		if (destination == dccrg::error_cell) {
+			const auto real_pos = grid.geometry.get_real_coordinate(
+				{new_pos[0], new_pos[1], new_pos[2]});
+			// remove from simulation if particle not inside of grid
+			if (isnan(real_pos[0]) or isnan(real_pos[1]) or isnan(real_pos[2])) {
+				particles.erase(particles.begin() + part_i);
+				return true;
+			}
+		}
+
+	} else {
+
+		// take into account periodic grid
+		const auto real_pos
+			= grid.geometry.get_real_coordinate(
+				{new_pos[0], new_pos[1], new_pos[2]});
+
+		position = {real_pos[0], real_pos[1], real_pos[2]};
+
+		// remove from simulation if particle not inside of grid
+		if (isnan(real_pos[0]) or isnan(real_pos[1]) or isnan(real_pos[2])) {
+			particles.erase(particles.begin() + part_i);
+			return true;
+		}
+
+		if (
+			real_pos[0] >= cell_min[0]
+			and real_pos[0] <= cell_max[0]
+			and real_pos[1] >= cell_min[1]
+			and real_pos[1] <= cell_max[1]
+			and real_pos[2] >= cell_min[2]
+			and real_pos[2] <= cell_max[2]
+		) {
+			return false;
+		}
+
+		for (const auto& neighbor: cell.neighbors_of) {
+			const auto
+				neighbor_min = grid.geometry.get_min(neighbor.id),
+				neighbor_max = grid.geometry.get_max(neighbor.id);
+
+			if (
+				real_pos[0] >= neighbor_min[0]
+				and real_pos[0] <= neighbor_max[0]
+				and real_pos[1] >= neighbor_min[1]
+				and real_pos[1] <= neighbor_max[1]
+				and real_pos[2] >= neighbor_min[2]
+				and real_pos[2] <= neighbor_max[2]
+			) {
+				destination = neighbor.id;
+				destination_synchronized
+					= current_substep % Substep.data(*neighbor.data) == 0;
+				break;
+			}
+		}
+	}
+
+	if (destination == dccrg::error_cell) {
+		std::string neighbors;
+		for (const auto& neighbor: cell.neighbors_of) {
+			neighbors += to_string(neighbor.id) + " ";
+		}
+		throw std::runtime_error(
+			__FILE__ "(" + to_string(__LINE__) + "): "
+			+ "No destination found for particle propagated from ("
+			+ to_string(old_pos[0]) + ", " + to_string(old_pos[1]) + ", "
+			+ to_string(old_pos[2]) + ") to (" + to_string(new_pos[0]) + ", "
+			+ to_string(new_pos[1]) + ", " + to_string(new_pos[2])
+			+ ") in cell " + to_string(cell.id) + " of length ("
+			+ to_string(cell_length[0]) + ", " + to_string(cell_length[1])
+			+ ", " + to_string(cell_length[2]) + ") from neighbors " + neighbors
+		);
+	}
+
+	if (not destination_synchronized) {
+		return false;
+	}
+
+	const auto index = Part_Ext.data(*cell.data).size();
+	Part_Ext.data(*cell.data).resize(index + 1);
+	assign(Part_Ext.data(*cell.data)[index], particles[part_i]);
+	Part_Des(Part_Ext.data(*cell.data)[index]) = destination;
+
+	particles.erase(particles.begin() + part_i);
+	return true;
+}
+
+
+/*!
+Returns data of neighborhood of given cell in order used by interpolate().
+
+Each of the 27 items is average of get_data() over neighbors
+overlapping the cell-sized region at that position, weighted
+by overlap volume, so neighbors of different size than given
+cell are also included. Regions without neighbors, or only
+with neighbors whose cell type < 0, have data of given cell.
+*/
+template<
+	class Cell_Item,
+	class Grid,
+	class Data_Getter,
+	class Cell_Type_Getter
+> auto get_neighborhood_data(
+	const Cell_Item& cell,
+	const Grid& grid,
+	const Data_Getter& get_data,
+	const Cell_Type_Getter& CType
+) {
+	using std::max;
+	using std::min;
+
+	using Data_T = std::remove_cvref_t<decltype(get_data(*cell.data))>;
+
+	std::array<Data_T, 27> data;
+	data.fill(get_data(*cell.data));
+	std::array<double, 27> total_weight;
+	total_weight.fill(0);
+
+	const auto cilen = int64_t(grid.mapping.get_cell_length_in_indices(cell.id));
+	for (const auto& neighbor: cell.neighbors_of) {
+		if (CType.data(*neighbor.data) < 0) {
+			continue;
+		}
+
+		const auto nilen = int64_t(grid.mapping.get_cell_length_in_indices(neighbor.id));
+		const auto neigh_data = get_data(*neighbor.data);
+
+		if (nilen == cilen) {
+			if (
+				neighbor.x % cilen != 0
+				or neighbor.y % cilen != 0
+				or neighbor.z % cilen != 0
+			) {
+				continue;
+			}
+			const int64_t
+				x = neighbor.x / cilen,
+				y = neighbor.y / cilen,
+				z = neighbor.z / cilen;
+			if (x < -1 or x > 1 or y < -1 or y > 1 or z < -1 or z > 1) {
+				continue;
+			}
+			const size_t index = (z + 1) * 9 + (y + 1) * 3 + x + 1;
+			data[index] = neigh_data;
+			total_weight[index] = 1;
+			continue;
+		}
+
+		// overlap with each region in indices relative to cell
+		const std::array<int64_t, 3> neigh_min{neighbor.x, neighbor.y, neighbor.z};
+		for (int64_t z = -1; z <= 1; z++)
+		for (int64_t y = -1; y <= 1; y++)
+		for (int64_t x = -1; x <= 1; x++) {
+			const std::array<int64_t, 3> region{x, y, z};
+			double weight = 1;
+			for (size_t dim = 0; dim < 3; dim++) {
+				const auto overlap
+					= min(neigh_min[dim] + nilen, (region[dim] + 1) * cilen)
+					- max(neigh_min[dim], region[dim] * cilen);
+				weight *= double(max(int64_t(0), overlap)) / cilen;
+			}
+			if (weight <= 0) {
+				continue;
+			}
+
+			const size_t index = (z + 1) * 9 + (y + 1) * 3 + x + 1;
+			if (total_weight[index] == 0) {
+				data[index] = pamhd::mul(weight, neigh_data);
+			} else {
+				data[index] = pamhd::add(data[index], pamhd::mul(weight, neigh_data));
+			}
+			total_weight[index] += weight;
+		}
+	}
+
+	for (size_t i = 0; i < data.size(); i++) {
+		if (total_weight[i] > 0 and total_weight[i] != 1) {
+			data[i] = pamhd::mul(1 / total_weight[i], data[i]);
+		}
+	}
+
+	return data;
+}
+
+} // namespace detail
+
+
 /*!
 Propagates particles in given cells for a given amount of time.
 
@@ -71,8 +410,26 @@ cell in which they are stored are moved to the External_Particles_T
 list of their previous cell and added to Particle_Destinations_T
 information.
 
-Assumes grid was initialized with neighbhorhood size of 1 and
-maximum refinement level of 0.
+bg_B can be analytic background field or Background_Field_Cache
+in which case cached field is interpolated inside each cell.
+
+With substepping only cells whose substepping period (in 2^N
+format) divides current_substep are solved, using time step
+of dt times their period, see move_particle() for particles
+moving between cells of different period. Cells and their
+neighbors can be of different size.
+
+Particles gyrating rapidly are subcycled with up to
+max_orbit_subcycles Boris steps during cell's time step with
+fields interpolated to particle's position before each step,
+each step being at most gyroperiod_time_step_factor gyroperiods
+if possible. Fields of particle's cell and its neighbors are
+used for the whole time step. Max_ω_part
+is divided by max_orbit_subcycles so that minimize_timestep()
+doesn't restrict global time step more than necessary.
+
+Assumes grid was initialized with neighbhorhood size of at
+least 1.
 */
 template<
 	class Cell_Iterator,
@@ -90,7 +447,8 @@ template<
 	class Particle_Charge_Mass_Ratio_Getter,
 	class Particle_Mass_Getter,
 	class Particle_Destination_Cell_Getter,
-	class Cell_Type_Getter
+	class Cell_Type_Getter,
+	class Substepping_Period_Getter
 > void solve(
 	const double& dt,
 	const Cell_Iterator& cells,
@@ -111,7 +469,11 @@ template<
 	const Particle_Charge_Mass_Ratio_Getter& Part_C2M,
 	const Particle_Mass_Getter& Part_Mas,
 	const Particle_Destination_Cell_Getter& Part_Des,
-	const Cell_Type_Getter& CType
+	const Cell_Type_Getter& CType,
+	const int& current_substep,
+	const Substepping_Period_Getter& Substep,
+	const unsigned int& max_orbit_subcycles = 1,
+	const double& gyroperiod_time_step_factor = 1
 ) {
 	using std::abs;
 	using std::isnan;
@@ -121,25 +483,11 @@ template<
 
 	using Cell = Grid::cell_data_type;
 
-	if (grid.get_maximum_refinement_level() > 0) {
-		throw std::runtime_error("Only maximum refinement level 0 supported.");
-	}
+	constexpr bool bg_B_is_cached = requires {
+		bg_B.get_vertex_fields(uint64_t(0));
+	};
 
-	bool update_copies = false;
-	if (JmV.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, JmV.type());
-		JmV.type().is_stale = false;
-	}
-	if (Vol_B.type().is_stale) {
-		update_copies = true;
-		Cell::set_transfer_all(true, Vol_B.type());
-		Vol_B.type().is_stale = false;
-	}
-	if (update_copies) {
-		grid.update_copies_of_remote_neighbors();
-	}
-	Cell::set_transfer_all(false, JmV.type(), Vol_B.type());
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, JmV, Vol_B);
 
 	std::pair<double, double> max_time_step{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
 	const std::array<double, 3>
@@ -151,38 +499,40 @@ template<
 			(grid_end[2]-grid_start[2]) / 2
 		};
 	for (const auto& cell: cells) {
-		Max_v_part.data(*cell.data) =
-		Max_ω_part.data(*cell.data) = 0;
 		if (CType.data(*cell.data) < 0) {
+			Max_v_part.data(*cell.data) =
+			Max_ω_part.data(*cell.data) = 0;
 			Part_Int(*cell.data).clear();
 			Part_Ext.data(*cell.data).clear();
 			Nr_Ext.data(*cell.data) = 0;
 			continue;
 		}
-
-		// get field data from neighborhood for interpolation
-		std::array<std::array<double, 3>, 27> current_minus_velocities, magnetic_fields;
-
-		// default to current cell's data
-		current_minus_velocities.fill(JmV.data(*cell.data));
-		magnetic_fields.fill(Vol_B.data(*cell.data));
-
-		for (const auto& neighbor: cell.neighbors_of) {
-			if (
-				abs(neighbor.x) > 1
-				or abs(neighbor.y) > 1
-				or abs(neighbor.z) > 1
-			) {
-				continue;
-			}
-			if (CType.data(*neighbor.data) < 0) {
-				continue;
-			}
-
-			const size_t index = (neighbor.z + 1) * 9 + (neighbor.y + 1) * 3 + neighbor.x + 1;
-			current_minus_velocities[index] = JmV.data(*neighbor.data);
-			magnetic_fields[index] = Vol_B.data(*neighbor.data);
+		if (current_substep % Substep.data(*cell.data) != 0) {
+			Nr_Ext.data(*cell.data) = Part_Ext.data(*cell.data).size();
+			continue;
 		}
+		Max_v_part.data(*cell.data) =
+		Max_ω_part.data(*cell.data) = 0;
+
+		const double cell_dt = dt * Substep.data(*cell.data);
+
+		/*
+		Get field data from neighborhood for interpolation,
+		packed as B followed by J - V (or E) so both are
+		gathered at once using same stencil
+		*/
+		const auto fields = detail::get_neighborhood_data(
+			cell, grid,
+			[&](auto& cell_data) {
+				const auto
+					&b = Vol_B.data(cell_data),
+					&jmv = JmV.data(cell_data);
+				return std::array<double, 6>{
+					b[0], b[1], b[2], jmv[0], jmv[1], jmv[2]
+				};
+			},
+			CType
+		);
 
 		const auto
 			cell_min = grid.geometry.get_min(cell.id),
@@ -202,132 +552,99 @@ template<
 				cell_center[2] + cell_length[2]
 			};
 
-		for (size_t part_i = 0; part_i < Part_Int(*cell.data).size(); part_i++) {
-			auto
-				pos = Part_Pos(Part_Int(*cell.data)[part_i]),
-				// emulate 2d,1d,0d sim from B0 perspective
-				bg_pos = pos;
-			const auto lvl0 = grid.mapping.length.get();
+		const auto lvl0 = grid.mapping.length.get();
+
+		// tabulated background field of cell, see background_field_cache.hpp
+		const auto bg_B_vertex_fields = [&](){
+			if constexpr (bg_B_is_cached) {
+				return &bg_B.get_vertex_fields(cell.id);
+			} else {
+				return nullptr;
+			}
+		}();
+
+		// returns E and B at given position
+		const auto get_E_B = [&](const std::array<double, 3>& pos){
+			// emulate 2d,1d,0d sim from B0 perspective
+			auto bg_pos = pos;
 			for (size_t dim = 0; dim < 3; dim++) {
 				if (lvl0[dim] == 1) {
 					bg_pos[dim] = grid_center[dim];
 				}
 			}
-			const std::array<double, 3> B_at_pos = pamhd::add(
-				interpolate(
-					pos, interpolation_start,
-					interpolation_end, magnetic_fields),
-				bg_B.get_background_field(
-					bg_pos, vacuum_permeability));
+
+			const auto fields_at_pos = interpolate(
+				get_interpolation_stencil(
+					pos, interpolation_start, interpolation_end),
+				fields);
+			const std::array<double, 3>
+				J_m_V_at_pos{
+					fields_at_pos[3], fields_at_pos[4], fields_at_pos[5]
+				},
+				B_at_pos = pamhd::add(
+					std::array<double, 3>{
+						fields_at_pos[0], fields_at_pos[1], fields_at_pos[2]
+					},
+					[&](){
+						if constexpr (bg_B_is_cached) {
+							// subcycled particle can be outside of cell
+							std::array<double, 3> relative_pos;
+							for (size_t dim = 0; dim < 3; dim++) {
+								relative_pos[dim] = min(1.0, max(0.0,
+									(pos[dim] - cell_min[dim]) / cell_length[dim]));
+							}
+							return Background_Magnetic_Field::interpolate(
+								*bg_B_vertex_fields, relative_pos);
+						} else {
+							return bg_B.get_background_field(
+								bg_pos, vacuum_permeability);
+						}
+					}());
+
+			if (E_is_derived_quantity) {
+				return std::make_pair(pamhd::cross(J_m_V_at_pos, B_at_pos), B_at_pos);
+			} else {
+				return std::make_pair(J_m_V_at_pos, B_at_pos);
+			}
+		};
+
+		for (size_t part_i = 0; part_i < Part_Int(*cell.data).size(); part_i++) {
+			const auto old_pos = get_absolute_position(
+				Part_Pos(Part_Int(*cell.data)[part_i]),
+				cell_min, cell_length);
+			auto pos = old_pos;
+			auto [E_at_pos, B_at_pos] = get_E_B(pos);
 
 			auto vel = Part_Vel(Part_Int(*cell.data)[part_i]);
 			Max_v_part.data(*cell.data) = max(
 				Max_v_part.data(*cell.data),
 				pamhd::norm(vel));
 			const auto& c2m = Part_C2M(Part_Int(*cell.data)[part_i]);
+			const auto angular_velocity = abs(c2m) * pamhd::norm(B_at_pos);
 			Max_ω_part.data(*cell.data) = max(
 				Max_ω_part.data(*cell.data),
-				abs(c2m) * pamhd::norm(B_at_pos));
-
-			const std::array<double, 3> E_at_pos = [&](){
-				if (E_is_derived_quantity) {
-					const auto J_m_V_at_pos = interpolate(
-						pos, interpolation_start,
-						interpolation_end, current_minus_velocities
-					);
-					return pamhd::cross(J_m_V_at_pos, B_at_pos);
-				} else {
-					return interpolate(
-						pos, interpolation_start,
-						interpolation_end, current_minus_velocities
-					);
+				angular_velocity / max_orbit_subcycles);
+
+			const auto subcycles = detail::get_orbit_subcycles(
+				angular_velocity, cell_dt,
+				gyroperiod_time_step_factor, max_orbit_subcycles);
+			for (unsigned int subcycle = 0; subcycle < subcycles; subcycle++) {
+				if (subcycle > 0) {
+					std::tie(E_at_pos, B_at_pos) = get_E_B(pos);
 				}
-			}();
-			std::tie(pos, vel) = propagate(
-				pos, vel, E_at_pos, B_at_pos, c2m, dt
-			);
+				std::tie(pos, vel) = propagate(
+					pos, vel, E_at_pos, B_at_pos, c2m, cell_dt / subcycles
+				);
+			}
 			Part_Vel(Part_Int(*cell.data)[part_i]) = vel;
 
-			// take into account periodic grid
-			const auto real_pos
-				= grid.geometry.get_real_coordinate(
-					{pos[0], pos[1], pos[2]});
-
-			Part_Pos(Part_Int(*cell.data)[part_i]) = {
-				real_pos[0], real_pos[1], real_pos[2]
-			};
-
-			// remove from simulation if particle not inside of grid
-			if (
-				isnan(real_pos[0])
-				or isnan(real_pos[1])
-				or isnan(real_pos[2])
-			) {
-
-				Part_Int(*cell.data).erase(Part_Int(*cell.data).begin() + part_i);
+			if (detail::move_particle(
+				cell, grid, cell_min, cell_max, cell_length,
+				old_pos, pos, part_i,
+				Part_Int, Part_Ext, Part_Pos, Part_Des,
+				current_substep, Substep
+			)) {
 				part_i--;
-
-			// move to ext list if particle outside of current cell
-			} else if (
-				real_pos[0] < cell_min[0]
-				or real_pos[0] > cell_max[0]
-				or real_pos[1] < cell_min[1]
-				or real_pos[1] > cell_max[1]
-				or real_pos[2] < cell_min[2]
-				or real_pos[2] > cell_max[2]
-			) {
-				uint64_t destination = dccrg::error_cell;
-
-				for (const auto& neighbor: cell.neighbors_of) {
-					const auto
-						neighbor_min = grid.geometry.get_min(neighbor.id),
-						neighbor_max = grid.geometry.get_max(neighbor.id);
-
-					if (
-						real_pos[0] >= neighbor_min[0]
-						and real_pos[0] <= neighbor_max[0]
-						and real_pos[1] >= neighbor_min[1]
-						and real_pos[1] <= neighbor_max[1]
-						and real_pos[2] >= neighbor_min[2]
-						and real_pos[2] <= neighbor_max[2]
-					) {
-						destination = neighbor.id;
-						break;
-					}
-				}
-
-				if (destination != dccrg::error_cell) {
-
-					const auto index = Part_Ext.data(*cell.data).size();
-
-					Part_Ext.data(*cell.data).resize(index + 1);
-					assign(
-						Part_Ext.data(*cell.data)[index],
-						Part_Int(*cell.data)[part_i]
-					);
-					Part_Des(Part_Ext.data(*cell.data)[index]) = destination;
-
-					Part_Int(*cell.data).erase(Part_Int(*cell.data).begin() + part_i);
-					part_i--;
-
-				} else {
-
-					std::cerr << __FILE__ << "(" << __LINE__ << "): "
-						<< " No destination found for particle at " << real_pos
-						<< " propagated from " << real_pos
-						<< " with dt " << dt
-						<< " in cell " << cell.id
-						<< " of length " << cell_length
-						<< " at " << cell_center
-						<< " with E " << pamhd::cross(JmV.data(*cell.data), Vol_B.data(*cell.data))
-						<< " and B " << Vol_B.data(*cell.data)
-						<< " from neighbors ";
-					for (const auto& neighbor: cell.neighbors_of) {
-						std::cerr << neighbor.id << " ";
-					}
-					std::cerr << std::endl;
-					abort();
-				}
 			}
 		}
 
@@ -339,6 +656,54 @@ template<
 	Max_ω_part.type().is_stale = true;
 }
 
+//! As solve() above but solves all given cells without substepping.
+template<
+	class Cell_Iterator,
+	class Grid,
+	class Background_Magnetic_Field,
+	class Current_Minus_Velocity_Getter,
+	class Volume_Magnetic_Field_Getter,
+	class Nr_Particles_External_Getter,
+	class Particles_Internal_Getter,
+	class Particles_External_Getter,
+	class Particle_Max_Spatial_Velocity_Getter,
+	class Particle_Max_Angular_Velocity_Getter,
+	class Particle_Position_Getter,
+	class Particle_Velocity_Getter,
+	class Particle_Charge_Mass_Ratio_Getter,
+	class Particle_Mass_Getter,
+	class Particle_Destination_Cell_Getter,
+	class Cell_Type_Getter
+> void solve(
+	const double& dt,
+	const Cell_Iterator& cells,
+	Grid& grid,
+	const Background_Magnetic_Field& bg_B,
+	const double& vacuum_permeability,
+	const bool& E_is_derived_quantity,
+	const Current_Minus_Velocity_Getter& JmV,
+	const Volume_Magnetic_Field_Getter& Vol_B,
+	const Nr_Particles_External_Getter& Nr_Ext,
+	const Particles_Internal_Getter& Part_Int,
+	const Particles_External_Getter& Part_Ext,
+	const Particle_Max_Spatial_Velocity_Getter& Max_v_part,
+	const Particle_Max_Angular_Velocity_Getter& Max_ω_part,
+	const Particle_Position_Getter& Part_Pos,
+	const Particle_Velocity_Getter& Part_Vel,
+	const Particle_Charge_Mass_Ratio_Getter& Part_C2M,
+	const Particle_Mass_Getter& Part_Mas,
+	const Particle_Destination_Cell_Getter& Part_Des,
+	const Cell_Type_Getter& CType
+) {
+	solve(
+		dt, cells, grid, bg_B, vacuum_permeability,
+		E_is_derived_quantity, JmV, Vol_B, Nr_Ext,
+		Part_Int, Part_Ext, Max_v_part, Max_ω_part,
+		Part_Pos, Part_Vel, Part_C2M, Part_Mas, Part_Des,
+		CType, 1, detail::No_Substeps()
+	);
+}
+
 
 /*!
 Propagates particles in given cells for a given amount of time.
@@ -349,8 +714,11 @@ cell in which they are stored are moved to the External_Particles_T
 list of their previous cell and added to Particle_Destinations_T
 information.
 
-Assumes grid was initialized with neighbhorhood size of 1 and
-maximum refinement level of 0.
+Substepping, cells of different size and orbit subcycling are
+handled as in solve(), fields of each cell are interpolated from
+its own vertices, also for subcycles outside of the cell.
+bg_B is added to Vert_B at particle's position and can be analytic
+background field or Background_Field_Cache as in solve().
 */
 template<
 	class Cell_Iterator,
@@ -386,7 +754,11 @@ template<
 	const Particle_Mass_Getter& Part_Mas,
 	const Particle_Destination_Cell_Getter& Part_Des,
 	const Cell_Type_Getter& CType,
-	const auto& Vert_B
+	const auto& Vert_B,
+	const int& current_substep,
+	const auto& Substep,
+	const unsigned int& max_orbit_subcycles = 1,
+	const double& gyroperiod_time_step_factor = 1
 ) {
 	using std::abs;
 	using std::isnan;
@@ -394,9 +766,9 @@ template<
 	using std::max;
 	using std::min;
 
-	if (grid.get_maximum_refinement_level() > 0) {
-		throw std::runtime_error("Only maximum refinement level 0 supported.");
-	}
+	constexpr bool bg_B_is_cached = requires {
+		bg_B.get_vertex_fields(uint64_t(0));
+	};
 
 	bool update_copies = false;
 	if (update_copies) {
@@ -413,134 +785,112 @@ template<
 			(grid_end[2]-grid_start[2]) / 2
 		};
 	for (const auto& cell: cells) {
-		Max_v_part.data(*cell.data) =
-		Max_ω_part.data(*cell.data) = 0;
 		if (CType.data(*cell.data) < 0) {
+			Max_v_part.data(*cell.data) =
+			Max_ω_part.data(*cell.data) = 0;
 			Part_Int(*cell.data).clear();
 			Part_Ext.data(*cell.data).clear();
 			Nr_Ext.data(*cell.data) = 0;
 			continue;
 		}
+		if (current_substep % Substep.data(*cell.data) != 0) {
+			Nr_Ext.data(*cell.data) = Part_Ext.data(*cell.data).size();
+			continue;
+		}
+		Max_v_part.data(*cell.data) =
+		Max_ω_part.data(*cell.data) = 0;
+
+		const double cell_dt = dt * Substep.data(*cell.data);
 
 		const auto
 			cell_min = grid.geometry.get_min(cell.id),
 			cell_max = grid.geometry.get_max(cell.id),
-			cell_center = grid.geometry.get_center(cell.id),
 			cell_length = grid.geometry.get_length(cell.id);
 
-		for (size_t part_i = 0; part_i < Part_Int(*cell.data).size(); part_i++) {
-			auto
-				pos = Part_Pos(Part_Int(*cell.data)[part_i]),
-				// emulate 2d,1d,0d sim from B0 perspective
-				bg_pos = pos;
-			const auto lvl0 = grid.mapping.length.get();
+		const auto lvl0 = grid.mapping.length.get();
+
+		// tabulated background field of cell, see background_field_cache.hpp
+		const auto bg_B_vertex_fields = [&](){
+			if constexpr (bg_B_is_cached) {
+				return &bg_B.get_vertex_fields(cell.id);
+			} else {
+				return nullptr;
+			}
+		}();
+
+		// returns E and B at given position
+		const auto get_E_B = [&](const std::array<double, 3>& pos){
+			// emulate 2d,1d,0d sim from B0 perspective
+			auto bg_pos = pos;
 			for (size_t dim = 0; dim < 3; dim++) {
 				if (lvl0[dim] == 1) {
 					bg_pos[dim] = grid_center[dim];
 				}
 			}
-			const std::array<double, 3> B_at_pos = pamhd::math::vertex2r(pos, cell_max, cell_length, Vert_B.data(*cell.data));
-			const double B_at_pos_abs = std::sqrt(
-				B_at_pos[0]*B_at_pos[0]
-				+ B_at_pos[1]*B_at_pos[1]
-				+ B_at_pos[2]*B_at_pos[2]
-			);
+
+			// same weights for E and B
+			const auto weights = pamhd::math::get_vertex_weights(
+				pos, cell_max, cell_length);
+			const std::array<double, 3>
+				E_at_pos = pamhd::math::vertex2r(
+					weights, Vert_E.data(*cell.data)),
+				B_at_pos = pamhd::add(
+					pamhd::math::vertex2r(weights, Vert_B.data(*cell.data)),
+					[&](){
+						if constexpr (bg_B_is_cached) {
+							// subcycled particle can be outside of cell
+							std::array<double, 3> relative_pos;
+							for (size_t dim = 0; dim < 3; dim++) {
+								relative_pos[dim] = min(1.0, max(0.0,
+									(pos[dim] - cell_min[dim]) / cell_length[dim]));
+							}
+							return Background_Magnetic_Field::interpolate(
+								*bg_B_vertex_fields, relative_pos);
+						} else {
+							return bg_B.get_background_field(
+								bg_pos, vacuum_permeability);
+						}
+					}());
+			return std::make_pair(E_at_pos, B_at_pos);
+		};
+
+		for (size_t part_i = 0; part_i < Part_Int(*cell.data).size(); part_i++) {
+			const auto old_pos = get_absolute_position(
+				Part_Pos(Part_Int(*cell.data)[part_i]),
+				cell_min, cell_length);
+			auto pos = old_pos;
+			auto [E_at_pos, B_at_pos] = get_E_B(pos);
 
 			auto vel = Part_Vel(Part_Int(*cell.data)[part_i]);
 			Max_v_part.data(*cell.data) = max(
 				Max_v_part.data(*cell.data),
 				pamhd::norm(vel));
 			const auto& c2m = Part_C2M(Part_Int(*cell.data)[part_i]);
+			const auto angular_velocity = abs(c2m) * pamhd::norm(B_at_pos);
 			Max_ω_part.data(*cell.data) = max(
 				Max_ω_part.data(*cell.data),
-				abs(c2m) * B_at_pos_abs);
-
-			const auto E_at_pos = pamhd::math::vertex2r(
-				pos, cell_max, cell_length, Vert_E.data(*cell.data));
-
-			std::tie(pos, vel) = propagate(
-				pos, vel, E_at_pos, B_at_pos, c2m, dt
-			);
+				angular_velocity / max_orbit_subcycles);
+
+			const auto subcycles = detail::get_orbit_subcycles(
+				angular_velocity, cell_dt,
+				gyroperiod_time_step_factor, max_orbit_subcycles);
+			for (unsigned int subcycle = 0; subcycle < subcycles; subcycle++) {
+				if (subcycle > 0) {
+					std::tie(E_at_pos, B_at_pos) = get_E_B(pos);
+				}
+				std::tie(pos, vel) = propagate(
+					pos, vel, E_at_pos, B_at_pos, c2m, cell_dt / subcycles
+				);
+			}
 			Part_Vel(Part_Int(*cell.data)[part_i]) = vel;
 
-			// take into account periodic grid
-			const auto real_pos
-				= grid.geometry.get_real_coordinate(
-					{pos[0], pos[1], pos[2]});
-
-			Part_Pos(Part_Int(*cell.data)[part_i]) = {
-				real_pos[0], real_pos[1], real_pos[2]
-			};
-
-			// remove from simulation if particle not inside of grid
-			if (
-				isnan(real_pos[0])
-				or isnan(real_pos[1])
-				or isnan(real_pos[2])
-			) {
-
-				Part_Int(*cell.data).erase(Part_Int(*cell.data).begin() + part_i);
+			if (detail::move_particle(
+				cell, grid, cell_min, cell_max, cell_length,
+				old_pos, pos, part_i,
+				Part_Int, Part_Ext, Part_Pos, Part_Des,
+				current_substep, Substep
+			)) {
 				part_i--;
-
-			// move to ext list if particle outside of current cell
-			} else if (
-				real_pos[0] < cell_min[0]
-				or real_pos[0] > cell_max[0]
-				or real_pos[1] < cell_min[1]
-				or real_pos[1] > cell_max[1]
-				or real_pos[2] < cell_min[2]
-				or real_pos[2] > cell_max[2]
-			) {
-				uint64_t destination = dccrg::error_cell;
-
-				for (const auto& neighbor: cell.neighbors_of) {
-					const auto
-						neighbor_min = grid.geometry.get_min(neighbor.id),
-						neighbor_max = grid.geometry.get_max(neighbor.id);
-
-					if (
-						real_pos[0] >= neighbor_min[0]
-						and real_pos[0] <= neighbor_max[0]
-						and real_pos[1] >= neighbor_min[1]
-						and real_pos[1] <= neighbor_max[1]
-						and real_pos[2] >= neighbor_min[2]
-						and real_pos[2] <= neighbor_max[2]
-					) {
-						destination = neighbor.id;
-						break;
-					}
-				}
-
-				if (destination != dccrg::error_cell) {
-
-					const auto index = Part_Ext.data(*cell.data).size();
-
-					Part_Ext.data(*cell.data).resize(index + 1);
-					assign(
-						Part_Ext.data(*cell.data)[index],
-						Part_Int(*cell.data)[part_i]
-					);
-					Part_Des(Part_Ext.data(*cell.data)[index]) = destination;
-
-					Part_Int(*cell.data).erase(Part_Int(*cell.data).begin() + part_i);
-					part_i--;
-
-				} else {
-
-					std::cerr << __FILE__ << "(" << __LINE__ << "): "
-						<< " No destination found for particle at " << real_pos
-						<< " propagated from " << real_pos
-						<< " with dt " << dt
-						<< " in cell " << cell.id
-						<< " of length " << cell_length
-						<< " at " << cell_center
-						<< " from neighbors ";
-					for (const auto& neighbor: cell.neighbors_of) {
-						std::cerr << neighbor.id << " ";
-					}
-					std::cerr << std::endl;
-					abort();
-				}
 			}
 		}
 
@@ -552,6 +902,52 @@ template<
 	Max_ω_part.type().is_stale = true;
 }
 
+//! As solve_hyb() above but solves all given cells without substepping.
+template<
+	class Cell_Iterator,
+	class Grid,
+	class Background_Magnetic_Field,
+	class Vertex_Electric_Field_Getter,
+	class Nr_Particles_External_Getter,
+	class Particles_Internal_Getter,
+	class Particles_External_Getter,
+	class Particle_Max_Spatial_Velocity_Getter,
+	class Particle_Max_Angular_Velocity_Getter,
+	class Particle_Position_Getter,
+	class Particle_Velocity_Getter,
+	class Particle_Charge_Mass_Ratio_Getter,
+	class Particle_Mass_Getter,
+	class Particle_Destination_Cell_Getter,
+	class Cell_Type_Getter
+> void solve_hyb(
+	const double& dt,
+	const Cell_Iterator& cells,
+	Grid& grid,
+	const Background_Magnetic_Field& bg_B,
+	const double& vacuum_permeability,
+	const Vertex_Electric_Field_Getter& Vert_E,
+	const Nr_Particles_External_Getter& Nr_Ext,
+	const Particles_Internal_Getter& Part_Int,
+	const Particles_External_Getter& Part_Ext,
+	const Particle_Max_Spatial_Velocity_Getter& Max_v_part,
+	const Particle_Max_Angular_Velocity_Getter& Max_ω_part,
+	const Particle_Position_Getter& Part_Pos,
+	const Particle_Velocity_Getter& Part_Vel,
+	const Particle_Charge_Mass_Ratio_Getter& Part_C2M,
+	const Particle_Mass_Getter& Part_Mas,
+	const Particle_Destination_Cell_Getter& Part_Des,
+	const Cell_Type_Getter& CType,
+	const auto& Vert_B
+) {
+	solve_hyb(
+		dt, cells, grid, bg_B, vacuum_permeability,
+		Vert_E, Nr_Ext, Part_Int, Part_Ext,
+		Max_v_part, Max_ω_part, Part_Pos, Part_Vel,
+		Part_C2M, Part_Mas, Part_Des, CType, Vert_B,
+		1, detail::No_Substeps()
+	);
+}
+
 
 template<
 	class Nr_Particles_T,
@@ -736,7 +1132,8 @@ double timestep(
 	const auto& Timestep,
 	const auto& max_time_step,
 	const auto& mhd_time_step_factor,
-	const auto& particle_time_step_factor
+	const auto& particle_time_step_factor,
+	const unsigned int& max_orbit_subcycles = 1
 ) try {
 	using std::cerr;
 	using std::cout;
@@ -746,9 +1143,10 @@ double timestep(
 
 	using Cell = std::remove_reference_t<decltype(grid)>::cell_data_type;
 
+	// offset with reduction of timesteps
 	set_minmax_substepping_period(
 		simulation_time, grid, options_mhd,
-		Substep_Min, Substep_Max
+		Substep_Min, Substep_Max, false
 	);
 
 	if (mhd_solver != mhd::Solver::hybrid) {
@@ -779,11 +1177,10 @@ double timestep(
 	);
 
 	const int max_substep = update_substeps(grid, CType, Substep);
-	if (max_substep > 1) {
-		cerr << "Substep > 1 (level > 0) not supported." << endl;
-		MPI_Finalize();
-		exit(EXIT_FAILURE);
-	}
+	// particle solver needs periods of remote neighbors in 2^N format
+	Cell::set_transfer_all(true, Substep.type());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Substep.type());
 	if (grid.get_rank() == 0) {
 		cout << "Substep: " << sub_dt
 			<< ", largest substep period: " << max_substep << endl;
@@ -858,7 +1255,9 @@ double timestep(
 			background_B, vacuum_permeability,
 			true, J_m_V, Vol_B, Nr_Ext, Part_Int, Part_Ext,
 			Max_v_part, Max_ω_part, Part_Pos, Part_Vel,
-			Part_C2M, Part_Mas, Part_Des, CType
+			Part_C2M, Part_Mas, Part_Des, CType,
+			substep, Substep, max_orbit_subcycles,
+			particle_time_step_factor
 		);
 
 		Cell::set_transfer_all(true,
@@ -881,7 +1280,9 @@ double timestep(
 			background_B, vacuum_permeability,
 			true, J_m_V, Vol_B, Nr_Ext, Part_Int, Part_Ext,
 			Max_v_part, Max_ω_part, Part_Pos, Part_Vel,
-			Part_C2M, Part_Mas, Part_Des, CType
+			Part_C2M, Part_Mas, Part_Des, CType,
+			substep, Substep, max_orbit_subcycles,
+			particle_time_step_factor
 		);
 
 		grid.wait_remote_neighbor_copy_update_receives();
@@ -1057,7 +1458,8 @@ double timestep_hyb(
 	const auto& particle_time_step_factor,
 	const auto& Vol_Qi,
 	const auto& Vol_Ji,
-	const auto& Vert_B
+	const auto& Vert_B,
+	const unsigned int& max_orbit_subcycles = 1
 ) try {
 	using std::cerr;
 	using std::cout;
@@ -1067,9 +1469,11 @@ double timestep_hyb(
 
 	using Cell = std::remove_reference_t<decltype(grid)>::cell_data_type;
 
+	Timer substep_timer("particle.substepping");
+	// offset with reduction of timesteps
 	set_minmax_substepping_period(
 		simulation_time, grid, options,
-		Substep_Min, Substep_Max
+		Substep_Min, Substep_Max, false
 	);
 
 	for (const auto& cell: grid.local_cells()) {
@@ -1094,11 +1498,11 @@ double timestep_hyb(
 	);
 
 	const int max_substep = update_substeps(grid, CType, Substep);
-	if (max_substep > 1) {
-		cerr << "Substep > 1 (level > 0) not supported." << endl;
-		MPI_Finalize();
-		exit(EXIT_FAILURE);
-	}
+	// particle solver needs periods of remote neighbors in 2^N format
+	Cell::set_transfer_all(true, Substep.type());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Substep.type());
+	substep_timer.stop();
 	if (grid.get_rank() == 0) {
 		cout << "Substep: " << sub_dt
 			<< ", largest substep period: " << max_substep << endl;
@@ -1108,10 +1512,13 @@ double timestep_hyb(
 	for (int substep = 1; substep <= max_substep; substep += 1) {
 		total_dt += sub_dt;
 
+		Timer current_timer("particle.current");
 		pamhd::math::get_curl_face2edge(grid, Face_B, Edge_J, CType);
 		pamhd::math::edge2vertex(grid, Edge_J, Vert_J, CType);
 		pamhd::math::vertex2volume(grid, Vert_J, Vol_J, CType);
+		current_timer.stop();
 
+		Timer accumulate_timer("particle.accumulate");
 		pamhd::particle::accumulate_hyb(
 			grid.local_cells(),
 			grid,
@@ -1125,40 +1532,54 @@ double timestep_hyb(
 			Vol_Ji,
 			CType
 		);
+		accumulate_timer.stop();
 
 		// outer particles
+		Timer outer_timer("particle.push");
 		pamhd::particle::solve_hyb(
 			sub_dt, grid.outer_cells(), grid,
 			background_B, vacuum_permeability,
 			Vert_E, Nr_Ext, Part_Int, Part_Ext,
 			Max_v_part, Max_ω_part, Part_Pos, Part_Vel,
-			Part_C2M, Part_Mas, Part_Des, CType, Vert_B
+			Part_C2M, Part_Mas, Part_Des, CType, Vert_B,
+			substep, Substep, max_orbit_subcycles,
+			particle_time_step_factor
 		);
+		outer_timer.stop();
 
 		Cell::set_transfer_all(true,
 			Bg_B.type(), Substep.type(), CType.type(), Nr_Ext.type());
 		grid.start_remote_neighbor_copy_updates();
 
 		// inner particles
+		Timer inner_timer("particle.push");
 		pamhd::particle::solve_hyb(
 			sub_dt, grid.inner_cells(), grid,
 			background_B, vacuum_permeability,
 			Vert_E, Nr_Ext, Part_Int, Part_Ext,
 			Max_v_part, Max_ω_part, Part_Pos, Part_Vel,
-			Part_C2M, Part_Mas, Part_Des, CType, Vert_B
+			Part_C2M, Part_Mas, Part_Des, CType, Vert_B,
+			substep, Substep, max_orbit_subcycles,
+			particle_time_step_factor
 		);
+		inner_timer.stop();
 
+		Timer wait_timer("particle.halo_wait");
 		grid.wait_remote_neighbor_copy_update_receives();
+		wait_timer.stop();
 
 		pamhd::particle::resize_receiving_containers<
 			pamhd::particle::Nr_Particles_External,
 			pamhd::particle::Particles_External
 		>(grid.remote_cells(), grid);
 
+		Timer send_timer("particle.halo_wait");
 		grid.wait_remote_neighbor_copy_update_sends();
+		send_timer.stop();
 		Cell::set_transfer_all(false,
 			Bg_B.type(), Substep.type(), CType.type(), Nr_Ext.type());
 
+		Timer incorporate_timer("particle.incorporate");
 		Cell::set_transfer_all(true, pamhd::particle::Particles_External());
 		grid.start_remote_neighbor_copy_updates();
 
@@ -1190,9 +1611,11 @@ double timestep_hyb(
 			pamhd::particle::Nr_Particles_External,
 			pamhd::particle::Particles_External
 		>(grid.outer_cells(), grid);
+		incorporate_timer.stop();
 	}
 
 	// update internal particles
+	Timer internal_timer("particle.update_internal");
 	for (const auto& cell: grid.local_cells()) {
 		// (ab)use external number counter as internal number counter
 		(*cell.data)[pamhd::particle::Nr_Particles_External()]
@@ -39,6 +39,7 @@ Author(s): Ilja Honkonen
 
 
 #include "algorithm"
+#include "array"
 #include "random"
 #include "utility"
 
@@ -46,6 +47,8 @@ Author(s): Ilja Honkonen
 #include "prettyprint.hpp"
 
 #include "common.hpp"
+#include "random.hpp"
+#include "relative_position.hpp"
 
 
 namespace pamhd {
@@ -61,17 +64,22 @@ Given particle is modified in-place:
   -particle mass is halved
 Returned copy is on opposite side of original position
 with respect to given particle's new position.
+
+Positions relative to particle's cell, see relative_position.hpp,
+are split within unit cube of cell and given cell_min and
+cell_max aren't used.
 */
 template<
 	class Particle,
 	class Vector,
+	class Random_Source,
 	class Particle_Position_Getter,
 	class Particle_Mass_Getter
 > Particle split(
 	Particle& particle,
 	const Vector& cell_min,
 	const Vector& cell_max,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	const Particle_Position_Getter Part_Pos,
 	const Particle_Mass_Getter Part_Mas
 ) {
@@ -80,32 +88,35 @@ template<
 
 	const auto old_pos = Part_Pos(particle);
 
+	std::array<double, 3>
+		pos_min{0, 0, 0},
+		pos_max{1, 1, 1};
+	if constexpr (not is_cell_relative<decltype(old_pos)>()) {
+		pos_min = {cell_min[0], cell_min[1], cell_min[2]};
+		pos_max = {cell_max[0], cell_max[1], cell_max[2]};
+	}
+
 	// particle must be created within this distance in every
 	// coord to stay within cell while preserving center of mass
 	const auto max_distance =
-		min(min(cell_max[0] - old_pos[0], old_pos[0] - cell_min[0]), // x
-		min(min(cell_max[1] - old_pos[1], old_pos[1] - cell_min[1]), // y
-		    min(cell_max[2] - old_pos[2], old_pos[2] - cell_min[2]))); // z
+		min(min(pos_max[0] - old_pos[0], old_pos[0] - pos_min[0]), // x
+		min(min(pos_max[1] - old_pos[1], old_pos[1] - pos_min[1]), // y
+		    min(pos_max[2] - old_pos[2], old_pos[2] - pos_min[2]))); // z
 
 	std::uniform_real_distribution<double> offset_gen(-max_distance, max_distance);
-	const auto
-		offset_x = offset_gen(random_source),
-		offset_y = offset_gen(random_source),
-		offset_z = offset_gen(random_source);
+	const std::array<double, 3> offset{
+		offset_gen(random_source),
+		offset_gen(random_source),
+		offset_gen(random_source)
+	};
 
 	Part_Mas(particle) /= 2;
 	auto new_particle = particle;
 
-	Part_Pos(particle) = {
-		old_pos[0] + offset_x,
-		old_pos[1] + offset_y,
-		old_pos[2] + offset_z
-	};
-	Part_Pos(new_particle) = {
-		old_pos[0] - offset_x,
-		old_pos[1] - offset_y,
-		old_pos[2] - offset_z
-	};
+	for (size_t dim = 0; dim < 3; dim++) {
+		Part_Pos(particle)[dim] = old_pos[dim] + offset[dim];
+		Part_Pos(new_particle)[dim] = old_pos[dim] - offset[dim];
+	}
 
 	return new_particle;
 }
@@ -116,6 +127,7 @@ template<
 	class Particle,
 	class Cell_Data,
 	class Vector,
+	class Random_Source,
 	class Particle_Position_Getter,
 	class Particle_Mass_Getter
 > uint64_t split(
@@ -125,7 +137,7 @@ template<
 	const Cell_Data* cell_data,
 	const Vector& cell_min,
 	const Vector& cell_max,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
 	const Particle_Position_Getter Part_Pos,
 	const Particle_Mass_Getter Part_Mas
 ) {
@@ -170,9 +182,14 @@ Splits random particles in normal cells until given minimum exist.
 
 Every split preserves center of mass, other parameters also unchanged.
 
+Counter based random_source, see random.hpp, is set to sequence of
+each cell at given simulation step so results don't depend on order
+of cells or their distribution between processes.
+
 Returns number of splits preformed on this process.
 */
 template<
+	class Random_Source,
 	class Grid,
 	class Particles_Getter,
 	class Particle_Position_Getter,
@@ -180,7 +197,8 @@ template<
 	class Solver_Info_Getter
 > uint64_t split_particles(
 	const size_t min_particles,
-	std::mt19937_64& random_source,
+	Random_Source& random_source,
+	const uint64_t simulation_step,
 	Grid& grid,
 	const Particles_Getter& Particles,
 	const Particle_Position_Getter& Part_Pos,
@@ -199,6 +217,9 @@ template<
 			cell_min = grid.geometry.get_min(cell.id),
 			cell_max = grid.geometry.get_max(cell.id);
 
+		set_random_stream(
+			random_source, cell.id, simulation_step, random_stream::split);
+
 		try {
 			splits += split(
 				Particles(*cell.data),
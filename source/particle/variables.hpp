@@ -48,6 +48,7 @@ Author(s): Ilja Honkonen
 
 #include "mhd/variables.hpp"
 #include "particle/accumulation_variables.hpp"
+#include "particle/relative_position.hpp"
 
 
 namespace pamhd {
@@ -114,6 +115,37 @@ template<
 >;
 
 
+/*!
+Particle position relative to particle's cell.
+
+Alternative to Position, see particle/relative_position.hpp.
+*/
+template<class Real> struct Relative_Position_T {
+	using data_type = Cell_Relative_Position<Real>;
+	static const std::string get_name() { return {"relative position"}; }
+	static const std::string get_option_name() { return {"relative-position"}; }
+	static const std::string get_option_help() { return {"Particle position relative to its cell"}; }
+};
+
+/*!
+As Particle_T but position is stored relative to particle's cell.
+
+Use float as Real to halve memory used by positions.
+*/
+template<
+	class Real,
+	class... Extra_Variables
+> using Particle_Relative_T = gensimcell::Cell<
+	gensimcell::Always_Transfer,
+	Relative_Position_T<Real>,
+	Velocity,
+	Mass,
+	Species_Mass,
+	Charge_Mass_Ratio,
+	Extra_Variables...
+>;
+
+
 //! Unique id of each particle
 struct Particle_ID {
 	using data_type = unsigned long long int;
@@ -307,12 +339,6 @@ using Cell_test_particle = gensimcell::Cell<
 	pamhd::particle::Max_Angular_Velocity,
 	pamhd::particle::Electric_Field,
 	pamhd::particle::Number_Of_Particles,
-	pamhd::particle::Bdy_Number_Density,
-	pamhd::particle::Bdy_Velocity,
-	pamhd::particle::Bdy_Temperature,
-	pamhd::particle::Bdy_Species_Mass,
-	pamhd::particle::Bdy_Charge_Mass_Ratio,
-	pamhd::particle::Bdy_Nr_Particles_In_Cell,
 	pamhd::particle::Nr_Particles_Internal,
 	pamhd::particle::Nr_Particles_External,
 	pamhd::particle::Particles_Internal,
@@ -338,12 +364,6 @@ using Cell_hyb_particle = gensimcell::Cell<
 	pamhd::Magnetic_Field_Divergence,
 	pamhd::particle::Electric_Field,
 	pamhd::particle::Number_Of_Particles,
-	pamhd::particle::Bdy_Number_Density,
-	pamhd::particle::Bdy_Velocity,
-	pamhd::particle::Bdy_Temperature,
-	pamhd::particle::Bdy_Species_Mass,
-	pamhd::particle::Bdy_Charge_Mass_Ratio,
-	pamhd::particle::Bdy_Nr_Particles_In_Cell,
 	pamhd::particle::Bulk_Mass,
 	pamhd::particle::Bulk_Momentum,
 	pamhd::particle::Bulk_Velocity,
@@ -385,12 +405,6 @@ using Cell_hyb_particle_staggered = gensimcell::Cell<
 	pamhd::particle::Number_Of_Particles,
 	pamhd::particle::Max_Spatial_Velocity,
 	pamhd::particle::Max_Angular_Velocity,
-	pamhd::particle::Bdy_Number_Density,
-	pamhd::particle::Bdy_Velocity,
-	pamhd::particle::Bdy_Temperature,
-	pamhd::particle::Bdy_Species_Mass,
-	pamhd::particle::Bdy_Charge_Mass_Ratio,
-	pamhd::particle::Bdy_Nr_Particles_In_Cell,
 	pamhd::particle::Bulk_Mass,
 	pamhd::particle::Bulk_Momentum,
 	pamhd::particle::Bulk_Velocity,
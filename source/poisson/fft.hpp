@@ -0,0 +1,280 @@
+/*
+Fast Fourier transform of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_POISSON_FFT_HPP
+#define PAMHD_POISSON_FFT_HPP
+
+
+#include "algorithm"
+#include "cmath"
+#include "complex"
+#include "cstdint"
+#include "memory"
+#include "stdexcept"
+#include "string"
+#include "utility"
+#include "vector"
+
+
+namespace pamhd {
+namespace poisson {
+
+
+/*!
+Discrete Fourier transform of complex data of any length.
+
+Lengths whose prime factors are all <= max_radix are
+transformed with mixed radix Cooley-Tukey algorithm,
+other lengths with Bluestein's algorithm using a power
+of 2 transform.
+
+Forward transform is X_j = sum_k x_k exp(-2 pi i j k / n),
+inverse transform uses exp(+2 pi i j k / n) and isn't
+divided by n.
+
+Example:
+
+pamhd::poisson::FFT fft(12);
+std::vector<std::complex<double>> data(12, 1);
+fft.transform(data.data(), false);
+// data[0] == 12, others 0
+*/
+class FFT
+{
+public:
+
+	static constexpr size_t max_radix = 31;
+
+	FFT() = default;
+	FFT(const FFT& other) = delete;
+	FFT(FFT&& other) = default;
+	FFT& operator=(const FFT& other) = delete;
+	FFT& operator=(FFT&& other) = default;
+
+	FFT(const size_t given_size)
+	{
+		this->set(given_size);
+	}
+
+
+	void set(const size_t given_size)
+	{
+		this->size = given_size;
+		this->factors.clear();
+		this->twiddles.clear();
+		this->chirp.clear();
+		this->chirp_fft.clear();
+		this->convolution.reset();
+		if (this->size == 0) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Length of transform must be > 0"
+			);
+		}
+
+		// factors as (radix, length of remaining transform) pairs
+		size_t remaining = this->size, radix = 2;
+		bool small_factors = true;
+		while (remaining > 1) {
+			while (remaining % radix != 0) {
+				radix = (radix == 2) ? 3 : radix + 2;
+				if (radix * radix > remaining) {
+					radix = remaining;
+				}
+			}
+			if (radix > max_radix) {
+				small_factors = false;
+				break;
+			}
+			remaining /= radix;
+			this->factors.push_back(radix);
+			this->factors.push_back(remaining);
+		}
+
+		if (small_factors) {
+			this->twiddles.resize(this->size);
+			for (size_t i = 0; i < this->size; i++) {
+				const double angle = -2 * M_PI * double(i) / double(this->size);
+				this->twiddles[i] = {std::cos(angle), std::sin(angle)};
+			}
+			this->work.resize(this->size);
+			this->scratch.resize(this->factors.size() == 0 ? 0 : max_radix);
+			return;
+		}
+
+		// Bluestein, X_j = w_j sum_k x_k w_k conj(w_(j-k))
+		this->factors.clear();
+		size_t convolution_size = 1;
+		while (convolution_size < 2 * this->size - 1) {
+			convolution_size *= 2;
+		}
+		this->convolution = std::make_unique<FFT>(convolution_size);
+
+		this->chirp.resize(this->size);
+		for (size_t i = 0; i < this->size; i++) {
+			// i^2 mod 2 * size keeps angle accurate
+			const uint64_t square = (uint64_t(i) * i) % (2 * uint64_t(this->size));
+			const double angle = -M_PI * double(square) / double(this->size);
+			this->chirp[i] = {std::cos(angle), std::sin(angle)};
+		}
+
+		this->chirp_fft.assign(convolution_size, 0);
+		this->chirp_fft[0] = std::conj(this->chirp[0]);
+		for (size_t i = 1; i < this->size; i++) {
+			this->chirp_fft[i]
+				= this->chirp_fft[convolution_size - i]
+				= std::conj(this->chirp[i]);
+		}
+		this->convolution->transform(this->chirp_fft.data(), false);
+		this->work.resize(convolution_size);
+	}
+
+
+	size_t get_size() const
+	{
+		return this->size;
+	}
+
+
+	//! Transforms get_size() values starting at data in place
+	void transform(std::complex<double>* const data, const bool inverse) const
+	{
+		if (this->size <= 1) {
+			return;
+		}
+
+		// inverse(x) == conj(forward(conj(x)))
+		if (inverse) {
+			for (size_t i = 0; i < this->size; i++) {
+				data[i] = std::conj(data[i]);
+			}
+		}
+
+		if (this->convolution) {
+			this->bluestein(data);
+		} else {
+			std::copy(data, data + this->size, this->work.begin());
+			this->mixed_radix(data, this->work.data(), 1, this->factors.data());
+		}
+
+		if (inverse) {
+			for (size_t i = 0; i < this->size; i++) {
+				data[i] = std::conj(data[i]);
+			}
+		}
+	}
+
+
+private:
+
+	size_t size = 0;
+	std::vector<size_t> factors;
+	std::vector<std::complex<double>> twiddles, chirp, chirp_fft;
+	std::unique_ptr<FFT> convolution;
+	mutable std::vector<std::complex<double>> work, scratch;
+
+
+	/*!
+	Decimation in time with output to out from input
+	read with given stride.
+	*/
+	void mixed_radix(
+		std::complex<double>* const out,
+		const std::complex<double>* in,
+		const size_t stride,
+		const size_t* const factor
+	) const {
+		const size_t radix = factor[0], length = factor[1];
+
+		if (length == 1) {
+			for (size_t i = 0; i < radix; i++) {
+				out[i] = *in;
+				in += stride;
+			}
+		} else {
+			for (size_t i = 0; i < radix; i++) {
+				this->mixed_radix(out + i * length, in, stride * radix, factor + 2);
+				in += stride;
+			}
+		}
+
+		if (radix == 2) {
+			for (size_t i = 0; i < length; i++) {
+				const auto temp = out[i + length] * this->twiddles[i * stride];
+				out[i + length] = out[i] - temp;
+				out[i] += temp;
+			}
+			return;
+		}
+
+		for (size_t i = 0; i < length; i++) {
+			for (size_t j = 0; j < radix; j++) {
+				this->scratch[j] = out[i + j * length];
+			}
+			for (size_t j = 0; j < radix; j++) {
+				const size_t k = i + j * length;
+				auto& result = out[k];
+				result = this->scratch[0];
+				size_t twiddle_i = 0;
+				for (size_t l = 1; l < radix; l++) {
+					twiddle_i += stride * k;
+					twiddle_i %= this->size;
+					result += this->scratch[l] * this->twiddles[twiddle_i];
+				}
+			}
+		}
+	}
+
+
+	void bluestein(std::complex<double>* const data) const
+	{
+		std::fill(this->work.begin(), this->work.end(), 0);
+		for (size_t i = 0; i < this->size; i++) {
+			this->work[i] = data[i] * this->chirp[i];
+		}
+		this->convolution->transform(this->work.data(), false);
+		for (size_t i = 0; i < this->work.size(); i++) {
+			this->work[i] *= this->chirp_fft[i];
+		}
+		this->convolution->transform(this->work.data(), true);
+
+		const double norm = 1.0 / double(this->work.size());
+		for (size_t i = 0; i < this->size; i++) {
+			data[i] = this->work[i] * this->chirp[i] * norm;
+		}
+	}
+};
+
+}} // namespaces
+
+
+#endif // ifndef PAMHD_POISSON_FFT_HPP
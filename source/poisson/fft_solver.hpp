@@ -0,0 +1,496 @@
+/*
+Distributed FFT Poisson solver of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_POISSON_FFT_SOLVER_HPP
+#define PAMHD_POISSON_FFT_SOLVER_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "cmath"
+#include "complex"
+#include "cstdint"
+#include "limits"
+#include "stdexcept"
+#include "string"
+#include "utility"
+#include "vector"
+
+#include "mpi.h"
+
+#include "poisson/fft.hpp"
+
+
+namespace pamhd {
+namespace poisson {
+
+
+/*!
+Direct solver of div(grad(phi)) = rhs on uniform periodic grid.
+
+Data is transformed one dimension at a time in pencils, i.e.
+whole lines of cells parallel to transformed dimension are
+on one process, and moved between processes with all-to-all
+transposes. Lines of each dimension are divided between
+processes in contiguous blocks.
+
+If central is true div and grad are discretized with central
+differences as in pamhd::divergence::get_divergence() and
+get_gradient(), otherwise with standard second order Laplacian.
+Components of rhs in null space of operator (constant, and
+checkerboard for central) are ignored.
+
+Example:
+
+pamhd::poisson::FFT_Solver solver;
+solver.set(grid, grid.local_cells(), true);
+std::vector<double> rhs(solver.get_nr_cells()), solution;
+...
+solver.solve(rhs, solution);
+*/
+class FFT_Solver
+{
+public:
+
+	FFT_Solver() = default;
+	FFT_Solver(const FFT_Solver& other) = delete;
+	FFT_Solver& operator=(const FFT_Solver& other) = delete;
+
+	~FFT_Solver()
+	{
+		this->free_comm();
+	}
+
+
+	/*!
+	Prepares solver for given local cells of uniform grid.
+
+	Indices of cells must be given in same order as rhs and
+	solution in solve(). Each cell of grid must be given by
+	exactly one process. Must be called by all processes.
+	*/
+	void set(
+		MPI_Comm given_comm,
+		const std::array<uint64_t, 3>& given_grid_size,
+		const std::array<double, 3>& cell_length,
+		const std::vector<std::array<uint64_t, 3>>& indices,
+		const bool central
+	) {
+		this->free_comm();
+		MPI_Comm_dup(given_comm, &this->comm);
+		MPI_Comm_rank(this->comm, &this->rank);
+		MPI_Comm_size(this->comm, &this->comm_size);
+
+		this->grid_size = given_grid_size;
+		const uint64_t total_cells = this->grid_size[0] * this->grid_size[1] * this->grid_size[2];
+
+		uint64_t nr_local = indices.size(), nr_global = 0;
+		MPI_Allreduce(&nr_local, &nr_global, 1, MPI_UINT64_T, MPI_SUM, this->comm);
+		if (nr_global != total_cells) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Number of cells on all processes " + std::to_string(nr_global)
+				+ " differs from grid size " + std::to_string(total_cells)
+			);
+		}
+
+		for (size_t dim = 0; dim < 3; dim++) {
+			this->ffts[dim].set(this->grid_size[dim]);
+		}
+
+		// cells in pencils of each dimension
+		for (size_t dim = 0; dim < 3; dim++) {
+			const auto [first, end] = this->get_lines(dim, this->rank);
+			auto& cells = this->pencil_cells[dim];
+			cells.clear();
+			cells.reserve((end - first) * this->grid_size[dim]);
+			for (uint64_t line = first; line < end; line++) {
+				for (uint64_t i = 0; i < this->grid_size[dim]; i++) {
+					cells.push_back(this->get_cell(dim, line, i));
+				}
+			}
+			this->pencils[dim].resize(cells.size());
+		}
+
+		std::vector<uint64_t> given_cells;
+		given_cells.reserve(indices.size());
+		for (const auto& index: indices) {
+			for (size_t dim = 0; dim < 3; dim++) {
+				if (index[dim] >= this->grid_size[dim]) {
+					throw std::invalid_argument(
+						std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+						+ "Index " + std::to_string(index[dim])
+						+ " outside of grid in dimension " + std::to_string(dim)
+					);
+				}
+			}
+			given_cells.push_back(
+				index[0]
+				+ index[1] * this->grid_size[0]
+				+ index[2] * this->grid_size[0] * this->grid_size[1]
+			);
+		}
+		this->given.resize(given_cells.size());
+
+		this->transposes[0] = this->get_transpose(given_cells, 0);
+		this->transposes[1] = this->get_transpose(this->pencil_cells[0], 1);
+		this->transposes[2] = this->get_transpose(this->pencil_cells[1], 2);
+
+		// inverse of eigenvalues of operator in pencils of last dimension
+		const auto& cells = this->pencil_cells[2];
+		this->inverse_eigenvalues.resize(cells.size());
+		std::vector<double> eigenvalues(cells.size(), 0);
+		double max_eigenvalue = 0;
+		for (size_t i = 0; i < cells.size(); i++) {
+			const std::array<uint64_t, 3> index{
+				cells[i] % this->grid_size[0],
+				cells[i] / this->grid_size[0] % this->grid_size[1],
+				cells[i] / this->grid_size[0] / this->grid_size[1]
+			};
+			for (size_t dim = 0; dim < 3; dim++) {
+				const double angle = 2 * M_PI * double(index[dim]) / double(this->grid_size[dim]);
+				if (central) {
+					eigenvalues[i] -= std::pow(std::sin(angle) / cell_length[dim], 2);
+				} else {
+					eigenvalues[i] += (2 * std::cos(angle) - 2) / std::pow(cell_length[dim], 2);
+				}
+			}
+			max_eigenvalue = std::max(max_eigenvalue, std::fabs(eigenvalues[i]));
+		}
+		MPI_Allreduce(MPI_IN_PLACE, &max_eigenvalue, 1, MPI_DOUBLE, MPI_MAX, this->comm);
+		for (size_t i = 0; i < cells.size(); i++) {
+			if (std::fabs(eigenvalues[i]) <= 1e-12 * max_eigenvalue) {
+				this->inverse_eigenvalues[i] = 0;
+			} else {
+				this->inverse_eigenvalues[i] = 1 / eigenvalues[i];
+			}
+		}
+	}
+
+
+	/*!
+	Prepares solver for given cells of dccrg grid.
+
+	Grid must not have refinement. Rhs and solution in solve()
+	are in same order as given cells.
+	*/
+	template<class Grid, class Cells> void set(
+		Grid& grid,
+		const Cells& cells,
+		const bool central
+	) {
+		std::vector<std::array<uint64_t, 3>> indices;
+		std::array<double, 3> cell_length{0, 0, 0};
+		for (const auto& cell: cells) {
+			indices.push_back(grid.mapping.get_indices(cell.id));
+			cell_length = grid.geometry.get_length(cell.id);
+		}
+
+		MPI_Comm grid_comm = grid.get_communicator();
+		MPI_Allreduce(MPI_IN_PLACE, cell_length.data(), 3, MPI_DOUBLE, MPI_MAX, grid_comm);
+		this->set(grid_comm, grid.mapping.length.get(), cell_length, indices, central);
+		MPI_Comm_free(&grid_comm);
+	}
+
+
+	//! Returns number of local cells given to set()
+	size_t get_nr_cells() const
+	{
+		return this->given.size();
+	}
+
+
+	/*!
+	Solves phi from div(grad(phi)) = rhs.
+
+	Average of solution is 0. Must be called by all processes.
+	*/
+	void solve(const std::vector<double>& rhs, std::vector<double>& solution)
+	{
+		if (rhs.size() != this->given.size()) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Wrong number of values in rhs: " + std::to_string(rhs.size())
+				+ ", should be " + std::to_string(this->given.size())
+			);
+		}
+
+		std::copy(rhs.cbegin(), rhs.cend(), this->given.begin());
+
+		this->transpose(this->transposes[0], this->given, this->pencils[0], false);
+		this->transform(0, false);
+		this->transpose(this->transposes[1], this->pencils[0], this->pencils[1], false);
+		this->transform(1, false);
+		this->transpose(this->transposes[2], this->pencils[1], this->pencils[2], false);
+		this->transform(2, false);
+
+		for (size_t i = 0; i < this->pencils[2].size(); i++) {
+			this->pencils[2][i] *= this->inverse_eigenvalues[i];
+		}
+
+		this->transform(2, true);
+		this->transpose(this->transposes[2], this->pencils[2], this->pencils[1], true);
+		this->transform(1, true);
+		this->transpose(this->transposes[1], this->pencils[1], this->pencils[0], true);
+		this->transform(0, true);
+		this->transpose(this->transposes[0], this->pencils[0], this->given, true);
+
+		const double norm = 1.0 / double(
+			this->grid_size[0] * this->grid_size[1] * this->grid_size[2]
+		);
+		solution.resize(this->given.size());
+		for (size_t i = 0; i < this->given.size(); i++) {
+			solution[i] = this->given[i].real() * norm;
+		}
+	}
+
+
+private:
+
+	//! Moves data between two distributions of cells
+	struct Transpose {
+		std::vector<int> send_counts, send_displacements, receive_counts, receive_displacements;
+		// local cells in order of sending, and receiving
+		std::vector<size_t> send_cells, receive_cells;
+	};
+
+	MPI_Comm comm = MPI_COMM_NULL;
+	int rank = 0, comm_size = 1;
+	std::array<uint64_t, 3> grid_size{0, 0, 0};
+	std::array<FFT, 3> ffts;
+	// cells of pencils of each dimension, line by line
+	std::array<std::vector<uint64_t>, 3> pencil_cells;
+	std::array<std::vector<std::complex<double>>, 3> pencils;
+	std::vector<std::complex<double>> given, send_buffer, receive_buffer;
+	// from given cells to x pencils, x to y, y to z
+	std::array<Transpose, 3> transposes;
+	std::vector<double> inverse_eigenvalues;
+
+
+	void free_comm()
+	{
+		if (this->comm == MPI_COMM_NULL) {
+			return;
+		}
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (not finalized) {
+			MPI_Comm_free(&this->comm);
+		}
+		this->comm = MPI_COMM_NULL;
+	}
+
+
+	//! Returns number of lines parallel to dimension
+	uint64_t get_nr_lines(const size_t dim) const
+	{
+		return this->grid_size[(dim + 1) % 3] * this->grid_size[(dim + 2) % 3];
+	}
+
+	//! Returns first and one past last line of process in dimension
+	std::pair<uint64_t, uint64_t> get_lines(const size_t dim, const int process) const
+	{
+		const uint64_t lines = this->get_nr_lines(dim);
+		return {
+			lines * process / this->comm_size,
+			lines * (process + 1) / this->comm_size
+		};
+	}
+
+	int get_process(const size_t dim, const uint64_t cell) const
+	{
+		const uint64_t lines = this->get_nr_lines(dim);
+		return int(((this->get_line(dim, cell) + 1) * this->comm_size - 1) / lines);
+	}
+
+	uint64_t get_line(const size_t dim, const uint64_t cell) const
+	{
+		const std::array<uint64_t, 3> index{
+			cell % this->grid_size[0],
+			cell / this->grid_size[0] % this->grid_size[1],
+			cell / this->grid_size[0] / this->grid_size[1]
+		};
+		const auto dim1 = (dim + 1) % 3, dim2 = (dim + 2) % 3;
+		return index[dim1] + index[dim2] * this->grid_size[dim1];
+	}
+
+	//! Returns cell at index i of line parallel to dimension
+	uint64_t get_cell(const size_t dim, const uint64_t line, const uint64_t i) const
+	{
+		const auto dim1 = (dim + 1) % 3, dim2 = (dim + 2) % 3;
+		std::array<uint64_t, 3> index{0, 0, 0};
+		index[dim] = i;
+		index[dim1] = line % this->grid_size[dim1];
+		index[dim2] = line / this->grid_size[dim1];
+		return
+			index[0]
+			+ index[1] * this->grid_size[0]
+			+ index[2] * this->grid_size[0] * this->grid_size[1];
+	}
+
+	//! Returns index of cell in local pencils of dimension
+	size_t get_pencil_index(const size_t dim, const uint64_t cell) const
+	{
+		const auto first = this->get_lines(dim, this->rank).first;
+		const auto line = this->get_line(dim, cell);
+		const std::array<uint64_t, 3> index{
+			cell % this->grid_size[0],
+			cell / this->grid_size[0] % this->grid_size[1],
+			cell / this->grid_size[0] / this->grid_size[1]
+		};
+		return (line - first) * this->grid_size[dim] + index[dim];
+	}
+
+
+	/*!
+	Returns transpose from given cells to pencils of dimension.
+
+	Sends cells to receivers once so both sides know the order.
+	*/
+	Transpose get_transpose(const std::vector<uint64_t>& cells, const size_t dim)
+	{
+		Transpose result;
+		result.send_counts.assign(this->comm_size, 0);
+		result.send_displacements.assign(this->comm_size, 0);
+		result.receive_counts.assign(this->comm_size, 0);
+		result.receive_displacements.assign(this->comm_size, 0);
+
+		std::vector<int> processes(cells.size());
+		for (size_t i = 0; i < cells.size(); i++) {
+			processes[i] = this->get_process(dim, cells[i]);
+			result.send_counts[processes[i]]++;
+		}
+		for (int i = 1; i < this->comm_size; i++) {
+			result.send_displacements[i]
+				= result.send_displacements[i - 1] + result.send_counts[i - 1];
+		}
+
+		result.send_cells.resize(cells.size());
+		std::vector<uint64_t> send_ids(cells.size());
+		auto offsets = result.send_displacements;
+		for (size_t i = 0; i < cells.size(); i++) {
+			const auto offset = offsets[processes[i]]++;
+			result.send_cells[offset] = i;
+			send_ids[offset] = cells[i];
+		}
+
+		MPI_Alltoall(
+			result.send_counts.data(), 1, MPI_INT,
+			result.receive_counts.data(), 1, MPI_INT,
+			this->comm
+		);
+		for (int i = 1; i < this->comm_size; i++) {
+			result.receive_displacements[i]
+				= result.receive_displacements[i - 1] + result.receive_counts[i - 1];
+		}
+		const size_t nr_receive
+			= result.receive_displacements.back() + result.receive_counts.back();
+
+		std::vector<uint64_t> receive_ids(nr_receive);
+		MPI_Alltoallv(
+			send_ids.data(), result.send_counts.data(),
+			result.send_displacements.data(), MPI_UINT64_T,
+			receive_ids.data(), result.receive_counts.data(),
+			result.receive_displacements.data(), MPI_UINT64_T,
+			this->comm
+		);
+
+		if (nr_receive != this->pencil_cells[dim].size()) {
+			throw std::runtime_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Received " + std::to_string(nr_receive)
+				+ " cells instead of " + std::to_string(this->pencil_cells[dim].size())
+				+ ", some cells were given by more than one process"
+			);
+		}
+		result.receive_cells.resize(nr_receive);
+		for (size_t i = 0; i < nr_receive; i++) {
+			result.receive_cells[i] = this->get_pencil_index(dim, receive_ids[i]);
+		}
+
+		return result;
+	}
+
+
+	/*!
+	Copies data from source to target cells of transpose.
+
+	If reverse is true copies from target to source.
+	*/
+	void transpose(
+		const Transpose& plan,
+		const std::vector<std::complex<double>>& source,
+		std::vector<std::complex<double>>& target,
+		const bool reverse
+	) {
+		const auto& send_cells = reverse ? plan.receive_cells : plan.send_cells;
+		const auto& receive_cells = reverse ? plan.send_cells : plan.receive_cells;
+
+		this->send_buffer.resize(send_cells.size());
+		for (size_t i = 0; i < send_cells.size(); i++) {
+			this->send_buffer[i] = source[send_cells[i]];
+		}
+		this->receive_buffer.resize(receive_cells.size());
+
+		MPI_Alltoallv(
+			this->send_buffer.data(),
+			(reverse ? plan.receive_counts : plan.send_counts).data(),
+			(reverse ? plan.receive_displacements : plan.send_displacements).data(),
+			MPI_CXX_DOUBLE_COMPLEX,
+			this->receive_buffer.data(),
+			(reverse ? plan.send_counts : plan.receive_counts).data(),
+			(reverse ? plan.send_displacements : plan.receive_displacements).data(),
+			MPI_CXX_DOUBLE_COMPLEX,
+			this->comm
+		);
+
+		for (size_t i = 0; i < receive_cells.size(); i++) {
+			target[receive_cells[i]] = this->receive_buffer[i];
+		}
+	}
+
+
+	//! Transforms local pencils of dimension
+	void transform(const size_t dim, const bool inverse)
+	{
+		auto& data = this->pencils[dim];
+		const auto length = this->grid_size[dim];
+		for (size_t start = 0; start < data.size(); start += length) {
+			this->ffts[dim].transform(data.data() + start, inverse);
+		}
+	}
+};
+
+}} // namespaces
+
+
+#endif // ifndef PAMHD_POISSON_FFT_SOLVER_HPP
@@ -0,0 +1,1318 @@
+/*
+Geometric multigrid Poisson solver of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_POISSON_MULTIGRID_HPP
+#define PAMHD_POISSON_MULTIGRID_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "cmath"
+#include "cstdint"
+#include "limits"
+#include "stdexcept"
+#include "string"
+#include "tuple"
+#include "unordered_map"
+#include "utility"
+#include "vector"
+
+#include "mpi.h"
+
+
+namespace pamhd {
+namespace poisson {
+
+
+/*!
+Geometric multigrid solver of div(grad(phi)) = rhs in cells of dccrg grid.
+
+Coarse levels follow dccrg's cell hierarchy: at first finest
+cells are merged into their parents, with cells of different
+refinement levels coarsened only after reaching their level,
+and after refinement level 0 blocks of 2x2x2 cells are merged.
+Cells are merged only with cells of the same process. Operator
+of each level is discretized from geometry of its cells, with
+distance between neighbors' centers in face normal direction
+in denominator of flux through their shared face(s).
+
+Prolongation interpolates trilinearly from parent and its
+face, edge and vertex neighbors at centers of children.
+Values of edge and vertex neighbors are gathered through face
+neighbors one dimension at a time, so only face neighbors are
+exchanged between processes. Restriction is transpose of
+prolongation, i.e. full weighting, which keeps the V-cycle
+symmetric as required by conjugate gradient.
+
+Can be used as a standalone solver by iterating V-cycles
+or as a preconditioner of conjugate gradient, see solve().
+
+Example:
+
+pamhd::poisson::Multigrid multigrid;
+multigrid.set(grid, grid.local_cells(), Cell_Type);
+std::vector<double> rhs(multigrid.get_cells().size()), solution;
+...
+multigrid.solve(rhs, solution, 100, 1e-10, 10);
+*/
+class Multigrid
+{
+public:
+
+	size_t
+		pre_smoothing = 2,
+		post_smoothing = 2,
+		//! coarsening stops when number of cells on all processes <= this
+		coarsest_cells = 64,
+		coarsest_iterations = 1000;
+	double jacobi_weight = 0.8;
+
+
+	Multigrid() = default;
+	Multigrid(const Multigrid& other) = delete;
+	Multigrid& operator=(const Multigrid& other) = delete;
+
+	~Multigrid()
+	{
+		this->free_comm();
+	}
+
+
+	/*!
+	Creates multigrid levels from given cells of given grid.
+
+	Cell_Type must return, when given a reference to data of
+	one cell, 1 if phi is solved in that cell, 0 if cell is a
+	boundary cell with phi == 0 and < 0 for cells that don't
+	exist from solver's point of view (zero flux through
+	their faces). Cell_Type must also work for copies of remote
+	neighbors which must have been updated before calling this.
+
+	Rhs and solution given to solve() are in same order as cells
+	with Cell_Type == 1 in given cells, returned by get_cells().
+
+	Must be called by all processes.
+	*/
+	template<
+		class Grid,
+		class Cells,
+		class Cell_Type_Getter
+	> void set(
+		Grid& grid,
+		const Cells& given_cells,
+		Cell_Type_Getter Cell_Type
+	) {
+		this->free_comm();
+		this->comm = grid.get_communicator();
+		MPI_Comm_rank(this->comm, &this->rank);
+
+		this->levels.clear();
+		this->cells.clear();
+
+		std::unordered_map<uint64_t, size_t> local_index;
+		for (const auto& cell: given_cells) {
+			if (Cell_Type(*cell.data) != 1) {
+				continue;
+			}
+			local_index[cell.id] = this->cells.size();
+			this->cells.push_back(cell.id);
+		}
+
+		this->levels.emplace_back();
+		auto& fine = this->levels.back();
+		const size_t nr_local = this->cells.size();
+		fine.keys.reserve(nr_local);
+		fine.volume.reserve(nr_local);
+		fine.min.reserve(nr_local);
+		fine.max.reserve(nr_local);
+
+		std::array<uint64_t, 3> extent{0, 0, 0};
+		std::vector<Face> faces;
+		for (size_t cell_i = 0; cell_i < nr_local; cell_i++) {
+			const auto cell = this->cells[cell_i];
+			const auto key = get_key(grid, cell);
+			fine.keys.push_back(key);
+			for (size_t dim = 0; dim < 3; dim++) {
+				extent[dim] = std::max(extent[dim], key[dim] + key[3]);
+			}
+
+			const auto length = grid.geometry.get_length(cell);
+			fine.volume.push_back(length[0] * length[1] * length[2]);
+			fine.min.push_back(grid.geometry.get_min(cell));
+			fine.max.push_back(grid.geometry.get_max(cell));
+
+			for (const auto& item: grid.get_face_neighbors_of(cell)) {
+				const auto neighbor = item.first;
+				const auto direction = item.second;
+				if (direction == 0 or std::abs(direction) > 3) {
+					throw std::runtime_error(
+						std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+						+ "Invalid direction " + std::to_string(direction)
+						+ " to neighbor " + std::to_string(neighbor)
+						+ " of cell " + std::to_string(cell)
+					);
+				}
+				const size_t dim = std::abs(direction) - 1;
+				const int side = direction < 0 ? -1 : +1;
+
+				auto* const neighbor_data = grid[neighbor];
+				if (neighbor_data == nullptr) {
+					throw std::runtime_error(
+						std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+						+ "No data for neighbor " + std::to_string(neighbor)
+						+ " of cell " + std::to_string(cell)
+					);
+				}
+				const auto neighbor_type = Cell_Type(*neighbor_data);
+				if (neighbor_type < 0 or neighbor_type > 1) {
+					continue;
+				}
+
+				const auto neighbor_length = grid.geometry.get_length(neighbor);
+				const double area
+					= std::min(length[(dim + 1) % 3], neighbor_length[(dim + 1) % 3])
+					* std::min(length[(dim + 2) % 3], neighbor_length[(dim + 2) % 3]);
+
+				if (neighbor_type == 0) {
+					fine.boundary_faces.push_back({
+						cell_i, dim, side, area, neighbor_length[dim] / 2
+					});
+					continue;
+				}
+
+				if (grid.is_local(neighbor)) {
+					const auto iter = local_index.find(neighbor);
+					if (iter == local_index.end()) {
+						continue;
+					}
+					if (iter->second != cell_i) {
+						faces.push_back({
+							cell_i, iter->second, -1, {}, dim, side, area
+						});
+					}
+				} else {
+					faces.push_back({
+						cell_i, 0, int(grid.get_process(neighbor)),
+						get_key(grid, neighbor), dim, side, area
+					});
+				}
+			}
+		}
+
+		uint64_t nr_boundary_faces = fine.boundary_faces.size(), global_boundary_faces = 0;
+		MPI_Allreduce(
+			&nr_boundary_faces, &global_boundary_faces,
+			1, MPI_UINT64_T, MPI_SUM, this->comm
+		);
+		this->singular = global_boundary_faces == 0;
+
+		MPI_Allreduce(
+			MPI_IN_PLACE, extent.data(), 3, MPI_UINT64_T, MPI_MAX, this->comm
+		);
+		const uint64_t max_extent = std::max({extent[0], extent[1], extent[2]});
+
+		this->finish_level(fine, faces);
+
+		// coarsen until small enough or nothing left to coarsen
+		uint64_t block = 1;
+		while (true) {
+			auto& current = this->levels.back();
+			const uint64_t global_cells = this->get_global_size(current);
+			if (global_cells <= this->coarsest_cells) {
+				break;
+			}
+
+			bool coarsened = false;
+			while (block < max_extent) {
+				block *= 2;
+
+				std::vector<key_type> coarse_keys;
+				coarse_keys.reserve(current.keys.size());
+				for (const auto& key: current.keys) {
+					coarse_keys.push_back(coarsen(key, block));
+				}
+				std::sort(coarse_keys.begin(), coarse_keys.end());
+				uint64_t nr_coarse = std::unique(
+					coarse_keys.begin(), coarse_keys.end()
+				) - coarse_keys.begin();
+				MPI_Allreduce(
+					MPI_IN_PLACE, &nr_coarse, 1, MPI_UINT64_T, MPI_SUM, this->comm
+				);
+				if (nr_coarse < global_cells) {
+					coarsened = true;
+					break;
+				}
+			}
+			if (not coarsened) {
+				break;
+			}
+
+			this->add_coarse_level(block);
+		}
+
+		for (auto& level: this->levels) {
+			level.faces.clear();
+			level.faces.shrink_to_fit();
+			level.boundary_faces.clear();
+			level.boundary_faces.shrink_to_fit();
+			level.min.clear();
+			level.min.shrink_to_fit();
+			level.max.clear();
+			level.max.shrink_to_fit();
+		}
+	}
+
+
+	/*!
+	Returns cells in which phi is solved in order of rhs
+	and solution given to solve().
+	*/
+	const std::vector<uint64_t>& get_cells() const
+	{
+		return this->cells;
+	}
+
+	//! Returns number of levels including finest one
+	size_t get_nr_levels() const
+	{
+		return this->levels.size();
+	}
+
+	/*!
+	Returns number of cells on all processes in given level.
+
+	Must be called by all processes.
+	*/
+	uint64_t get_nr_cells(const size_t level) const
+	{
+		return this->get_global_size(this->levels.at(level));
+	}
+
+	//! Returns relative 2-norm of residual after last solve()
+	double get_residual() const
+	{
+		return this->residual;
+	}
+
+	//! Returns number of iterations of last solve()
+	size_t get_iterations() const
+	{
+		return this->iterations;
+	}
+
+
+	/*!
+	Solves phi from div(grad(phi)) = rhs.
+
+	Given solution is used as initial guess unless it has
+	wrong size in which case it starts from zero.
+
+	If precondition is true uses one V-cycle as preconditioner
+	of conjugate gradient method, otherwise applies V-cycles
+	to residual until convergence.
+
+	Stops when 2-norm of residual relative to 2-norm of rhs
+	(both multiplied by cell volumes) is below stop_residual,
+	i.e. unlike in dccrg's Poisson_Solve stop_residual is relative,
+	after max_iterations, if residual grows stop_after_residual_increase
+	times larger than smallest residual or if smallest residual
+	hasn't decreased during last 10 iterations. Solution of
+	smallest residual is returned.
+
+	If there are no boundary cells solution is defined up to a
+	constant and is returned with zero average.
+
+	Returns number of iterations. Must be called by all processes.
+	*/
+	size_t solve(
+		const std::vector<double>& rhs,
+		std::vector<double>& solution,
+		const size_t max_iterations,
+		const double stop_residual,
+		const double stop_after_residual_increase,
+		const bool precondition = true
+	) {
+		if (this->levels.size() == 0) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Multigrid hasn't been set."
+			);
+		}
+
+		auto& fine = this->levels[0];
+		const size_t nr_local = fine.keys.size();
+		if (rhs.size() != nr_local) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Wrong number of values in rhs: " + std::to_string(rhs.size())
+				+ ", should be " + std::to_string(nr_local)
+			);
+		}
+		if (solution.size() != nr_local) {
+			solution.assign(nr_local, 0);
+		}
+
+		// solve (-div(grad)) * volume * phi = -rhs * volume
+		std::vector<double>
+			b(nr_local),
+			r(nr_local),
+			z(nr_local),
+			q(nr_local),
+			x(nr_local + fine.nr_ghosts, 0),
+			p(nr_local + fine.nr_ghosts, 0);
+		for (size_t i = 0; i < nr_local; i++) {
+			b[i] = -rhs[i] * fine.volume[i];
+			x[i] = solution[i];
+		}
+		if (this->singular) {
+			this->remove_average(fine, b);
+		}
+
+		const double norm_b = std::sqrt(this->dot(b, b, nr_local));
+		if (norm_b == 0) {
+			std::fill(solution.begin(), solution.end(), 0);
+			this->residual = 0;
+			this->iterations = 0;
+			return 0;
+		}
+
+		this->exchange(fine, x, 1);
+		this->apply(fine, x, r);
+		for (size_t i = 0; i < nr_local; i++) {
+			r[i] = b[i] - r[i];
+		}
+
+		double
+			best_residual = std::sqrt(this->dot(r, r, nr_local)) / norm_b,
+			rz = 0;
+		size_t iteration = 0, best_iteration = 0;
+		std::vector<double> best_x(x.begin(), x.begin() + nr_local);
+
+		if (precondition) {
+			this->v_cycle(r, z);
+			std::copy(z.cbegin(), z.cend(), p.begin());
+			rz = this->dot(r, z, nr_local);
+		}
+
+		while (
+			best_residual > stop_residual
+			and iteration < max_iterations
+		) {
+			iteration++;
+
+			if (precondition) {
+				this->exchange(fine, p, 1);
+				this->apply(fine, p, q);
+				const double pq = this->dot(p, q, nr_local);
+				if (pq == 0) {
+					break;
+				}
+				const double alpha = rz / pq;
+				for (size_t i = 0; i < nr_local; i++) {
+					x[i] += alpha * p[i];
+					r[i] -= alpha * q[i];
+				}
+			} else {
+				this->v_cycle(r, z);
+				for (size_t i = 0; i < nr_local; i++) {
+					x[i] += z[i];
+				}
+				this->exchange(fine, x, 1);
+				this->apply(fine, x, r);
+				for (size_t i = 0; i < nr_local; i++) {
+					r[i] = b[i] - r[i];
+				}
+			}
+
+			const double current = std::sqrt(this->dot(r, r, nr_local)) / norm_b;
+			if (current < best_residual) {
+				best_residual = current;
+				best_iteration = iteration;
+				std::copy(x.cbegin(), x.cbegin() + nr_local, best_x.begin());
+			}
+			if (
+				current > stop_after_residual_increase * best_residual
+				or iteration >= best_iteration + 10
+			) {
+				break;
+			}
+
+			if (precondition) {
+				this->v_cycle(r, z);
+				const double new_rz = this->dot(r, z, nr_local);
+				const double beta = new_rz / rz;
+				rz = new_rz;
+				for (size_t i = 0; i < nr_local; i++) {
+					p[i] = z[i] + beta * p[i];
+				}
+			}
+		}
+
+		if (this->singular) {
+			this->remove_average(fine, best_x, false);
+		}
+		std::copy(best_x.cbegin(), best_x.cend(), solution.begin());
+		this->residual = best_residual;
+		this->iterations = iteration;
+
+		return iteration;
+	}
+
+
+private:
+
+	// indices of first corner and length in indices of cell
+	using key_type = std::array<uint64_t, 4>;
+
+	struct Face {
+		size_t cell, neighbor;
+		// process of neighbor if not local, otherwise -1
+		int process;
+		key_type neighbor_key;
+		size_t dim;
+		// -1 or +1 if neighbor is on negative or positive side of cell
+		int side;
+		double area;
+	};
+
+	struct Boundary_Face {
+		size_t cell, dim;
+		int side;
+		double area,
+			// distance from face to where phi == 0
+			outer;
+	};
+
+	struct Level {
+		// cells owned by this process sorted by key, except in finest level
+		std::vector<key_type> keys;
+		std::vector<double> volume;
+		std::vector<std::array<double, 3>> min, max;
+
+		// -A_ij, A_ii of operator A = -div(grad) * volume
+		std::vector<double> diagonal, coefficients;
+		std::vector<size_t> row_start, columns;
+
+		// remote neighbors sorted by process and key
+		size_t nr_ghosts = 0;
+		std::vector<std::pair<int, key_type>> ghosts;
+		std::vector<int> processes;
+		std::vector<size_t> ghost_start;
+		std::vector<std::vector<size_t>> send_cells;
+		std::vector<std::vector<double>> send_buffers;
+		std::vector<MPI_Request> requests;
+
+		// index of each cell in next level
+		std::vector<size_t> coarse;
+		// center of each cell relative to center of its cell in
+		// next level, in units of length of latter
+		std::vector<std::array<double, 3>> offset;
+
+		/*
+		Weights of neighbors in directions -x, +x, -y, ..., +z whose
+		sum is interpolated value of that direction's neighbor
+		*/
+		std::vector<size_t> interpolation_start, interpolation_columns;
+		std::vector<double> interpolation_weights;
+
+		std::vector<double> x, b, r, p, q,
+			// values of cells and their neighbors during interpolation
+			values_x, values_xy, values_xyz;
+
+		// only used while setting up levels
+		std::vector<Face> faces;
+		std::vector<Boundary_Face> boundary_faces;
+	};
+
+	std::vector<Level> levels;
+	std::vector<uint64_t> cells;
+	MPI_Comm comm = MPI_COMM_NULL;
+	int rank = 0;
+	bool singular = false;
+	double residual = 0;
+	size_t iterations = 0;
+
+
+	void free_comm()
+	{
+		if (this->comm == MPI_COMM_NULL) {
+			return;
+		}
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (not finalized) {
+			MPI_Comm_free(&this->comm);
+		}
+		this->comm = MPI_COMM_NULL;
+	}
+
+
+	template<class Grid> static key_type get_key(
+		const Grid& grid,
+		const uint64_t cell
+	) {
+		const auto indices = grid.mapping.get_indices(cell);
+		return {
+			indices[0], indices[1], indices[2],
+			grid.mapping.get_cell_length_in_indices(cell)
+		};
+	}
+
+	//! Returns key of block of given size containing given cell
+	static key_type coarsen(const key_type& key, const uint64_t block)
+	{
+		const auto length = std::max(key[3], block);
+		return {
+			key[0] / length * length,
+			key[1] / length * length,
+			key[2] / length * length,
+			length
+		};
+	}
+
+
+	uint64_t get_global_size(const Level& level) const
+	{
+		uint64_t local = level.keys.size(), global = 0;
+		MPI_Allreduce(&local, &global, 1, MPI_UINT64_T, MPI_SUM, this->comm);
+		return global;
+	}
+
+
+	/*!
+	Sets up remote neighbors and operator of level.
+
+	Faces with a remote neighbor must have process >= 0
+	and neighbor_key, others must have local neighbor.
+	*/
+	void finish_level(Level& level, std::vector<Face>& faces)
+	{
+		const size_t nr_local = level.keys.size();
+
+		level.ghosts.clear();
+		for (const auto& face: faces) {
+			if (face.process >= 0) {
+				level.ghosts.emplace_back(face.process, face.neighbor_key);
+			}
+		}
+		std::sort(level.ghosts.begin(), level.ghosts.end());
+		level.ghosts.erase(
+			std::unique(level.ghosts.begin(), level.ghosts.end()),
+			level.ghosts.end()
+		);
+		level.nr_ghosts = level.ghosts.size();
+
+		level.processes.clear();
+		level.ghost_start.clear();
+		for (size_t i = 0; i < level.ghosts.size(); i++) {
+			if (i == 0 or level.ghosts[i].first != level.ghosts[i - 1].first) {
+				level.processes.push_back(level.ghosts[i].first);
+				level.ghost_start.push_back(i);
+			}
+		}
+		level.ghost_start.push_back(level.ghosts.size());
+
+		// local cells sent to each process, in same order as ghosts there
+		level.send_cells.assign(level.processes.size(), {});
+		for (auto& face: faces) {
+			if (face.process < 0) {
+				continue;
+			}
+			const auto ghost = std::lower_bound(
+				level.ghosts.cbegin(), level.ghosts.cend(),
+				std::make_pair(face.process, face.neighbor_key)
+			);
+			face.neighbor = nr_local + (ghost - level.ghosts.cbegin());
+
+			const auto process_i = std::lower_bound(
+				level.processes.cbegin(), level.processes.cend(), face.process
+			) - level.processes.cbegin();
+			level.send_cells[process_i].push_back(face.cell);
+		}
+		for (auto& send: level.send_cells) {
+			std::sort(
+				send.begin(), send.end(),
+				[&level](const size_t a, const size_t b) {
+					return level.keys[a] < level.keys[b];
+				}
+			);
+			send.erase(std::unique(send.begin(), send.end()), send.end());
+		}
+		level.send_buffers.assign(level.processes.size(), {});
+		level.requests.resize(2 * level.processes.size());
+
+		// lengths of local and remote cells
+		std::vector<double> length((nr_local + level.nr_ghosts) * 3, 0);
+		for (size_t i = 0; i < nr_local; i++) {
+			for (size_t dim = 0; dim < 3; dim++) {
+				length[3 * i + dim] = level.max[i][dim] - level.min[i][dim];
+			}
+		}
+		this->exchange(level, length, 3);
+
+		// merge faces between same cells
+		std::sort(
+			faces.begin(), faces.end(),
+			[](const Face& a, const Face& b) {
+				return
+					std::tie(a.cell, a.neighbor, a.dim, a.side)
+					< std::tie(b.cell, b.neighbor, b.dim, b.side);
+			}
+		);
+		level.faces.clear();
+		for (const auto& face: faces) {
+			if (
+				level.faces.size() > 0
+				and level.faces.back().cell == face.cell
+				and level.faces.back().neighbor == face.neighbor
+				and level.faces.back().dim == face.dim
+				and level.faces.back().side == face.side
+			) {
+				level.faces.back().area += face.area;
+			} else {
+				level.faces.push_back(face);
+			}
+		}
+
+		level.diagonal.assign(nr_local, 0);
+		level.row_start.assign(nr_local + 1, 0);
+		level.columns.clear();
+		level.coefficients.clear();
+		size_t previous_cell = std::numeric_limits<size_t>::max();
+		for (const auto& face: level.faces) {
+			const double coefficient = face.area / (
+				length[3 * face.cell + face.dim]
+				+ length[3 * face.neighbor + face.dim]
+			) * 2;
+
+			level.diagonal[face.cell] += coefficient;
+			if (
+				face.cell == previous_cell
+				and level.columns.back() == face.neighbor
+			) {
+				level.coefficients.back() += coefficient;
+			} else {
+				level.columns.push_back(face.neighbor);
+				level.coefficients.push_back(coefficient);
+			}
+			previous_cell = face.cell;
+			level.row_start[face.cell + 1] = level.columns.size();
+		}
+		for (size_t i = 0; i < nr_local; i++) {
+			level.row_start[i + 1] = std::max(level.row_start[i + 1], level.row_start[i]);
+		}
+		for (const auto& face: level.boundary_faces) {
+			level.diagonal[face.cell] += face.area / (
+				length[3 * face.cell + face.dim] / 2 + face.outer
+			);
+		}
+
+		this->set_interpolation(level, length);
+
+		level.x.assign(nr_local + level.nr_ghosts, 0);
+		level.p.assign(nr_local + level.nr_ghosts, 0);
+		level.b.assign(nr_local, 0);
+		level.r.assign(nr_local, 0);
+		level.q.assign(nr_local, 0);
+		level.values_x.assign(3 * (nr_local + level.nr_ghosts), 0);
+		level.values_xy.assign(9 * (nr_local + level.nr_ghosts), 0);
+		level.values_xyz.assign(27 * nr_local, 0);
+	}
+
+
+	/*!
+	Sets weights of neighbors in each direction of level's cells.
+
+	Value in a direction is area weighted average of face neighbors
+	on that side, zero at distance of boundary faces extrapolated
+	to center of a neighbor of same size, or value of cell itself
+	if it has no neighbors on that side.
+	*/
+	void set_interpolation(Level& level, const std::vector<double>& length)
+	{
+		const size_t nr_local = level.keys.size();
+
+		std::vector<double> area(6 * nr_local, 0);
+		for (const auto& face: level.faces) {
+			area[6 * face.cell + 2 * face.dim + (face.side + 1) / 2] += face.area;
+		}
+		for (const auto& face: level.boundary_faces) {
+			area[6 * face.cell + 2 * face.dim + (face.side + 1) / 2] += face.area;
+		}
+
+		// direction, column, weight
+		std::vector<std::tuple<size_t, size_t, double>> entries;
+		entries.reserve(level.faces.size() + level.boundary_faces.size() + 6 * nr_local);
+		for (const auto& face: level.faces) {
+			const auto direction = 6 * face.cell + 2 * face.dim + (face.side + 1) / 2;
+			entries.emplace_back(direction, face.neighbor, face.area / area[direction]);
+		}
+		for (const auto& face: level.boundary_faces) {
+			const auto direction = 6 * face.cell + 2 * face.dim + (face.side + 1) / 2;
+			const auto cell_length = length[3 * face.cell + face.dim];
+			entries.emplace_back(
+				direction, face.cell,
+				face.area / area[direction]
+					* (1 - cell_length / (cell_length / 2 + face.outer))
+			);
+		}
+		for (size_t direction = 0; direction < area.size(); direction++) {
+			if (area[direction] == 0) {
+				entries.emplace_back(direction, direction / 6, 1);
+			}
+		}
+		std::sort(entries.begin(), entries.end());
+
+		level.interpolation_start.assign(area.size() + 1, 0);
+		level.interpolation_columns.clear();
+		level.interpolation_weights.clear();
+		for (const auto& [direction, column, weight]: entries) {
+			level.interpolation_columns.push_back(column);
+			level.interpolation_weights.push_back(weight);
+			level.interpolation_start[direction + 1] = level.interpolation_columns.size();
+		}
+		for (size_t i = 0; i < area.size(); i++) {
+			level.interpolation_start[i + 1] = std::max(
+				level.interpolation_start[i + 1],
+				level.interpolation_start[i]
+			);
+		}
+	}
+
+
+	//! Adds level with cells of last level merged into blocks of given size
+	void add_coarse_level(const uint64_t block)
+	{
+		this->levels.emplace_back();
+		auto& fine = this->levels[this->levels.size() - 2];
+		auto& coarse = this->levels.back();
+		const size_t nr_fine = fine.keys.size();
+
+		for (const auto& key: fine.keys) {
+			coarse.keys.push_back(coarsen(key, block));
+		}
+		std::sort(coarse.keys.begin(), coarse.keys.end());
+		coarse.keys.erase(
+			std::unique(coarse.keys.begin(), coarse.keys.end()),
+			coarse.keys.end()
+		);
+		const size_t nr_coarse = coarse.keys.size();
+
+		coarse.volume.assign(nr_coarse, 0);
+		coarse.min.assign(nr_coarse, {
+			std::numeric_limits<double>::max(),
+			std::numeric_limits<double>::max(),
+			std::numeric_limits<double>::max()
+		});
+		coarse.max.assign(nr_coarse, {
+			std::numeric_limits<double>::lowest(),
+			std::numeric_limits<double>::lowest(),
+			std::numeric_limits<double>::lowest()
+		});
+
+		fine.coarse.resize(nr_fine);
+		for (size_t i = 0; i < nr_fine; i++) {
+			const auto parent = std::lower_bound(
+				coarse.keys.cbegin(), coarse.keys.cend(),
+				coarsen(fine.keys[i], block)
+			) - coarse.keys.cbegin();
+			fine.coarse[i] = parent;
+
+			coarse.volume[parent] += fine.volume[i];
+			for (size_t dim = 0; dim < 3; dim++) {
+				coarse.min[parent][dim] = std::min(coarse.min[parent][dim], fine.min[i][dim]);
+				coarse.max[parent][dim] = std::max(coarse.max[parent][dim], fine.max[i][dim]);
+			}
+		}
+
+		std::vector<Face> faces;
+		faces.reserve(fine.faces.size());
+		for (const auto& face: fine.faces) {
+			const auto cell = fine.coarse[face.cell];
+			if (face.neighbor < nr_fine) {
+				const auto neighbor = fine.coarse[face.neighbor];
+				if (neighbor != cell) {
+					faces.push_back({
+						cell, neighbor, -1, {}, face.dim, face.side, face.area
+					});
+				}
+			} else {
+				const auto& ghost = fine.ghosts[face.neighbor - nr_fine];
+				faces.push_back({
+					cell, 0, ghost.first, coarsen(ghost.second, block),
+					face.dim, face.side, face.area
+				});
+			}
+		}
+
+		coarse.boundary_faces.reserve(fine.boundary_faces.size());
+		for (const auto& face: fine.boundary_faces) {
+			coarse.boundary_faces.push_back({
+				fine.coarse[face.cell], face.dim, face.side, face.area, face.outer
+			});
+		}
+
+		fine.offset.resize(nr_fine);
+		for (size_t i = 0; i < nr_fine; i++) {
+			const auto parent = fine.coarse[i];
+			for (size_t dim = 0; dim < 3; dim++) {
+				fine.offset[i][dim]
+					= (fine.min[i][dim] + fine.max[i][dim]
+						- coarse.min[parent][dim] - coarse.max[parent][dim])
+					/ 2 / (coarse.max[parent][dim] - coarse.min[parent][dim]);
+			}
+		}
+
+		this->finish_level(coarse, faces);
+	}
+
+
+	//! Copies data of local cells to other processes' ghosts
+	void exchange(Level& level, std::vector<double>& data, const size_t stride)
+	{
+		const size_t nr_local = level.keys.size();
+		const size_t nr_processes = level.processes.size();
+
+		for (size_t i = 0; i < nr_processes; i++) {
+			const auto start = nr_local + level.ghost_start[i];
+			MPI_Irecv(
+				data.data() + start * stride,
+				int((level.ghost_start[i + 1] - level.ghost_start[i]) * stride),
+				MPI_DOUBLE,
+				level.processes[i],
+				0,
+				this->comm,
+				&level.requests[i]
+			);
+		}
+
+		for (size_t i = 0; i < nr_processes; i++) {
+			auto& buffer = level.send_buffers[i];
+			buffer.resize(level.send_cells[i].size() * stride);
+			size_t buffer_i = 0;
+			for (const auto cell: level.send_cells[i]) {
+				for (size_t j = 0; j < stride; j++) {
+					buffer[buffer_i++] = data[cell * stride + j];
+				}
+			}
+			MPI_Isend(
+				buffer.data(),
+				int(buffer.size()),
+				MPI_DOUBLE,
+				level.processes[i],
+				0,
+				this->comm,
+				&level.requests[nr_processes + i]
+			);
+		}
+
+		MPI_Waitall(
+			int(level.requests.size()),
+			level.requests.data(),
+			MPI_STATUSES_IGNORE
+		);
+	}
+
+	//! Adds data of ghosts to corresponding local cells of other processes
+	void accumulate(Level& level, std::vector<double>& data, const size_t stride)
+	{
+		const size_t nr_local = level.keys.size();
+		const size_t nr_processes = level.processes.size();
+
+		for (size_t i = 0; i < nr_processes; i++) {
+			auto& buffer = level.send_buffers[i];
+			buffer.resize(level.send_cells[i].size() * stride);
+			MPI_Irecv(
+				buffer.data(),
+				int(buffer.size()),
+				MPI_DOUBLE,
+				level.processes[i],
+				1,
+				this->comm,
+				&level.requests[i]
+			);
+		}
+
+		for (size_t i = 0; i < nr_processes; i++) {
+			const auto start = nr_local + level.ghost_start[i];
+			MPI_Isend(
+				data.data() + start * stride,
+				int((level.ghost_start[i + 1] - level.ghost_start[i]) * stride),
+				MPI_DOUBLE,
+				level.processes[i],
+				1,
+				this->comm,
+				&level.requests[nr_processes + i]
+			);
+		}
+
+		MPI_Waitall(
+			int(level.requests.size()),
+			level.requests.data(),
+			MPI_STATUSES_IGNORE
+		);
+
+		for (size_t i = 0; i < nr_processes; i++) {
+			const auto& buffer = level.send_buffers[i];
+			size_t buffer_i = 0;
+			for (const auto cell: level.send_cells[i]) {
+				for (size_t j = 0; j < stride; j++) {
+					data[cell * stride + j] += buffer[buffer_i++];
+				}
+			}
+		}
+	}
+
+
+	//! result = A * x, remote neighbors of x must be up to date
+	void apply(
+		const Level& level,
+		const std::vector<double>& x,
+		std::vector<double>& result
+	) const {
+		const size_t nr_local = level.keys.size();
+		for (size_t i = 0; i < nr_local; i++) {
+			double value = level.diagonal[i] * x[i];
+			for (size_t j = level.row_start[i]; j < level.row_start[i + 1]; j++) {
+				value -= level.coefficients[j] * x[level.columns[j]];
+			}
+			result[i] = value;
+		}
+	}
+
+
+	double dot(
+		const std::vector<double>& a,
+		const std::vector<double>& b,
+		const size_t nr_local
+	) const {
+		double local = 0, global = 0;
+		for (size_t i = 0; i < nr_local; i++) {
+			local += a[i] * b[i];
+		}
+		MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_SUM, this->comm);
+		return global;
+	}
+
+
+	/*!
+	Removes constant from data.
+
+	If integrated is true data is assumed to be multiplied
+	by volume, i.e. removes volume weighted average.
+	*/
+	void remove_average(
+		const Level& level,
+		std::vector<double>& data,
+		const bool integrated = true
+	) const {
+		const size_t nr_local = level.keys.size();
+		std::array<double, 2> local{0, 0}, global{0, 0};
+		for (size_t i = 0; i < nr_local; i++) {
+			local[0] += integrated ? data[i] : data[i] * level.volume[i];
+			local[1] += level.volume[i];
+		}
+		MPI_Allreduce(
+			local.data(), global.data(), 2, MPI_DOUBLE, MPI_SUM, this->comm
+		);
+		if (global[1] == 0) {
+			return;
+		}
+		const double average = global[0] / global[1];
+		for (size_t i = 0; i < nr_local; i++) {
+			data[i] -= integrated ? average * level.volume[i] : average;
+		}
+	}
+
+
+	//! Weighted Jacobi iterations of level.x
+	void smooth(Level& level, const size_t iterations)
+	{
+		const size_t nr_local = level.keys.size();
+		for (size_t iteration = 0; iteration < iterations; iteration++) {
+			this->exchange(level, level.x, 1);
+			this->apply(level, level.x, level.r);
+			for (size_t i = 0; i < nr_local; i++) {
+				if (level.diagonal[i] == 0) {
+					continue;
+				}
+				level.x[i]
+					+= this->jacobi_weight
+					* (level.b[i] - level.r[i])
+					/ level.diagonal[i];
+			}
+		}
+	}
+
+
+	//! Solves coarsest level with conjugate gradient
+	void solve_coarsest(Level& level)
+	{
+		const size_t nr_local = level.keys.size();
+		if (this->singular) {
+			this->remove_average(level, level.b);
+		}
+
+		std::fill(level.x.begin(), level.x.end(), 0);
+		std::copy(level.b.cbegin(), level.b.cend(), level.r.begin());
+		std::copy(level.b.cbegin(), level.b.cend(), level.p.begin());
+
+		const double norm_b = this->dot(level.b, level.b, nr_local);
+		double rr = norm_b;
+		for (
+			size_t iteration = 0;
+			iteration < this->coarsest_iterations
+				and rr > 1e-24 * norm_b;
+			iteration++
+		) {
+			this->exchange(level, level.p, 1);
+			this->apply(level, level.p, level.q);
+			const double pq = this->dot(level.p, level.q, nr_local);
+			if (pq <= 0) {
+				break;
+			}
+			const double alpha = rr / pq;
+			for (size_t i = 0; i < nr_local; i++) {
+				level.x[i] += alpha * level.p[i];
+				level.r[i] -= alpha * level.q[i];
+			}
+			const double new_rr = this->dot(level.r, level.r, nr_local);
+			const double beta = new_rr / rr;
+			rr = new_rr;
+			for (size_t i = 0; i < nr_local; i++) {
+				level.p[i] = level.r[i] + beta * level.p[i];
+			}
+		}
+	}
+
+
+	void v_cycle(const size_t level_i)
+	{
+		auto& level = this->levels[level_i];
+		if (level_i + 1 == this->levels.size()) {
+			this->solve_coarsest(level);
+			return;
+		}
+
+		const size_t nr_local = level.keys.size();
+		this->smooth(level, this->pre_smoothing);
+
+		this->exchange(level, level.x, 1);
+		this->apply(level, level.x, level.r);
+
+		for (size_t i = 0; i < nr_local; i++) {
+			level.r[i] = level.b[i] - level.r[i];
+		}
+		this->restrict_residual(level_i);
+
+		auto& coarse = this->levels[level_i + 1];
+		std::fill(coarse.x.begin(), coarse.x.end(), 0);
+		this->v_cycle(level_i + 1);
+
+		this->prolongate(level_i);
+		this->smooth(level, this->post_smoothing);
+	}
+
+
+	/*!
+	Sets out[(k + 1) * in_stride + j] of each local cell to
+	in[j] of its neighbor in direction k of given dimension,
+	k == 0 being cell itself.
+
+	Ghosts of in must be up to date.
+	*/
+	void gather_neighbors(
+		const Level& level,
+		const size_t dim,
+		const std::vector<double>& in,
+		const size_t in_stride,
+		std::vector<double>& out
+	) const {
+		const size_t nr_local = level.keys.size();
+		const size_t out_stride = 3 * in_stride;
+		for (size_t cell = 0; cell < nr_local; cell++) {
+			auto* const cell_out = out.data() + cell * out_stride;
+			for (size_t j = 0; j < in_stride; j++) {
+				cell_out[in_stride + j] = in[cell * in_stride + j];
+			}
+			for (const size_t side: {0, 1}) {
+				const auto direction = 6 * cell + 2 * dim + side;
+				auto* const side_out = cell_out + 2 * side * in_stride;
+				for (size_t j = 0; j < in_stride; j++) {
+					side_out[j] = 0;
+				}
+				for (
+					size_t i = level.interpolation_start[direction];
+					i < level.interpolation_start[direction + 1];
+					i++
+				) {
+					const auto column = level.interpolation_columns[i];
+					const auto weight = level.interpolation_weights[i];
+					for (size_t j = 0; j < in_stride; j++) {
+						side_out[j] += weight * in[column * in_stride + j];
+					}
+				}
+			}
+		}
+	}
+
+	/*!
+	Transpose of gather_neighbors(), adds to in including ghosts.
+	*/
+	void scatter_neighbors(
+		const Level& level,
+		const size_t dim,
+		const std::vector<double>& out,
+		const size_t in_stride,
+		std::vector<double>& in
+	) const {
+		const size_t nr_local = level.keys.size();
+		const size_t out_stride = 3 * in_stride;
+		for (size_t cell = 0; cell < nr_local; cell++) {
+			const auto* const cell_out = out.data() + cell * out_stride;
+			for (size_t j = 0; j < in_stride; j++) {
+				in[cell * in_stride + j] += cell_out[in_stride + j];
+			}
+			for (const size_t side: {0, 1}) {
+				const auto direction = 6 * cell + 2 * dim + side;
+				const auto* const side_out = cell_out + 2 * side * in_stride;
+				for (
+					size_t i = level.interpolation_start[direction];
+					i < level.interpolation_start[direction + 1];
+					i++
+				) {
+					const auto column = level.interpolation_columns[i];
+					const auto weight = level.interpolation_weights[i];
+					for (size_t j = 0; j < in_stride; j++) {
+						in[column * in_stride + j] += weight * side_out[j];
+					}
+				}
+			}
+		}
+	}
+
+	/*!
+	Calls f(index, weight) for each of 27 values of parent and
+	its neighbors used in trilinear interpolation at given offset.
+	*/
+	template<class Function> static void for_each_corner(
+		const std::array<double, 3>& offset,
+		Function f
+	) {
+		for (size_t corner = 0; corner < 8; corner++) {
+			double weight = 1;
+			size_t index = 0, stride = 1;
+			for (size_t dim = 0; dim < 3; dim++) {
+				const auto t = std::abs(offset[dim]);
+				const bool neighbor = (corner >> dim) & 1;
+				weight *= neighbor ? t : 1 - t;
+				const int k = neighbor ? (offset[dim] < 0 ? -1 : +1) : 0;
+				index += size_t(k + 1) * stride;
+				stride *= 3;
+			}
+			if (weight != 0) {
+				f(index, weight);
+			}
+		}
+	}
+
+	//! Adds trilinearly interpolated correction of next level to level
+	void prolongate(const size_t level_i)
+	{
+		auto& fine = this->levels[level_i];
+		auto& coarse = this->levels[level_i + 1];
+
+		this->exchange(coarse, coarse.x, 1);
+		this->gather_neighbors(coarse, 0, coarse.x, 1, coarse.values_x);
+		this->exchange(coarse, coarse.values_x, 3);
+		this->gather_neighbors(coarse, 1, coarse.values_x, 3, coarse.values_xy);
+		this->exchange(coarse, coarse.values_xy, 9);
+		this->gather_neighbors(coarse, 2, coarse.values_xy, 9, coarse.values_xyz);
+
+		const size_t nr_local = fine.keys.size();
+		for (size_t i = 0; i < nr_local; i++) {
+			const auto* const values = coarse.values_xyz.data() + 27 * fine.coarse[i];
+			double correction = 0;
+			for_each_corner(fine.offset[i], [&](const size_t index, const double weight) {
+				correction += weight * values[index];
+			});
+			fine.x[i] += correction;
+		}
+	}
+
+	/*!
+	Sets rhs of next level from residual of level
+	with transpose of prolongate().
+	*/
+	void restrict_residual(const size_t level_i)
+	{
+		auto& fine = this->levels[level_i];
+		auto& coarse = this->levels[level_i + 1];
+
+		std::fill(coarse.values_xyz.begin(), coarse.values_xyz.end(), 0);
+		const size_t nr_local = fine.keys.size();
+		for (size_t i = 0; i < nr_local; i++) {
+			auto* const values = coarse.values_xyz.data() + 27 * fine.coarse[i];
+			const auto residual = fine.r[i];
+			for_each_corner(fine.offset[i], [&](const size_t index, const double weight) {
+				values[index] += weight * residual;
+			});
+		}
+
+		std::fill(coarse.values_xy.begin(), coarse.values_xy.end(), 0);
+		this->scatter_neighbors(coarse, 2, coarse.values_xyz, 9, coarse.values_xy);
+		this->accumulate(coarse, coarse.values_xy, 9);
+		std::fill(coarse.values_x.begin(), coarse.values_x.end(), 0);
+		this->scatter_neighbors(coarse, 1, coarse.values_xy, 3, coarse.values_x);
+		this->accumulate(coarse, coarse.values_x, 3);
+		std::fill(coarse.x.begin(), coarse.x.end(), 0);
+		this->scatter_neighbors(coarse, 0, coarse.values_x, 1, coarse.x);
+		this->accumulate(coarse, coarse.x, 1);
+		std::copy(coarse.x.cbegin(), coarse.x.cbegin() + coarse.b.size(), coarse.b.begin());
+	}
+
+	//! result = V-cycle applied to residual, starting from zero
+	void v_cycle(const std::vector<double>& residual, std::vector<double>& result)
+	{
+		auto& fine = this->levels[0];
+		const size_t nr_local = fine.keys.size();
+		std::copy(residual.cbegin(), residual.cbegin() + nr_local, fine.b.begin());
+		std::fill(fine.x.begin(), fine.x.end(), 0);
+		this->v_cycle(0);
+		std::copy(fine.x.cbegin(), fine.x.cbegin() + nr_local, result.begin());
+	}
+};
+
+}} // namespaces
+
+
+#endif // ifndef PAMHD_POISSON_MULTIGRID_HPP
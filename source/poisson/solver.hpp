@@ -34,13 +34,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PAMHD_POISSON_SOLVER_HPP
 
 
+#include "array"
 #include "cmath"
+#include "complex"
 #include "iostream"
 #include "stdexcept"
+#include "vector"
 
 #include "Eigen/Core"
 #include "Eigen/IterativeLinearSolvers"
 
+#include "poisson/fft.hpp"
+
 
 namespace pamhd {
 namespace poisson {
@@ -306,6 +311,95 @@ template<class Scalar_T> std::vector<Scalar_T> solve_bicgstab(
 }
 
 
+/*!
+Direct solver using discrete Fourier transform.
+
+Solves same discretization as solve_failsafe() and
+solve_bicgstab() on a periodic grid by dividing
+transformed rhs with eigenvalues of discrete Laplacian.
+Average of returned solution is 0.
+*/
+template<class Scalar_T> std::vector<Scalar_T> solve_fft(
+	const size_t grid_size_x,
+	const size_t grid_size_y,
+	const size_t grid_size_z,
+	const Scalar_T cell_length_x,
+	const Scalar_T cell_length_y,
+	const Scalar_T cell_length_z,
+	const std::vector<Scalar_T>& rhs
+) {
+	const size_t nr_of_cells = grid_size_x * grid_size_y * grid_size_z;
+
+	if (rhs.size() == 0 or rhs.size() != nr_of_cells) {
+		throw std::invalid_argument("Number of cells and rhs size do not match");
+	}
+
+	const std::array<size_t, 3> grid_size{grid_size_x, grid_size_y, grid_size_z};
+	const std::array<double, 3> cell_length{
+		double(cell_length_x), double(cell_length_y), double(cell_length_z)
+	};
+
+	std::vector<std::complex<double>> data(rhs.cbegin(), rhs.cend());
+
+	// transform one dimension at a time, line by line
+	const std::array<size_t, 3> stride{1, grid_size_x, grid_size_x * grid_size_y};
+	std::vector<std::complex<double>> line;
+	auto transform_all = [&](const bool inverse) {
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (grid_size[dim] == 1) {
+				continue;
+			}
+			const FFT fft(grid_size[dim]);
+			line.resize(grid_size[dim]);
+			for (size_t start = 0; start < nr_of_cells; start++) {
+				// first cell of each line
+				if ((start / stride[dim]) % grid_size[dim] != 0) {
+					continue;
+				}
+				for (size_t i = 0; i < grid_size[dim]; i++) {
+					line[i] = data[start + i * stride[dim]];
+				}
+				fft.transform(line.data(), inverse);
+				for (size_t i = 0; i < grid_size[dim]; i++) {
+					data[start + i * stride[dim]] = line[i];
+				}
+			}
+		}
+	};
+
+	transform_all(false);
+
+	for (size_t z_i = 0; z_i < grid_size_z; z_i++) {
+	for (size_t y_i = 0; y_i < grid_size_y; y_i++) {
+	for (size_t x_i = 0; x_i < grid_size_x; x_i++) {
+		const std::array<size_t, 3> index{x_i, y_i, z_i};
+		double eigenvalue = 0;
+		for (size_t dim = 0; dim < 3; dim++) {
+			eigenvalue
+				+= (2 * std::cos(2 * M_PI * index[dim] / grid_size[dim]) - 2)
+				/ (cell_length[dim] * cell_length[dim]);
+		}
+
+		const size_t cell_index
+			= map_3_to_1(x_i, y_i, z_i, grid_size_x, grid_size_y);
+		if (x_i == 0 and y_i == 0 and z_i == 0) {
+			data[cell_index] = 0;
+		} else {
+			data[cell_index] /= eigenvalue;
+		}
+	}}}
+
+	transform_all(true);
+
+	std::vector<Scalar_T> solution(nr_of_cells);
+	for (size_t i = 0; i < nr_of_cells; i++) {
+		solution[i] = Scalar_T(data[i].real() / nr_of_cells);
+	}
+
+	return solution;
+}
+
+
 /*!
 Solves 2-dimensional Poisson's equation
 (https://en.wikipedia.org/wiki/Poisson%27s_equation)
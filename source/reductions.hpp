@@ -0,0 +1,263 @@
+/*
+Batched nonblocking reductions of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_REDUCTIONS_HPP
+#define PAMHD_REDUCTIONS_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "stdexcept"
+#include "string"
+#include "vector"
+
+#include "mpi.h"
+
+
+namespace pamhd {
+
+
+/*! Reduces scalars of all processes with one nonblocking collective.
+
+Values added with add_min(), add_max() and add_sum() are reduced
+together by one MPI_Iallreduce started by start(), each with its
+own operation. Result of a value is returned by get() which waits
+for the reduction to finish if necessary, so reduction can overlap
+with work done between start() and first get().
+
+All processes must add the same number of values with the same
+operations in the same order. Values are reduced as doubles so
+sums of integers are exact up to 2^53. Adding values after results
+have been received starts a new batch and previous indices become
+invalid.
+
+Example:
+\verbatim
+pamhd::Reductions reductions;
+reductions.set(comm);
+const auto dt_i = reductions.add_min(local_dt);
+const auto cells_i = reductions.add_sum(local_cells);
+reductions.start();
+// work not needing dt
+...
+const double dt = reductions.get(dt_i);
+\endverbatim
+*/
+class Reductions
+{
+public:
+
+	Reductions() = default;
+	Reductions(const Reductions& other) = delete;
+	Reductions& operator=(const Reductions& other) = delete;
+
+	~Reductions()
+	{
+		this->free();
+	}
+
+
+	/*!
+	Uses duplicate of given communicator for reductions.
+
+	Must be called by all processes of comm.
+	*/
+	void set(MPI_Comm given_comm)
+	{
+		this->free();
+		MPI_Comm_dup(given_comm, &this->comm);
+		MPI_Type_contiguous(2, MPI_DOUBLE, &this->item_type);
+		MPI_Type_commit(&this->item_type);
+		MPI_Op_create(&reduce, 1, &this->op);
+	}
+
+	//! Adds value to be reduced to its minimum, returns index of result.
+	size_t add_min(const double value)
+	{
+		return this->add(min_op, value);
+	}
+
+	//! Adds value to be reduced to its maximum, returns index of result.
+	size_t add_max(const double value)
+	{
+		return this->add(max_op, value);
+	}
+
+	//! Adds value to be summed, returns index of result.
+	size_t add_sum(const double value)
+	{
+		return this->add(sum_op, value);
+	}
+
+	/*!
+	Starts reducing values added after previous start().
+
+	Results of previous reduction aren't available afterwards.
+	*/
+	void start()
+	{
+		if (this->comm == MPI_COMM_NULL) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "set() hasn't been called"
+			);
+		}
+		if (this->started) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Reduction already started"
+			);
+		}
+		if (this->finished) {
+			this->values.clear();
+			this->finished = false;
+		}
+		this->results.resize(this->values.size());
+		MPI_Iallreduce(
+			this->values.data(), this->results.data(), int(this->values.size()),
+			this->item_type, this->op, this->comm, &this->request
+		);
+		this->started = true;
+		this->finished = false;
+	}
+
+	//! Waits until reduction started by start() finishes.
+	void wait()
+	{
+		if (not this->started) {
+			return;
+		}
+		MPI_Wait(&this->request, MPI_STATUS_IGNORE);
+		this->started = false;
+		this->finished = true;
+	}
+
+	/*!
+	Returns result of value with given index.
+
+	Waits for reduction to finish if necessary.
+	*/
+	double get(const size_t index)
+	{
+		this->wait();
+		if (not this->finished or index >= this->results.size()) {
+			throw std::out_of_range(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "No result for index " + std::to_string(index)
+			);
+		}
+		return this->results[index][1];
+	}
+
+
+private:
+
+	//! operations stored with values
+	static constexpr double min_op = 0, max_op = 1, sum_op = 2;
+
+	MPI_Comm comm = MPI_COMM_NULL;
+	MPI_Datatype item_type = MPI_DATATYPE_NULL;
+	MPI_Op op = MPI_OP_NULL;
+	MPI_Request request = MPI_REQUEST_NULL;
+	bool started = false, finished = false;
+	//! operation and value of each item
+	std::vector<std::array<double, 2>> values, results;
+
+
+	size_t add(const double operation, const double value)
+	{
+		if (this->started) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Can't add values during reduction"
+			);
+		}
+		if (this->finished) {
+			this->values.clear();
+			this->results.clear();
+			this->finished = false;
+		}
+		this->values.push_back({operation, value});
+		return this->values.size() - 1;
+	}
+
+	/*
+	Operation is stored with each value instead of per batch
+	because MPI can apply op to any part of given items.
+	*/
+	static void reduce(void* in, void* inout, int* len, MPI_Datatype*)
+	{
+		const auto* const source = static_cast<const std::array<double, 2>*>(in);
+		auto* const target = static_cast<std::array<double, 2>*>(inout);
+		for (int i = 0; i < *len; i++) {
+			const auto& operation = source[i][0];
+			auto& result = target[i][1];
+			if (operation == min_op) {
+				result = std::min(result, source[i][1]);
+			} else if (operation == max_op) {
+				result = std::max(result, source[i][1]);
+			} else {
+				result += source[i][1];
+			}
+		}
+	}
+
+	void free()
+	{
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (not finalized) {
+			this->wait();
+			if (this->op != MPI_OP_NULL) {
+				MPI_Op_free(&this->op);
+			}
+			if (this->item_type != MPI_DATATYPE_NULL) {
+				MPI_Type_free(&this->item_type);
+			}
+			if (this->comm != MPI_COMM_NULL) {
+				MPI_Comm_free(&this->comm);
+			}
+		}
+		this->op = MPI_OP_NULL;
+		this->item_type = MPI_DATATYPE_NULL;
+		this->comm = MPI_COMM_NULL;
+		this->started = this->finished = false;
+		this->values.clear();
+		this->results.clear();
+	}
+};
+
+
+} // namespace
+
+
+#endif // ifndef PAMHD_REDUCTIONS_HPP
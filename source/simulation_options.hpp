@@ -60,7 +60,9 @@ struct Options {
 		vacuum_permeability{4e-7 * M_PI},
 		proton_mass{1.672621777e-27},
 		charge2mass{95788332}, // charge to mass ratio (C/kg)
-		temp2nrj{1.380649e-23}; // Boltzmann constant (J/K)
+		temp2nrj{1.380649e-23}, // Boltzmann constant (J/K)
+		// < 0: no timers, 0: report at end, > 0: report interval (s)
+		timers_n{-1};
 	math::Expression<Substep_Min> substep_min_e;
 	math::Expression<Substep_Max> substep_max_e;
 
@@ -232,6 +234,24 @@ struct Options {
 			}
 		}
 
+		if (object.HasMember("timers-n")) {
+			const auto& timers_n_json = object["timers-n"];
+			if (not timers_n_json.IsNumber()) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "JSON item timers-n is not a number."
+				);
+			}
+			this->timers_n = object["timers-n"].GetDouble();
+			if (not isfinite(this->timers_n)) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "Invalid timers-n: "
+					+ to_string(this->timers_n)
+				);
+			}
+		}
+
 		if (object.HasMember("output-directory")) {
 			output_directory = object["output-directory"].GetString();
 		}
@@ -39,12 +39,16 @@ Author(s): Ilja Honkonen
 
 
 #include "array"
+#include "limits"
 #include "stdexcept"
 #include "string"
+#include "utility"
 #include "vector"
 
 #include "rapidjson/document.h"
 
+#include "solar_wind_driver.hpp"
+
 
 namespace pamhd {
 
@@ -63,6 +67,8 @@ struct Solar_Wind_Box_Options
 		inner_magnetic_field{0, 0, 0};
 	std::vector<double> sw_nr_density, sw_pressure, sw_timestamps;
 	std::vector<std::array<double, 3>> sw_velocity, sw_magnetic_field;
+	//! upstream solar wind parameters as function of time
+	Solar_Wind_Driver solar_wind;
 
 
 	Solar_Wind_Box_Options() = default;
@@ -128,6 +134,126 @@ struct Solar_Wind_Box_Options
 		}
 		this->sw_dim = std::abs(this->sw_dir) - 1;
 
+		/*
+		Solar wind is either read from file or given as arrays of
+		parameters that are in effect until corresponding time stamp:
+		"timestamps": [t1, t2, ...], "number-density": [n0, n1, n2, ...]
+		*/
+		if (sw.HasMember("file")) {
+			const auto& file_json = sw["file"];
+			if (not file_json.IsString()) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "'solar-wind' item 'file' is not a string."
+				);
+			}
+			this->solar_wind.set_file(file_json.GetString(), true);
+		} else {
+			this->set_solar_wind_arrays(sw);
+		}
+
+		if (not object.HasMember("inner-boundary")) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "JSON data doesn't have an 'inner-boundary' key."
+			);
+		}
+		const auto& inner = object["inner-boundary"];
+		if (not inner.IsObject()) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "JSON item 'inner-boundary' isn't an object."
+			);
+		}
+
+		if (not inner.HasMember("radius")) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "'inner-boundary' doesn't have a 'radius' key."
+			);
+		}
+		const auto& r_json = inner["radius"];
+		if (not r_json.IsNumber()) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "'inner-boundary' item 'radius' is not a number."
+			);
+		}
+		this->inner_radius = r_json.GetDouble();
+
+		if (not inner.HasMember("number-density")) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "'inner-boundary' doesn't have a 'number-density' key."
+			);
+		}
+		const auto& n_json = inner["number-density"];
+		if (not n_json.IsNumber()) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "'inner-boundary' item 'number-density' is not a number."
+			);
+		}
+		this->inner_nr_density = n_json.GetDouble();
+
+		if (not inner.HasMember("pressure")) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "'inner-boundary' doesn't have a 'pressure' key."
+			);
+		}
+		const auto& p_json = inner["pressure"];
+		if (not p_json.IsNumber()) {
+			throw invalid_argument(
+				string(__FILE__ "(") + to_string(__LINE__) + "): "
+				+ "'inner-boundary' item 'pressure' is not a number."
+			);
+		}
+		this->inner_pressure = p_json.GetDouble();
+
+		if (inner.HasMember("velocity")) {
+			const auto& v_json = inner["velocity"];
+			if (not v_json.IsArray()) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "'inner-boundary' item 'velocity' is not an array."
+				);
+			}
+			this->inner_velocity = {
+				v_json[0].GetDouble(),
+				v_json[1].GetDouble(),
+				v_json[2].GetDouble()
+			};
+		}
+
+		if (inner.HasMember("magnetic-field")) {
+			const auto& b_json = inner["magnetic-field"];
+			if (not b_json.IsArray()) {
+				throw invalid_argument(
+					string(__FILE__ "(") + to_string(__LINE__) + "): "
+					+ "'inner-boundary' item 'magnetic-field' is not an array."
+				);
+			}
+			this->inner_magnetic_field = {
+				b_json[0].GetDouble(),
+				b_json[1].GetDouble(),
+				b_json[2].GetDouble()
+			};
+		}
+	}
+
+	//! Sets solar wind from parameter arrays of given JSON object
+	void set_solar_wind_arrays(const rapidjson::Value& sw) {
+		using std::invalid_argument;
+		using std::string;
+		using std::to_string;
+
+		this->sw_nr_density.clear();
+		this->sw_pressure.clear();
+		this->sw_timestamps.clear();
+		this->sw_velocity.clear();
+		this->sw_magnetic_field.clear();
+
 		if (not sw.HasMember("number-density")) {
 			throw invalid_argument(
 				string(__FILE__ "(") + to_string(__LINE__) + "): "
@@ -300,94 +426,18 @@ struct Solar_Wind_Box_Options
 			}
 		}
 
-		if (not object.HasMember("inner-boundary")) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "JSON data doesn't have an 'inner-boundary' key."
-			);
-		}
-		const auto& inner = object["inner-boundary"];
-		if (not inner.IsObject()) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "JSON item 'inner-boundary' isn't an object."
-			);
-		}
-
-		if (not inner.HasMember("radius")) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "'inner-boundary' doesn't have a 'radius' key."
-			);
-		}
-		const auto& r_json = inner["radius"];
-		if (not r_json.IsNumber()) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "'inner-boundary' item 'radius' is not a number."
-			);
-		}
-		this->inner_radius = r_json.GetDouble();
-
-		if (not inner.HasMember("number-density")) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "'inner-boundary' doesn't have a 'number-density' key."
-			);
-		}
-		const auto& n_json = inner["number-density"];
-		if (not n_json.IsNumber()) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "'inner-boundary' item 'number-density' is not a number."
-			);
-		}
-		this->inner_nr_density = n_json.GetDouble();
-
-		if (not inner.HasMember("pressure")) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "'inner-boundary' doesn't have a 'pressure' key."
-			);
-		}
-		const auto& p_json = inner["pressure"];
-		if (not p_json.IsNumber()) {
-			throw invalid_argument(
-				string(__FILE__ "(") + to_string(__LINE__) + "): "
-				+ "'inner-boundary' item 'pressure' is not a number."
-			);
-		}
-		this->inner_pressure = p_json.GetDouble();
-
-		if (inner.HasMember("velocity")) {
-			const auto& v_json = inner["velocity"];
-			if (not v_json.IsArray()) {
-				throw invalid_argument(
-					string(__FILE__ "(") + to_string(__LINE__) + "): "
-					+ "'inner-boundary' item 'velocity' is not an array."
-				);
-			}
-			this->inner_velocity = {
-				v_json[0].GetDouble(),
-				v_json[1].GetDouble(),
-				v_json[2].GetDouble()
-			};
-		}
-
-		if (inner.HasMember("magnetic-field")) {
-			const auto& b_json = inner["magnetic-field"];
-			if (not b_json.IsArray()) {
-				throw invalid_argument(
-					string(__FILE__ "(") + to_string(__LINE__) + "): "
-					+ "'inner-boundary' item 'magnetic-field' is not an array."
-				);
-			}
-			this->inner_magnetic_field = {
-				b_json[0].GetDouble(),
-				b_json[1].GetDouble(),
-				b_json[2].GetDouble()
-			};
+		std::vector<Solar_Wind_Record> records(this->sw_nr_density.size());
+		for (size_t i = 0; i < records.size(); i++) {
+			records[i].time
+				= i == 0
+				? std::numeric_limits<double>::lowest()
+				: this->sw_timestamps[i - 1];
+			records[i].nr_density = this->sw_nr_density[i];
+			records[i].pressure = this->sw_pressure[i];
+			records[i].velocity = this->sw_velocity[i];
+			records[i].magnetic_field = this->sw_magnetic_field[i];
 		}
+		this->solar_wind.set_records(std::move(records), false);
 	}
 };
 
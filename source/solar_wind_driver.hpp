@@ -0,0 +1,357 @@
+/*
+Time series of upstream solar wind parameters for PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_SOLAR_WIND_DRIVER_HPP
+#define PAMHD_SOLAR_WIND_DRIVER_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "cstdlib"
+#include "cstring"
+#include "fstream"
+#include "limits"
+#include "stdexcept"
+#include "string"
+#include "vector"
+
+
+namespace pamhd {
+
+
+//! Solar wind parameters in effect from given time onward.
+struct Solar_Wind_Record
+{
+	double time, nr_density, pressure;
+	std::array<double, 3> velocity, magnetic_field;
+};
+
+
+/*!
+Writes given records in binary format read by Solar_Wind_Driver.
+
+File starts with 8 characters "pamhdsw1" followed by records
+of 9 native doubles each: time, number density, velocity x, y, z,
+pressure, magnetic field x, y, z.
+*/
+inline void write_solar_wind_file(
+	const std::string& path,
+	const std::vector<Solar_Wind_Record>& records
+) {
+	std::ofstream file(path, std::ios::binary);
+	file.write("pamhdsw1", 8);
+	for (const auto& r: records) {
+		const std::array<double, 9> values{
+			r.time, r.nr_density,
+			r.velocity[0], r.velocity[1], r.velocity[2],
+			r.pressure,
+			r.magnetic_field[0], r.magnetic_field[1], r.magnetic_field[2]
+		};
+		file.write(reinterpret_cast<const char*>(values.data()), sizeof(values));
+	}
+	if (not file.good()) {
+		throw std::runtime_error(
+			std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+			+ "Couldn't write solar wind to " + path
+		);
+	}
+}
+
+
+/*!
+Provides solar wind parameters at any time.
+
+Records are either given to set_records() and kept in memory
+or read from a file given to set_file() in windows of at most
+window_size records, so that only records around current time
+are in memory. Time in files is expected to move mostly forward,
+going back before current window rereads file from beginning.
+
+Files whose name ends with .csv are text with one record per line
+in same order as in write_solar_wind_file(), values separated by
+commas and/or whitespace, empty lines and lines starting with #
+are ignored. Other files are in format of write_solar_wind_file().
+
+Parameters of record with largest time not larger than requested
+are returned, if interpolation is enabled they are interpolated
+linearly between that and next record. Parameters before first
+record are those of first record and after last those of last.
+*/
+class Solar_Wind_Driver
+{
+public:
+
+	static constexpr size_t window_size = 4096;
+
+
+	void set_records(std::vector<Solar_Wind_Record> given, const bool given_linear)
+	{
+		check_order(given, 0);
+		if (given.size() == 0) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "No solar wind records given"
+			);
+		}
+		this->file_path.clear();
+		this->linear = given_linear;
+		this->window = std::move(given);
+		this->window_at_start = this->at_end = true;
+	}
+
+
+	void set_file(const std::string& path, const bool given_linear)
+	{
+		this->file_path = path;
+		this->linear = given_linear;
+		this->csv
+			= path.size() >= 4
+			and path.compare(path.size() - 4, 4, ".csv") == 0;
+
+		std::ifstream file(path, std::ios::binary);
+		if (not file.good()) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Couldn't open solar wind file " + path
+			);
+		}
+		this->data_offset = 0;
+		if (not this->csv) {
+			std::array<char, 8> magic{};
+			file.read(magic.data(), magic.size());
+			if (not file.good() or std::memcmp(magic.data(), "pamhdsw1", 8) != 0) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ path + " isn't a solar wind file"
+				);
+			}
+			this->data_offset = 8;
+		}
+
+		this->rewind();
+		if (this->window.size() == 0) {
+			throw std::invalid_argument(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "No solar wind records in " + path
+			);
+		}
+	}
+
+
+	/*!
+	Returns solar wind parameters at given time.
+
+	Time of returned record is given time.
+	*/
+	Solar_Wind_Record get(const double& time) const
+	{
+		if (this->window.size() == 0) {
+			throw std::logic_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "No solar wind records"
+			);
+		}
+
+		if (time < this->window.front().time and not this->window_at_start) {
+			this->rewind();
+		}
+		while (not this->at_end and this->window.back().time <= time) {
+			this->slide();
+		}
+
+		const auto after = std::upper_bound(
+			this->window.cbegin(), this->window.cend(), time,
+			[](const double& t, const Solar_Wind_Record& r) {
+				return t < r.time;
+			}
+		);
+
+		Solar_Wind_Record ret_val;
+		if (after == this->window.cbegin()) {
+			ret_val = this->window.front();
+		} else if (after == this->window.cend() or not this->linear) {
+			ret_val = *(after - 1);
+		} else {
+			const auto& r0 = *(after - 1);
+			const auto& r1 = *after;
+			const double w1 = (time - r0.time) / (r1.time - r0.time), w0 = 1 - w1;
+			ret_val.nr_density = w0 * r0.nr_density + w1 * r1.nr_density;
+			ret_val.pressure = w0 * r0.pressure + w1 * r1.pressure;
+			for (size_t i = 0; i < 3; i++) {
+				ret_val.velocity[i] = w0 * r0.velocity[i] + w1 * r1.velocity[i];
+				ret_val.magnetic_field[i]
+					= w0 * r0.magnetic_field[i] + w1 * r1.magnetic_field[i];
+			}
+		}
+		ret_val.time = time;
+		return ret_val;
+	}
+
+
+	//! Returns records currently in memory
+	const std::vector<Solar_Wind_Record>& get_window() const
+	{
+		return this->window;
+	}
+
+
+private:
+
+	bool linear = false, csv = false;
+	std::string file_path;
+	std::streamoff data_offset = 0;
+
+	// records around latest requested time
+	mutable std::vector<Solar_Wind_Record> window;
+	// offset in file after last record of window
+	mutable std::streamoff window_end = 0;
+	mutable bool window_at_start = false, at_end = false;
+
+
+	static void check_order(
+		const std::vector<Solar_Wind_Record>& records,
+		const size_t first
+	) {
+		for (size_t i = std::max(first, size_t(1)); i < records.size(); i++) {
+			if (records[i - 1].time >= records[i].time) {
+				throw std::invalid_argument(
+					std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+					+ "Time of solar wind record " + std::to_string(i)
+					+ " isn't larger than of previous record"
+				);
+			}
+		}
+	}
+
+
+	void rewind() const
+	{
+		this->window.clear();
+		this->window_end = this->data_offset;
+		this->at_end = false;
+		this->read();
+		this->window_at_start = true;
+	}
+
+
+	//! Keeps last record of window and reads following ones
+	void slide() const
+	{
+		const auto last = this->window.back();
+		this->window.clear();
+		this->window.push_back(last);
+		this->read();
+		this->window_at_start = false;
+	}
+
+
+	//! Appends at most window_size records from file to window
+	void read() const
+	{
+		std::ifstream file(this->file_path, std::ios::binary);
+		file.seekg(this->window_end);
+		const size_t old_size = this->window.size();
+
+		if (this->csv) {
+			std::string line;
+			while (
+				this->window.size() < old_size + window_size
+				and std::getline(file, line)
+			) {
+				// tellg() fails after last line without newline
+				if (file.eof()) {
+					this->at_end = true;
+				} else {
+					this->window_end = file.tellg();
+				}
+				const auto first = line.find_first_not_of(" \t\r");
+				if (first == std::string::npos or line[first] == '#') {
+					continue;
+				}
+				std::array<double, 9> values;
+				const char* start = line.c_str();
+				for (auto& value: values) {
+					while (*start == ',' or *start == ' ' or *start == '\t') {
+						start++;
+					}
+					char* end = nullptr;
+					value = std::strtod(start, &end);
+					if (end == start) {
+						throw std::invalid_argument(
+							std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+							+ "Invalid line in " + this->file_path + ": " + line
+						);
+					}
+					start = end;
+				}
+				this->window.push_back(to_record(values));
+			}
+			if (this->window.size() < old_size + window_size) {
+				this->at_end = true;
+			}
+		} else {
+			std::vector<std::array<double, 9>> values(window_size);
+			file.read(
+				reinterpret_cast<char*>(values.data()),
+				values.size() * sizeof(values[0])
+			);
+			const size_t nr_read = size_t(file.gcount()) / sizeof(values[0]);
+			for (size_t i = 0; i < nr_read; i++) {
+				this->window.push_back(to_record(values[i]));
+			}
+			this->window_end += std::streamoff(nr_read * sizeof(values[0]));
+			if (nr_read < window_size) {
+				this->at_end = true;
+			}
+		}
+
+		check_order(this->window, old_size);
+	}
+
+
+	static Solar_Wind_Record to_record(const std::array<double, 9>& values)
+	{
+		Solar_Wind_Record r;
+		r.time = values[0];
+		r.nr_density = values[1];
+		r.velocity = {values[2], values[3], values[4]};
+		r.pressure = values[5];
+		r.magnetic_field = {values[6], values[7], values[8]};
+		return r;
+	}
+};
+
+
+} // namespace
+
+
+#endif // ifndef PAMHD_SOLAR_WIND_DRIVER_HPP
@@ -37,11 +37,15 @@ Author(s): Ilja Honkonen
 #define PAMHD_SUBSTEPPING_HPP
 
 
+#include "algorithm"
+#include "array"
 #include "cmath"
 #include "limits"
 #include "string"
+#include "vector"
 
 #include "mhd/options.hpp"
+#include "grid/halo_exchange.hpp"
 #include "common_variables.hpp"
 
 
@@ -127,12 +131,7 @@ template <
 		Substep.data(*cell.data) = Substep_Max.data(*cell.data);
 	}
 
-	if (SInfo.type().is_stale) {
-		Cell::set_transfer_all(true, SInfo.type());
-		grid.update_copies_of_remote_neighbors();
-		Cell::set_transfer_all(false, SInfo.type());
-		SInfo.type().is_stale = false;
-	}
+	pamhd::grid::Halo_Exchange<Cell>::update(grid, SInfo);
 
 	auto comm = grid.get_communicator();
 	Cell::set_transfer_all(true, Substep.type());
@@ -190,7 +189,9 @@ template <
 Sets min and max substepping periods based on geometry.
 
 Offsets minimum substep so that at it will be 0 in at
-least one cell.
+least one cell. If offset_substep_min is false offset is
+left to the other set_minmax_substepping_period() which
+does it without a separate reduction.
 
 Assumes that substep is stored in 2^N format.
 */
@@ -204,32 +205,59 @@ template <
 	Grid& grid,
 	Options& options,
 	const Substep_Min_Getter Substep_Min,
-	const Substep_Max_Getter Substep_Max
+	const Substep_Max_Getter Substep_Max,
+	const bool offset_substep_min = true
 ) try {
+	// evaluate expressions for all cells at once
+	std::vector<double> x, y, z, r, lat, lon;
+	std::vector<int> substep_min, substep_max;
+	if (options.substep_min_i < 0 or options.substep_max_i < 0) {
+		for (const auto& cell: grid.local_cells()) {
+			const auto c = grid.geometry.get_center(cell.id);
+			x.push_back(c[0]);
+			y.push_back(c[1]);
+			z.push_back(c[2]);
+			r.push_back(std::sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]));
+			lat.push_back(std::asin(c[2] / r.back()));
+			lon.push_back(std::atan2(c[1], c[0]));
+		}
+	}
+	if (options.substep_min_i < 0) {
+		substep_min.resize(x.size());
+		options.substep_min_e.evaluate(
+			x.size(), time, x.data(), y.data(), z.data(),
+			r.data(), lat.data(), lon.data(), substep_min.data());
+	}
+	if (options.substep_max_i < 0) {
+		substep_max.resize(x.size());
+		options.substep_max_e.evaluate(
+			x.size(), time, x.data(), y.data(), z.data(),
+			r.data(), lat.data(), lon.data(), substep_max.data());
+	}
+
 	int min_substep_min_local = std::numeric_limits<int>::max();
+	size_t cell_i = 0;
 	for (const auto& cell: grid.local_cells()) {
-		const auto c = grid.geometry.get_center(cell.id);
-		const auto
-			r = std::sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]),
-			lat = std::asin(c[2] / r),
-			lon = std::atan2(c[1], c[0]);
 		if (options.substep_min_i >= 0) {
 			Substep_Min.data(*cell.data) = options.substep_min_i;
 		} else {
-			Substep_Min.data(*cell.data) = options.substep_min_e.evaluate(
-				time, c[0], c[1], c[2], r, lat, lon);
+			Substep_Min.data(*cell.data) = substep_min[cell_i];
 		}
 		if (options.substep_max_i >= 0) {
 			Substep_Max.data(*cell.data) = options.substep_max_i;
 		} else {
-			Substep_Max.data(*cell.data) = options.substep_max_e.evaluate(
-				time, c[0], c[1], c[2], r, lat, lon);
+			Substep_Max.data(*cell.data) = substep_max[cell_i];
 		}
 		min_substep_min_local = std::min(Substep_Min.data(*cell.data), min_substep_min_local);
+		cell_i++;
 	}
 	Substep_Max.type().is_stale = true;
 	Substep_Min.type().is_stale = true;
 
+	if (not offset_substep_min) {
+		return;
+	}
+
 	int min_substep_min_global = std::numeric_limits<int>::max();
 	auto comm = grid.get_communicator();
 	if (
@@ -267,6 +295,9 @@ Assumes substep is in 2^N format indicating period of solving
 a cell, or in other words, indicating length of cell's timestep
 in substeps.
 
+Offsets minimum substep so that it will be 0 in at least
+one cell, as the geometric set_minmax_substepping_period().
+
 If max_dt is smaller than smallest allowed timestep (including
 dt_factor) in any cell, returns max_dt and sets substep range
 to [0, 0] in all cells.
@@ -299,25 +330,31 @@ template <
 	Substep_Max.type().is_stale = true;
 	Substep_Min.type().is_stale = true;
 
-	// calculate range of dts allowed in cells
-	double
-		smallest_dt_local = numeric_limits<double>::max(),
-		largest_dt_local = 0;
-
+	/*
+	Smallest dt, minimum substep length and smallest minimum
+	substep in one reduction, second is only used if
+	max_dt > smallest dt
+	*/
+	std::array<double, 3> smallest{
+		numeric_limits<double>::max(),
+		numeric_limits<double>::max(),
+		numeric_limits<double>::max()
+	};
 	for (const auto& cell: grid.local_cells()) {
+		smallest[2] = min(smallest[2], double(Substep_Min.data(*cell.data)));
 		if (SInfo.data(*cell.data) < 0) {
 			continue;
 		}
-		smallest_dt_local = min(Timestep.data(*cell.data), smallest_dt_local);
-		largest_dt_local = max(Timestep.data(*cell.data), largest_dt_local);
+		smallest[0] = min(Timestep.data(*cell.data), smallest[0]);
+		smallest[1] = min(smallest[1],
+			Timestep.data(*cell.data) / (1 << Substep_Min.data(*cell.data)));
 	}
 	auto comm = grid.get_communicator();
-	double smallest_dt_global = -1;
 	if (
 		MPI_Allreduce(
-			&smallest_dt_local,
-			&smallest_dt_global,
-			1,
+			MPI_IN_PLACE,
+			smallest.data(),
+			3,
 			MPI_DOUBLE,
 			MPI_MIN,
 			comm
@@ -327,43 +364,28 @@ template <
 			<< "): Couldn't reduce smallest_dt." << endl;
 		abort();
 	}
+	MPI_Comm_free(&comm);
+
+	// substep lengths are relative to offset minimum substeps
+	int substep_min_offset = 0;
+	if (smallest[2] > 0 and smallest[2] < numeric_limits<int>::max()) {
+		substep_min_offset = int(smallest[2]);
+		for (const auto& cell: grid.local_cells()) {
+			Substep_Min.data(*cell.data) -= substep_min_offset;
+		}
+	}
+	const double
+		smallest_dt_global = smallest[0],
+		ret_val_global = std::ldexp(smallest[1], substep_min_offset);
 
 	if (max_dt <= smallest_dt_global) {
 		for (const auto& cell: grid.local_cells()) {
 			Substep_Max.data(*cell.data) =
 			Substep_Min.data(*cell.data) = 0;
 		}
-		MPI_Comm_free(&comm);
 		return max_dt;
 	}
 
-	// minimum substep length
-	double ret_val_local = numeric_limits<double>::max();
-	for (const auto& cell: grid.local_cells()) {
-		if (SInfo.data(*cell.data) < 0) {
-			continue;
-		}
-		ret_val_local = min(ret_val_local,
-			Timestep.data(*cell.data) / (1 << Substep_Min.data(*cell.data)));
-	}
-
-	double ret_val_global = numeric_limits<double>::max();
-	if (
-		MPI_Allreduce(
-			&ret_val_local,
-			&ret_val_global,
-			1,
-			MPI_DOUBLE,
-			MPI_MIN,
-			comm
-		) != MPI_SUCCESS
-	) {
-		cerr << __FILE__ "(" << __LINE__
-			<< "): Couldn't reduce ret_val." << endl;
-		abort();
-	}
-	MPI_Comm_free(&comm);
-
 	// decrease too large max substep periods
 	for (const auto& cell: grid.local_cells()) {
 		if (SInfo.data(*cell.data) < 0) {
@@ -0,0 +1,295 @@
+/*
+Timers of simulation phases of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PAMHD_TIMERS_HPP
+#define PAMHD_TIMERS_HPP
+
+
+#include "chrono"
+#include "cstdint"
+#include "fstream"
+#include "functional"
+#include "iomanip"
+#include "map"
+#include "ostream"
+#include "set"
+#include "sstream"
+#include "stdexcept"
+#include "string"
+#include "string_view"
+#include "vector"
+
+#include "mpi.h"
+
+
+namespace pamhd {
+
+
+/*!
+Wall clock time spent in named phases of simulation.
+
+Time is recorded by Timer objects only if enabled is true,
+otherwise instrumentation costs one branch per phase.
+report() combines times of all processes and clears them
+so each report covers time since previous report.
+
+Phase names should not contain quotes or backslashes and
+must outlive Timers, e.g. string literals, as they're stored
+without copying so that recording a phase doesn't allocate.
+
+Example:
+\verbatim
+pamhd::Timers::enabled = true;
+...
+{
+	pamhd::Timer timer("mhd.fluxes");
+	pamhd::mhd::get_fluxes(...);
+}
+...
+pamhd::Timers::report(comm, simulation_time, std::cout, "timers.json");
+\endverbatim
+*/
+class Timers
+{
+public:
+
+	//! whether Timer objects record time
+	inline static bool enabled = false;
+
+	struct Phase {
+		double time = 0;
+		uint64_t calls = 0;
+	};
+
+	//! Adds given number of seconds to given phase, see name requirements above.
+	static void add(const std::string_view name, const double seconds)
+	{
+		auto& phase = phases[name];
+		phase.time += seconds;
+		phase.calls++;
+	}
+
+	//! Returns phases recorded on this process since last report.
+	static const std::map<std::string_view, Phase, std::less<>>& get()
+	{
+		return phases;
+	}
+
+	static void clear()
+	{
+		phases.clear();
+	}
+
+	/*!
+	Reports time spent in phases since last report.
+
+	Must be called by all processes of given communicator.
+	Rank 0 writes minimum, maximum and mean time of each
+	phase over processes to output and, if json_path isn't
+	empty, rewrites json_path with all reports made so far.
+	*/
+	static void report(
+		MPI_Comm comm,
+		const double simulation_time,
+		std::ostream& output,
+		const std::string& json_path = ""
+	) {
+		int rank = 0, comm_size = 0;
+		MPI_Comm_rank(comm, &rank);
+		MPI_Comm_size(comm, &comm_size);
+
+		// union of phase names over processes
+		std::string local_names;
+		for (const auto& item: phases) {
+			local_names += item.first;
+			local_names += '\n';
+		}
+		int local_size = int(local_names.size());
+		std::vector<int> sizes(comm_size), displs(comm_size);
+		MPI_Allgather(&local_size, 1, MPI_INT, sizes.data(), 1, MPI_INT, comm);
+		int total_size = 0;
+		for (int i = 0; i < comm_size; i++) {
+			displs[i] = total_size;
+			total_size += sizes[i];
+		}
+		std::string all_names(total_size, '\n');
+		MPI_Allgatherv(
+			local_names.data(), local_size, MPI_CHAR,
+			all_names.data(), sizes.data(), displs.data(), MPI_CHAR,
+			comm
+		);
+		std::set<std::string> names;
+		std::istringstream name_stream(all_names);
+		for (std::string name; std::getline(name_stream, name); ) {
+			if (name.size() > 0) {
+				names.insert(name);
+			}
+		}
+
+		// times followed by numbers of calls
+		const size_t nr_phases = names.size();
+		std::vector<double>
+			local(2 * nr_phases, 0),
+			min(2 * nr_phases, 0),
+			max(2 * nr_phases, 0),
+			sum(2 * nr_phases, 0);
+		size_t i = 0;
+		for (const auto& name: names) {
+			const auto iter = phases.find(name);
+			if (iter != phases.end()) {
+				local[i] = iter->second.time;
+				local[nr_phases + i] = double(iter->second.calls);
+			}
+			i++;
+		}
+		MPI_Reduce(local.data(), min.data(), int(local.size()), MPI_DOUBLE, MPI_MIN, 0, comm);
+		MPI_Reduce(local.data(), max.data(), int(local.size()), MPI_DOUBLE, MPI_MAX, 0, comm);
+		MPI_Reduce(local.data(), sum.data(), int(local.size()), MPI_DOUBLE, MPI_SUM, 0, comm);
+		phases.clear();
+
+		if (rank != 0) {
+			return;
+		}
+
+		std::ostringstream table, json;
+		table << "Time (s) in phases over " << comm_size
+			<< " process(es) at simulation time " << simulation_time << ":\n"
+			<< std::left << std::setw(32) << "phase" << std::right
+			<< std::setw(10) << "calls"
+			<< std::setw(13) << "min"
+			<< std::setw(13) << "max"
+			<< std::setw(13) << "mean" << "\n";
+		json << std::setprecision(9)
+			<< "{\"simulation-time\": " << simulation_time
+			<< ", \"processes\": " << comm_size
+			<< ", \"phases\": {";
+		i = 0;
+		for (const auto& name: names) {
+			const double mean = sum[i] / comm_size;
+			table << std::left << std::setw(32) << name << std::right
+				<< std::setw(10) << uint64_t(max[nr_phases + i])
+				<< std::scientific << std::setprecision(4)
+				<< std::setw(13) << min[i]
+				<< std::setw(13) << max[i]
+				<< std::setw(13) << mean << "\n"
+				<< std::defaultfloat;
+			if (i > 0) {
+				json << ", ";
+			}
+			json << "\"" << name << "\": {"
+				<< "\"calls\": " << uint64_t(max[nr_phases + i])
+				<< ", \"min\": " << min[i]
+				<< ", \"max\": " << max[i]
+				<< ", \"mean\": " << mean << "}";
+			i++;
+		}
+		json << "}}";
+		output << table.str() << std::flush;
+
+		if (json_path == "") {
+			return;
+		}
+		json_reports.push_back(json.str());
+		std::ofstream json_file(json_path);
+		if (not json_file.good()) {
+			throw std::runtime_error(
+				std::string(__FILE__ "(") + std::to_string(__LINE__) + "): "
+				+ "Couldn't open " + json_path + " for writing"
+			);
+		}
+		json_file << "[\n";
+		for (size_t j = 0; j < json_reports.size(); j++) {
+			json_file << json_reports[j]
+				<< (j + 1 < json_reports.size() ? ",\n" : "\n");
+		}
+		json_file << "]\n";
+	}
+
+
+private:
+
+	inline static std::map<std::string_view, Phase, std::less<>> phases;
+	//! reports written to json file so far
+	inline static std::vector<std::string> json_reports;
+};
+
+
+/*!
+Records time from construction until stop() or destruction
+into given phase of Timers if they're enabled.
+*/
+class Timer
+{
+public:
+
+	Timer(const char* given_name) :
+		name(given_name)
+	{
+		if (Timers::enabled) {
+			this->running = true;
+			this->start = std::chrono::steady_clock::now();
+		}
+	}
+
+	Timer(const Timer& other) = delete;
+	Timer& operator=(const Timer& other) = delete;
+
+	~Timer()
+	{
+		this->stop();
+	}
+
+	//! Records time of phase, later calls do nothing.
+	void stop()
+	{
+		if (not this->running) {
+			return;
+		}
+		this->running = false;
+		const std::chrono::duration<double> elapsed
+			= std::chrono::steady_clock::now() - this->start;
+		Timers::add(this->name, elapsed.count());
+	}
+
+
+private:
+
+	const char* name;
+	bool running = false;
+	std::chrono::steady_clock::time_point start;
+};
+
+
+} // namespace
+
+
+#endif // ifndef PAMHD_TIMERS_HPP
@@ -32,13 +32,52 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "array"
+#include "cmath"
 #include "cstdlib"
 #include "iostream"
+#include "map"
 #include "set"
+#include "string"
+#include "vector"
 
 #include "boundaries/geometries.hpp"
 
 
+// minimal stand-in for dccrg
+struct Grid {
+	std::map<unsigned int, double> data;
+
+	double* operator[](const unsigned int cell)
+	{
+		if (this->data.count(cell) == 0) {
+			return nullptr;
+		}
+		return &this->data.at(cell);
+	}
+
+	struct {
+		std::array<double, 3> get_center(const unsigned int cell) const
+		{
+			return {0, double(cell), double(cell)};
+		}
+		std::array<double, 3> get_min(const unsigned int cell) const
+		{
+			const auto c = this->get_center(cell);
+			return {c[0] - 0.25, c[1] - 0.25, c[2] - 0.25};
+		}
+		std::array<double, 3> get_max(const unsigned int cell) const
+		{
+			const auto c = this->get_center(cell);
+			return {c[0] + 0.25, c[1] + 0.25, c[2] + 0.25};
+		}
+	} geometry;
+};
+
+struct Cell_Item {
+	unsigned int id;
+};
+
+
 int main()
 {
 	const char json[] = "{"
@@ -70,7 +109,8 @@ int main()
 		unsigned int,
 		std::array<double, 3>,
 		double,
-		unsigned int
+		unsigned int,
+		double
 	> geometries;
 	geometries.set(document);
 
@@ -153,5 +193,169 @@ int main()
 	}
 
 
+	Grid grid;
+	for (unsigned int cell = 1; cell <= 5; cell++) {
+		grid.data[cell] = 10 * cell;
+	}
+	geometries.update_cell_info(grid);
+	const auto& infos0 = geometries.get_cell_info(0);
+	if (infos0.size() != cells0.size()) {
+		std::cerr << "Wrong number of cell infos in geometry 0: "
+			<< infos0.size() << ", should be " << cells0.size()
+			<< std::endl;
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < infos0.size(); i++) {
+		const auto& info = infos0[i];
+		if (
+			info.id != cells0[i]
+			or info.data != grid[info.id]
+			or *info.data != 10 * info.id
+			or info.center[1] != info.id
+			or std::abs(info.r - std::sqrt(2) * info.id) > 1e-10
+			or std::abs(info.lat - std::asin(1 / std::sqrt(2))) > 1e-10
+			or std::abs(info.lon - std::atan2(1, 0)) > 1e-10
+		) {
+			std::cerr << "Wrong cell info for cell " << info.id
+				<< " of geometry 0" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	geometries.overlaps({0.1, 0.1, 0.1}, {0.2, 0.2, 0.2}, 6);
+	try {
+		geometries.get_cell_info(0);
+		std::cerr << "Stale cell info wasn't detected." << std::endl;
+		return EXIT_FAILURE;
+	} catch (const std::out_of_range&) {}
+
+
+	// bulk classification
+	grid.data.clear();
+	std::vector<Cell_Item> cell_items;
+	for (unsigned int cell = 1; cell <= 10; cell++) {
+		grid.data[cell] = cell;
+		cell_items.push_back({cell});
+	}
+	// of cells 1..10 only 1 overlaps any geometry
+	geometries.classify(grid, cell_items);
+	if (geometries.get_cells(0) != std::vector<unsigned int>{1}) {
+		std::cerr << "Wrong cells in geometry 0 after classify()" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (geometries.get_cells(1).size() > 0 or geometries.get_cells(2).size() > 0) {
+		std::cerr << "Wrong cells in geometries 1 or 2 after classify()" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (geometries.get_cell_info(0).size() != 1) {
+		std::cerr << "Cell info not updated by classify()" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// grid change with same number of cells
+	geometries.invalidate_cell_info();
+	try {
+		geometries.get_cell_info(0);
+		std::cerr << "Cell info wasn't invalidated." << std::endl;
+		return EXIT_FAILURE;
+	} catch (const std::out_of_range&) {}
+	if (geometries.get_cell_info(1).size() > 0) {
+		std::cerr << "Cell info of empty geometry not empty" << std::endl;
+		return EXIT_FAILURE;
+	}
+	geometries.update_cell_info(grid);
+	if (geometries.get_cell_info(0).size() != 1) {
+		std::cerr << "Cell info not updated after invalidation" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+
+	// compare index with brute force over many geometries
+	std::string many_json = "{\"geometries\": [";
+	for (int i = 0; i < 100; i++) {
+		const double x = (i * 37) % 100 - 50, y = (i * 53) % 100 - 50, z = (i * 71) % 100 - 50;
+		if (i > 0) {
+			many_json += ",";
+		}
+		if (i % 3 == 0) {
+			many_json += "{\"sphere\": {\"center\": ["
+				+ std::to_string(x) + "," + std::to_string(y) + "," + std::to_string(z)
+				+ "], \"radius\": " + std::to_string(1 + i % 7) + "}}";
+		} else {
+			many_json += "{\"box\": {\"start\": ["
+				+ std::to_string(x) + "," + std::to_string(y) + "," + std::to_string(z)
+				+ "], \"end\": ["
+				+ std::to_string(x + 1 + i % 5) + "," + std::to_string(y + 2) + "," + std::to_string(z + 3)
+				+ "]}}";
+		}
+	}
+	many_json += "]}";
+	rapidjson::Document many_document;
+	many_document.Parse(many_json.c_str());
+	if (many_document.HasParseError()) {
+		std::cerr << "Couldn't parse json data: " << many_json << std::endl;
+		return EXIT_FAILURE;
+	}
+	pamhd::boundaries::Geometries<
+		unsigned int,
+		std::array<double, 3>,
+		double,
+		unsigned int
+	> many;
+	many.set(many_document);
+	const auto& json_many = many_document["geometries"];
+	std::map<unsigned int, pamhd::boundaries::Box<std::array<double, 3>, unsigned int>> ref_boxes;
+	std::map<unsigned int, pamhd::boundaries::Sphere<std::array<double, 3>, double, unsigned int>> ref_spheres;
+	for (unsigned int gid = 0; gid < json_many.Size(); gid++) {
+		if (json_many[gid].HasMember("box")) {
+			ref_boxes[gid].set_geometry(json_many[gid]["box"]);
+		} else {
+			ref_spheres[gid].set_geometry(json_many[gid]["sphere"]);
+		}
+	}
+
+	std::vector<unsigned int> overlapping;
+	unsigned int nr_overlaps = 0;
+	for (int i = 0; i < 20000; i++) {
+		const std::array<double, 3>
+			start{
+				double((i * 7919LL) % 110 - 55) / 1.1,
+				double((i * 104729LL) % 110 - 55) / 1.1,
+				double((i * 1299709LL) % 110 - 55) / 1.1
+			},
+			end{start[0] + 1.5, start[1] + 0.5, start[2] + 2.5};
+
+		many.overlaps(start, end, i, overlapping);
+
+		std::vector<unsigned int> reference;
+		for (unsigned int gid = 0; gid < json_many.Size(); gid++) {
+			if (
+				(ref_boxes.count(gid) > 0 and ref_boxes.at(gid).overlaps(start, end, i))
+				or (ref_spheres.count(gid) > 0 and ref_spheres.at(gid).overlaps(start, end, i))
+			) {
+				reference.push_back(gid);
+			}
+		}
+		if (overlapping != reference) {
+			std::cerr << "Index and brute force disagree for volume " << i << std::endl;
+			return EXIT_FAILURE;
+		}
+		nr_overlaps += overlapping.size();
+	}
+	if (nr_overlaps == 0) {
+		std::cerr << "No volume overlapped any geometry." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// copy must have its own index
+	auto many_copy = many;
+	many_copy.overlaps({-99, -99, -99}, {99, 99, 99}, 1, overlapping);
+	if (overlapping.size() != json_many.Size()) {
+		std::cerr << "Copy overlapped with " << overlapping.size()
+			<< " geometries instead of " << json_many.Size() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,212 @@
+/*
+Tests interpolated point cloud data of boundaries of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdio"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "boundaries/point_cloud.hpp"
+#include "boundaries/value_boundary.hpp"
+
+
+using namespace pamhd::boundaries;
+
+
+struct Mass_Density {
+	using data_type = double;
+	static const std::string get_name(){ return {"mass density"}; }
+};
+
+struct Momentum_Density {
+	using data_type = std::array<double, 2>;
+	static const std::string get_name(){ return {"momentum density"}; }
+};
+
+struct Nr_Particles {
+	using data_type = int;
+	static const std::string get_name(){ return {"number of particles"}; }
+};
+
+double linear_function(const double x, const double y, const double z, const double t)
+{
+	return 1 + 2*x - 3*y + 0.5*z + 0.25*t;
+}
+
+int main()
+{
+	// linear function is reproduced exactly inside grid
+	const std::array<std::vector<double>, 3> coordinates{
+		std::vector<double>{-1, 0, 2, 5},
+		std::vector<double>{0, 1, 1.5},
+		std::vector<double>{-3, 3}
+	};
+	const std::vector<double> time_stamps{0, 1, 3, 4, 10};
+	std::vector<double> data;
+	for (const auto& t: time_stamps)
+	for (const auto& z: coordinates[2])
+	for (const auto& y: coordinates[1])
+	for (const auto& x: coordinates[0]) {
+		data.push_back(linear_function(x, y, z, t));
+	}
+
+	Point_Cloud<Mass_Density> memory;
+	memory.set(coordinates, 1, time_stamps, data, true);
+
+	const std::string file_name = "point_cloud_test.dat";
+	write_point_cloud_file(file_name, coordinates, 1, time_stamps, data);
+	Point_Cloud<Mass_Density> streamed;
+	streamed.set_file(file_name, true);
+
+	// go back and forth in time with same positions
+	for (const double t: {0.5, 2.0, 3.5, 0.0, 9.99, 1.0, 1.25}) {
+		for (int i = 0; i < 50; i++) {
+			const double
+				x = -1 + 6 * std::fmod(i * 0.618034, 1.0),
+				y = 1.5 * std::fmod(i * 0.414214, 1.0),
+				z = -3 + 6 * std::fmod(i * 0.732051, 1.0),
+				correct = linear_function(x, y, z, t),
+				from_memory = memory.get_data(t, x, y, z, 0, 0, 0),
+				from_file = streamed.get_data(t, x, y, z, 0, 0, 0);
+			if (std::abs(from_memory - correct) > 1e-10) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value at "
+					<< x << ", " << y << ", " << z << ", " << t << ": "
+					<< from_memory << ", should be " << correct << std::endl;
+				return EXIT_FAILURE;
+			}
+			if (from_file != from_memory) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): Value from file "
+					<< from_file << " differs from " << from_memory << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	// values outside of grid and time stamps are those of nearest edge
+	const double outside = memory.get_data(20, 7, -1, 0, 0, 0, 0);
+	if (std::abs(outside - linear_function(5, 0, 0, 10)) > 1e-10) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value outside of grid: "
+			<< outside << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// copies don't use slices of original at same time
+	std::vector<Point_Cloud<Mass_Density>> copies(2, memory);
+	copies.push_back(streamed);
+	// release data of originals
+	memory = Point_Cloud<Mass_Density>();
+	streamed = Point_Cloud<Mass_Density>();
+	for (auto& copy: copies) {
+		const double from_copy = copy.get_data(20, 7, -1, 0, 0, 0, 0);
+		if (from_copy != outside) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value from copy: "
+				<< from_copy << ", should be " << outside << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+
+	// file and linear interpolation from json
+	const std::string json = "["
+		"{"
+			"\"geometry-id\": 1,"
+			"\"values\": {\"file\": \"" + file_name + "\", \"interpolation\": \"linear\"}"
+		"},"
+		"{"
+			"\"geometry-id\": 2,"
+			"\"time-stamps\": [0, 2],"
+			"\"values\": {"
+				"\"x\": [0, 1],"
+				"\"y\": [0],"
+				"\"z\": [0],"
+				"\"data\": [[0, 0], [1, -1], [10, -10], [11, -11]],"
+				"\"interpolation\": \"linear\""
+			"}"
+		"},"
+		"{"
+			"\"geometry-id\": 3,"
+			"\"time-stamps\": [0],"
+			"\"values\": {"
+				"\"x\": [0, 1],"
+				"\"y\": [0],"
+				"\"z\": [0],"
+				"\"data\": [3, 4],"
+				"\"interpolation\": \"linear\""
+			"}"
+		"}"
+	"]";
+
+	rapidjson::Document document;
+	document.Parse(json.c_str());
+	if (document.HasParseError()) {
+		std::cerr << "Couldn't parse json data: " << json << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Value_Boundary<unsigned int, Mass_Density> bdy0;
+	bdy0.set(document[0]);
+	const double mass = bdy0.get_data(2, 0.5, 0.5, 0, 0, 0, 0);
+	if (std::abs(mass - linear_function(0.5, 0.5, 0, 2)) > 1e-10) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value for variable: "
+			<< mass << ", should be " << linear_function(0.5, 0.5, 0, 2)
+			<< std::endl;
+		return EXIT_FAILURE;
+	}
+	std::remove(file_name.c_str());
+
+	Value_Boundary<unsigned int, Momentum_Density> bdy1;
+	bdy1.set(document[1]);
+	const auto momentum = bdy1.get_data(0.5, 0.25, 0, 0, 0, 0, 0);
+	if (
+		std::abs(momentum[0] - 2.75) > 1e-10
+		or std::abs(momentum[1] + 2.75) > 1e-10
+	) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value for variable: "
+			<< momentum[0] << ", " << momentum[1] << ", should be 2.75, -2.75"
+			<< std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// integers can't be interpolated
+	Value_Boundary<unsigned int, Nr_Particles> bdy2;
+	try {
+		bdy2.set(document[2]);
+		std::cerr << __FILE__ "(" << __LINE__ << "): Interpolation of integers accepted"
+			<< std::endl;
+		return EXIT_FAILURE;
+	} catch (const std::invalid_argument&) {}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/*
+Tests solar wind driver of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "cmath"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "solar_wind_driver.hpp"
+
+
+using namespace pamhd;
+
+
+Solar_Wind_Record make_record(const double t)
+{
+	Solar_Wind_Record r;
+	r.time = t;
+	r.nr_density = 1e6 + 10 * t;
+	r.pressure = 1e-11 * (1 + t);
+	r.velocity = {-4e5 + t, 2 * t, -t};
+	r.magnetic_field = {0, 1e-9 * t, -1e-9};
+	return r;
+}
+
+bool is_close(const Solar_Wind_Record& a, const Solar_Wind_Record& b)
+{
+	auto close = [](const double x, const double y) {
+		return std::abs(x - y) <= 1e-12 * std::max(std::abs(x), std::abs(y));
+	};
+	bool ret_val = close(a.nr_density, b.nr_density) and close(a.pressure, b.pressure);
+	for (size_t i = 0; i < 3; i++) {
+		ret_val = ret_val
+			and close(a.velocity[i], b.velocity[i])
+			and close(a.magnetic_field[i], b.magnetic_field[i]);
+	}
+	return ret_val;
+}
+
+int main()
+{
+	// piecewise constant records in memory
+	Solar_Wind_Driver constant;
+	constant.set_records({make_record(-1e300), make_record(10), make_record(20)}, false);
+	for (const auto& [time, record_time]: std::vector<std::array<double, 2>>{
+		{-5, -1e300}, {9.99, -1e300}, {10, 10}, {15, 10}, {20, 20}, {1e9, 20}
+	}) {
+		if (not is_close(constant.get(time), make_record(record_time))) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): Wrong solar wind at time "
+				<< time << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+
+	// same records in binary and csv files, interpolated
+	std::vector<Solar_Wind_Record> records;
+	for (size_t i = 0; i < 3 * Solar_Wind_Driver::window_size + 7; i++) {
+		records.push_back(make_record(60.0 * i));
+	}
+	const std::string bin_name = "solar_wind_driver_test.dat", csv_name = "solar_wind_driver_test.csv";
+	write_solar_wind_file(bin_name, records);
+	{
+		std::ofstream csv(csv_name);
+		csv << "# time, n, vx, vy, vz, p, bx, by, bz\n\n";
+		csv.precision(17);
+		for (const auto& r: records) {
+			csv << r.time << ", " << r.nr_density << ", "
+				<< r.velocity[0] << ", " << r.velocity[1] << ", " << r.velocity[2] << ", "
+				<< r.pressure << ", " << r.magnetic_field[0] << " "
+				<< r.magnetic_field[1] << "\t" << r.magnetic_field[2] << "\n";
+		}
+	}
+
+	Solar_Wind_Driver binary, text;
+	binary.set_file(bin_name, true);
+	text.set_file(csv_name, true);
+
+	// forward in time, back to start and past end
+	const double end_time = records.back().time;
+	std::vector<double> times;
+	for (double t = -100; t < end_time + 100; t += 17.5) {
+		times.push_back(t);
+	}
+	times.push_back(30);
+	times.push_back(end_time / 2);
+	for (const auto& t: times) {
+		const auto correct = make_record(std::max(0.0, std::min(end_time, t)));
+		for (const auto* driver: {&binary, &text}) {
+			if (not is_close(driver->get(t), correct)) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): Wrong solar wind at time "
+					<< t << std::endl;
+				return EXIT_FAILURE;
+			}
+			if (driver->get_window().size() > Solar_Wind_Driver::window_size + 1) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): Too many records in memory: "
+					<< driver->get_window().size() << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	// last line of csv file without newline ends a full window
+	records.resize(2 * Solar_Wind_Driver::window_size);
+	{
+		std::ofstream csv(csv_name);
+		csv.precision(17);
+		for (size_t i = 0; i < records.size(); i++) {
+			const auto& r = records[i];
+			if (i > 0) {
+				csv << "\n";
+			}
+			csv << r.time << ", " << r.nr_density << ", "
+				<< r.velocity[0] << ", " << r.velocity[1] << ", " << r.velocity[2] << ", "
+				<< r.pressure << ", " << r.magnetic_field[0] << ", "
+				<< r.magnetic_field[1] << ", " << r.magnetic_field[2];
+		}
+	}
+	Solar_Wind_Driver no_newline;
+	no_newline.set_file(csv_name, true);
+	const double last_time = records.back().time;
+	for (const auto& t: {0.0, last_time / 2, last_time - 30, last_time, last_time + 100, 30.0}) {
+		const auto correct = make_record(std::max(0.0, std::min(last_time, t)));
+		if (not is_close(no_newline.get(t), correct)) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): Wrong solar wind at time "
+				<< t << " from csv file without final newline" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::remove(bin_name.c_str());
+	std::remove(csv_name.c_str());
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,283 @@
+/*
+Tests sparse cell data of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "algorithm"
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "stdexcept"
+#include "string"
+#include "vector"
+
+#include "dccrg.hpp"
+#include "dccrg_no_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell.hpp
+#include "gensimcell.hpp"
+
+#include "boundaries/sparse_cell_data.hpp"
+
+
+struct Dense {
+	using data_type = int;
+};
+
+struct Sparse1 {
+	using data_type = double;
+};
+
+struct Sparse2 {
+	using data_type = std::array<double, 3>;
+};
+
+using Cell = gensimcell::Cell<gensimcell::Optional_Transfer, Dense>;
+using Grid = dccrg::Dccrg<Cell, dccrg::No_Geometry>;
+
+//! Every fourth cell is in boundary geometry
+struct Geometries {
+	std::vector<uint64_t> cells;
+	std::vector<int> get_geometry_ids() const { return {0}; }
+	const std::vector<uint64_t>& get_cells(const int) const { return this->cells; }
+};
+
+pamhd::boundaries::Sparse_Cell_Data<Cell, Sparse1, Sparse2> bdy_data;
+const auto S1 = bdy_data.getter<Sparse1>();
+const auto S2 = bdy_data.getter<Sparse2>();
+
+//! Returns true if every local cell in boundary has expected data
+bool check(Grid& grid)
+{
+	uint64_t local_ok = 1, ok = 0;
+	size_t nr_bdy = 0;
+	for (const auto& cell: grid.local_cells()) {
+		if (cell.id % 4 != 0) {
+			if (bdy_data.contains(*cell.data)) {
+				local_ok = 0;
+			}
+			continue;
+		}
+		nr_bdy++;
+		if (not bdy_data.contains(*cell.data)) {
+			local_ok = 0;
+			continue;
+		}
+		if (S1(*cell.data) != double(cell.id)) {
+			local_ok = 0;
+		}
+		if (S2(*cell.data)[2] != -double(cell.id)) {
+			local_ok = 0;
+		}
+	}
+	if (bdy_data.size() != nr_bdy) {
+		local_ok = 0;
+	}
+	MPI_Comm comm = grid.get_communicator();
+	MPI_Allreduce(&local_ok, &ok, 1, MPI_UINT64_T, MPI_MIN, comm);
+	MPI_Comm_free(&comm);
+	return ok > 0;
+}
+
+/*!
+Returns true if every local child of refined boundary cell has
+data, Sparse1 equal to own id if own_ids is true or to parent's
+id otherwise, and Sparse2 of parent.
+*/
+bool check_refined(Grid& grid, const bool own_ids)
+{
+	uint64_t local_ok = 1, ok = 0;
+	for (const auto& cell: grid.local_cells()) {
+		// boundary cells were refined
+		if (grid.get_refinement_level(cell.id) == 0) {
+			if (bdy_data.contains(*cell.data)) {
+				local_ok = 0;
+			}
+			continue;
+		}
+		if (not bdy_data.contains(*cell.data)) {
+			local_ok = 0;
+			continue;
+		}
+		const auto parent = grid.mapping.get_parent(cell.id);
+		if (S1(*cell.data) != double(own_ids ? cell.id : parent)) {
+			local_ok = 0;
+		}
+		if (S2(*cell.data)[2] != -double(parent)) {
+			local_ok = 0;
+		}
+	}
+	MPI_Comm comm = grid.get_communicator();
+	MPI_Allreduce(&local_ok, &ok, 1, MPI_UINT64_T, MPI_MIN, comm);
+	MPI_Comm_free(&comm);
+	return ok > 0;
+}
+
+int main(int argc, char* argv[])
+{
+	using std::runtime_error;
+	using std::to_string;
+
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+	float zoltan_version = -1.0;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	Grid grid; grid
+		.set_initial_length({16, 4, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(1)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.balance_load();
+
+	Geometries geometries;
+	for (const auto& cell: grid.local_cells()) {
+		if (cell.id % 4 == 0) {
+			geometries.cells.push_back(cell.id);
+		}
+	}
+
+	// initial condition touches every cell
+	bdy_data.allocate(grid);
+	for (const auto& cell: grid.local_cells()) {
+		S1(*cell.data) = cell.id;
+		S2(*cell.data) = {1, 2, -double(cell.id)};
+	}
+	if (bdy_data.size() != grid.local_cells().size()) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	bdy_data.retain(grid, geometries);
+	if (not check(grid)) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	// only boundary cells have data
+	for (const auto& cell: grid.local_cells()) {
+		if (cell.id % 4 == 0) {
+			continue;
+		}
+		if (bdy_data.find<Sparse1>(*cell.data) != nullptr) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		bool thrown = false;
+		try {
+			S1(*cell.data) = 0;
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		if (not thrown) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+	}
+
+	// data moves with cells
+	for (const auto& cell: grid.local_cells()) {
+		grid.pin(cell.id, (rank + 1) % comm_size);
+	}
+	bdy_data.before_grid_change(grid);
+	grid.balance_load(false);
+	bdy_data.after_grid_change(grid);
+	if (not check(grid)) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	// children of refined cells get parent's data
+	for (const auto& cell: grid.local_cells()) {
+		if (cell.id % 4 == 0) {
+			grid.refine_completely(cell.id);
+		}
+	}
+	bdy_data.before_grid_change(grid);
+	grid.stop_refining();
+	bdy_data.after_grid_change(grid);
+	grid.clear_refined_unrefined_data();
+	if (not check_refined(grid, false)) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	// split siblings between processes
+	for (const auto& cell: grid.local_cells()) {
+		if (grid.get_refinement_level(cell.id) > 0) {
+			S1(*cell.data) = cell.id;
+			if (cell.id % 2 == 0) {
+				grid.pin(cell.id, (rank + 1) % comm_size);
+			}
+		}
+	}
+	bdy_data.before_grid_change(grid);
+	grid.balance_load(false);
+	bdy_data.after_grid_change(grid);
+	if (not check_refined(grid, true)) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	// parents of unrefined cells get data of smallest child
+	for (const auto& cell: grid.local_cells()) {
+		if (grid.get_refinement_level(cell.id) > 0) {
+			grid.unrefine_completely(cell.id);
+		}
+	}
+	bdy_data.before_grid_change(grid);
+	grid.stop_refining();
+	bdy_data.after_grid_change(grid);
+	grid.clear_refined_unrefined_data();
+	for (const auto& cell: grid.local_cells()) {
+		if (cell.id % 4 != 0) {
+			continue;
+		}
+		const auto children = grid.mapping.get_all_children(cell.id);
+		if (
+			not bdy_data.contains(*cell.data)
+			or S1(*cell.data) != double(*std::min_element(children.cbegin(), children.cend()))
+		) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		S1(*cell.data) = cell.id;
+	}
+	if (not check(grid)) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -30,9 +30,11 @@ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "array"
 #include "cstdlib"
 #include "iostream"
 #include "string"
+#include "vector"
 
 #include "boundaries/value_boundary.hpp"
 
@@ -77,6 +79,11 @@ int main()
 				"\"z\": [0.1],"
 				"\"data\": [-1, 0, 1, 2, -2, -4, 10, 20, 30]"
 			"}"
+		"},"
+		"{"
+			"\"geometry-id\": 2,"
+			"\"time-stamps\": [0, 10],"
+			"\"values\": [\"x*x\", \"2*x\"]"
 		"}"
 	"]";
 
@@ -89,7 +96,7 @@ int main()
 
 	typename Mass_Density::data_type mass;
 
-	Value_Boundary<unsigned int, Mass_Density> bdy0, bdy1, bdy2, bdy3;
+	Value_Boundary<unsigned int, Mass_Density> bdy0, bdy1, bdy2, bdy3, bdy4;
 
 	/*{
 		"geometry-id": 1,
@@ -133,6 +140,14 @@ int main()
 			<< std::endl;
 		return EXIT_FAILURE;
 	}
+	// same position at different time
+	mass = bdy1.get_data(0.25, 0, 0, 0, 0, 0, 0);
+	if (mass != 0.25) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value for variable: "
+			<< mass << ", should be 0.25"
+			<< std::endl;
+		return EXIT_FAILURE;
+	}
 	mass = bdy1.get_data(2.75, 2, 3, 4, 5, 6, 7);
 	if (mass != 7.5625) {
 		std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value for variable: "
@@ -216,5 +231,30 @@ int main()
 		return EXIT_FAILURE;
 	}
 
+
+	/*{
+		"geometry-id": 2,
+		"time-stamps": [0, 10],
+		"values": ["x*x", "2*x"]
+	}*/
+	bdy4.set(document[4]);
+	for (const auto& item: std::vector<std::array<double, 3>>{
+		// time, x, correct value
+		{0, 3, 9},
+		{4, 3, 9},
+		{4, 2, 4},
+		{20, 3, 6},
+		{30, 2, 4}
+	}) {
+		mass = bdy4.get_data(item[0], item[1], 0, 0, 0, 0, 0);
+		if (mass != item[2]) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): Wrong value for variable: "
+				<< mass << ", should be " << item[2]
+				<< " at time " << item[0] << " and x " << item[1]
+				<< std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
 	return EXIT_SUCCESS;
 }
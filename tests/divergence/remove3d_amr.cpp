@@ -284,6 +284,7 @@ int main(int argc, char* argv[])
 			Type_Getter
 		);
 
+		pamhd::divergence::Poisson_Cache<dccrg::Cartesian_Geometry> poisson_cache;
 		pamhd::divergence::remove(
 			grid.local_cells(),
 			grid,
@@ -291,7 +292,8 @@ int main(int argc, char* argv[])
 			Div_Getter,
 			Gradient_Getter,
 			Type_Getter,
-			2000, 0, 1e-10, 2, 100, 10, false, false
+			2000, 0, 1e-10, 2, 100, 10, false, false,
+			&poisson_cache
 		);
 		grid.update_copies_of_remote_neighbors();
 
@@ -350,6 +352,27 @@ int main(int argc, char* argv[])
 			abort();
 		}
 
+		// warm started removal reuses poisson grid
+		pamhd::divergence::remove(
+			grid.local_cells(),
+			grid,
+			Vector_Getter,
+			Div_Getter,
+			Gradient_Getter,
+			Type_Getter,
+			2000, 0, 1e-10, 2, 100, 0, false, false,
+			&poisson_cache
+		);
+		if (poisson_cache.get_rebuilds() != 1) {
+			if (grid.get_rank() == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< ": Poisson grid created " << poisson_cache.get_rebuilds()
+					<< " times instead of once."
+					<< std::endl;
+			}
+			abort();
+		}
+
 		if (old_nr_of_cells > 0) {
 			const double
 				order_of_accuracy
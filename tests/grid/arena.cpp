@@ -0,0 +1,138 @@
+/*
+Tests storage of cell variables outside of grid cells in PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "stdexcept"
+#include "string"
+
+#include "dccrg.hpp"
+#include "dccrg_no_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell.hpp
+#include "gensimcell.hpp"
+
+#include "grid/arena.hpp"
+#include "grid/variables.hpp"
+
+
+struct Hot {
+	using data_type = int;
+};
+
+struct Cold1 {
+	using data_type = double;
+};
+
+struct Cold2 {
+	using data_type = double;
+};
+
+struct Cold3 {
+	using data_type = std::array<double, 3>;
+};
+
+using Cell = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	Hot,
+	pamhd::grid::Arena_Index
+>;
+using Grid = dccrg::Dccrg<Cell, dccrg::No_Geometry>;
+
+pamhd::grid::Arena<pamhd::grid::Arena_Index, Cold1, Cold2, Cold3> arena;
+const auto C1 = arena.getter<Cold1>();
+const auto C2 = arena.getter<Cold2>();
+const auto C3 = arena.getter<Cold3>();
+
+int main(int argc, char* argv[])
+{
+	using std::runtime_error;
+	using std::to_string;
+
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+	float zoltan_version = -1.0;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	Grid grid; grid
+		.set_initial_length({16, 4, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.balance_load();
+
+	arena.update(grid);
+	if (arena.size() != grid.local_cells().size() + grid.remote_cells().size()) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	for (const auto& cell: grid.local_cells()) {
+		(*cell.data)[Hot()] = cell.id;
+		C1(*cell.data) = cell.id;
+		C2.data(*cell.data) = -double(cell.id);
+		C3(*cell.data) = {1, 2, double(cell.id)};
+	}
+
+	// variables are separate and values are kept by update
+	arena.update(grid);
+	for (const auto& cell: grid.local_cells()) {
+		if ((*cell.data)[Hot()] != int(cell.id)) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (C1(*cell.data) != cell.id) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (C2(*cell.data) != -double(cell.id)) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (C3(*cell.data)[2] != cell.id) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+	}
+	for (const auto& cell: grid.remote_cells()) {
+		if (C1(*cell.data) != 0) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*
+Tests merging of remote neighbor updates in PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "cstdlib"
+#include "iostream"
+#include "stdexcept"
+#include "string"
+#include "tuple"
+
+#include "dccrg.hpp"
+#include "dccrg_no_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell.hpp
+#include "gensimcell.hpp"
+
+#include "grid/halo_exchange.hpp"
+#include "variable_getter.hpp"
+
+
+struct Var1 {
+	static bool is_stale;
+	using data_type = int;
+};
+bool Var1::is_stale = true;
+
+struct Var2 {
+	static bool is_stale;
+	using data_type = int;
+};
+bool Var2::is_stale = true;
+
+using Cell = gensimcell::Cell<gensimcell::Optional_Transfer, Var1, Var2>;
+using Grid = dccrg::Dccrg<Cell, dccrg::No_Geometry>;
+using Halo = pamhd::grid::Halo_Exchange<Cell>;
+
+const auto V1 = pamhd::Variable_Getter<Var1>();
+const auto V2 = pamhd::Variable_Getter<Var2>();
+
+//! Returns true if remote copies of variable have expected value
+template<class Getter> bool check(
+	Grid& grid, const Getter& V, const int offset
+) {
+	bool local_ok = true, ok = false;
+	for (const auto& cell: grid.remote_cells()) {
+		if (V.data(*cell.data) != int(cell.id) + offset) {
+			local_ok = false;
+		}
+	}
+	MPI_Comm comm = grid.get_communicator();
+	MPI_Allreduce(&local_ok, &ok, 1, MPI_CXX_BOOL, MPI_LAND, comm);
+	MPI_Comm_free(&comm);
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	using std::runtime_error;
+	using std::to_string;
+
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+	float zoltan_version = -1.0;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	Grid grid; grid
+		.set_initial_length({16, 4, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.balance_load();
+
+	for (const auto& cell: grid.local_cells()) {
+		V1.data(*cell.data) = cell.id + 10;
+		V2.data(*cell.data) = cell.id + 20;
+	}
+	for (const auto& cell: grid.remote_cells()) {
+		V1.data(*cell.data) = V2.data(*cell.data) = -1;
+	}
+
+	// requested variable is exchanged together with updated one
+	Halo::request(V1);
+	if (V1.type().is_stale) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not Halo::is_in_flight(V1)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not Halo::update(grid, V2)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (Halo::is_in_flight(V1)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (V2.type().is_stale) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, V1, 10)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, V2, 20)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	// nothing stale so nothing exchanged
+	for (const auto& cell: grid.local_cells()) {
+		V1.data(*cell.data) = cell.id + 30;
+	}
+	if (Halo::update(grid, V1, V2)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, V1, 10)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	// requested variable isn't exchanged by update of unrelated variable
+	V1.type().is_stale = true;
+	Halo::request(V1);
+	if (Halo::update(grid, V2)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, V1, 10)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	// but is by explicit start
+	if (not Halo::start(grid)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	Halo::wait_receives(grid);
+	if (not check(grid, V1, 30)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	Halo::finish(grid);
+	if (Halo::is_in_flight(V1)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (Halo::start(grid)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	// variable marked stale again after request is exchanged again later
+	V2.type().is_stale = true;
+	Halo::request(V2);
+	for (const auto& cell: grid.local_cells()) {
+		V2.data(*cell.data) = cell.id + 40;
+	}
+	V2.type().is_stale = true;
+	if (not Halo::update(grid, V2)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not V2.type().is_stale) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, V2, 40)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not Halo::update(grid, V2)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (V2.type().is_stale) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+Tests halo exchange of PAMHD using pre-packed buffers.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "array"
+#include "cstdlib"
+#include "iostream"
+#include "stdexcept"
+#include "string"
+
+#include "dccrg.hpp"
+#include "dccrg_no_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell.hpp
+#include "gensimcell.hpp"
+
+#include "grid/halo_exchange.hpp"
+#include "grid/packed_halo.hpp"
+#include "variable_getter.hpp"
+
+
+struct Var1 {
+	static bool is_stale;
+	using data_type = int;
+};
+bool Var1::is_stale = true;
+
+struct Var2 {
+	static bool is_stale;
+	using data_type = std::array<double, 3>;
+};
+bool Var2::is_stale = true;
+
+using Cell = gensimcell::Cell<gensimcell::Optional_Transfer, Var1, Var2>;
+using Grid = dccrg::Dccrg<Cell, dccrg::No_Geometry>;
+using Halo = pamhd::grid::Halo_Exchange<Cell>;
+
+const auto V1 = pamhd::Variable_Getter<Var1>();
+const auto V2 = pamhd::Variable_Getter<Var2>();
+
+void set_local(Grid& grid, const int offset)
+{
+	for (const auto& cell: grid.local_cells()) {
+		V1.data(*cell.data) = cell.id + offset;
+		V2.data(*cell.data) = {double(cell.id), double(offset), -double(cell.id)};
+	}
+}
+
+//! Returns true if remote copies of variables have expected values
+bool check(Grid& grid, const int offset1, const int offset2)
+{
+	bool local_ok = true, ok = false;
+	for (const auto& cell: grid.remote_cells()) {
+		if (V1.data(*cell.data) != int(cell.id) + offset1) {
+			local_ok = false;
+		}
+		const std::array<double, 3> ref{
+			double(cell.id), double(offset2), -double(cell.id)
+		};
+		if (V2.data(*cell.data) != ref) {
+			local_ok = false;
+		}
+	}
+	MPI_Comm comm = grid.get_communicator();
+	MPI_Allreduce(&local_ok, &ok, 1, MPI_CXX_BOOL, MPI_LAND, comm);
+	MPI_Comm_free(&comm);
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	using std::runtime_error;
+	using std::to_string;
+
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+	float zoltan_version = -1.0;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	Grid grid; grid
+		.set_initial_length({16, 4, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.balance_load();
+
+	set_local(grid, 10);
+	for (const auto& cell: grid.remote_cells()) {
+		V1.data(*cell.data) = -1;
+		V2.data(*cell.data) = {double(cell.id), -1, -double(cell.id)};
+	}
+
+	// ranges of variables
+	const auto ranges = pamhd::grid::Packed_Halo<Grid>::get_ranges(V2, V1, V1);
+	if (ranges.size() == 0 or ranges.size() > 2) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+	size_t bytes = 0;
+	for (const auto& range: ranges) {
+		bytes += range.second;
+	}
+	if (bytes != sizeof(int) + 3 * sizeof(double)) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	// only given variables are exchanged
+	pamhd::grid::Packed_Halo<Grid> halo;
+	halo.update(grid, V1);
+	if (not halo.is_set()) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, 10, -1)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	// buffers of earlier variables are reused
+	set_local(grid, 20);
+	halo.update(grid, V1, V2);
+	if (not check(grid, 20, 20)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	set_local(grid, 30);
+	halo.update(grid, V1);
+	if (not check(grid, 30, 20)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	halo.start(ranges);
+	halo.wait_receives();
+	if (not check(grid, 30, 30)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	halo.wait_sends();
+
+	// exchanges planned by Halo_Exchange use packed buffers
+	Halo::use(&halo);
+	set_local(grid, 40);
+	V1.type().is_stale = V2.type().is_stale = true;
+	Halo::request(V1);
+	if (not Halo::update(grid, V2)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, 40, 40)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	// and dccrg after clearing
+	halo.clear();
+	set_local(grid, 50);
+	V1.type().is_stale = true;
+	if (not Halo::update(grid, V1)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, 50, 40)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+	halo.set(grid);
+	V2.type().is_stale = true;
+	if (not Halo::update(grid, V2)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	if (not check(grid, 50, 50)) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	Halo::use<Grid>(nullptr);
+	halo.clear();
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
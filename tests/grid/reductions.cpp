@@ -0,0 +1,112 @@
+/*
+Tests batched nonblocking reductions of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "cstdlib"
+#include "iostream"
+#include "stdexcept"
+#include "string"
+#include "vector"
+
+#include "mpi.h"
+
+#include "reductions.hpp"
+
+
+int main(int argc, char* argv[])
+{
+	using std::runtime_error;
+	using std::to_string;
+
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	pamhd::Reductions reductions;
+	reductions.set(comm);
+
+	// different operations in one reduction
+	for (int step = 0; step < 3; step++) {
+		const auto
+			min_i = reductions.add_min(rank + step),
+			sum_i = reductions.add_sum(1),
+			max_i = reductions.add_max(-rank),
+			sum2_i = reductions.add_sum(rank * step);
+		reductions.start();
+
+		bool failed = false;
+		try {
+			reductions.add_sum(1);
+		} catch (const std::logic_error&) {
+			failed = true;
+		}
+		if (not failed) throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+
+		if (reductions.get(sum_i) != comm_size) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (reductions.get(min_i) != step) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (reductions.get(max_i) != 0) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (reductions.get(sum2_i) != step * comm_size * (comm_size - 1) / 2) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+	}
+
+	// many values in one reduction
+	std::vector<size_t> indices;
+	for (int i = 0; i < 1000; i++) {
+		indices.push_back(reductions.add_max(i * (rank + 1)));
+	}
+	reductions.start();
+	for (int i = 0; i < 1000; i++) {
+		if (reductions.get(indices[i]) != i * comm_size) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+	}
+
+	// empty reduction
+	reductions.start();
+	reductions.wait();
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+/*
+Tests per phase timers of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "sstream"
+#include "stdexcept"
+#include "string"
+
+#include "mpi.h"
+
+#include "timers.hpp"
+
+
+int main(int argc, char* argv[])
+{
+	using std::runtime_error;
+	using std::to_string;
+
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	// nothing recorded when disabled
+	{
+		pamhd::Timer timer("disabled");
+	}
+	if (pamhd::Timers::get().size() != 0) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	pamhd::Timers::enabled = true;
+	for (int i = 0; i < 3; i++) {
+		pamhd::Timer timer("common");
+	}
+	// phases are identified by name instead of its address
+	{
+		static const char common[] = "common";
+		pamhd::Timer timer(common);
+	}
+	// stopped timer isn't recorded again by destructor
+	{
+		pamhd::Timer timer("stopped");
+		timer.stop();
+	}
+	// phase only on some processes
+	if (rank == comm_size - 1) {
+		pamhd::Timer timer("last");
+	}
+	const auto& phases = pamhd::Timers::get();
+	if (phases.at("common").calls != 4) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+	if (phases.at("stopped").calls != 1) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+	if (phases.at("common").time < 0) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	const std::string json_path = "tests/grid/timers.json";
+	std::ostringstream output;
+	pamhd::Timers::report(comm, 1, output, json_path);
+	if (phases.size() != 0) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+	if (rank == 0) {
+		const auto table = output.str();
+		for (const auto name: {"common", "stopped", "last"}) {
+			if (table.find(name) == std::string::npos) {
+				throw runtime_error(__FILE__ "(" + to_string(__LINE__) + "): " + name);
+			}
+		}
+		if (table.find("disabled") != std::string::npos) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+	} else if (output.str().size() != 0) {
+		throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	}
+
+	// json file has all reports
+	{
+		pamhd::Timer timer("second");
+	}
+	pamhd::Timers::report(comm, 2, output, json_path);
+	if (rank == 0) {
+		std::ifstream json_file(json_path);
+		std::stringstream json;
+		json << json_file.rdbuf();
+		const auto contents = json.str();
+		if (contents.find("[") != 0) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (contents.find("\"last\": {\"calls\": 1") == std::string::npos) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (contents.find("\"second\"") == std::string::npos) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		if (contents.find("\"simulation-time\": 2") == std::string::npos) {
+			throw runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		}
+		std::remove(json_path.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
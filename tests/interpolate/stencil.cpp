@@ -0,0 +1,100 @@
+/*
+Tests interpolation stencil of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "random"
+
+#include "interpolate.hpp"
+
+
+using namespace std;
+using namespace pamhd;
+
+void test(
+	const std::array<double, 3>& start,
+	const std::array<double, 3>& end
+) {
+	std::mt19937_64 random_source(1);
+	std::uniform_real_distribution<double> value(-10, 10);
+
+	std::array<double, 27> scalars;
+	std::array<std::array<double, 6>, 27> vectors;
+	for (size_t i = 0; i < scalars.size(); i++) {
+		scalars[i] = value(random_source);
+		for (auto& v: vectors[i]) {
+			v = value(random_source);
+		}
+	}
+
+	for (size_t samples = 1; samples <= 5; samples++)
+	for (double x = start[0]; x <= end[0]; x += (end[0] - start[0])/samples)
+	for (double y = start[1]; y <= end[1]; y += (end[1] - start[1])/samples)
+	for (double z = start[2]; z <= end[2]; z += (end[2] - start[2])/samples) {
+		const std::array<double, 3> coord{x, y, z};
+		const auto stencil = get_interpolation_stencil(coord, start, end);
+
+		const double
+			reference = interpolate(coord, start, end, scalars),
+			interpolated = interpolate(stencil, scalars);
+		if (fabs(interpolated - reference) > 1e-10) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< interpolated << " " << reference << std::endl;
+			abort();
+		}
+
+		const auto packed = interpolate(stencil, vectors);
+		for (size_t i = 0; i < packed.size(); i++) {
+			std::array<double, 27> component;
+			for (size_t j = 0; j < component.size(); j++) {
+				component[j] = vectors[j][i];
+			}
+			const auto ref = interpolate(coord, start, end, component);
+			if (fabs(packed[i] - ref) > 1e-10) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): "
+					<< packed[i] << " " << ref << std::endl;
+				abort();
+			}
+		}
+	}
+}
+
+int main()
+{
+	test({{1., -4., -2.}}, {{5., 0., 2.}});
+	test({{-1.3, 4.5, 2.1}}, {{5.5, 6.7, 10.8}});
+
+	return EXIT_SUCCESS;
+}
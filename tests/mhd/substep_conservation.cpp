@@ -0,0 +1,219 @@
+/*
+Tests conservation of MHD solution with different substepping periods.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "tuple"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+#include "Eigen/Core" // must be included before gensimcell.hpp
+#include "mpi.h" // must be included before gensimcell.hpp
+#include "gensimcell.hpp"
+
+#include "grid/variables.hpp"
+#include "mhd/common.hpp"
+#include "mhd/rusanov.hpp"
+#include "mhd/solve.hpp"
+#include "mhd/variables.hpp"
+#include "variable_getter.hpp"
+
+
+using Cell = pamhd::mhd::Cell;
+using Grid = dccrg::Dccrg<
+	Cell,
+	dccrg::Cartesian_Geometry,
+	std::tuple<pamhd::grid::Cell_Is_Local>,
+	std::tuple<
+		pamhd::grid::Face_Neighbor,
+		pamhd::grid::Edge_Neighbor,
+		pamhd::grid::Relative_Size,
+		pamhd::grid::Neighbor_Is_Local>
+>;
+
+const auto Bg_B = pamhd::Variable_Getter<pamhd::Bg_Magnetic_Field>();
+bool pamhd::Bg_Magnetic_Field::is_stale = true;
+const auto Mas = pamhd::Variable_Getter<pamhd::mhd::Mass_Density>();
+bool pamhd::mhd::Mass_Density::is_stale = true;
+const auto Mom = pamhd::Variable_Getter<pamhd::mhd::Momentum_Density>();
+bool pamhd::mhd::Momentum_Density::is_stale = true;
+const auto Nrj = pamhd::Variable_Getter<pamhd::mhd::Total_Energy_Density>();
+bool pamhd::mhd::Total_Energy_Density::is_stale = true;
+const auto Vol_B = pamhd::Variable_Getter<pamhd::Magnetic_Field>();
+bool pamhd::Magnetic_Field::is_stale = true;
+const auto Face_B = pamhd::Variable_Getter<pamhd::Face_Magnetic_Field>();
+bool pamhd::Face_Magnetic_Field::is_stale = true;
+const auto Face_dB = pamhd::Variable_Getter<pamhd::Face_dB>();
+const auto CType = pamhd::Variable_Getter<pamhd::Cell_Type>();
+bool pamhd::Cell_Type::is_stale = true;
+const auto Substep = pamhd::Variable_Getter<pamhd::Substepping_Period>();
+bool pamhd::Substepping_Period::is_stale = true;
+const auto Max_v = pamhd::Variable_Getter<pamhd::mhd::Max_Velocity>();
+bool pamhd::mhd::Max_Velocity::is_stale = true;
+
+const auto MHDF = pamhd::Variable_Getter<pamhd::mhd::MHD_Flux>();
+const auto Mas_f = [](Cell& cell_data, const int dir)->auto& {
+	return MHDF.data(cell_data)(dir)[pamhd::mhd::Mass_Density()];
+};
+const auto Mom_f = [](Cell& cell_data, const int dir)->auto& {
+	return MHDF.data(cell_data)(dir)[pamhd::mhd::Momentum_Density()];
+};
+const auto Nrj_f = [](Cell& cell_data, const int dir)->auto& {
+	return MHDF.data(cell_data)(dir)[pamhd::mhd::Total_Energy_Density()];
+};
+const auto Mag_f = [](Cell& cell_data, const int dir)->auto& {
+	return MHDF.data(cell_data)(dir)[pamhd::Magnetic_Field()];
+};
+
+
+//! Returns total mass, x momentum and energy in grid.
+std::array<double, 3> get_totals(Grid& grid) {
+	std::array<double, 3> local{0, 0, 0}, global{0, 0, 0};
+	for (const auto& cell: grid.local_cells()) {
+		const auto len = grid.geometry.get_length(cell.id);
+		const auto volume = len[0] * len[1] * len[2];
+		local[0] += Mas.data(*cell.data) * volume;
+		local[1] += Mom.data(*cell.data)[0] * volume;
+		local[2] += Nrj.data(*cell.data) * volume;
+	}
+	MPI_Allreduce(
+		local.data(), global.data(), 3,
+		MPI_DOUBLE, MPI_SUM, grid.get_communicator()
+	);
+	return global;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	constexpr uint64_t nr_cells = 16;
+	constexpr double
+		adiabatic_index = 5.0 / 3.0,
+		vacuum_permeability = 1,
+		sub_dt = 1e-3;
+
+	Grid grid;
+	grid
+		.set_initial_length({nr_cells, 1, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.set_periodic(true, false, false)
+		.initialize(comm)
+		.balance_load();
+
+	dccrg::Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{0, 0, 0}};
+	geom_params.level_0_cell_length = {{1.0 / nr_cells, 1, 1}};
+	grid.set_geometry(geom_params);
+
+	// cells in negative half are solved every substep,
+	// in positive half every other substep
+	for (const auto& cell: grid.local_cells()) {
+		const auto x = grid.geometry.get_center(cell.id)[0];
+		const double
+			mas = 1 + 0.5 * std::sin(2 * M_PI * x),
+			pre = 1;
+		const std::array<double, 3>
+			vel{0.5, 0.1, 0},
+			mag{1, 0.2 * std::cos(2 * M_PI * x), 0};
+
+		Mas.data(*cell.data) = mas;
+		Mom.data(*cell.data) = {mas * vel[0], mas * vel[1], mas * vel[2]};
+		Nrj.data(*cell.data) = pamhd::mhd::get_total_energy_density(
+			mas, vel, pre, mag, adiabatic_index, vacuum_permeability);
+		Vol_B.data(*cell.data) = mag;
+		for (int dir: {-3,-2,-1,+1,+2,+3}) {
+			Face_B.data(*cell.data)(dir) = mag[std::abs(dir) - 1];
+			Bg_B.data(*cell.data)(dir) = {0, 0, 0};
+			Mas_f(*cell.data, dir) =
+			Nrj_f(*cell.data, dir) = 0;
+			Mom_f(*cell.data, dir) =
+			Mag_f(*cell.data, dir) = {0, 0, 0};
+		}
+		Face_dB.data(*cell.data) = {0, 0, 0, 0, 0, 0};
+		CType.data(*cell.data) = 1;
+		Substep.data(*cell.data) = (x < 0.5) ? 1 : 2;
+	}
+
+	const auto initial = get_totals(grid);
+
+	constexpr int max_substep = 2;
+	for (size_t step = 0; step < 20; step++) {
+		for (int substep = 1; substep <= max_substep; substep++) {
+			pamhd::mhd::get_all_fluxes(
+				sub_dt, pamhd::mhd::Solver::rusanov, grid, substep,
+				adiabatic_index, vacuum_permeability,
+				Mas, Mom, Nrj, Vol_B, Face_B, Face_dB, Bg_B,
+				Mas_f, Mom_f, Nrj_f, Mag_f, CType, Substep, Max_v
+			);
+			pamhd::mhd::update_mhd_state(
+				grid.local_cells(), grid, substep,
+				Face_B, Face_dB, CType, Substep,
+				Mas, Mom, Nrj, Vol_B,
+				Mas_f, Mom_f, Nrj_f, Mag_f
+			);
+		}
+
+		const auto current = get_totals(grid);
+		for (size_t i = 0; i < current.size(); i++) {
+			if (std::fabs(current[i] - initial[i]) > 1e-12 * std::fabs(initial[i])) {
+				if (grid.get_rank() == 0) {
+					std::cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Conserved variable " << i
+						<< " changed at step " << step
+						<< " from " << initial[i]
+						<< " to " << current[i] << std::endl;
+				}
+				abort();
+			}
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -48,7 +48,9 @@ Author(s): Ilja Honkonen
 #include "boundaries/multivariable_boundaries.hpp"
 #include "boundaries/multivariable_initial_conditions.hpp"
 #include "grid/amr.hpp"
+#include "grid/halo_exchange.hpp"
 #include "grid/options.hpp"
+#include "grid/packed_halo.hpp"
 #include "grid/variables.hpp"
 #include "math/nabla.hpp"
 #include "mhd/amr.hpp"
@@ -64,7 +66,9 @@ Author(s): Ilja Honkonen
 #include "mhd/save.hpp"
 #include "mhd/solve.hpp"
 #include "mhd/variables.hpp"
+#include "reductions.hpp"
 #include "simulation_options.hpp"
+#include "timers.hpp"
 #include "variable_getter.hpp"
 #include "common_variables.hpp"
 
@@ -263,7 +267,8 @@ int main(int argc, char* argv[]) {
 		geometry_id_t,
 		std::array<double, 3>,
 		double,
-		uint64_t
+		uint64_t,
+		Cell
 	> geometries;
 	geometries.set(document);
 
@@ -376,6 +381,11 @@ int main(int argc, char* argv[]) {
 		cout << "done" << endl;
 	}
 
+	// exchange trivially copyable variables from pre-packed buffers
+	pamhd::grid::Packed_Halo<Grid> packed_halo;
+	packed_halo.set(grid);
+	pamhd::grid::Halo_Exchange<Cell>::use(&packed_halo);
+
 	for (const auto& cell: grid.local_cells()) {
 		(*cell.data)[pamhd::MPI_Rank()] = rank;
 		Substep.data(*cell.data) = 1;
@@ -386,15 +396,7 @@ int main(int argc, char* argv[]) {
 	Substep.type().is_stale = true;
 
 	// assign cells into boundary geometries
-	for (const auto& gid: geometries.get_geometry_ids()) {
-		geometries.clear_cells(gid);
-	}
-	for (const auto& cell: grid.local_cells()) {
-		geometries.overlaps(
-			grid.geometry.get_min(cell.id),
-			grid.geometry.get_max(cell.id),
-			cell.id);
-	}
+	geometries.classify(grid, grid.local_cells());
 
 	/*
 	Simulate
@@ -404,7 +406,9 @@ int main(int argc, char* argv[]) {
 	double
 		simulation_time = options_sim.time_start,
 		next_mhd_save = options_mhd.save_n,
-		next_amr = options_grid.amr_n;
+		next_amr = options_grid.amr_n,
+		next_timers = options_sim.timers_n;
+	pamhd::Timers::enabled = options_sim.timers_n >= 0;
 
 	if (grid.get_rank() == 0) {
 		cout << "Initializing solver information... " << flush;
@@ -507,6 +511,10 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
+	// per step global values
+	pamhd::Reductions reductions;
+	reductions.set(comm);
+
 	size_t total_flux_calcs = 0;
 	while (simulation_time < time_end) {
 		simulation_step++;
@@ -532,7 +540,8 @@ int main(int argc, char* argv[]) {
 				<< max_sub << " substep(s)" << flush;
 		}
 		simulation_time += dt;
-		total_flux_calcs += flux_calcs;
+		// summed over processes with div(B)
+		const auto flux_calcs_i = reductions.add_sum(flux_calcs);
 
 		if (options_grid.amr_n > 0 and simulation_time >= next_amr) {
 			if (rank == 0) {
@@ -541,6 +550,8 @@ int main(int argc, char* argv[]) {
 			next_amr
 				+= options_grid.amr_n
 				* ceil((simulation_time - next_amr) / options_grid.amr_n);
+			// cell lists change so use dccrg until adapted
+			packed_halo.clear();
 			pamhd::mhd::adapt_grid(
 				grid, options_grid, options_mhd,
 				geometries, boundaries_mhd, background_B,
@@ -551,8 +562,10 @@ int main(int argc, char* argv[]) {
 				CType, FInfo, Ref_min, Ref_max,
 				Substep, Max_v, Berror
 			);
+			packed_halo.set(grid);
 		}
 
+		pamhd::Timer boundary_timer("boundaries");
 		pamhd::mhd::apply_boundaries(
 			grid, geometries, boundaries_mhd,
 			simulation_time, options_sim.proton_mass,
@@ -561,23 +574,32 @@ int main(int argc, char* argv[]) {
 			Mas, Mom, Nrj, Vol_B,
 			Face_B, CType, FInfo, Substep
 		);
+		boundary_timer.stop();
 
+		// next timestep needs Max_v, exchange with face B
+		pamhd::grid::Halo_Exchange<Cell>::request(Max_v);
+		pamhd::Timer sync_timer("mhd.sync_B");
 		sync_magnetic_field(grid, Face_B, Vol_B, Berror, CType);
+		sync_timer.stop();
 
-		const auto avg_div = pamhd::math::get_divergence_face2volume(
+		const auto local_div = pamhd::math::get_local_divergence_face2volume(
 			grid.local_cells(), grid,
 			Face_B, Div_B, CType
 		);
-		if (rank == 0) {
-			cout << ", avg div(B) " << avg_div << endl;
-		}
+		const auto
+			div_i = reductions.add_sum(local_div.first),
+			div_cells_i = reductions.add_sum(local_div.second);
+		pamhd::Timer reduction_timer("reductions");
+		reductions.start();
+		reduction_timer.stop();
 
 		if (
 			(options_mhd.save_n >= 0 and simulation_time >= time_end)
 			or (options_mhd.save_n > 0 and simulation_time >= next_mhd_save)
 		) {
+			pamhd::Timer save_timer("save");
 			if (rank == 0) {
-				cout << "Saving MHD at time " << simulation_time << endl;
+				cout << "...\nSaving MHD at time " << simulation_time << "..." << flush;
 			}
 			if (next_mhd_save <= simulation_time) {
 				next_mhd_save
@@ -604,6 +626,31 @@ int main(int argc, char* argv[]) {
 				abort();
 			}
 		}
+
+		// reduced during saving
+		total_flux_calcs += size_t(reductions.get(flux_calcs_i));
+		const auto div_cells = reductions.get(div_cells_i);
+		const auto avg_div = div_cells > 0 ? reductions.get(div_i) / div_cells : 0.0;
+		if (rank == 0) {
+			cout << ", avg div(B) " << avg_div << endl;
+		}
+
+		if (
+			(options_sim.timers_n >= 0 and simulation_time >= time_end)
+			or (options_sim.timers_n > 0 and simulation_time >= next_timers)
+		) {
+			if (next_timers <= simulation_time) {
+				next_timers
+					+= options_sim.timers_n
+					* ceil(max(options_sim.timers_n, simulation_time - next_timers) / options_sim.timers_n);
+			}
+			pamhd::Timers::report(
+				comm, simulation_time, cout,
+				boost::filesystem::canonical(
+					boost::filesystem::path(options_sim.output_directory)
+				).append("timers.json").generic_string()
+			);
+		}
 	}
 
 	if (rank == 0) {
@@ -611,6 +658,8 @@ int main(int argc, char* argv[]) {
 			<< " with " << total_flux_calcs
 			<< " total flux calculations" << endl;
 	}
+	pamhd::grid::Halo_Exchange<Cell>::use<Grid>(nullptr);
+	packed_halo.clear();
 	MPI_Finalize();
 
 	return EXIT_SUCCESS;
@@ -260,7 +260,8 @@ int main(int argc, char* argv[])
 		geometry_id_t,
 		std::array<double, 3>,
 		double,
-		uint64_t
+		uint64_t,
+		Cell
 	> geometries;
 	geometries.set(document);
 
@@ -390,6 +391,7 @@ int main(int argc, char* argv[])
 			end = grid.geometry.get_max(cell.id);
 		geometries.overlaps(start, end, cell.id);
 	}
+	geometries.update_cell_info(grid);
 
 
 	/*
@@ -402,6 +404,10 @@ int main(int argc, char* argv[])
 		simulation_time = options_sim.time_start,
 		next_mhd_save = options_mhd.save_n,
 		next_rem_div_B = options_div_B.remove_n;
+	// keeps solution of divergence removal for next removal
+	pamhd::divergence::Poisson_Cache<Grid::geometry_type> poisson_cache;
+	poisson_cache.use_multigrid = options_div_B.poisson_solver == "multigrid";
+	poisson_cache.use_fft = options_div_B.poisson_solver == "fft";
 
 	// initialize MHD
 	if (rank == 0) {
@@ -709,7 +715,8 @@ int main(int argc, char* argv[])
 					options_div_B.poisson_norm_increase_max,
 					0,
 					false,
-					false
+					false,
+					&poisson_cache
 				);
 			Cell::set_transfer_all(false, pamhd::Magnetic_Field_Divergence());
 
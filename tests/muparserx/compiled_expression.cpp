@@ -0,0 +1,223 @@
+/*
+Tests compiled math expressions against muparserx.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "chrono"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "mpParser.h"
+
+#include "math/compiled_expression.hpp"
+#include "math/expression.hpp"
+
+
+struct Scalar {
+	using data_type = double;
+	static const std::string get_name() { return {"scalar"}; }
+};
+
+struct Integer {
+	using data_type = int;
+	static const std::string get_name() { return {"integer"}; }
+};
+
+int main()
+{
+	using std::chrono::duration;
+	using std::chrono::duration_cast;
+	using std::chrono::high_resolution_clock;
+
+	const std::vector<std::string> expressions{
+		"1 + 2 * 3 - 4 / 5",
+		"-(2^2) + 2^3^2 + 2^-1",
+		"t * x + y / (z + 10)",
+		"radius < 2 ? 1e-3 : 0",
+		"sin(lat) * cos(lon) + sqrt(abs(x)) - exp(-t)",
+		"min(x, y, 1) + max(z, -1)",
+		"x > 0 && y > 0 || z <= -1",
+		"ln(radius + 1) + log10(1 + t) + log2(2 + x*x)",
+		"_pi * radius^2 + _e",
+		"(x - 1) * (x + 1) != y"
+	};
+
+	pamhd::math::Expression<Scalar> expression;
+	mup::ParserX parser(mup::pckCOMMON | mup::pckNON_COMPLEX | mup::pckMATRIX | mup::pckUNIT);
+	mup::Value t_val, x_val, y_val, z_val, radius_val, lat_val, lon_val;
+	mup::Variable
+		t_var(&t_val), x_var(&x_val), y_var(&y_val), z_var(&z_val),
+		radius_var(&radius_val), lat_var(&lat_val), lon_var(&lon_val);
+	parser.DefineVar("t", t_var);
+	parser.DefineVar("x", x_var);
+	parser.DefineVar("y", y_var);
+	parser.DefineVar("z", z_var);
+	parser.DefineVar("radius", radius_var);
+	parser.DefineVar("lat", lat_var);
+	parser.DefineVar("lon", lon_var);
+
+	constexpr size_t N = 1000;
+	std::vector<double> x(N), y(N), z(N), r(N), lat(N), lon(N), out(N);
+	for (size_t i = 0; i < N; i++) {
+		x[i] = -2 + 4.0 * i / N;
+		y[i] = std::sin(double(i));
+		z[i] = std::cos(3.0 * i);
+		r[i] = std::sqrt(x[i]*x[i] + y[i]*y[i] + z[i]*z[i]);
+		lat[i] = std::asin(z[i] / r[i]);
+		lon[i] = std::atan2(y[i], x[i]);
+	}
+	const double t = 0.75;
+
+	for (const auto& expr: expressions) {
+		expression.set_expression(expr);
+		if (not expression.is_compiled()) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Expression " << expr << " wasn't compiled" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		parser.SetExpr(expr);
+		expression.evaluate(
+			N, t, x.data(), y.data(), z.data(),
+			r.data(), lat.data(), lon.data(), out.data());
+		for (size_t i = 0; i < N; i++) {
+			t_val = t;
+			x_val = x[i];
+			y_val = y[i];
+			z_val = z[i];
+			radius_val = r[i];
+			lat_val = lat[i];
+			lon_val = lon[i];
+			const double
+				reference = parser.Eval().GetFloat(),
+				single = expression.evaluate(t, x[i], y[i], z[i], r[i], lat[i], lon[i]);
+			if (
+				std::abs(out[i] - reference) > 1e-12 * (1 + std::abs(reference))
+				or std::abs(single - reference) > 1e-12 * (1 + std::abs(reference))
+			) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): "
+					<< "Wrong value for " << expr << " at point " << i
+					<< ": " << out[i] << " and " << single
+					<< ", should be " << reference << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	// unsupported or ambiguous syntax falls back to muparserx
+	for (const auto& expr: {"3{m}", "-x^2"}) {
+		expression.set_expression(expr);
+		if (expression.is_compiled()) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Expression " << expr << " was compiled" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// extra variables
+	mup::Value J_val;
+	mup::Variable J_var(&J_val);
+	expression.add_expression_variable("J", J_var);
+	expression.set_expression("2 * J + x");
+	J_val = 3.0;
+	if (expression.evaluate(0, 1, 0, 0, 0, 0, 0) != 7) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Wrong value with extra variable" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::vector<double> J(N, 0.5);
+	expression.evaluate(
+		N, t, x.data(), y.data(), z.data(),
+		r.data(), lat.data(), lon.data(), out.data(), {J.data()});
+	if (out[N - 1] != 1 + x[N - 1]) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Wrong batch value with extra variable: " << out[N - 1]
+			<< ", should be " << 1 + x[N - 1] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	pamhd::math::Expression<Integer> integer;
+	integer.set_expression("x < 0 ? 2 : 4");
+	if (integer.evaluate(0, -1, 0, 0, 0, 0, 0) != 2 or integer.evaluate(0, 1, 0, 0, 0, 0, 0) != 4) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Wrong integer value" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// compare performance
+	pamhd::math::Expression<Scalar> resistivity;
+	resistivity.set_expression("radius < 2 ? 1e-3 * exp(-t) : 0");
+	parser.SetExpr("radius < 2 ? 1e-3 * exp(-t) : 0");
+	constexpr size_t rounds = 100;
+	const auto parser_start = high_resolution_clock::now();
+	double parser_sum = 0;
+	for (size_t round = 0; round < rounds; round++) {
+		for (size_t i = 0; i < N; i++) {
+			t_val = t;
+			x_val = x[i];
+			y_val = y[i];
+			z_val = z[i];
+			radius_val = r[i];
+			lat_val = lat[i];
+			lon_val = lon[i];
+			parser_sum += parser.Eval().GetFloat();
+		}
+	}
+	const auto compiled_start = high_resolution_clock::now();
+	double compiled_sum = 0;
+	for (size_t round = 0; round < rounds; round++) {
+		resistivity.evaluate(
+			N, t, x.data(), y.data(), z.data(),
+			r.data(), lat.data(), lon.data(), out.data());
+		for (size_t i = 0; i < N; i++) {
+			compiled_sum += out[i];
+		}
+	}
+	const auto compiled_end = high_resolution_clock::now();
+
+	if (std::abs(parser_sum - compiled_sum) > 1e-9 * std::abs(parser_sum)) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Different sums: " << parser_sum << " and " << compiled_sum
+			<< std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const double
+		parser_time = duration_cast<duration<double>>(compiled_start - parser_start).count(),
+		compiled_time = duration_cast<duration<double>>(compiled_end - compiled_start).count();
+	std::cout << "Time per evaluation with muparserx: "
+		<< parser_time / (rounds * N) << " s, compiled: "
+		<< compiled_time / (rounds * N) << " s" << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -50,9 +50,12 @@ particles represent one of the fluids.
 #include "boundaries/geometries.hpp"
 #include "boundaries/multivariable_boundaries.hpp"
 #include "boundaries/multivariable_initial_conditions.hpp"
+#include "boundaries/sparse_cell_data.hpp"
 #include "divergence/options.hpp"
 #include "divergence/remove.hpp"
+#include "grid/arena.hpp"
 #include "grid/options.hpp"
+#include "grid/variables.hpp"
 #include "mhd/boundaries.hpp"
 #include "mhd/common.hpp"
 #include "mhd/options.hpp"
@@ -72,7 +75,9 @@ particles represent one of the fluids.
 #include "particle/solve_dccrg.hpp"
 #include "particle/splitter.hpp"
 #include "particle/variables.hpp"
+#include "reductions.hpp"
 #include "simulation_options.hpp"
+#include "timers.hpp"
 
 
 using namespace std;
@@ -101,18 +106,9 @@ using Cell = gensimcell::Cell<
 	pamhd::Bg_Magnetic_Field_Pos_X,
 	pamhd::Bg_Magnetic_Field_Pos_Y,
 	pamhd::Bg_Magnetic_Field_Pos_Z,
-	pamhd::Magnetic_Field_Resistive,
-	pamhd::Magnetic_Field_Temp,
 	pamhd::Magnetic_Field_Divergence,
-	pamhd::Scalar_Potential_Gradient,
 	pamhd::particle::Electric_Field,
 	pamhd::particle::Number_Of_Particles,
-	pamhd::particle::Bdy_Number_Density,
-	pamhd::particle::Bdy_Velocity,
-	pamhd::particle::Bdy_Temperature,
-	pamhd::particle::Bdy_Species_Mass,
-	pamhd::particle::Bdy_Charge_Mass_Ratio,
-	pamhd::particle::Bdy_Nr_Particles_In_Cell,
 	pamhd::particle::Bulk_Mass,
 	pamhd::particle::Bulk_Momentum,
 	pamhd::particle::Bulk_Velocity,
@@ -126,9 +122,35 @@ using Cell = gensimcell::Cell<
 	pamhd::particle::Accumulated_To_Cells,
 	pamhd::mhd::HD_Flux_Conservative,
 	pamhd::mhd::HD2_Flux_Conservative,
-	pamhd::Magnetic_Field_Flux
+	pamhd::Magnetic_Field_Flux,
+	pamhd::Divergence_Cleaning_Potential,
+	pamhd::Divergence_Cleaning_Potential_Flux,
+	pamhd::grid::Arena_Index
 >;
 
+/*
+Variables used only by resistivity and divergence removal,
+stored outside of Cell so that solvers streaming through
+cells don't load them into cache
+*/
+pamhd::grid::Arena<
+	pamhd::grid::Arena_Index,
+	pamhd::Magnetic_Field_Resistive,
+	pamhd::Magnetic_Field_Temp,
+	pamhd::Scalar_Potential_Gradient
+> cold_cell_data;
+
+// initial condition & boundary data of particles, kept only in boundary cells
+pamhd::boundaries::Sparse_Cell_Data<
+	Cell,
+	pamhd::particle::Bdy_Number_Density,
+	pamhd::particle::Bdy_Velocity,
+	pamhd::particle::Bdy_Temperature,
+	pamhd::particle::Bdy_Species_Mass,
+	pamhd::particle::Bdy_Charge_Mass_Ratio,
+	pamhd::particle::Bdy_Nr_Particles_In_Cell
+> particle_bdy_data;
+
 // simulation data, see doi:10.1016/j.cpc.2012.12.017 or arxiv.org/abs/1212.3496
 using Grid = dccrg::Dccrg<
 	Cell,
@@ -155,29 +177,17 @@ const auto Nr_Ext
 
 // references to initial condition & boundary data of cell
 const auto Bdy_N
-	= [](Cell& cell_data)->typename pamhd::particle::Bdy_Number_Density::data_type&{
-		return cell_data[pamhd::particle::Bdy_Number_Density()];
-	};
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Number_Density>();
 const auto Bdy_V
-	= [](Cell& cell_data)->typename pamhd::particle::Bdy_Velocity::data_type&{
-		return cell_data[pamhd::particle::Bdy_Velocity()];
-	};
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Velocity>();
 const auto Bdy_T
-	= [](Cell& cell_data)->typename pamhd::particle::Bdy_Temperature::data_type&{
-		return cell_data[pamhd::particle::Bdy_Temperature()];
-	};
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Temperature>();
 const auto Bdy_Nr_Par
-	= [](Cell& cell_data)->typename pamhd::particle::Bdy_Nr_Particles_In_Cell::data_type&{
-		return cell_data[pamhd::particle::Bdy_Nr_Particles_In_Cell()];
-	};
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Nr_Particles_In_Cell>();
 const auto Bdy_SpM
-	= [](Cell& cell_data)->typename pamhd::particle::Bdy_Species_Mass::data_type&{
-		return cell_data[pamhd::particle::Bdy_Species_Mass()];
-	};
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Species_Mass>();
 const auto Bdy_C2M
-	= [](Cell& cell_data)->typename pamhd::particle::Bdy_Charge_Mass_Ratio::data_type&{
-		return cell_data[pamhd::particle::Bdy_Charge_Mass_Ratio()];
-	};
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Charge_Mass_Ratio>();
 
 // given a particle these return references to particle's parameters
 const auto Part_Pos
@@ -321,9 +331,7 @@ const auto Mag
 
 // field before divergence removal in case removal fails
 const auto Mag_tmp
-	= [](Cell& cell_data)->typename pamhd::Magnetic_Field_Temp::data_type&{
-		return cell_data[pamhd::Magnetic_Field_Temp()];
-	};
+	= cold_cell_data.getter<pamhd::Magnetic_Field_Temp>();
 // divergence of magnetic field
 const auto Mag_div
 	= [](Cell& cell_data)->typename pamhd::Magnetic_Field_Divergence::data_type&{
@@ -336,9 +344,7 @@ const auto Res
 	};
 // adjustment to magnetic field due to resistivity
 const auto Mag_res
-	= [](Cell& cell_data)->typename pamhd::Magnetic_Field_Resistive::data_type&{
-		return cell_data[pamhd::Magnetic_Field_Resistive()];
-	};
+	= cold_cell_data.getter<pamhd::Magnetic_Field_Resistive>();
 // curl of magnetic field
 const auto Cur
 	= [](Cell& cell_data)->typename pamhd::Electric_Current_Density::data_type&{
@@ -381,6 +387,16 @@ const auto Mag_f
 		return cell_data[pamhd::Magnetic_Field_Flux()];
 	};
 
+// potential of GLM divergence cleaning and its flux over one time step
+const auto Psi
+	= [](Cell& cell_data)->typename pamhd::Divergence_Cleaning_Potential::data_type&{
+		return cell_data[pamhd::Divergence_Cleaning_Potential()];
+	};
+const auto Psi_f
+	= [](Cell& cell_data)->typename pamhd::Divergence_Cleaning_Potential_Flux::data_type&{
+		return cell_data[pamhd::Divergence_Cleaning_Potential_Flux()];
+	};
+
 // reference to mass density of fluid 1 in given cell
 const auto Mas1
 	= [](Cell& cell_data)->typename pamhd::mhd::Mass_Density::data_type&{
@@ -566,7 +582,8 @@ int main(int argc, char* argv[])
 		geometry_id_t,
 		std::array<double, 3>,
 		double,
-		uint64_t
+		uint64_t,
+		Cell
 	> geometries;
 	geometries.set(document);
 
@@ -731,6 +748,9 @@ int main(int argc, char* argv[])
 		.set_initial_length(number_of_cells)
 		.initialize(comm)
 		.balance_load();
+	cold_cell_data.update(grid);
+	// boundary data until boundary cells are known
+	particle_bdy_data.allocate(grid);
 
 	// set grid geometry
 	const std::array<double, 3>
@@ -754,12 +774,7 @@ int main(int argc, char* argv[])
 	}
 
 	// assign cells into boundary geometries
-	for (const auto& cell: grid.local_cells()) {
-		const auto
-			start = grid.geometry.get_min(cell.id),
-			end = grid.geometry.get_max(cell.id);
-		geometries.overlaps(start, end, cell.id);
-	}
+	geometries.classify(grid, grid.local_cells());
 
 
 	/*
@@ -774,7 +789,13 @@ int main(int argc, char* argv[])
 		simulation_time = options_sim.time_start,
 		next_particle_save = options_particle.save_n,
 		next_mhd_save = options_mhd.save_n,
-		next_rem_div_B = options_div_B.remove_n;
+		next_rem_div_B = options_div_B.remove_n,
+		next_timers = options_sim.timers_n;
+	pamhd::Timers::enabled = options_sim.timers_n >= 0;
+	// keeps solution of divergence removal for next removal
+	pamhd::divergence::Poisson_Cache<Grid::geometry_type> poisson_cache;
+	poisson_cache.use_multigrid = options_div_B.poisson_solver == "multigrid";
+	poisson_cache.use_fft = options_div_B.poisson_solver == "fft";
 
 	if (rank == 0) {
 		cout << "Initializing simulation... " << endl;
@@ -783,6 +804,8 @@ int main(int argc, char* argv[])
 	// zero B before initializing fluids to get correct total energy
 	for (auto& cell: grid.local_cells()) {
 		Mag(*cell.data) = {0, 0, 0};
+		Psi(*cell.data) = 0;
+		Psi_f(*cell.data) = 0;
 	}
 
 	// fluid 1
@@ -866,6 +889,8 @@ int main(int argc, char* argv[])
 			Bdy_C2M
 		);
 	next_particle_id += nr_particles_created * grid.get_comm_size();
+	// initial condition is done, boundaries only need their own cells
+	particle_bdy_data.retain(grid, geometries);
 
 	// fluid 2 from particles
 	try {
@@ -1001,37 +1026,46 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	const bool glm_cleaning = options_div_B.cleaning == "glm";
+
+	// per step global values
+	pamhd::Reductions reductions;
+	reductions.set(comm);
+
 	size_t simulated_steps = 0;
 	while (simulation_time < time_end) {
 		simulated_steps++;
 
+		// smallest cell limits speed of GLM divergence cleaning
+		const double local_min_cell_length
+			= glm_cleaning
+			? pamhd::mhd::get_min_cell_length(grid.local_cells(), grid)
+			: std::numeric_limits<double>::max();
+
 		double
 			// don't step over the final simulation time
 			until_end = time_end - simulation_time,
-			// max allowed step for this rank
-			local_time_step = min(min(min(
+			// max allowed step for this rank without final time
+			local_cfl_time_step = min(min(
 				options_mhd.time_step_factor * max_dt_mhd,
 				options_particle.gyroperiod_time_step_factor * max_dt_particle_gyro),
-				options_particle.flight_time_step_factor * max_dt_particle_flight),
-				until_end),
-			time_step = -1;
+				options_particle.flight_time_step_factor * max_dt_particle_flight);
 
-		if (
-			MPI_Allreduce(
-				&local_time_step,
-				&time_step,
-				1,
-				MPI_DOUBLE,
-				MPI_MIN,
-				comm
-			) != MPI_SUCCESS
-		) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< ": Couldn't reduce time step."
-				<< std::endl;
-			abort();
+		if (glm_cleaning and options_div_B.glm_speed > 0) {
+			local_cfl_time_step = min(
+				local_cfl_time_step,
+				options_mhd.time_step_factor * local_min_cell_length / options_div_B.glm_speed
+			);
 		}
 
+		// time step isn't needed before solving
+		const auto
+			time_step_i = reductions.add_min(min(local_cfl_time_step, until_end)),
+			cfl_time_step_i = reductions.add_min(local_cfl_time_step),
+			min_cell_length_i = reductions.add_min(local_min_cell_length);
+		reductions.start();
+
+		pamhd::Timer split_timer("particle.split");
 		pamhd::particle::split_particles(
 			options_particle.min_particles,
 			random_source,
@@ -1042,8 +1076,10 @@ int main(int argc, char* argv[])
 			Sol_Info,
 			pamhd::particle::Solver_Info::normal
 		);
+		split_timer.stop();
 
 		try {
+			pamhd::Timer accumulate_timer("particle.accumulate");
 			pamhd::particle::accumulate_mhd_data(
 				grid,
 				Part_Int,
@@ -1165,11 +1201,29 @@ int main(int argc, char* argv[])
 		max_dt_particle_flight =
 		max_dt_particle_gyro   = std::numeric_limits<double>::max();
 
+		const double time_step = reductions.get(time_step_i);
 		if (rank == 0) {
 			cout << "Solving at time " << simulation_time
 				<< " s with time step " << time_step << " s" << endl;
 		}
 
+		/*
+		Use fastest cleaning allowed by time step unless given,
+		time step shortened to reach final time doesn't speed
+		up cleaning so that its speed doesn't jump at the end
+		*/
+		double glm_speed = 0;
+		if (glm_cleaning) {
+			const double
+				cfl_time_step = reductions.get(cfl_time_step_i),
+				min_cell_length = reductions.get(min_cell_length_i);
+			if (options_div_B.glm_speed > 0) {
+				glm_speed = options_div_B.glm_speed;
+			} else if (cfl_time_step > 0) {
+				glm_speed = options_mhd.time_step_factor * min_cell_length / cfl_time_step;
+			}
+		}
+
 		// TODO: don't use preprocessor
 		#define SOLVE_WITH_STEPPER(given_type, given_cells) \
 			pamhd::particle::solve<\
@@ -1197,6 +1251,7 @@ int main(int argc, char* argv[])
 		std::pair<double, double> particle_max_dt{0, 0};
 
 		// outer cells
+		pamhd::Timer outer_push_timer("particle.push");
 		switch (particle_stepper) {
 		case 0:
 			particle_max_dt = SOLVE_WITH_STEPPER(odeint::euler<pamhd::particle::state_t>, grid.outer_cells());
@@ -1217,6 +1272,7 @@ int main(int argc, char* argv[])
 			std::cerr <<  __FILE__ << "(" << __LINE__ << "): " << particle_stepper << std::endl;
 			abort();
 		}
+		outer_push_timer.stop();
 		max_dt_particle_flight = min(particle_max_dt.first, max_dt_particle_flight);
 		max_dt_particle_gyro = min(particle_max_dt.second, max_dt_particle_gyro);
 
@@ -1227,12 +1283,14 @@ int main(int argc, char* argv[])
 			pamhd::mhd::HD2_State_Conservative(),
 			pamhd::particle::Nr_Particles_External()
 		);
+		Cell::set_transfer_all(glm_cleaning, pamhd::Divergence_Cleaning_Potential());
 		grid.start_remote_neighbor_copy_updates();
 
 		// inner MHD
 		double solve_max_dt = -1;
 
 		try {
+			pamhd::Timer flux_timer("mhd.fluxes");
 			solve_max_dt = pamhd::mhd::N_solve(
 				mhd_solver,
 				grid.inner_cells(),
@@ -1249,7 +1307,11 @@ int main(int argc, char* argv[])
 				std::make_pair(Mom1_f, Mom2_f),
 				std::make_pair(Nrj1_f, Nrj2_f),
 				Mag_f,
-				Sol_Info
+				Sol_Info,
+				Psi,
+				Psi_f,
+				glm_speed,
+				options_div_B.glm_damping
 			);
 		} catch (const std::exception& e) {
 			std::cerr << __FILE__ "(" << __LINE__ << ": "
@@ -1260,6 +1322,7 @@ int main(int argc, char* argv[])
 		max_dt_mhd = min(solve_max_dt, max_dt_mhd);
 
 		// inner particles
+		pamhd::Timer inner_push_timer("particle.push");
 		switch (particle_stepper) {
 		case 0:
 			particle_max_dt = SOLVE_WITH_STEPPER(odeint::euler<pamhd::particle::state_t>, grid.inner_cells());
@@ -1281,13 +1344,17 @@ int main(int argc, char* argv[])
 			abort();
 		}
 		#undef SOLVE_WITH_STEPPER
+		inner_push_timer.stop();
 		max_dt_particle_flight = min(particle_max_dt.first, max_dt_particle_flight);
 		max_dt_particle_gyro = min(particle_max_dt.second, max_dt_particle_gyro);
 
+		pamhd::Timer wait_timer("halo_wait");
 		grid.wait_remote_neighbor_copy_update_receives();
+		wait_timer.stop();
 
 		// outer MHD
 		try {
+			pamhd::Timer flux_timer("mhd.fluxes");
 			solve_max_dt = pamhd::mhd::N_solve(
 				mhd_solver,
 				grid.outer_cells(),
@@ -1304,7 +1371,11 @@ int main(int argc, char* argv[])
 				std::make_pair(Mom1_f, Mom2_f),
 				std::make_pair(Nrj1_f, Nrj2_f),
 				Mag_f,
-				Sol_Info
+				Sol_Info,
+				Psi,
+				Psi_f,
+				glm_speed,
+				options_div_B.glm_damping
 			);
 		} catch (const std::exception& e) {
 			std::cerr << __FILE__ "(" << __LINE__ << ": "
@@ -1338,6 +1409,7 @@ int main(int argc, char* argv[])
 			pamhd::mhd::HD2_State_Conservative(),
 			pamhd::particle::Nr_Particles_External()
 		);
+		Cell::set_transfer_all(false, pamhd::Divergence_Cleaning_Potential());
 
 		// transfer J for calculating additional contributions to B
 		Cell::set_transfer_all(true, pamhd::Electric_Current_Density());
@@ -1398,6 +1470,7 @@ int main(int argc, char* argv[])
 		grid.start_remote_neighbor_copy_updates();
 
 		try {
+			pamhd::Timer update_timer("mhd.update_state");
 			pamhd::mhd::apply_fluxes_N(
 				grid,
 				options_mhd.min_pressure,
@@ -1411,7 +1484,9 @@ int main(int argc, char* argv[])
 				std::make_pair(Mom1_f, Mom2_f),
 				std::make_pair(Nrj1_f, Nrj2_f),
 				Mag_f,
-				Sol_Info
+				Sol_Info,
+				Psi,
+				Psi_f
 			);
 		} catch (const std::exception& e) {
 			std::cerr << __FILE__ "(" << __LINE__ << ": "
@@ -1420,6 +1495,7 @@ int main(int argc, char* argv[])
 			abort();
 		}
 
+		pamhd::Timer incorporate_timer("particle.incorporate");
 		pamhd::particle::incorporate_external_particles<
 			pamhd::particle::Nr_Particles_Internal,
 			pamhd::particle::Particles_Internal,
@@ -1448,6 +1524,7 @@ int main(int argc, char* argv[])
 			pamhd::particle::Nr_Particles_External,
 			pamhd::particle::Particles_External
 		>(grid.outer_cells(), grid);
+		incorporate_timer.stop();
 
 
 		simulation_time += time_step;
@@ -1457,9 +1534,14 @@ int main(int argc, char* argv[])
 		Remove divergence of magnetic field
 		*/
 
-		if (options_div_B.remove_n > 0 and simulation_time >= next_rem_div_B) {
+		if (
+			not glm_cleaning
+			and options_div_B.remove_n > 0
+			and simulation_time >= next_rem_div_B
+		) {
 			next_rem_div_B += options_div_B.remove_n;
 
+			pamhd::Timer div_timer("div_B.remove");
 			if (rank == 0) {
 				cout << "Removing divergence of B at time "
 					<< simulation_time << "...  ";
@@ -1483,11 +1565,7 @@ int main(int argc, char* argv[])
 					grid,
 					Mag,
 					Mag_div,
-					[](Cell& cell_data)
-						-> pamhd::Scalar_Potential_Gradient::data_type&
-					{
-						return cell_data[pamhd::Scalar_Potential_Gradient()];
-					},
+					cold_cell_data.getter<pamhd::Scalar_Potential_Gradient>(),
 					Sol_Info,
 					options_div_B.poisson_iterations_max,
 					options_div_B.poisson_iterations_min,
@@ -1496,7 +1574,8 @@ int main(int argc, char* argv[])
 					options_div_B.poisson_norm_increase_max,
 					0,
 					false,
-					false
+					false,
+					&poisson_cache
 				);
 			Cell::set_transfer_all(false, pamhd::Magnetic_Field_Divergence());
 
@@ -1578,6 +1657,7 @@ int main(int argc, char* argv[])
 		grid.update_copies_of_remote_neighbors();
 		Cell::set_transfer_all(false, pamhd::particle::Particles_Internal());
 
+		pamhd::Timer boundary_timer("boundaries");
 		try {
 			pamhd::mhd::apply_magnetic_field_boundaries(
 				grid,
@@ -1642,6 +1722,7 @@ int main(int argc, char* argv[])
 				Bdy_C2M
 			);
 		next_particle_id += nr_particles_created * grid.get_comm_size();
+		boundary_timer.stop();
 
 			// add magnetic nrj to fluid boundary cells
 			/*if ((*cell_data)[pamhd::mhd::Cell_Type()] == bdy_classifier_fluid1.value_boundary_cell) {
@@ -1666,6 +1747,7 @@ int main(int argc, char* argv[])
 				next_particle_save += options_particle.save_n;
 			}
 
+			pamhd::Timer save_timer("save");
 			if (rank == 0) {
 				cout << "Saving particles at time " << simulation_time << "...";
 			}
@@ -1709,6 +1791,7 @@ int main(int argc, char* argv[])
 				next_mhd_save += options_mhd.save_n;
 			}
 
+			pamhd::Timer save_timer("save");
 			if (rank == 0) {
 				cout << "Saving fluid at time " << simulation_time << "... ";
 			}
@@ -1746,6 +1829,21 @@ int main(int argc, char* argv[])
 				cout << "done." << endl;
 			}
 		}
+
+		if (
+			(options_sim.timers_n >= 0 and simulation_time >= time_end)
+			or (options_sim.timers_n > 0 and simulation_time >= next_timers)
+		) {
+			if (next_timers <= simulation_time) {
+				next_timers += options_sim.timers_n;
+			}
+			pamhd::Timers::report(
+				comm, simulation_time, cout,
+				boost::filesystem::canonical(
+					boost::filesystem::path(options_sim.output_directory)
+				).append("timers.json").generic_string()
+			);
+		}
 	}
 
 	MPI_Finalize();
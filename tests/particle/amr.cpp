@@ -0,0 +1,328 @@
+/*
+Tests redistribution of particles on adapted grid of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "random"
+#include "utility"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell
+#include "gensimcell.hpp"
+
+#include "background_magnetic_field.hpp"
+#include "common_variables.hpp"
+#include "grid/variables.hpp"
+#include "particle/amr.hpp"
+#include "particle/variables.hpp"
+#include "variable_getter.hpp"
+
+
+using Cell = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	pamhd::grid::Target_Refinement_Level_Max,
+	pamhd::grid::Target_Refinement_Level_Min,
+	pamhd::Face_Magnetic_Field,
+	pamhd::Bg_Magnetic_Field,
+	pamhd::particle::Volume_Magnetic_Field,
+	pamhd::particle::Nr_Particles_External,
+	pamhd::particle::Particles_Internal
+>;
+using Grid = dccrg::Dccrg<Cell, dccrg::Cartesian_Geometry>;
+
+const auto RLMax = pamhd::Variable_Getter<pamhd::grid::Target_Refinement_Level_Max>();
+const auto RLMin = pamhd::Variable_Getter<pamhd::grid::Target_Refinement_Level_Min>();
+
+bool pamhd::Face_Magnetic_Field::is_stale = true;
+const auto Face_B = pamhd::Variable_Getter<pamhd::Face_Magnetic_Field>();
+
+bool pamhd::Bg_Magnetic_Field::is_stale = true;
+const auto Bg_B = pamhd::Variable_Getter<pamhd::Bg_Magnetic_Field>();
+
+bool pamhd::particle::Volume_Magnetic_Field::is_stale = true;
+const auto Vol_B = pamhd::Variable_Getter<pamhd::particle::Volume_Magnetic_Field>();
+
+const auto Part_Int = [](Cell& cell_data)->auto& {
+	return cell_data[pamhd::particle::Particles_Internal()];
+};
+const auto Part_Pos = [](
+	pamhd::particle::Particle_Internal& particle
+)->auto& {
+	return particle[pamhd::particle::Position()];
+};
+const auto Part_Mas = [](
+	pamhd::particle::Particle_Internal& particle
+)->auto& {
+	return particle[pamhd::particle::Mass()];
+};
+
+// uniform magnetic field that must survive refinement
+constexpr std::array<double, 3> B0{1, -2, 3};
+
+
+/*!
+Returns total number and mass of particles.
+
+Aborts if any particle isn't inside its cell or
+magnetic field of any cell differs from B0.
+*/
+std::pair<uint64_t, double> check(Grid& grid, MPI_Comm comm)
+{
+	uint64_t local = 0;
+	double local_mass = 0;
+	for (const auto& cell: grid.local_cells()) {
+		const auto
+			cell_min = grid.geometry.get_min(cell.id),
+			cell_max = grid.geometry.get_max(cell.id);
+		for (auto& particle: Part_Int(*cell.data)) {
+			const auto& pos = Part_Pos(particle);
+			for (size_t dim = 0; dim < 3; dim++) {
+				if (pos[dim] < cell_min[dim] or pos[dim] > cell_max[dim]) {
+					std::cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Particle outside of cell " << cell.id << std::endl;
+					abort();
+				}
+			}
+			local_mass += Part_Mas(particle);
+		}
+		local += Part_Int(*cell.data).size();
+
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (
+				Vol_B.data(*cell.data)[dim] != B0[dim]
+				or Face_B.data(*cell.data)(dim, -1) != B0[dim]
+				or Face_B.data(*cell.data)(dim, +1) != B0[dim]
+			) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): "
+					<< "Wrong magnetic field in cell " << cell.id << std::endl;
+				abort();
+			}
+		}
+	}
+	uint64_t global = 0;
+	MPI_Allreduce(&local, &global, 1, MPI_UINT64_T, MPI_SUM, comm);
+	double global_mass = 0;
+	MPI_Allreduce(&local_mass, &global_mass, 1, MPI_DOUBLE, MPI_SUM, comm);
+	return {global, global_mass};
+}
+
+
+/*!
+Moves every other refined cell to next process so that
+siblings of cells removed by later unrefinement are
+split between processes.
+*/
+void move_refined_cells(Grid& grid)
+{
+	const int
+		rank = grid.get_rank(),
+		comm_size = grid.get_comm_size();
+	for (const auto& cell: grid.local_cells()) {
+		(*cell.data)[pamhd::particle::Nr_Particles_External()]
+			= Part_Int(*cell.data).size();
+		if (
+			grid.get_refinement_level(cell.id) > 0
+			and cell.id % 2 == 0
+		) {
+			grid.pin(cell.id, (rank + 1) % comm_size);
+		}
+	}
+
+	// allocate space for particles before receiving them
+	Cell::set_transfer_all(true,
+		pamhd::grid::Target_Refinement_Level_Max(),
+		pamhd::grid::Target_Refinement_Level_Min(),
+		pamhd::Face_Magnetic_Field(),
+		pamhd::Bg_Magnetic_Field(),
+		pamhd::particle::Volume_Magnetic_Field(),
+		pamhd::particle::Nr_Particles_External()
+	);
+	grid.initialize_balance_load(false);
+	grid.continue_balance_load();
+	for (const auto& cell_id: grid.get_cells_added_by_balance_load()) {
+		auto* const cell_data = grid[cell_id];
+		if (cell_data == nullptr) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "No data for cell " << cell_id << std::endl;
+			abort();
+		}
+		Part_Int(*cell_data).resize(
+			(*cell_data)[pamhd::particle::Nr_Particles_External()]
+		);
+	}
+	Cell::set_transfer_all(false,
+		pamhd::grid::Target_Refinement_Level_Max(),
+		pamhd::grid::Target_Refinement_Level_Min(),
+		pamhd::Face_Magnetic_Field(),
+		pamhd::Bg_Magnetic_Field(),
+		pamhd::particle::Volume_Magnetic_Field(),
+		pamhd::particle::Nr_Particles_External()
+	);
+
+	Cell::set_transfer_all(true, pamhd::particle::Particles_Internal());
+	grid.continue_balance_load();
+	Cell::set_transfer_all(false, pamhd::particle::Particles_Internal());
+	grid.finish_balance_load();
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0;
+	MPI_Comm_rank(comm, &rank);
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	Grid grid;
+	grid
+		.set_initial_length({4, 4, 4})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(1)
+		.set_load_balancing_method("RANDOM")
+		.initialize(comm)
+		.balance_load();
+
+	dccrg::Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{-2, -2, -2}};
+	geom_params.level_0_cell_length = {{1, 1, 1}};
+	grid.set_geometry(geom_params);
+
+	pamhd::Background_Magnetic_Field<double, std::array<double, 3>> bg_B;
+	const double vacuum_permeability = 4e-7 * M_PI;
+
+	std::mt19937_64 random_source(rank);
+	std::uniform_real_distribution<double> rel_dist(0, 1);
+	for (const auto& cell: grid.local_cells()) {
+		const auto
+			cell_min = grid.geometry.get_min(cell.id),
+			cell_length = grid.geometry.get_length(cell.id);
+		Vol_B.data(*cell.data) = B0;
+		for (size_t dim = 0; dim < 3; dim++) {
+			Face_B.data(*cell.data)(dim, -1) =
+			Face_B.data(*cell.data)(dim, +1) = B0[dim];
+		}
+		for (size_t i = 0; i < 20; i++) {
+			pamhd::particle::Particle_Internal particle;
+			Part_Pos(particle) = {
+				cell_min[0] + rel_dist(random_source) * cell_length[0],
+				cell_min[1] + rel_dist(random_source) * cell_length[1],
+				cell_min[2] + rel_dist(random_source) * cell_length[2]
+			};
+			Part_Mas(particle) = 1 + rel_dist(random_source);
+			Part_Int(*cell.data).push_back(particle);
+		}
+	}
+	const auto [nr_particles, mass] = check(grid, comm);
+
+	// refine cells at origin
+	for (const auto& cell: grid.local_cells()) {
+		const auto center = grid.geometry.get_center(cell.id);
+		const bool refine
+			= std::fabs(center[0]) < 1
+			and std::fabs(center[1]) < 1
+			and std::fabs(center[2]) < 1;
+		RLMin.data(*cell.data) =
+		RLMax.data(*cell.data) = refine ? 1 : 0;
+	}
+	pamhd::particle::adapt_grid(
+		grid, bg_B, vacuum_permeability, Face_B, Vol_B, Bg_B,
+		RLMin, RLMax, Part_Int, Part_Pos);
+	const auto [refined_nr, refined_mass] = check(grid, comm);
+	if (
+		refined_nr != nr_particles
+		or std::fabs(refined_mass - mass) > 1e-12 * mass
+	) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< refined_nr << " " << nr_particles << ", "
+			<< refined_mass << " " << mass << std::endl;
+		abort();
+	}
+	uint64_t refined_local = 0, refined = 0;
+	for (const auto& cell: grid.local_cells()) {
+		if (grid.get_refinement_level(cell.id) > 0) {
+			refined_local++;
+		}
+	}
+	MPI_Allreduce(&refined_local, &refined, 1, MPI_UINT64_T, MPI_SUM, comm);
+	if (refined != 64) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): " << refined << std::endl;
+		abort();
+	}
+
+	move_refined_cells(grid);
+	const auto [moved_nr, moved_mass] = check(grid, comm);
+	if (
+		moved_nr != nr_particles
+		or std::fabs(moved_mass - mass) > 1e-12 * mass
+	) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< moved_nr << " " << nr_particles << ", "
+			<< moved_mass << " " << mass << std::endl;
+		abort();
+	}
+
+	// unrefine everything, siblings are on different processes
+	for (const auto& cell: grid.local_cells()) {
+		RLMin.data(*cell.data) =
+		RLMax.data(*cell.data) = 0;
+	}
+	pamhd::particle::adapt_grid(
+		grid, bg_B, vacuum_permeability, Face_B, Vol_B, Bg_B,
+		RLMin, RLMax, Part_Int, Part_Pos);
+	const auto [unrefined_nr, unrefined_mass] = check(grid, comm);
+	if (
+		unrefined_nr != nr_particles
+		or std::fabs(unrefined_mass - mass) > 1e-12 * mass
+	) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< unrefined_nr << " " << nr_particles << ", "
+			<< unrefined_mass << " " << mass << std::endl;
+		abort();
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
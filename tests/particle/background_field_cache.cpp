@@ -0,0 +1,172 @@
+/*
+Tests cached background magnetic field of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "random"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell
+#include "gensimcell.hpp"
+#include "rapidjson/document.h"
+
+#include "background_magnetic_field.hpp"
+#include "common_functions.hpp"
+#include "particle/background_field_cache.hpp"
+#include "particle/variables.hpp"
+
+using namespace std;
+
+using Cell = pamhd::particle::Cell_test_particle;
+using Grid = dccrg::Dccrg<Cell, dccrg::Cartesian_Geometry>;
+
+
+int main(int argc, char* argv[])
+{
+	using std::cerr;
+	using std::endl;
+
+	constexpr double Re = 6.371e6, mu0 = 1.257e-06;
+
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Couldn't initialize MPI." << endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0;
+	if (MPI_Comm_rank(comm, &rank) != MPI_SUCCESS) {
+		cerr << "Couldn't obtain MPI rank." << endl;
+		abort();
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed." << endl;
+		abort();
+	}
+
+	Grid grid;
+	grid
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RANDOM")
+		.set_initial_length({30, 30, 30})
+		.initialize(comm)
+		.balance_load();
+
+	dccrg::Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{-6.0 * Re, -6.0 * Re, -6.0 * Re}};
+	geom_params.level_0_cell_length = {{0.4 * Re, 0.4 * Re, 0.4 * Re}};
+	grid.set_geometry(geom_params);
+
+	rapidjson::Document document;
+	document.Parse(
+		"{\"background-magnetic-field\": {"
+		"	\"value\": [1e-9, 0, 0],"
+		"	\"dipoles\": ["
+		"		{\"moment\": [0, 0, -7.94e22], \"position\": [0, 0, 0]}"
+		"	]"
+		"}}"
+	);
+	if (document.HasParseError()) {
+		cerr << __FILE__ "(" << __LINE__ << "): Couldn't parse json data." << endl;
+		abort();
+	}
+	pamhd::Background_Magnetic_Field<double, std::array<double, 3>> bg_B(document);
+
+	pamhd::particle::Background_Field_Cache cache(bg_B, mu0);
+	cache.update(grid);
+
+	std::mt19937_64 random_source(rank);
+	std::uniform_real_distribution<double> rel_dist(0, 1);
+	for (const auto& cell: grid.local_cells()) {
+		const auto
+			cell_min = grid.geometry.get_min(cell.id),
+			cell_length = grid.geometry.get_length(cell.id);
+
+		// corners must match analytic field exactly
+		const auto corner = cache.get_background_field(
+			cell.id, std::array<double, 3>{0, 0, 0});
+		const auto corner_ref = bg_B.get_background_field(cell_min, mu0);
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (corner[dim] != corner_ref[dim]) {
+				cerr << __FILE__ "(" << __LINE__ << "): " << dim
+					<< ": " << corner[dim] << " " << corner_ref[dim] << endl;
+				abort();
+			}
+		}
+
+		if (pamhd::norm(grid.geometry.get_center(cell.id)) < 3 * Re) {
+			continue;
+		}
+
+		const std::array<double, 3> rel{
+			rel_dist(random_source),
+			rel_dist(random_source),
+			rel_dist(random_source)
+		};
+		const std::array<double, 3> r{
+			cell_min[0] + rel[0] * cell_length[0],
+			cell_min[1] + rel[1] * cell_length[1],
+			cell_min[2] + rel[2] * cell_length[2]
+		};
+		const auto
+			cached = cache.get_background_field(cell.id, rel),
+			analytic = bg_B.get_background_field(r, mu0);
+		const auto error = pamhd::norm(pamhd::add(cached, pamhd::neg(analytic)));
+		if (error > 0.05 * pamhd::norm(analytic)) {
+			cerr << __FILE__ "(" << __LINE__ << "): cell " << cell.id
+				<< ", error " << error << " of " << pamhd::norm(analytic) << endl;
+			abort();
+		}
+	}
+
+	// non-local cells aren't tabulated
+	bool thrown = false;
+	try {
+		cache.get_vertex_fields(dccrg::error_cell);
+	} catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	if (not thrown) {
+		cerr << __FILE__ "(" << __LINE__ << ")" << endl;
+		abort();
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -31,6 +31,7 @@ Author(s): Ilja Honkonen
 #include "random"
 #include "streambuf"
 #include "string"
+#include "tuple"
 #include "vector"
 
 #include "boost/filesystem.hpp"
@@ -54,17 +55,23 @@ Author(s): Ilja Honkonen
 #include "math/interpolation.hpp"
 #include "math/nabla.hpp"
 #include "particle/accumulate_dccrg.hpp"
+#include "particle/amr.hpp"
+#include "particle/background_field_cache.hpp"
 #include "particle/boundaries.hpp"
 #include "particle/common.hpp"
 #include "particle/initialize.hpp"
+#include "particle/merger.hpp"
 #include "particle/options.hpp"
+#include "particle/random.hpp"
 #include "particle/save.hpp"
 #include "particle/solar_wind_box.hpp"
 #include "particle/solve_dccrg.hpp"
 #include "particle/splitter.hpp"
 #include "particle/variables.hpp"
+#include "reductions.hpp"
 #include "simulation_options.hpp"
 #include "solar_wind_box_options.hpp"
+#include "timers.hpp"
 #include "variable_getter.hpp"
 
 
@@ -149,12 +156,6 @@ using Cell = gensimcell::Cell<
 	pamhd::particle::Number_Of_Particles,
 	pamhd::particle::Max_Spatial_Velocity,
 	pamhd::particle::Max_Angular_Velocity,
-	pamhd::particle::Bdy_Number_Density,
-	pamhd::particle::Bdy_Velocity,
-	pamhd::particle::Bdy_Temperature,
-	pamhd::particle::Bdy_Species_Mass,
-	pamhd::particle::Bdy_Charge_Mass_Ratio,
-	pamhd::particle::Bdy_Nr_Particles_In_Cell,
 	pamhd::particle::Bulk_Mass,
 	pamhd::particle::Bulk_Momentum,
 	pamhd::particle::Bulk_Velocity,
@@ -564,6 +565,11 @@ int main(int argc, char* argv[]) {
 		cout << "done" << endl;
 	}
 
+	// background field for particle propagation
+	pamhd::particle::Background_Field_Cache background_B_cache(
+		background_B, options_sim.vacuum_permeability);
+	background_B_cache.update(grid);
+
 	for (const auto& cell: solar_wind_cells) {
 		if (CType.data(*cell.data) != 0) {
 			throw runtime_error(
@@ -647,13 +653,16 @@ int main(int argc, char* argv[]) {
 	const double time_end = options_sim.time_start + options_sim.time_length;
 	double
 		simulation_time = options_sim.time_start,
-		next_particle_save = options_particle.save_n;
+		next_particle_save = options_particle.save_n,
+		next_amr = options_grid.amr_n,
+		next_timers = options_sim.timers_n;
+	pamhd::Timers::enabled = options_sim.timers_n >= 0;
 
 	if (rank == 0) {
 		cout << "Initializing... " << endl;
 	}
 
-	std::mt19937_64 random_source;
+	pamhd::particle::Counter_Random_Source random_source;
 	uint64_t next_particle_id = pamhd::particle::initialize_plasma(
 		grid, simulation_time, options_sim, options_box,
 		options_particle, random_source, Part_Int
@@ -665,6 +674,7 @@ int main(int argc, char* argv[]) {
 		simulation_step,
 		grid,
 		simulation_time,
+		0.0,
 		options_sim,
 		options_box,
 		options_particle,
@@ -700,9 +710,10 @@ int main(int argc, char* argv[]) {
 		Vol_J, Edge_J, Vert_J, Vert_E, Nr_Ext, Max_v_part, Max_ω_part,
 		Part_Ext, Part_C2M, Part_Des, Face_dB, Bg_B,
 		Substep, Substep_Min,
-		Substep_Max, Face_B, background_B,
+		Substep_Max, Face_B, background_B_cache,
 		Timestep, 0,
-		options_particle.gyroperiod_time_step_factor, Vol_Qi, Vol_Ji, Vert_B
+		options_particle.gyroperiod_time_step_factor, Vol_Qi, Vol_Ji, Vert_B,
+		options_particle.max_orbit_subcycles
 	);
 	if (rank == 0) {
 		cout << "done" << endl;
@@ -735,6 +746,10 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
+	// per step global values
+	pamhd::Reductions reductions;
+	reductions.set(comm);
+
 	while (simulation_time < time_end) {
 		simulation_step++;
 
@@ -762,52 +777,88 @@ int main(int argc, char* argv[]) {
 				Vol_J, Edge_J, Vert_J, Vert_E, Nr_Ext, Max_v_part, Max_ω_part,
 				Part_Ext, Part_C2M, Part_Des, Face_dB, Bg_B,
 				Substep, Substep_Min,
-				Substep_Max, Face_B, background_B,
+				Substep_Max, Face_B, background_B_cache,
 				Timestep, until_end,
-				options_particle.gyroperiod_time_step_factor, Vol_Qi, Vol_Ji, Vert_B
+				options_particle.gyroperiod_time_step_factor, Vol_Qi, Vol_Ji, Vert_B,
+				options_particle.max_orbit_subcycles
 			);
 
-		if (rank == 0) {
-			cout << "Solution calculated at time " << simulation_time
-				<< " s, timestep " << dt << " s" << flush;
-		}
-
+		const double solved_time = simulation_time;
 		simulation_time += dt;
 
-		const auto avg_div = pamhd::math::get_divergence_face2volume(
+		// reduced with split counts during grid adaptation and boundaries
+		const auto local_div = pamhd::math::get_local_divergence_face2volume(
 			grid.local_cells(), grid,
 			Face_B, Div_B, CType
 		);
-		if (rank == 0) {
-			cout << ", average divergence " << avg_div;
-		}
 
-		const uint64_t splits_local = pamhd::particle::split_particles(
-			options_particle.min_particles, random_source,
-			grid, Part_Int, Part_Pos, Part_Mas, CType
-		);
-		uint64_t splits_global = 0;
-		if (MPI_Reduce(
-			&splits_local, &splits_global, 1,
-			MPI_UINT64_T, MPI_SUM, 0, comm
-		) != MPI_SUCCESS) {
-			std::cerr << __FILE__ "(" << __LINE__
-				<< "): Couldn't reduce max substep." << std::endl;
-			abort();
-		}
-		if (rank == 0) {
-			if (splits_global > 0) {
-				cout << ", " << splits_global << " particle(s) split" << endl;
-			} else {
-				cout << endl;
+		pamhd::Timer split_merge_timer("particle.split_merge");
+		const std::array<uint64_t, 2> splits_merges_local{
+			pamhd::particle::split_particles(
+				options_particle.min_particles, random_source, simulation_step,
+				grid, Part_Int, Part_Pos, Part_Mas, CType
+			),
+			pamhd::particle::merge_particles(
+				options_particle.max_particles, grid, Part_Int,
+				Part_Pos, Part_Mas, Part_Vel, Part_SpM, Part_C2M, CType
+			)
+		};
+		const auto
+			div_i = reductions.add_sum(local_div.first),
+			div_cells_i = reductions.add_sum(local_div.second),
+			splits_i = reductions.add_sum(splits_merges_local[0]),
+			merges_i = reductions.add_sum(splits_merges_local[1]);
+		reductions.start();
+		split_merge_timer.stop();
+
+		if (options_grid.amr_n > 0 and simulation_time >= next_amr) {
+			if (rank == 0) {
+				cout << "Adapting grid at time " << simulation_time << "..." << flush;
+			}
+			next_amr
+				+= options_grid.amr_n
+				* ceil((simulation_time - next_amr) / options_grid.amr_n);
+
+			pamhd::Timer amr_timer("amr");
+			pamhd::grid::set_minmax_refinement_level_sw_box(
+				options_grid, options_box, simulation_time,
+				grid, Ref_max, Ref_min
+			);
+			pamhd::particle::adapt_grid(
+				grid, background_B, options_sim.vacuum_permeability,
+				Face_B, Vol_B, Bg_B, Ref_min, Ref_max, Part_Int, Part_Pos
+			);
+			background_B_cache.update(grid);
+			std::tie(
+				solar_wind_cells, face_cells,
+				edge_cells, vert_cells, planet_cells
+			) = pamhd::grid::classify_cells_sw_box(options_box, grid, CType);
+			for (const auto& cell: grid.local_cells()) {
+				(*cell.data)[pamhd::MPI_Rank()] = rank;
+				Substep.data(*cell.data)     =
+				Substep_Max.data(*cell.data) =
+				Substep_Min.data(*cell.data) = 1;
+				Max_v_part.data(*cell.data) =
+				Max_ω_part.data(*cell.data) = -1;
+			}
+			Max_v_part.type().is_stale = true;
+			Max_ω_part.type().is_stale = true;
+			Substep.type().is_stale = true;
+			Substep_Max.type().is_stale = true;
+			Substep_Min.type().is_stale = true;
+			amr_timer.stop();
+			if (rank == 0) {
+				cout << " done" << endl;
 			}
 		}
 
+		pamhd::Timer boundary_timer("boundaries");
 		next_particle_id = pamhd::particle::apply_boundaries_sw_box(
 			next_particle_id,
 			simulation_step,
 			grid,
 			simulation_time,
+			dt,
 			options_sim,
 			options_box,
 			options_particle,
@@ -820,6 +871,24 @@ int main(int argc, char* argv[]) {
 			Part_Int,
 			CType
 		);
+		boundary_timer.stop();
+
+		const auto
+			div_cells = reductions.get(div_cells_i),
+			splits = reductions.get(splits_i),
+			merges = reductions.get(merges_i);
+		if (rank == 0) {
+			cout << "Solution calculated at time " << solved_time
+				<< " s, timestep " << dt << " s, average divergence "
+				<< (div_cells > 0 ? reductions.get(div_i) / div_cells : 0.0);
+			if (splits > 0) {
+				cout << ", " << uint64_t(splits) << " particle(s) split";
+			}
+			if (merges > 0) {
+				cout << ", " << uint64_t(merges) << " particle(s) merged";
+			}
+			cout << endl;
+		}
 
 		if (
 			(options_particle.save_n >= 0 and simulation_time >= time_end)
@@ -831,6 +900,7 @@ int main(int argc, char* argv[]) {
 					* ceil(max(options_particle.save_n, simulation_time - next_particle_save) / options_particle.save_n);
 			}
 
+			pamhd::Timer save_timer("save");
 			if (rank == 0) {
 				cout << "Saving particles at time " << simulation_time << "... " << endl;
 			}
@@ -860,6 +930,23 @@ int main(int argc, char* argv[]) {
 				abort();
 			}
 		}
+
+		if (
+			(options_sim.timers_n >= 0 and simulation_time >= time_end)
+			or (options_sim.timers_n > 0 and simulation_time >= next_timers)
+		) {
+			if (next_timers <= simulation_time) {
+				next_timers
+					+= options_sim.timers_n
+					* ceil(max(options_sim.timers_n, simulation_time - next_timers) / options_sim.timers_n);
+			}
+			pamhd::Timers::report(
+				comm, simulation_time, cout,
+				boost::filesystem::canonical(
+					boost::filesystem::path(options_sim.output_directory)
+				).append("timers.json").generic_string()
+			);
+		}
 	}
 
 	if (rank == 0) {
@@ -0,0 +1,256 @@
+/*
+Tests creation of inflowing particles of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "random"
+#include "vector"
+
+#include "particle/common.hpp"
+#include "particle/variables.hpp"
+
+
+using namespace std;
+using namespace pamhd::particle;
+
+
+// mean of x*x*exp(-(x-s)^2/2) / x*exp(-(x-s)^2/2), x > 0
+double get_mean_inflow_speed(const double drift)
+{
+	double nominator = 0, denominator = 0;
+	const double step = 1e-4;
+	for (double x = step / 2; x < drift + 20; x += step) {
+		const auto f = x * exp(-(x - drift) * (x - drift) / 2);
+		nominator += x * f;
+		denominator += f;
+	}
+	return nominator / denominator;
+}
+
+
+int main()
+{
+	const Position Pos{};
+	const Velocity Vel{};
+	const Mass Mas{};
+
+	// sampled speeds follow flux weighted distribution
+	std::mt19937_64 random_source(1);
+	for (const double drift: {-3.0, -0.5, 0.0, 0.5, 2.0, 8.0}) {
+		const int samples = 200000;
+		double mean = 0;
+		for (int i = 0; i < samples; i++) {
+			const auto speed = get_inflow_speed(drift, random_source);
+			if (speed <= 0) {
+				std::cerr << __FILE__ << "(" << __LINE__ << "): "
+					<< drift << " " << speed << std::endl;
+				abort();
+			}
+			mean += speed;
+		}
+		mean /= samples;
+		const auto ref = get_mean_inflow_speed(drift);
+		if (abs(mean - ref) > 0.01 * ref) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< drift << " " << mean << " " << ref << std::endl;
+			abort();
+		}
+	}
+
+	// flux of cold plasma is n*v
+	if (abs(get_inflow_flux(3, 0, 2) - 6) > 1e-12) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+	// half of thermal flux crosses surface in each direction
+	if (abs(get_inflow_flux(2, 1, 0) - 2 / sqrt(2 * M_PI)) > 1e-12) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	// solar wind flowing in -x direction into domain at -x face
+	const array<double, 3>
+		bulk_velocity{-4e5, 1e4, 0},
+		volume_min{10, -1, -2},
+		volume_max{11, 2, 3};
+	const double
+		dt = 1e-6,
+		temperature = 1e5,
+		nr_density = 5e6,
+		species_mass = 1.67e-27,
+		temp2nrj = 1.38e-23;
+	const size_t particles_in_cell = 100;
+
+	const auto particles = create_inflowing_particles<
+		Particle_Internal,
+		Mass,
+		Charge_Mass_Ratio,
+		Position,
+		Velocity,
+		Particle_ID,
+		Species_Mass
+	>(
+		bulk_velocity, volume_min, volume_max, -1, dt,
+		temperature, nr_density, particles_in_cell, 1,
+		species_mass, temp2nrj, random_source, 0, 1
+	);
+	if (particles.size() == 0) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	const auto
+		thermal_speed = sqrt(temp2nrj * temperature / species_mass),
+		ref_mass
+			= species_mass * dt * 3 * 5
+			* get_inflow_flux(nr_density, thermal_speed, -bulk_velocity[0]);
+	double total_mass = 0;
+	for (const auto& particle: particles) {
+		total_mass += particle[Mas];
+		// every particle enters domain during dt
+		if (particle[Vel][0] >= 0) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< particle[Vel][0] << std::endl;
+			abort();
+		}
+		const auto distance = particle[Pos][0] - volume_min[0];
+		if (distance < 0 or distance > -particle[Vel][0] * dt) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< distance << std::endl;
+			abort();
+		}
+		for (size_t dim = 1; dim < 3; dim++) {
+			if (
+				particle[Pos][dim] < volume_min[dim]
+				or particle[Pos][dim] > volume_max[dim]
+			) {
+				std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+				abort();
+			}
+		}
+	}
+	if (abs(total_mass - ref_mass) > 1e-9 * ref_mass) {
+		std::cerr << __FILE__ << "(" << __LINE__ << "): "
+			<< total_mass << " " << ref_mass << std::endl;
+		abort();
+	}
+
+	// nothing is created without time step
+	if (create_inflowing_particles<
+		Particle_Internal,
+		Mass,
+		Charge_Mass_Ratio,
+		Position,
+		Velocity,
+		Particle_ID,
+		Species_Mass
+	>(
+		bulk_velocity, volume_min, volume_max, -1, 0,
+		temperature, nr_density, particles_in_cell, 1,
+		species_mass, temp2nrj, random_source, 0, 1
+	).size() > 0) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	/*
+	mass crossing face over steps of varying length
+	matches flux when volume is stocked after each step
+	*/
+	std::vector<Particle_Internal> stock;
+	size_t next_id = stock_inflowing_particles<
+		Particle_Internal,
+		Mass,
+		Charge_Mass_Ratio,
+		Position,
+		Velocity,
+		Particle_ID,
+		Species_Mass
+	>(
+		stock, bulk_velocity, volume_min, volume_max, -1, 0,
+		temperature, nr_density, 20000, 1,
+		species_mass, temp2nrj, random_source, 0, 1
+	);
+	double crossed_mass = 0, total_time = 0;
+	for (const double step: {1e-6, 2e-7, 1.2e-6, 5e-7, 9e-7, 1e-7, 1e-6}) {
+		for (auto& particle: stock) {
+			for (size_t dim = 0; dim < 3; dim++) {
+				particle[Pos][dim] += particle[Vel][dim] * step;
+			}
+			if (particle[Pos][0] < volume_min[0]) {
+				crossed_mass += particle[Mas];
+				particle[Mas] = 0;
+			}
+		}
+		std::erase_if(stock, [&](const auto& particle) {
+			return particle[Mas] == 0;
+		});
+		total_time += step;
+
+		next_id += stock_inflowing_particles<
+			Particle_Internal,
+			Mass,
+			Charge_Mass_Ratio,
+			Position,
+			Velocity,
+			Particle_ID,
+			Species_Mass
+		>(
+			stock, bulk_velocity, volume_min, volume_max, -1, step,
+			temperature, nr_density, 20000, 1,
+			species_mass, temp2nrj, random_source, next_id, 1
+		);
+		for (const auto& particle: stock) {
+			if (
+				particle[Vel][0] >= 0
+				or particle[Pos][0] < volume_min[0]
+				or particle[Pos][0] > volume_max[0]
+			) {
+				std::cerr << __FILE__ << "(" << __LINE__ << "): "
+					<< particle[Pos][0] << " " << particle[Vel][0] << std::endl;
+				abort();
+			}
+		}
+	}
+	const auto ref_crossed_mass
+		= species_mass * total_time * 3 * 5
+		* get_inflow_flux(nr_density, thermal_speed, -bulk_velocity[0]);
+	if (abs(crossed_mass - ref_crossed_mass) > 0.01 * ref_crossed_mass) {
+		std::cerr << __FILE__ << "(" << __LINE__ << "): "
+			<< crossed_mass << " " << ref_crossed_mass << std::endl;
+		abort();
+	}
+
+	return EXIT_SUCCESS;
+}
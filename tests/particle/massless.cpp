@@ -60,6 +60,7 @@ be used in config file.
 #include "boundaries/geometries.hpp"
 #include "boundaries/multivariable_boundaries.hpp"
 #include "boundaries/multivariable_initial_conditions.hpp"
+#include "boundaries/sparse_cell_data.hpp"
 #include "grid/options.hpp"
 #include "mhd/initialize.hpp"
 #include "mhd/options.hpp"
@@ -124,24 +125,27 @@ const auto Max_ω_part = pamhd::Variable_Getter<pamhd::particle::Max_Angular_Vel
 bool pamhd::particle::Max_Angular_Velocity::is_stale = true;
 
 // references to initial condition & boundary data of cell
-const auto Bdy_N = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Number_Density()];
-};
-const auto Bdy_V = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Velocity()];
-};
-const auto Bdy_T = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Temperature()];
-};
-const auto Bdy_Nr_Par = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Nr_Particles_In_Cell()];
-};
-const auto Bdy_SpM = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Species_Mass()];
-};
-const auto Bdy_C2M = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Charge_Mass_Ratio()];
-};
+pamhd::boundaries::Sparse_Cell_Data<
+	Cell,
+	pamhd::particle::Bdy_Number_Density,
+	pamhd::particle::Bdy_Velocity,
+	pamhd::particle::Bdy_Temperature,
+	pamhd::particle::Bdy_Species_Mass,
+	pamhd::particle::Bdy_Charge_Mass_Ratio,
+	pamhd::particle::Bdy_Nr_Particles_In_Cell
+> particle_bdy_data;
+const auto Bdy_N
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Number_Density>();
+const auto Bdy_V
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Velocity>();
+const auto Bdy_T
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Temperature>();
+const auto Bdy_Nr_Par
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Nr_Particles_In_Cell>();
+const auto Bdy_SpM
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Species_Mass>();
+const auto Bdy_C2M
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Charge_Mass_Ratio>();
 
 // given a particle these return references to particle's parameters
 const auto Part_Pos = [](
@@ -277,7 +281,8 @@ int main(int argc, char* argv[])
 		geometry_id_t,
 		std::array<double, 3>,
 		double,
-		uint64_t
+		uint64_t,
+		Cell
 	> geometries;
 	geometries.set(document);
 
@@ -336,6 +341,8 @@ int main(int argc, char* argv[])
 		.set_initial_length(number_of_cells)
 		.initialize(comm)
 		.balance_load();
+	// boundary data until boundary cells are known
+	particle_bdy_data.allocate(grid);
 
 	// set grid geometry
 	const std::array<double, 3>
@@ -359,12 +366,7 @@ int main(int argc, char* argv[])
 	}
 
 	// assign cells into boundary geometries
-	for (const auto& cell: grid.local_cells()) {
-		const auto
-			start = grid.geometry.get_min(cell.id),
-			end = grid.geometry.get_max(cell.id);
-		geometries.overlaps(start, end, cell.id);
-	}
+	geometries.classify(grid, grid.local_cells());
 
 
 	/*
@@ -464,6 +466,8 @@ int main(int argc, char* argv[])
 			Bdy_C2M
 		);
 	next_particle_id += nr_particles_created * grid.get_comm_size();
+	// initial condition is done, boundaries only need their own cells
+	particle_bdy_data.retain(grid, geometries);
 
 	if (rank == 0) {
 		cout << "Done initializing particles" << endl;
@@ -0,0 +1,169 @@
+/*
+Tests particle merging of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "random"
+#include "vector"
+
+#include "particle/merger.hpp"
+
+
+struct Particle {
+	std::array<double, 3> r, v;
+	double mass, species_mass, c2m;
+};
+
+const auto Part_Pos = [](Particle& p)->auto& { return p.r; };
+const auto Part_Vel = [](Particle& p)->auto& { return p.v; };
+const auto Part_Mas = [](Particle& p)->auto& { return p.mass; };
+const auto Part_SpM = [](Particle& p)->auto& { return p.species_mass; };
+const auto Part_C2M = [](Particle& p)->auto& { return p.c2m; };
+
+
+// mass, momentum, energy and center of mass of given species
+std::array<double, 8> get_moments(
+	std::vector<Particle>& particles,
+	const double species_mass
+) {
+	std::array<double, 8> ret_val{0, 0, 0, 0, 0, 0, 0, 0};
+	for (auto& p: particles) {
+		if (p.species_mass != species_mass) {
+			continue;
+		}
+		ret_val[0] += p.mass;
+		for (size_t dim = 0; dim < 3; dim++) {
+			ret_val[1 + dim] += p.mass * p.v[dim];
+			ret_val[5 + dim] += p.mass * p.r[dim];
+		}
+		ret_val[4] += 0.5 * p.mass
+			* (p.v[0]*p.v[0] + p.v[1]*p.v[1] + p.v[2]*p.v[2]);
+	}
+	return ret_val;
+}
+
+
+int main()
+{
+	using std::fabs;
+
+	std::mt19937_64 random_source(1);
+	std::normal_distribution<double>
+		vel1(1e5, 3e4), vel2(-2e5, 1e5);
+	std::uniform_real_distribution<double> pos(-1, 1);
+
+	std::vector<Particle> particles;
+	for (size_t i = 0; i < 700; i++) {
+		particles.push_back({
+			{pos(random_source), pos(random_source), pos(random_source)},
+			{vel1(random_source), vel1(random_source), vel1(random_source)},
+			1.5, 1, 1
+		});
+	}
+	for (size_t i = 0; i < 300; i++) {
+		particles.push_back({
+			{pos(random_source), pos(random_source), pos(random_source)},
+			{vel2(random_source), vel2(random_source), vel2(random_source)},
+			40, 16, 0.5
+		});
+	}
+	// test particle isn't merged
+	particles.push_back({{0, 0, 0}, {1, 2, 3}, 0, 1, 1});
+
+	const auto
+		before1 = get_moments(particles, 1),
+		before16 = get_moments(particles, 16);
+
+	const size_t max_particles = 101;
+	const auto removed = pamhd::particle::merge(
+		particles, max_particles,
+		Part_Pos, Part_Mas, Part_Vel, Part_SpM, Part_C2M
+	);
+	if (particles.size() > max_particles) {
+		std::cerr << __FILE__ << "(" << __LINE__ << "): "
+			<< particles.size() << " particles left" << std::endl;
+		abort();
+	}
+	if (removed + particles.size() != 1001) {
+		std::cerr << __FILE__ << "(" << __LINE__ << "): "
+			<< removed << " " << particles.size() << std::endl;
+		abort();
+	}
+
+	const auto
+		after1 = get_moments(particles, 1),
+		after16 = get_moments(particles, 16);
+	for (size_t i = 0; i < before1.size(); i++) {
+		if (fabs(before1[i] - after1[i]) > 1e-9 * fabs(before1[i]) + 1e-9) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< i << ": " << before1[i] << " " << after1[i] << std::endl;
+			abort();
+		}
+		if (fabs(before16[i] - after16[i]) > 1e-9 * fabs(before16[i]) + 1e-9) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< i << ": " << before16[i] << " " << after16[i] << std::endl;
+			abort();
+		}
+	}
+
+	size_t test_particles = 0;
+	for (auto& p: particles) {
+		if (p.mass == 0) {
+			test_particles++;
+			if (p.v[0] != 1 or p.v[1] != 2 or p.v[2] != 3) {
+				std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+				abort();
+			}
+		}
+		if (p.species_mass == 1 and p.c2m != 1) {
+			std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+			abort();
+		}
+	}
+	if (test_particles != 1) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	// nothing to do if below maximum
+	if (pamhd::particle::merge(
+		particles, max_particles,
+		Part_Pos, Part_Mas, Part_Vel, Part_SpM, Part_C2M
+	) != 0) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	return EXIT_SUCCESS;
+}
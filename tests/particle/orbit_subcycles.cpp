@@ -0,0 +1,351 @@
+/*
+Tests orbit subcycling of particle solvers of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell.hpp
+#include "gensimcell.hpp"
+
+#include "background_magnetic_field.hpp"
+#include "common_variables.hpp"
+#include "particle/solve_dccrg.hpp"
+#include "particle/variables.hpp"
+#include "variable_getter.hpp"
+
+
+using Cell = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	pamhd::Cell_Type,
+	pamhd::Magnetic_Field,
+	pamhd::particle::Electric_Field,
+	pamhd::particle::Vertex_Magnetic_Field,
+	pamhd::particle::Vertex_Electric_Field,
+	pamhd::particle::Max_Spatial_Velocity,
+	pamhd::particle::Max_Angular_Velocity,
+	pamhd::particle::Nr_Particles_External,
+	pamhd::particle::Particles_Internal,
+	pamhd::particle::Particles_External
+>;
+using Grid = dccrg::Dccrg<Cell, dccrg::Cartesian_Geometry>;
+
+const auto CType = pamhd::Variable_Getter<pamhd::Cell_Type>();
+bool pamhd::Cell_Type::is_stale = true;
+
+const auto Vol_B = pamhd::Variable_Getter<pamhd::Magnetic_Field>();
+bool pamhd::Magnetic_Field::is_stale = true;
+
+const auto Ele = pamhd::Variable_Getter<pamhd::particle::Electric_Field>();
+bool pamhd::particle::Electric_Field::is_stale = true;
+
+const auto Vert_B = pamhd::Variable_Getter<pamhd::particle::Vertex_Magnetic_Field>();
+bool pamhd::particle::Vertex_Magnetic_Field::is_stale = true;
+
+const auto Vert_E = pamhd::Variable_Getter<pamhd::particle::Vertex_Electric_Field>();
+bool pamhd::particle::Vertex_Electric_Field::is_stale = true;
+
+const auto Max_v_part = pamhd::Variable_Getter<pamhd::particle::Max_Spatial_Velocity>();
+bool pamhd::particle::Max_Spatial_Velocity::is_stale = true;
+
+const auto Max_ω_part = pamhd::Variable_Getter<pamhd::particle::Max_Angular_Velocity>();
+bool pamhd::particle::Max_Angular_Velocity::is_stale = true;
+
+const auto Nr_Ext = pamhd::Variable_Getter<pamhd::particle::Nr_Particles_External>();
+bool pamhd::particle::Nr_Particles_External::is_stale = true;
+
+const auto Part_Ext = pamhd::Variable_Getter<pamhd::particle::Particles_External>();
+bool pamhd::particle::Particles_External::is_stale = true;
+
+const auto Part_Int = [](Cell& cell_data)->auto& {
+	return cell_data[pamhd::particle::Particles_Internal()];
+};
+const auto Part_Pos = [](
+	pamhd::particle::Particle_Internal& particle
+)->auto& {
+	return particle[pamhd::particle::Position()];
+};
+const auto Part_Vel = [](
+	pamhd::particle::Particle_Internal& particle
+)->auto& {
+	return particle[pamhd::particle::Velocity()];
+};
+const auto Part_C2M = [](
+	pamhd::particle::Particle_Internal& particle
+)->auto& {
+	return particle[pamhd::particle::Charge_Mass_Ratio()];
+};
+const auto Part_Mas = [](
+	pamhd::particle::Particle_Internal& particle
+)->auto& {
+	return particle[pamhd::particle::Mass()];
+};
+const auto Part_Des = [](
+	pamhd::particle::Particle_External& particle
+)->auto& {
+	return particle[pamhd::particle::Destination_Cell()];
+};
+
+/*
+Particle gyrates in uniform magnetic field along +z and drifts
+slowly along it, radius of gyration is small enough for particle
+to stay in its cell.
+*/
+constexpr double
+	B0 = 2,
+	charge_mass_ratio = 3,
+	angular_velocity = charge_mass_ratio * B0,
+	gyroperiod = 2 * M_PI / angular_velocity,
+	perp_speed = 0.3,
+	para_speed = 0.02,
+	gyroradius = perp_speed / angular_velocity;
+constexpr std::array<double, 3> start{1.5, 1.5, 1.5};
+
+
+//! Aborts if get_orbit_subcycles() returns other than expected.
+void check_subcycles(
+	const double ω,
+	const double dt,
+	const double factor,
+	const unsigned int max_subcycles,
+	const unsigned int expected,
+	const int line
+) {
+	const auto subcycles = pamhd::particle::detail::get_orbit_subcycles(
+		ω, dt, factor, max_subcycles);
+	if (subcycles != expected) {
+		std::cerr << __FILE__ "(" << line << "): "
+			<< subcycles << " " << expected << std::endl;
+		abort();
+	}
+}
+
+
+/*!
+Propagates particle steps times with given solver and aborts
+if its position, speed or phase differ from analytic gyration.
+
+Returns number of processes whose cell had particle.
+*/
+int check_gyration(
+	Grid& grid,
+	const bool hybrid,
+	const double dt,
+	const int steps,
+	const unsigned int max_subcycles,
+	const double gyroperiod_factor
+) {
+	for (const auto& cell: grid.local_cells()) {
+		Part_Int(*cell.data).clear();
+		Part_Ext.data(*cell.data).clear();
+		Nr_Ext.data(*cell.data) = 0;
+		if (grid.geometry.get_cell(0, start) != cell.id) {
+			continue;
+		}
+		pamhd::particle::Particle_Internal particle;
+		Part_Pos(particle) = start;
+		Part_Vel(particle) = {perp_speed, 0, para_speed};
+		Part_C2M(particle) = charge_mass_ratio;
+		Part_Mas(particle) = 1;
+		Part_Int(*cell.data).push_back(particle);
+	}
+
+	pamhd::Background_Magnetic_Field<double, std::array<double, 3>> bg_B;
+	for (int step = 0; step < steps; step++) {
+		if (hybrid) {
+			pamhd::particle::solve_hyb(
+				dt, grid.local_cells(), grid, bg_B, 1, Vert_E,
+				Nr_Ext, Part_Int, Part_Ext, Max_v_part, Max_ω_part,
+				Part_Pos, Part_Vel, Part_C2M, Part_Mas, Part_Des,
+				CType, Vert_B, 1, pamhd::particle::detail::No_Substeps(),
+				max_subcycles, gyroperiod_factor
+			);
+		} else {
+			pamhd::particle::solve(
+				dt, grid.local_cells(), grid, bg_B, 1, false, Ele,
+				Vol_B, Nr_Ext, Part_Int, Part_Ext, Max_v_part, Max_ω_part,
+				Part_Pos, Part_Vel, Part_C2M, Part_Mas, Part_Des,
+				CType, 1, pamhd::particle::detail::No_Substeps(),
+				max_subcycles, gyroperiod_factor
+			);
+		}
+	}
+
+	const double
+		time = dt * steps,
+		phase = angular_velocity * time;
+	const std::array<double, 3>
+		ref_pos{
+			start[0] + gyroradius * std::sin(phase),
+			start[1] + gyroradius * (std::cos(phase) - 1),
+			start[2] + para_speed * time
+		};
+
+	int found = 0;
+	for (const auto& cell: grid.local_cells()) {
+		if (Part_Ext.data(*cell.data).size() > 0) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Particle left cell " << cell.id << std::endl;
+			abort();
+		}
+		if (Part_Int(*cell.data).size() == 0) {
+			continue;
+		}
+		found++;
+
+		auto& particle = Part_Int(*cell.data)[0];
+		const auto pos = pamhd::particle::get_absolute_position(
+			Part_Pos(particle),
+			grid.geometry.get_min(cell.id),
+			grid.geometry.get_length(cell.id));
+		const auto& vel = Part_Vel(particle);
+
+		const auto speed = std::sqrt(vel[0]*vel[0] + vel[1]*vel[1]);
+		if (
+			std::fabs(speed - perp_speed) > 1e-10 * perp_speed
+			or std::fabs(vel[2] - para_speed) > 1e-10 * para_speed
+		) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< speed << " " << vel[2] << std::endl;
+			abort();
+		}
+
+		const auto phase_error = std::remainder(
+			std::atan2(-vel[1], vel[0]) - phase, 2 * M_PI);
+		if (std::fabs(phase_error) > 1e-8) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< phase_error << std::endl;
+			abort();
+		}
+
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (std::fabs(pos[dim] - ref_pos[dim]) > 0.05 * gyroradius) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): "
+					<< dim << " " << pos[dim] << " " << ref_pos[dim] << std::endl;
+				abort();
+			}
+		}
+
+		// global time step isn't restricted by subcycled gyration
+		if (
+			std::fabs(
+				Max_ω_part.data(*cell.data)
+				- angular_velocity / std::max(1u, max_subcycles)
+			) > 1e-10 * angular_velocity
+		) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< Max_ω_part.data(*cell.data) << std::endl;
+			abort();
+		}
+	}
+	return found;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	// no subcycling
+	check_subcycles(100, 1, 0.01, 1, 1, __LINE__);
+	check_subcycles(100, 1, 0.01, 0, 1, __LINE__);
+	check_subcycles(100, 1, 0, 10, 1, __LINE__);
+	check_subcycles(100, 1, -1, 10, 1, __LINE__);
+	// needed <= 1
+	check_subcycles(0, 1, 0.01, 10, 1, __LINE__);
+	check_subcycles(1, 1, 1, 10, 1, __LINE__);
+	check_subcycles(2 * M_PI, 1, 1, 10, 1, __LINE__);
+	check_subcycles(NAN, 1, 1, 10, 1, __LINE__);
+	// ceil(2.5)
+	check_subcycles(5 * M_PI, 1, 1, 10, 3, __LINE__);
+	// cap reached
+	check_subcycles(2 * M_PI * 10, 1, 1, 10, 10, __LINE__);
+	check_subcycles(2 * M_PI * 100, 1, 1, 10, 10, __LINE__);
+
+	Grid grid;
+	grid
+		.set_initial_length({3, 3, 3})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_periodic(true, true, true)
+		.set_load_balancing_method("RANDOM")
+		.initialize(comm)
+		.balance_load();
+
+	dccrg::Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{0, 0, 0}};
+	geom_params.level_0_cell_length = {{1, 1, 1}};
+	grid.set_geometry(geom_params);
+
+	for (const auto& cell: grid.local_cells()) {
+		CType.data(*cell.data) = 1;
+		Vol_B.data(*cell.data) = {0, 0, B0};
+		Ele.data(*cell.data) = {0, 0, 0};
+		Vert_B.data(*cell.data).vertex.fill({0, 0, B0});
+		Vert_E.data(*cell.data).vertex.fill({0, 0, 0});
+	}
+	grid.update_copies_of_remote_neighbors();
+
+	for (const bool hybrid: {false, true}) {
+		int found_local = 0;
+		// one Boris step per 1/200 gyroperiod
+		found_local += check_gyration(
+			grid, hybrid, gyroperiod / 200, 660, 1, 1);
+		// time step of several gyroperiods, 660 subcycles per step
+		found_local += check_gyration(
+			grid, hybrid, 3.3 * gyroperiod, 3, 1000, 0.005);
+		int found = 0;
+		MPI_Allreduce(&found_local, &found, 1, MPI_INT, MPI_SUM, comm);
+		if (found != 2) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): " << found << std::endl;
+			abort();
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/*
+Tests counter based random number generator of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "random"
+#include "vector"
+
+#include "particle/random.hpp"
+
+
+using namespace pamhd::particle;
+
+
+int main()
+{
+	// known answers of Random123 library
+	if (
+		Counter_Random_Source::philox({0, 0, 0, 0}, {0, 0})
+		!= std::array<uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}
+	) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+	if (
+		Counter_Random_Source::philox(
+			{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+			{0xffffffff, 0xffffffff}
+		)
+		!= std::array<uint32_t, 4>{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}
+	) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	// sequences don't depend on order in which they're used
+	Counter_Random_Source source1(123), source2(123);
+	std::vector<uint64_t> forward, backward;
+	for (uint64_t cell = 1; cell <= 10; cell++) {
+		set_random_stream(source1, cell, 5, random_stream::split);
+		for (int i = 0; i < 7; i++) {
+			forward.push_back(source1());
+		}
+	}
+	for (uint64_t cell = 10; cell >= 1; cell--) {
+		set_random_stream(source2, cell, 5, random_stream::split);
+		for (int i = 0; i < 7; i++) {
+			backward.push_back(source2());
+		}
+	}
+	for (size_t cell = 0; cell < 10; cell++) {
+		for (size_t i = 0; i < 7; i++) {
+			if (forward[cell * 7 + i] != backward[(9 - cell) * 7 + i]) {
+				std::cerr << __FILE__ << "(" << __LINE__ << "): "
+					<< cell << " " << i << std::endl;
+				abort();
+			}
+		}
+	}
+
+	// different step, stream or seed gives different numbers
+	set_random_stream(source1, 1, 6, random_stream::split);
+	if (source1() == forward[0]) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+	set_random_stream(source1, 1, 5, random_stream::initialize);
+	if (source1() == forward[0]) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+	Counter_Random_Source source3(124);
+	set_random_stream(source3, 1, 5, random_stream::split);
+	if (source3() == forward[0]) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	// discard is equivalent to drawing
+	for (unsigned int skip = 0; skip < 6; skip++) {
+		set_random_stream(source1, 3, 5, random_stream::split);
+		source1();
+		source1.discard(skip);
+		if (source1() != forward[2 * 7 + 1 + skip]) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): " << skip << std::endl;
+			abort();
+		}
+	}
+
+	// usable with standard distributions
+	set_random_stream(source1, 1, 0, random_stream::initialize);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	double mean = 0;
+	const int samples = 100000;
+	for (int i = 0; i < samples; i++) {
+		const auto value = uniform(source1);
+		if (value < 0 or value >= 1) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): " << value << std::endl;
+			abort();
+		}
+		mean += value;
+	}
+	mean /= samples;
+	if (mean < 0.49 or mean > 0.51) {
+		std::cerr << __FILE__ << "(" << __LINE__ << "): " << mean << std::endl;
+		abort();
+	}
+
+	// other sources are seeded with legacy seed
+	std::mt19937_64 legacy1, legacy2(42);
+	set_random_stream(legacy1, 1, 0, random_stream::initialize, 42);
+	if (legacy1() != legacy2()) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+/*
+Tests cell-relative particle positions of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+
+#include "particle/relative_position.hpp"
+
+
+using namespace std;
+using namespace pamhd::particle;
+
+
+int main()
+{
+	// far from origin absolute float coordinates would have
+	// resolution of ~1e3 so small steps would be lost
+	const std::array<double, 3>
+		cell_min{1e10, -2e10, 3e10},
+		cell_length{1e4, 2e4, 5e3};
+
+	const std::array<double, 3> abs_pos{
+		cell_min[0] + 0.25 * cell_length[0],
+		cell_min[1] + 0.5 * cell_length[1],
+		cell_min[2] + 0.75 * cell_length[2]
+	};
+	auto rel_pos = get_relative_position<float>(abs_pos, cell_min, cell_length);
+	if (not is_inside_cell(rel_pos)) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+	const auto abs_pos2 = get_absolute_position(rel_pos, cell_min, cell_length);
+	for (size_t dim = 0; dim < 3; dim++) {
+		if (fabs(abs_pos2[dim] - abs_pos[dim]) > 1e-6 * cell_length[dim]) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< dim << ": " << abs_pos2[dim] << " " << abs_pos[dim]
+				<< std::endl;
+			abort();
+		}
+	}
+
+	// step of 1 m must not be lost
+	const std::array<double, 3> step{1, -1, 1};
+	const auto moved = get_displaced_position(rel_pos, step, cell_length);
+	const auto abs_moved = get_absolute_position(moved, cell_min, cell_length);
+	for (size_t dim = 0; dim < 3; dim++) {
+		const auto diff = abs_moved[dim] - abs_pos2[dim];
+		if (fabs(diff - step[dim]) > 1e-2) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< dim << ": " << diff << std::endl;
+			abort();
+		}
+	}
+
+	// move into neighbor at +x, -z
+	const std::array<double, 3> step2{
+		0.9 * cell_length[0], 0, -0.8 * cell_length[2]
+	};
+	const auto outside = get_displaced_position(rel_pos, step2, cell_length);
+	if (is_inside_cell(outside)) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+	const auto offset = get_cell_offset(outside);
+	if (offset[0] != 1 or offset[1] != 0 or offset[2] != -1) {
+		std::cerr << __FILE__ << "(" << __LINE__ << "): "
+			<< offset[0] << " " << offset[1] << " " << offset[2]
+			<< std::endl;
+		abort();
+	}
+
+	// neighbor twice as large with same min corner as offset
+	const std::array<double, 3> neigh_length{
+		2 * cell_length[0], 2 * cell_length[1], 2 * cell_length[2]
+	};
+	const std::array<double, 3> neigh_offset{1, 0, -2};
+	const auto renormalized = renormalize(
+		outside, cell_length, neigh_offset, neigh_length);
+	if (not is_inside_cell(renormalized)) {
+		std::cerr << __FILE__ << "(" << __LINE__ << "): "
+			<< renormalized[0] << " " << renormalized[1] << " "
+			<< renormalized[2] << std::endl;
+		abort();
+	}
+	const std::array<double, 3> neigh_min{
+		cell_min[0] + neigh_offset[0] * cell_length[0],
+		cell_min[1] + neigh_offset[1] * cell_length[1],
+		cell_min[2] + neigh_offset[2] * cell_length[2]
+	};
+	const auto
+		abs_outside = get_absolute_position(outside, cell_min, cell_length),
+		abs_renormalized = get_absolute_position(
+			renormalized, neigh_min, neigh_length);
+	for (size_t dim = 0; dim < 3; dim++) {
+		if (fabs(abs_outside[dim] - abs_renormalized[dim]) > 1e-6 * neigh_length[dim]) {
+			std::cerr << __FILE__ << "(" << __LINE__ << "): "
+				<< dim << ": " << abs_outside[dim] << " " << abs_renormalized[dim]
+				<< std::endl;
+			abort();
+		}
+	}
+
+	// absolute positions are returned as is
+	const auto same = get_absolute_position(abs_pos, cell_min, cell_length);
+	if (same != abs_pos) {
+		std::cerr << __FILE__ << "(" << __LINE__ << ")" << std::endl;
+		abort();
+	}
+	static_assert(is_cell_relative<decltype(rel_pos)>());
+	static_assert(not is_cell_relative<decltype(abs_pos)>());
+
+	return EXIT_SUCCESS;
+}
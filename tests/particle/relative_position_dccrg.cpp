@@ -0,0 +1,415 @@
+/*
+Tests particle propagation and accumulation of PAMHD with cell relative positions.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "limits"
+#include "map"
+#include "tuple"
+#include "vector"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+#include "mpi.h" // must be included before gensimcell.hpp
+#include "gensimcell.hpp"
+
+#include "background_magnetic_field.hpp"
+#include "particle/accumulate_dccrg.hpp"
+#include "particle/accumulation_variables.hpp"
+#include "particle/relative_position.hpp"
+#include "particle/solve_dccrg.hpp"
+#include "particle/variables.hpp"
+#include "variable_getter.hpp"
+
+
+using namespace pamhd::particle;
+
+// particles with cell relative single precision positions
+using Rel_Particle_Internal = Particle_Relative_T<float, Particle_ID>;
+using Rel_Particle_External = Particle_Relative_T<float, Particle_ID, Destination_Cell>;
+
+struct Rel_Particles_Internal {
+	using data_type = std::vector<Rel_Particle_Internal>;
+};
+struct Rel_Particles_External {
+	static bool is_stale;
+	using data_type = std::vector<Rel_Particle_External>;
+};
+bool Rel_Particles_External::is_stale = true;
+struct Rel_Nr_Particles_External {
+	static bool is_stale;
+	using data_type = uint64_t;
+};
+bool Rel_Nr_Particles_External::is_stale = true;
+
+//! mass accumulated from particles
+struct Accu_Mass {
+	using data_type = double;
+};
+using Accu_To_Cell = Accumulated_To_Cell_T<Accu_Mass>;
+using Accu_To_Cells = Accumulated_To_Cells_T<Accu_To_Cell>;
+
+using Cell = gensimcell::Cell<
+	gensimcell::Optional_Transfer,
+	pamhd::Cell_Type,
+	pamhd::Magnetic_Field,
+	Electric_Field,
+	Max_Spatial_Velocity,
+	Max_Angular_Velocity,
+	Nr_Particles_External,
+	Particles_Internal,
+	Particles_External,
+	Rel_Nr_Particles_External,
+	Rel_Particles_Internal,
+	Rel_Particles_External,
+	Accu_Mass,
+	Nr_Accumulated_To_Cells,
+	Accu_To_Cells
+>;
+using Grid = dccrg::Dccrg<
+	Cell,
+	dccrg::Cartesian_Geometry,
+	std::tuple<>,
+	std::tuple<Is_Local>
+>;
+
+const auto Vol_B = pamhd::Variable_Getter<pamhd::Magnetic_Field>();
+bool pamhd::Magnetic_Field::is_stale = true;
+const auto Ele = pamhd::Variable_Getter<Electric_Field>();
+bool Electric_Field::is_stale = true;
+const auto CType = pamhd::Variable_Getter<pamhd::Cell_Type>();
+bool pamhd::Cell_Type::is_stale = true;
+const auto Max_v_part = pamhd::Variable_Getter<Max_Spatial_Velocity>();
+bool Max_Spatial_Velocity::is_stale = true;
+const auto Max_ω_part = pamhd::Variable_Getter<Max_Angular_Velocity>();
+bool Max_Angular_Velocity::is_stale = true;
+const auto Nr_Ext = pamhd::Variable_Getter<Nr_Particles_External>();
+bool Nr_Particles_External::is_stale = true;
+const auto Part_Ext = pamhd::Variable_Getter<Particles_External>();
+bool Particles_External::is_stale = true;
+const auto Rel_Nr_Ext = pamhd::Variable_Getter<Rel_Nr_Particles_External>();
+const auto Rel_Part_Ext = pamhd::Variable_Getter<Rel_Particles_External>();
+const auto Mass_Cell = pamhd::Variable_Getter<Accu_Mass>();
+
+const auto Part_Int = [](Cell& cell_data)->auto& {
+	return cell_data[Particles_Internal()];
+};
+const auto Rel_Part_Int = [](Cell& cell_data)->auto& {
+	return cell_data[Rel_Particles_Internal()];
+};
+// same for both types of particles except position
+const auto Part_Pos = [](auto& particle)->auto& {
+	return particle[Position()];
+};
+const auto Rel_Part_Pos = [](auto& particle)->auto& {
+	return particle[Relative_Position_T<float>()];
+};
+const auto Part_Vel = [](auto& particle)->auto& {
+	return particle[Velocity()];
+};
+const auto Part_C2M = [](auto& particle)->auto& {
+	return particle[Charge_Mass_Ratio()];
+};
+const auto Part_Mas = [](auto& particle)->auto& {
+	return particle[Mass()];
+};
+const auto Part_Des = [](auto& particle)->auto& {
+	return particle[Destination_Cell()];
+};
+
+
+//! Propagates and exchanges particles of given type by one step.
+template<
+	class Nr_Ext_T,
+	class Part_Int_T,
+	class Part_Ext_T,
+	class Part_Int_Getter,
+	class Part_Ext_Getter,
+	class Nr_Ext_Getter,
+	class Part_Pos_Getter
+> void step(
+	Grid& grid,
+	const Part_Int_Getter& PInt,
+	const Part_Ext_Getter& PExt,
+	const Nr_Ext_Getter& NExt,
+	const Part_Pos_Getter& PPos
+) {
+	const pamhd::Background_Magnetic_Field<double, std::array<double, 3>> bg_B;
+	for (const auto& cells: {grid.outer_cells(), grid.inner_cells()}) {
+		solve(
+			1.0, cells, grid, bg_B, 1, false, Ele, Vol_B,
+			NExt, PInt, PExt, Max_v_part, Max_ω_part,
+			PPos, Part_Vel, Part_C2M, Part_Mas, Part_Des, CType
+		);
+	}
+
+	Cell::set_transfer_all(true, Nr_Ext_T());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Nr_Ext_T());
+	resize_receiving_containers<Nr_Ext_T, Part_Ext_T>(grid.remote_cells(), grid);
+
+	Cell::set_transfer_all(true, Part_Ext_T());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Part_Ext_T());
+
+	incorporate_external_particles<
+		Nr_Ext_T, Part_Int_T, Part_Ext_T, Destination_Cell
+	>(grid.local_cells(), grid);
+	remove_external_particles<Nr_Ext_T, Part_Ext_T>(grid.local_cells(), grid);
+	remove_external_particles<Nr_Ext_T, Part_Ext_T>(grid.remote_cells(), grid);
+}
+
+
+//! Accumulates mass of particles of given type into Accu_Mass.
+template<
+	class Part_Int_Getter,
+	class Part_Pos_Getter
+> void accumulate_mass(
+	Grid& grid,
+	const Part_Int_Getter& PInt,
+	const Part_Pos_Getter& PPos
+) {
+	for (const auto& cell: grid.local_cells()) {
+		Mass_Cell.data(*cell.data) = 0;
+	}
+	accumulate(
+		grid.local_cells(), grid, PInt, PPos,
+		[](Cell&, auto& particle)->auto& {
+			return particle[Mass()];
+		},
+		Mass_Cell,
+		[](Accu_To_Cell& item)->auto& {
+			return item[Accu_Mass()];
+		},
+		[](Accu_To_Cell& item)->auto& {
+			return item[Target()];
+		},
+		[](Cell& cell_data)->auto& {
+			return cell_data[Nr_Accumulated_To_Cells()];
+		},
+		[](Cell& cell_data)->auto& {
+			return cell_data[Accu_To_Cells()];
+		},
+		CType
+	);
+
+	Cell::set_transfer_all(true, Nr_Accumulated_To_Cells());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Nr_Accumulated_To_Cells());
+
+	allocate_accumulation_lists(
+		grid,
+		[](Cell& cell_data)->auto& {
+			return cell_data[Accu_To_Cells()];
+		},
+		[](Cell& cell_data)->auto& {
+			return cell_data[Nr_Accumulated_To_Cells()];
+		}
+	);
+
+	Cell::set_transfer_all(true, Accu_To_Cells());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, Accu_To_Cells());
+
+	accumulate_from_remote_neighbors(
+		grid,
+		Mass_Cell,
+		[](Accu_To_Cell& item)->auto& {
+			return item[Accu_Mass()];
+		},
+		[](Accu_To_Cell& item)->auto& {
+			return item[Target()];
+		},
+		[](Cell& cell_data)->auto& {
+			return cell_data[Accu_To_Cells()];
+		},
+		CType
+	);
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		std::cerr << "Zoltan_Initialize failed." << std::endl;
+		abort();
+	}
+
+	constexpr uint64_t nr_cells = 10;
+	Grid grid;
+	grid
+		.set_initial_length({nr_cells, 1, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RANDOM")
+		.set_periodic(true, false, false)
+		.initialize(comm)
+		.balance_load();
+
+	// far from origin so that float absolute positions would fail
+	dccrg::Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{1e9, 0, 0}};
+	geom_params.level_0_cell_length = {{1, 1, 1}};
+	grid.set_geometry(geom_params);
+
+	// identical particles with absolute and relative positions
+	constexpr std::array<double, 3>
+		start_x{0.1, 0.5, 0.9},
+		velocity_x{0.3, 0.7, -0.45};
+	for (const auto& cell: grid.local_cells()) {
+		CType.data(*cell.data) = 1;
+		Ele.data(*cell.data) =
+		Vol_B.data(*cell.data) = {0, 0, 0};
+
+		const auto
+			cell_min = grid.geometry.get_min(cell.id),
+			cell_length = grid.geometry.get_length(cell.id);
+		for (size_t i = 0; i < start_x.size(); i++) {
+			Particle_Internal particle;
+			Part_Pos(particle) = {
+				cell_min[0] + start_x[i] * cell_length[0],
+				cell_min[1] + 0.5 * cell_length[1],
+				cell_min[2] + 0.5 * cell_length[2]
+			};
+			Part_Vel(particle) = {velocity_x[i], 0, 0};
+			Part_Mas(particle) = double(cell.id) + i;
+			Part_C2M(particle) = 0;
+			particle[Particle_ID()] = 10 * cell.id + i;
+			Part_Int(*cell.data).push_back(particle);
+
+			Rel_Particle_Internal rel_particle;
+			Rel_Part_Pos(rel_particle) = get_relative_position<float>(
+				Part_Pos(particle), cell_min, cell_length);
+			Part_Vel(rel_particle) = Part_Vel(particle);
+			Part_Mas(rel_particle) = Part_Mas(particle);
+			Part_C2M(rel_particle) = 0;
+			rel_particle[Particle_ID()] = particle[Particle_ID()];
+			Rel_Part_Int(*cell.data).push_back(rel_particle);
+		}
+	}
+	Cell::set_transfer_all(true, pamhd::Cell_Type());
+	grid.update_copies_of_remote_neighbors();
+	Cell::set_transfer_all(false, pamhd::Cell_Type());
+
+	for (size_t step_i = 0; step_i < 12; step_i++) {
+		step<Nr_Particles_External, Particles_Internal, Particles_External>(
+			grid, Part_Int, Part_Ext, Nr_Ext, Part_Pos);
+		step<Rel_Nr_Particles_External, Rel_Particles_Internal, Rel_Particles_External>(
+			grid, Rel_Part_Int, Rel_Part_Ext, Rel_Nr_Ext, Rel_Part_Pos);
+
+		// same particles in same cells at same positions
+		for (const auto& cell: grid.local_cells()) {
+			if (Part_Int(*cell.data).size() != Rel_Part_Int(*cell.data).size()) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): "
+					<< "Different number of particles in cell " << cell.id
+					<< " at step " << step_i << ": "
+					<< Part_Int(*cell.data).size() << ", "
+					<< Rel_Part_Int(*cell.data).size() << std::endl;
+				abort();
+			}
+			const auto
+				cell_min = grid.geometry.get_min(cell.id),
+				cell_length = grid.geometry.get_length(cell.id);
+
+			std::map<uint64_t, double> abs_x;
+			for (auto& particle: Part_Int(*cell.data)) {
+				abs_x[particle[Particle_ID()]] = Part_Pos(particle)[0];
+			}
+			for (auto& particle: Rel_Part_Int(*cell.data)) {
+				if (not is_inside_cell(Rel_Part_Pos(particle))) {
+					std::cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Particle " << particle[Particle_ID()]
+						<< " outside of cell " << cell.id << std::endl;
+					abort();
+				}
+				const auto id = particle[Particle_ID()];
+				if (abs_x.count(id) == 0) {
+					std::cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Particle " << id << " in wrong cell: "
+						<< cell.id << std::endl;
+					abort();
+				}
+				const auto pos = get_absolute_position(
+					Rel_Part_Pos(particle), cell_min, cell_length);
+				if (std::fabs(pos[0] - abs_x.at(id)) > 1e-5 * cell_length[0]) {
+					std::cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Particle " << id << " at " << pos[0]
+						<< " instead of " << abs_x.at(id) << std::endl;
+					abort();
+				}
+			}
+		}
+	}
+
+	// accumulation gives same result for both
+	accumulate_mass(grid, Part_Int, Part_Pos);
+	std::map<uint64_t, double> abs_mass;
+	for (const auto& cell: grid.local_cells()) {
+		abs_mass[cell.id] = Mass_Cell.data(*cell.data);
+	}
+	accumulate_mass(grid, Rel_Part_Int, Rel_Part_Pos);
+	double local_mass = 0, total_mass = 0;
+	for (const auto& cell: grid.local_cells()) {
+		const auto mass = Mass_Cell.data(*cell.data);
+		local_mass += mass;
+		if (std::fabs(mass - abs_mass.at(cell.id)) > 1e-4 * abs_mass.at(cell.id)) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Accumulated mass in cell " << cell.id << ": "
+				<< mass << " instead of " << abs_mass.at(cell.id) << std::endl;
+			abort();
+		}
+	}
+	MPI_Allreduce(&local_mass, &total_mass, 1, MPI_DOUBLE, MPI_SUM, comm);
+	// sum of cell.id + i over all particles
+	const double expected_mass
+		= start_x.size() * nr_cells * (nr_cells + 1) / 2
+		+ nr_cells * (0 + 1 + 2);
+	if (std::fabs(total_mass - expected_mass) > 1e-6 * expected_mass) {
+		std::cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Total accumulated mass " << total_mass
+			<< " instead of " << expected_mass << std::endl;
+		abort();
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -33,6 +33,7 @@ Author(s): Ilja Honkonen
 #include "random"
 #include "streambuf"
 #include "string"
+#include "tuple"
 #include "vector"
 
 #include "boost/filesystem.hpp"
@@ -69,15 +70,19 @@ Author(s): Ilja Honkonen
 #include "mhd/solve.hpp"
 #include "mhd/variables.hpp"
 #include "particle/accumulate_dccrg.hpp"
+#include "particle/amr.hpp"
 #include "particle/boundaries.hpp"
 #include "particle/common.hpp"
 #include "particle/initialize.hpp"
+#include "particle/merger.hpp"
 #include "particle/options.hpp"
+#include "particle/random.hpp"
 #include "particle/save.hpp"
 #include "particle/solar_wind_box.hpp"
 #include "particle/solve_dccrg.hpp"
 #include "particle/splitter.hpp"
 #include "particle/variables.hpp"
+#include "reductions.hpp"
 #include "simulation_options.hpp"
 #include "solar_wind_box_options.hpp"
 #include "variable_getter.hpp"
@@ -619,7 +624,8 @@ int main(int argc, char* argv[]) {
 	double
 		simulation_time = options_sim.time_start,
 		next_mhd_save = options_mhd.save_n,
-		next_particle_save = options_particle.save_n;
+		next_particle_save = options_particle.save_n,
+		next_amr = options_grid.amr_n;
 
 	if (rank == 0) {
 		cout << "Initializing... " << endl;
@@ -634,7 +640,7 @@ int main(int argc, char* argv[]) {
 		options_sim.vacuum_permeability,
 		options_sim.proton_mass
 	);
-	std::mt19937_64 random_source;
+	pamhd::particle::Counter_Random_Source random_source;
 	uint64_t next_particle_id = pamhd::particle::initialize_plasma(
 		grid, simulation_time, options_sim, options_box,
 		options_particle, random_source, Part_Int
@@ -663,6 +669,7 @@ int main(int argc, char* argv[]) {
 		simulation_step,
 		grid,
 		simulation_time,
+		0.0,
 		options_sim,
 		options_box,
 		options_particle,
@@ -705,7 +712,8 @@ int main(int argc, char* argv[]) {
 		Substep_Max, Max_v_wave, Face_B, background_B,
 		mhd_solver, Timestep, 0,
 		options_mhd.time_step_factor,
-		options_particle.gyroperiod_time_step_factor
+		options_particle.gyroperiod_time_step_factor,
+		options_particle.max_orbit_subcycles
 	);
 	if (rank == 0) {
 		cout << "done" << endl;
@@ -761,6 +769,10 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
+	// per step global values
+	pamhd::Reductions reductions;
+	reductions.set(comm);
+
 	while (simulation_time < time_end) {
 		simulation_step++;
 
@@ -795,42 +807,74 @@ int main(int argc, char* argv[]) {
 				Substep_Max, Max_v_wave, Face_B, background_B,
 				mhd_solver, Timestep, until_end,
 				options_mhd.time_step_factor,
-				options_particle.gyroperiod_time_step_factor
+				options_particle.gyroperiod_time_step_factor,
+				options_particle.max_orbit_subcycles
 			);
 
-		if (rank == 0) {
-			cout << "Solution calculated at time " << simulation_time
-				<< " s, timestep " << dt << " s" << flush;
-		}
-
+		const double solved_time = simulation_time;
 		simulation_time += dt;
 
-		const auto avg_div = pamhd::math::get_divergence_face2volume(
+		// reduced with split counts during grid adaptation and boundaries
+		const auto local_div = pamhd::math::get_local_divergence_face2volume(
 			grid.local_cells(), grid,
 			Face_B, Div_B, CType
 		);
-		if (rank == 0) {
-			cout << ", average divergence " << avg_div;
-		}
 
-		const uint64_t splits_local = pamhd::particle::split_particles(
-			options_particle.min_particles, random_source,
-			grid, Part_Int, Part_Pos, Part_Mas, CType
-		);
-		uint64_t splits_global = 0;
-		if (MPI_Reduce(
-			&splits_local, &splits_global, 1,
-			MPI_UINT64_T, MPI_SUM, 0, comm
-		) != MPI_SUCCESS) {
-			std::cerr << __FILE__ "(" << __LINE__
-				<< "): Couldn't reduce max substep." << std::endl;
-			abort();
-		}
-		if (rank == 0) {
-			if (splits_global > 0) {
-				cout << ", " << splits_global << " particle(s) split" << endl;
-			} else {
-				cout << endl;
+		const std::array<uint64_t, 2> splits_merges_local{
+			pamhd::particle::split_particles(
+				options_particle.min_particles, random_source, simulation_step,
+				grid, Part_Int, Part_Pos, Part_Mas, CType
+			),
+			pamhd::particle::merge_particles(
+				options_particle.max_particles, grid, Part_Int,
+				Part_Pos, Part_Mas, Part_Vel, Part_SpM, Part_C2M, CType
+			)
+		};
+		const auto
+			div_i = reductions.add_sum(local_div.first),
+			div_cells_i = reductions.add_sum(local_div.second),
+			splits_i = reductions.add_sum(splits_merges_local[0]),
+			merges_i = reductions.add_sum(splits_merges_local[1]);
+		reductions.start();
+
+		if (options_grid.amr_n > 0 and simulation_time >= next_amr) {
+			if (rank == 0) {
+				cout << "Adapting grid at time " << simulation_time << "..." << flush;
+			}
+			next_amr
+				+= options_grid.amr_n
+				* ceil((simulation_time - next_amr) / options_grid.amr_n);
+
+			// fluid is accumulated from particles on next step
+			pamhd::grid::set_minmax_refinement_level_sw_box(
+				options_grid, options_box, simulation_time,
+				grid, Ref_max, Ref_min
+			);
+			pamhd::particle::adapt_grid(
+				grid, background_B, options_sim.vacuum_permeability,
+				Face_B, Vol_B, Bg_B, Ref_min, Ref_max, Part_Int, Part_Pos
+			);
+			std::tie(
+				solar_wind_cells, face_cells,
+				edge_cells, vert_cells, planet_cells
+			) = pamhd::grid::classify_cells_sw_box(options_box, grid, CType);
+			for (const auto& cell: grid.local_cells()) {
+				(*cell.data)[pamhd::MPI_Rank()] = rank;
+				Substep.data(*cell.data)     =
+				Substep_Max.data(*cell.data) =
+				Substep_Min.data(*cell.data) = 1;
+				Max_v_wave.data(*cell.data) = {-1, -1, -1, -1, -1, -1};
+				Max_v_part.data(*cell.data) =
+				Max_ω_part.data(*cell.data) = -1;
+			}
+			Max_v_wave.type().is_stale = true;
+			Max_v_part.type().is_stale = true;
+			Max_ω_part.type().is_stale = true;
+			Substep.type().is_stale = true;
+			Substep_Max.type().is_stale = true;
+			Substep_Min.type().is_stale = true;
+			if (rank == 0) {
+				cout << " done" << endl;
 			}
 		}
 
@@ -847,6 +891,7 @@ int main(int argc, char* argv[]) {
 			simulation_step,
 			grid,
 			simulation_time,
+			dt,
 			options_sim,
 			options_box,
 			options_particle,
@@ -860,6 +905,23 @@ int main(int argc, char* argv[]) {
 			CType
 		);
 
+		const auto
+			div_cells = reductions.get(div_cells_i),
+			splits = reductions.get(splits_i),
+			merges = reductions.get(merges_i);
+		if (rank == 0) {
+			cout << "Solution calculated at time " << solved_time
+				<< " s, timestep " << dt << " s, average divergence "
+				<< (div_cells > 0 ? reductions.get(div_i) / div_cells : 0.0);
+			if (splits > 0) {
+				cout << ", " << uint64_t(splits) << " particle(s) split";
+			}
+			if (merges > 0) {
+				cout << ", " << uint64_t(merges) << " particle(s) merged";
+			}
+			cout << endl;
+		}
+
 		if (
 			(options_particle.save_n >= 0 and simulation_time >= time_end)
 			or (options_particle.save_n > 0 and simulation_time >= next_particle_save)
@@ -46,6 +46,7 @@ Author(s): Ilja Honkonen
 #include "boundaries/geometries.hpp"
 #include "boundaries/multivariable_boundaries.hpp"
 #include "boundaries/multivariable_initial_conditions.hpp"
+#include "boundaries/sparse_cell_data.hpp"
 #include "common_variables.hpp"
 #include "grid/options.hpp"
 #include "grid/variables.hpp"
@@ -67,7 +68,9 @@ Author(s): Ilja Honkonen
 #include "particle/boundaries.hpp"
 #include "particle/common.hpp"
 #include "particle/initialize.hpp"
+#include "particle/merger.hpp"
 #include "particle/options.hpp"
+#include "particle/random.hpp"
 #include "particle/save.hpp"
 #include "particle/solve_dccrg.hpp"
 #include "particle/splitter.hpp"
@@ -196,24 +199,27 @@ const auto Nr_Int = [](Cell& cell_data)->auto& {
 	return cell_data[pamhd::particle::Nr_Particles_Internal()];
 };
 // references to initial condition & boundary data of cell
-const auto Bdy_N = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Number_Density()];
-};
-const auto Bdy_V = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Velocity()];
-};
-const auto Bdy_T = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Temperature()];
-};
-const auto Bdy_Nr_Par = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Nr_Particles_In_Cell()];
-};
-const auto Bdy_SpM = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Species_Mass()];
-};
-const auto Bdy_C2M = [](Cell& cell_data)->auto& {
-	return cell_data[pamhd::particle::Bdy_Charge_Mass_Ratio()];
-};
+pamhd::boundaries::Sparse_Cell_Data<
+	Cell,
+	pamhd::particle::Bdy_Number_Density,
+	pamhd::particle::Bdy_Velocity,
+	pamhd::particle::Bdy_Temperature,
+	pamhd::particle::Bdy_Species_Mass,
+	pamhd::particle::Bdy_Charge_Mass_Ratio,
+	pamhd::particle::Bdy_Nr_Particles_In_Cell
+> particle_bdy_data;
+const auto Bdy_N
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Number_Density>();
+const auto Bdy_V
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Velocity>();
+const auto Bdy_T
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Temperature>();
+const auto Bdy_Nr_Par
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Nr_Particles_In_Cell>();
+const auto Bdy_SpM
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Species_Mass>();
+const auto Bdy_C2M
+	= particle_bdy_data.getter<pamhd::particle::Bdy_Charge_Mass_Ratio>();
 
 // given a particle these return references to particle's parameters
 const auto Part_Pos = [](
@@ -457,7 +463,8 @@ int main(int argc, char* argv[]) {
 		geometry_id_t,
 		std::array<double, 3>,
 		double,
-		uint64_t
+		uint64_t,
+		Cell
 	> geometries;
 	geometries.set(document);
 
@@ -592,6 +599,8 @@ int main(int argc, char* argv[]) {
 		.set_load_balancing_method(options_sim.lb_name.c_str())
 		.set_maximum_refinement_level(0)
 		.initialize(comm);
+	// boundary data until boundary cells are known
+	particle_bdy_data.allocate(grid);
 
 	// set grid geometry
 	const std::array<double, 3>
@@ -633,15 +642,7 @@ int main(int argc, char* argv[]) {
 		Substep_Max.type(), pamhd::MPI_Rank());
 
 	// assign cells into boundary geometries
-	for (const auto& gid: geometries.get_geometry_ids()) {
-		geometries.clear_cells(gid);
-	}
-	for (const auto& cell: grid.local_cells()) {
-		geometries.overlaps(
-			grid.geometry.get_min(cell.id),
-			grid.geometry.get_max(cell.id),
-			cell.id);
-	}
+	geometries.classify(grid, grid.local_cells());
 
 	/*
 	Simulate
@@ -683,7 +684,7 @@ int main(int argc, char* argv[]) {
 	);
 
 	// particles
-	std::mt19937_64 random_source;
+	pamhd::particle::Counter_Random_Source random_source;
 
 	unsigned long long int nr_particles_created = 0;
 	for (auto& init_cond_part: initial_conditions_particles) {
@@ -749,6 +750,8 @@ int main(int argc, char* argv[]) {
 			Bdy_C2M
 		);
 	next_particle_id += nr_particles_created * grid.get_comm_size();
+	// initial condition is done, boundaries only need their own cells
+	particle_bdy_data.retain(grid, geometries);
 
 	try {
 		pamhd::particle::accumulate_mhd_data(
@@ -873,7 +876,8 @@ int main(int argc, char* argv[]) {
 		Face_dB, Bg_B, Mas_f, Mom_f, Nrj_f, Mag_f, Substep,
 		Substep_Min, Substep_Max, Max_v_wave, Face_B, background_B,
 		mhd_solver, Timestep, 0, options_mhd.time_step_factor,
-		options_particle.gyroperiod_time_step_factor
+		options_particle.gyroperiod_time_step_factor,
+		options_particle.max_orbit_subcycles
 	);
 	if (rank == 0) {
 		cout << "done" << endl;
@@ -967,7 +971,8 @@ int main(int argc, char* argv[]) {
 				Substep_Min, Substep_Max, Max_v_wave, Face_B, background_B,
 				mhd_solver, Timestep, until_end,
 				options_mhd.time_step_factor,
-				options_particle.gyroperiod_time_step_factor
+				options_particle.gyroperiod_time_step_factor,
+				options_particle.max_orbit_subcycles
 			);
 
 		if (rank == 0) {
@@ -1029,9 +1034,13 @@ int main(int argc, char* argv[]) {
 		}
 
 		pamhd::particle::split_particles(
-			options_particle.min_particles, random_source,
+			options_particle.min_particles, random_source, simulation_step,
 			grid, Part_Int, Part_Pos, Part_Mas, CType
 		);
+		pamhd::particle::merge_particles(
+			options_particle.max_particles, grid, Part_Int,
+			Part_Pos, Part_Mas, Part_Vel, Part_SpM, Part_C2M, CType
+		);
 
 		nr_particles_created += pamhd::particle::apply_boundaries<
 			pamhd::particle::Particle_Internal,
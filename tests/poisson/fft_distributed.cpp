@@ -0,0 +1,193 @@
+/*
+Tests distributed FFT Poisson solver of PAMHD.
+
+Copyright 2026 Finnish Meteorological Institute
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+* Neither the names of the copyright holders nor the names of their contributors
+  may be used to endorse or promote products derived from this software
+  without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "array"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "vector"
+
+#include "mpi.h"
+
+#include "poisson/fft_solver.hpp"
+#include "poisson/solver.hpp"
+
+
+//! Returns div(grad(phi)) with central differences
+std::vector<double> get_central_laplacian(
+	const std::array<uint64_t, 3>& grid_size,
+	const std::array<double, 3>& cell_length,
+	const std::vector<double>& phi
+) {
+	std::vector<double> result(phi.size(), 0);
+	for (uint64_t z = 0; z < grid_size[2]; z++) {
+	for (uint64_t y = 0; y < grid_size[1]; y++) {
+	for (uint64_t x = 0; x < grid_size[0]; x++) {
+		const std::array<uint64_t, 3> index{x, y, z};
+		const auto cell = pamhd::poisson::map_3_to_1(x, y, z, grid_size[0], grid_size[1]);
+		for (size_t dim = 0; dim < 3; dim++) {
+			auto neg = index, pos = index;
+			neg[dim] = pamhd::poisson::wrap(index[dim], -2, grid_size[dim]);
+			pos[dim] = pamhd::poisson::wrap(index[dim], +2, grid_size[dim]);
+			result[cell] += (
+				phi[pamhd::poisson::map_3_to_1(pos[0], pos[1], pos[2], grid_size[0], grid_size[1])]
+				- 2 * phi[cell]
+				+ phi[pamhd::poisson::map_3_to_1(neg[0], neg[1], neg[2], grid_size[0], grid_size[1])]
+			) / (4 * cell_length[dim] * cell_length[dim]);
+		}
+	}}}
+	return result;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		std::cerr << "Couldn't initialize MPI." << std::endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	if (MPI_Comm_rank(comm, &rank) != MPI_SUCCESS) {
+		std::cerr << "Couldn't obtain MPI rank." << std::endl;
+		abort();
+	}
+	if (MPI_Comm_size(comm, &comm_size) != MPI_SUCCESS) {
+		std::cerr << "Couldn't obtain size of MPI communicator." << std::endl;
+		abort();
+	}
+
+	const std::array<double, 3> cell_length{0.1, 0.2, 0.3};
+
+	// mixed radix, prime and 1 cell dimensions
+	for (const auto& grid_size: {
+		std::array<uint64_t, 3>{8, 8, 8},
+		std::array<uint64_t, 3>{30, 12, 10},
+		std::array<uint64_t, 3>{37, 1, 6},
+		std::array<uint64_t, 3>{1, 1, 64}
+	}) {
+		const uint64_t nr_cells = grid_size[0] * grid_size[1] * grid_size[2];
+
+		std::vector<double> phi(nr_cells);
+		for (uint64_t cell = 0; cell < nr_cells; cell++) {
+			phi[cell] = std::sin(double(cell * cell % 101));
+		}
+		const auto rhs_central = get_central_laplacian(grid_size, cell_length, phi);
+
+		std::vector<double> rhs_compact(nr_cells);
+		double average = 0;
+		for (uint64_t cell = 0; cell < nr_cells; cell++) {
+			rhs_compact[cell] = std::cos(double(cell * cell % 103));
+			average += rhs_compact[cell];
+		}
+		for (auto& rhs: rhs_compact) {
+			rhs -= average / nr_cells;
+		}
+		const auto reference = pamhd::poisson::solve_fft(
+			grid_size[0], grid_size[1], grid_size[2],
+			cell_length[0], cell_length[1], cell_length[2],
+			rhs_compact
+		);
+
+		// scatter cells between processes
+		std::vector<uint64_t> cells;
+		std::vector<std::array<uint64_t, 3>> indices;
+		std::vector<double> local_central, local_compact;
+		for (uint64_t cell = 0; cell < nr_cells; cell++) {
+			if (int(cell * 7919 % comm_size) != rank) {
+				continue;
+			}
+			cells.push_back(cell);
+			indices.push_back({
+				cell % grid_size[0],
+				cell / grid_size[0] % grid_size[1],
+				cell / grid_size[0] / grid_size[1]
+			});
+			local_central.push_back(rhs_central[cell]);
+			local_compact.push_back(rhs_compact[cell]);
+		}
+
+		pamhd::poisson::FFT_Solver compact, central;
+		compact.set(comm, grid_size, cell_length, indices, false);
+		central.set(comm, grid_size, cell_length, indices, true);
+
+		std::vector<double> compact_solution, central_solution;
+		compact.solve(local_compact, compact_solution);
+		central.solve(local_central, central_solution);
+
+		// gather central solution to check it against operator
+		std::vector<double> central_phi(nr_cells, 0);
+		double compact_error = 0;
+		for (size_t i = 0; i < cells.size(); i++) {
+			central_phi[cells[i]] = central_solution[i];
+			compact_error = std::max(
+				compact_error,
+				std::fabs(compact_solution[i] - reference[cells[i]])
+			);
+		}
+		MPI_Allreduce(MPI_IN_PLACE, central_phi.data(), int(nr_cells), MPI_DOUBLE, MPI_SUM, comm);
+		MPI_Allreduce(MPI_IN_PLACE, &compact_error, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+		if (compact_error > 1e-10) {
+			std::cerr <<  __FILE__ << "(" << __LINE__ << "): "
+				<< "Solution differs from serial one by " << compact_error
+				<< " in grid of size " << grid_size[0]
+				<< " " << grid_size[1] << " " << grid_size[2]
+				<< std::endl;
+			abort();
+		}
+
+		const auto central_rhs = get_central_laplacian(grid_size, cell_length, central_phi);
+		double central_error = 0;
+		for (uint64_t cell = 0; cell < nr_cells; cell++) {
+			central_error = std::max(
+				central_error,
+				std::fabs(central_rhs[cell] - rhs_central[cell])
+			);
+		}
+		if (central_error > 1e-9) {
+			std::cerr <<  __FILE__ << "(" << __LINE__ << "): "
+				<< "Residual of central solution too large: " << central_error
+				<< " in grid of size " << grid_size[0]
+				<< " " << grid_size[1] << " " << grid_size[2]
+				<< std::endl;
+			abort();
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}